@@ -1,5 +1,18 @@
 #include "Application.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+// The simulation advances in fixed steps of this length, whatever the frame rate
+static const double SIMULATION_STEP_SECONDS = 1.0 / 60.0;
+
+// The instance buffer is made before the scene is loaded, and grows to fit the belt the first
+// time it is drawn, so this is only where it starts
+static const int INITIAL_INSTANCE_CAPACITY = 256;
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	PAINTSTRUCT ps;
@@ -16,6 +29,20 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		PostQuitMessage(0);
 		break;
 
+	// Keys are queued here and only applied at the start of the next frame
+	case WM_KEYDOWN:
+	case WM_KEYUP:
+	case WM_KILLFOCUS:
+	{
+		Application* application = reinterpret_cast<Application*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+		if (application)
+			application->HandleInput(message, wParam, lParam);
+
+		if (message == WM_KILLFOCUS)
+			return DefWindowProc(hWnd, message, wParam, lParam);
+		break;
+	}
+
 	default:
 		return DefWindowProc(hWnd, message, wParam, lParam);
 	}
@@ -36,13 +63,45 @@ Application::Application()
 	_pVertexShader = nullptr;
 	_pPixelShader = nullptr;
 	_pVertexLayout = nullptr;
+	_pInstancedVertexShader = nullptr;
+	_pInstancedVertexLayout = nullptr;
+	_pQuantisedVertexShader = nullptr;
+	_pInstancedQuantisedVertexShader = nullptr;
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		_pQuantisedVertexLayouts[i] = nullptr;
+		_pInstancedQuantisedVertexLayouts[i] = nullptr;
+	}
+	_bodyVertexFormat = VERTEX_FORMAT_SIMPLE;
+	_scenePath = L"SolarSystem.scene";
 	_pVertexBuffer = nullptr;
 	_pIndexBuffer = nullptr;
-	_pConstantBuffer = nullptr;
+	_reportFrameCount = 0;
+	_reportBytesUploaded = 0;
+	_reportBytesCombined = 0;
+	_reportSimulationSteps = 0;
+	_reportSimulationSeconds = 0.0;
+	_reportTriangles = 0;
+	_reportFullDetailTriangles = 0;
+	_reportProfileStart = Profiler::Now();
+	_simulationClock.SetStepSeconds(SIMULATION_STEP_SECONDS);
 }
 
 Application::~Application()
 {
+	if (!_recordingPath.empty())
+	{
+		_input.StopRecording();
+		ofstream recording(_recordingPath);
+		InputSystem::SaveRecording(recording, _input.GetRecording());
+	}
+
+	if (!_tracePath.empty())
+	{
+		ofstream trace(_tracePath);
+		Profiler::WriteChromeTrace(trace, Profiler::Collect());
+	}
+
 	Cleanup();
 }
 
@@ -73,26 +132,69 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	// The VBOffset is just the index of the vertex buffer array, so we want to start at the first element which is 0.
 	_meshData.VBOffset = 0;
 	_meshData.IndexCount = 36;
+	_meshData.IndexFormat = INDEX_FORMAT_16;
+	_meshData.VertexFormat = VERTEX_FORMAT_SIMPLE;
+	_meshData.Quantisation = PositionQuantisation();
+	CreateCubeGeometry().GetBounds(_meshData.BoundsCenter, _meshData.BoundsRadius);
 
-	_sun.Initialise(_meshData);
-	_planet1.Initialise(_meshData);
-	_planet2.Initialise(_meshData);
-	_moon1.Initialise(_meshData);
-	_moon2.Initialise(_meshData);
+	// Initialise mesh data for the plane
+	MeshData planeMeshData = _meshData;
+	planeMeshData.VertexBuffer = _pVertexBufferPlane;
+	planeMeshData.IndexBuffer = _pIndexBufferPlane;
+	CreatePlaneGeometry().GetBounds(planeMeshData.BoundsCenter, planeMeshData.BoundsRadius);
+
+	// The mesh file is only mapped while its buffers are created from it
+	MeshData bodyMeshData = _meshData;
+	if (!_bodyMeshPath.empty())
+	{
+		MeshFile bodyMesh;
+		if (!bodyMesh.Open(_bodyMeshPath.c_str()))
+		{
+			OutputDebugStringA(("Could not load the body mesh: " + bodyMesh.GetError() + "\n").c_str());
+		}
+		else if (FAILED(_renderDevice.CreateMesh(bodyMesh, bodyMeshData)))
+		{
+			OutputDebugStringA("The body mesh must have SimpleVertex vertices\n");
+			bodyMeshData = _meshData;
+		}
+	}
 
-	for (int i = 0; i < ASTEROID_COUNT; i++)
+	SceneFile scene;
+	if (!scene.Load(_scenePath.c_str()))
 	{
-		asteroidBelt[i] = _asteroid;
-		asteroidBelt[i].Initialise(_meshData);
+		OutputDebugStringA(("Could not load the scene: " + scene.GetError() + "\n").c_str());
+		Cleanup();
+
+		return E_FAIL;
 	}
 
-	srand(time(NULL));
+	// The scene's body mesh is the mesh file or the icospheres, and any other mesh it names the cube
+	vector<MeshData> sceneMeshes(scene.GetMeshCount(), _meshData);
+	int bodyMesh = scene.FindMesh("body");
+	if (bodyMesh >= 0)
+		sceneMeshes[bodyMesh] = bodyMeshData;
 
-	// Initialise mesh data for the plane
-	_meshData.VertexBuffer = _pVertexBufferPlane;
-	_meshData.IndexBuffer = _pIndexBufferPlane;
+	_solarSystem.Initialise(scene, sceneMeshes, planeMeshData);
+
+	// Without a mesh file the bodies are icospheres, drawn with the detail their size on screen needs
+	if (_bodyMeshPath.empty() && bodyMesh >= 0)
+	{
+		for (int subdivisions = SolarSystem::BODY_LOD_SUBDIVISIONS; subdivisions >= 0; subdivisions--)
+		{
+			MeshGeometry sphere = CreateIcosphereGeometry(subdivisions);
+			MeshData sphereMeshData;
+			if (FAILED(_renderDevice.CreateMesh(sphere, sphereMeshData, _bodyVertexFormat)))
+				break;
+
+			_bodyLodChain.AddLevel(sphere, sphereMeshData);
+		}
+
+		_solarSystem.SetMeshLodChain(bodyMesh, &_bodyLodChain);
+	}
+
+	_sceneRenderer.SetViewportHeight(_WindowHeight);
 
-	_plane.Initialise(_meshData);
+	srand(time(NULL));
 
 	// Initialise the lighting variables
 	lightDir = XMFLOAT3(0.25f, 0.5f, -1.0f);
@@ -107,11 +209,6 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	//XMStoreFloat4x4(&_moon1World, XMMatrixIdentity());
 	//XMStoreFloat4x4(&_moon2World, XMMatrixIdentity());
 
-	//for (int i = 0; i < ASTEROID_COUNT; i++)
-	//{
-	//	XMStoreFloat4x4(&_moon2World, XMMatrixIdentity());
-	//}
-
 	// Initialize the view matrix
 	//XMVECTOR Eye = XMVectorSet(0.0f, 6.5f, -20.0f, 0.0f);
 	//XMVECTOR At = XMVectorSet(0.0f, -3.0f, 0.0f, 0.0f);
@@ -199,86 +296,130 @@ HRESULT Application::InitShadersAndInputLayout()
 	// Set the input layout
 	_pImmediateContext->IASetInputLayout(_pVertexLayout);
 
-	return hr;
+	// Compile the instanced vertex shader
+	hr = CompileShaderFromFile(L"Lighting.fx", "VSInstanced", "vs_4_0", &pVSBlob);
+
+	if (FAILED(hr))
+	{
+		MessageBox(nullptr,
+			L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+		return hr;
+	}
+
+	// Create the instanced vertex shader
+	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pInstancedVertexShader);
+
+	if (FAILED(hr))
+	{
+		pVSBlob->Release();
+		return hr;
+	}
+
+	// The mesh comes from slot 0 as before, and each instance's world matrix from slot 1
+	D3D11_INPUT_ELEMENT_DESC instancedLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	// Create the instanced input layout
+	hr = _pd3dDevice->CreateInputLayout(instancedLayout, ARRAYSIZE(instancedLayout), pVSBlob->GetBufferPointer(),
+		pVSBlob->GetBufferSize(), &_pInstancedVertexLayout);
+	pVSBlob->Release();
+
+	if (FAILED(hr))
+		return hr;
+
+	return InitQuantisedShaders();
 }
 
-HRESULT Application::InitVertexBuffer()
+HRESULT Application::InitQuantisedShaders()
 {
 	HRESULT hr;
 
-
-	// Create vertex buffer for Cube 1
-	SimpleVertex vertices[] =
-	{	// Top Left - v0
-		{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT3(-1.0f, 1.0f, -1.0f) },
-		// Top right - v1		 
-		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, -1.0f) },
-		// Bottom left - v2		 
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, -1.0f, -1.0f) },
-		// Bottom right - v3	 
-		{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, -1.0f, -1.0f) },
-		// Top left Z=1 - v4
-		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(-1.0f, 1.0f, 1.0f) },
-		// Top right Z=1 - v5				  
-		{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) },
-		// Bottom left Z=1 - v6				  
-		{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT3(-1.0f, -1.0f, 1.0f) },
-		// Bottom right Z=1 - v7			  
-		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(1.0f, -1.0f, 1.0f) },
+	// The position is split in two since there is no three-component 16-bit format. Both
+	// formats are read by the same vertex shader, and only the normal's width differs.
+	D3D11_INPUT_ELEMENT_DESC layouts[VERTEX_FORMAT_COUNT][7] =
+	{
+		{},
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "POSITION", 1, DXGI_FORMAT_R16_UNORM, 0, 4, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		},
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "POSITION", 1, DXGI_FORMAT_R16_UNORM, 0, 4, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R8G8_SNORM, 0, 6, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		},
 	};
 
-	//SimpleVertex planeVertices[] =
-	//{	// Top Left - v0
-	//	{ XMFLOAT3(-1.0f, -0.9f, -1.0f), XMFLOAT3(-1.0f, -0.1f, -1.0f) },
-	//	// Top right - v1		 
-	//	{ XMFLOAT3(1.0f, -0.9f, -1.0f), XMFLOAT3(1.0f, -0.1f, -1.0f) },
-	//	// Bottom left - v2		 
-	//	{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, -1.0f, -1.0f) },
-	//	// Bottom right - v3	 
-	//	{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, -1.0f, -1.0f) },
-	//	// Top left Z=1 - v4
-	//	{ XMFLOAT3(-1.0f, -0.9f, 1.0f), XMFLOAT3(-1.0f, -0.9f, 1.0f) },
-	//	// Top right Z=1 - v5				  
-	//	{ XMFLOAT3(1.0f, -0.9f, 1.0f), XMFLOAT3(1.0f, -0.9f, 1.0f) },
-	//	// Bottom left Z=1 - v6				  
-	//	{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT3(-1.0f, -1.0f, 1.0f) },
-	//	// Bottom right Z=1 - v7			  
-	//	{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(1.0f, -1.0f, 1.0f) },
-	//};
-
-
-	SimpleVertex planeVertices[] =
-	{	// Top Left - v0
-		{ XMFLOAT3(-100.0f, -99.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Top right - v1		 
-		{ XMFLOAT3(100.0f, -99.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Bottom left - v2		 
-		{ XMFLOAT3(-100.0f, -100.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Bottom right - v3	 
-		{ XMFLOAT3(100.0f, -100.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Top left Z=1 - v4
-		{ XMFLOAT3(-100.0f, -99.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Top right Z=1 - v5				  
-		{ XMFLOAT3(100.0f, -99.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Bottom left Z=1 - v6				  
-		{ XMFLOAT3(-100.0f, -100.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-		// Bottom right Z=1 - v7			  
-		{ XMFLOAT3(100.0f, -100.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
-	};
+	// The instanced layouts add the world matrix rows from slot 1
+	for (int format = VERTEX_FORMAT_QUANTISED_12; format < VERTEX_FORMAT_COUNT; format++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			D3D11_INPUT_ELEMENT_DESC world = { "WORLD", (UINT)row, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, (UINT)(row * 16),
+				D3D11_INPUT_PER_INSTANCE_DATA, 1 };
+			layouts[format][3 + row] = world;
+		}
+	}
+
+	const char * entryPoints[2] = { "VSQuantised", "VSInstancedQuantised" };
+	ID3D11VertexShader** vertexShaders[2] = { &_pQuantisedVertexShader, &_pInstancedQuantisedVertexShader };
+	ID3D11InputLayout** inputLayouts[2] = { _pQuantisedVertexLayouts, _pInstancedQuantisedVertexLayouts };
+	UINT elementCounts[2] = { 3, 7 };
+
+	for (int shader = 0; shader < 2; shader++)
+	{
+		ID3DBlob* pVSBlob = nullptr;
+		hr = CompileShaderFromFile(L"Lighting.fx", entryPoints[shader], "vs_4_0", &pVSBlob);
+
+		if (FAILED(hr))
+			return hr;
+
+		hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, vertexShaders[shader]);
+
+		for (int format = VERTEX_FORMAT_QUANTISED_12; format < VERTEX_FORMAT_COUNT && SUCCEEDED(hr); format++)
+		{
+			hr = _pd3dDevice->CreateInputLayout(layouts[format], elementCounts[shader], pVSBlob->GetBufferPointer(),
+				pVSBlob->GetBufferSize(), &inputLayouts[shader][format]);
+		}
+
+		pVSBlob->Release();
+
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return S_OK;
+}
+
+HRESULT Application::InitVertexBuffer()
+{
+	HRESULT hr;
+
 
+	// The vertices for the cube and the plane
+	MeshGeometry cube = CreateCubeGeometry();
+	MeshGeometry plane = CreatePlaneGeometry();
 
 	//D3D11 buffer for Cube
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
 	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(SimpleVertex) * 8;
+	bd.ByteWidth = sizeof(SimpleVertex) * (UINT)cube.vertices.size();
 	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 
 	// Store the vertices for our cube
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = vertices;
+	InitData.pSysMem = cube.vertices.data();
 
 	// Create the Vertex Buffer for the solar system
 	hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &_pVertexBuffer);
@@ -287,7 +428,7 @@ HRESULT Application::InitVertexBuffer()
 		return hr;
 
 	// Store the vertices for our plane
-	InitData.pSysMem = planeVertices;
+	InitData.pSysMem = plane.vertices.data();
 
 	// Create the Vertex Buffer for the plane
 	hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &_pVertexBufferPlane);
@@ -303,73 +444,27 @@ HRESULT Application::InitIndexBuffer()
 {
 	HRESULT hr;
 
-	// Create index buffer for cube
-	WORD indices[] =
-	{
-		//Front
-		0, 1, 2,
-		2, 1, 3,
-		//Left Side
-		4, 0, 6,
-		6, 0, 2,
-		//Back
-		5, 4, 6,
-		5, 6, 7,
-		//Right Side
-		3, 1, 5,
-		3, 5, 7,
-		//Top
-		4, 5, 1,
-		4, 1, 0,
-		//Bottom
-		6, 3, 7,
-		6, 2, 3
-
-
-	};
-
-	// Create index buffer for plane
-	WORD planeIndices[] =
-	{
-		//Front
-		0, 1, 2,
-		2, 1, 3,
-		//Left Side
-		4, 0, 6,
-		6, 0, 2,
-		//Back
-		5, 4, 6,
-		5, 6, 7,
-		//Right Side
-		3, 1, 5,
-		3, 5, 7,
-		//Top
-		4, 5, 1,
-		4, 1, 0,
-		//Bottom
-		6, 3, 7,
-		6, 2, 3
-
-
-	};
+	// The indices for the cube and the plane
+	MeshGeometry cube = CreateCubeGeometry();
+	MeshGeometry plane = CreatePlaneGeometry();
 
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
 
 	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * 36;
+	bd.ByteWidth = sizeof(WORD) * (UINT)cube.indices.size();
 	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = indices;
+	InitData.pSysMem = cube.indices.data();
 	hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &_pIndexBuffer);
 
 	if (FAILED(hr))
 		return hr;
 
-	InitData.pSysMem = planeIndices;
+	InitData.pSysMem = plane.indices.data();
 	hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &_pIndexBufferPlane);
 
 	if (FAILED(hr))
@@ -408,6 +503,9 @@ HRESULT Application::InitWindow(HINSTANCE hInstance, int nCmdShow)
 	if (!_hWnd)
 		return E_FAIL;
 
+	// Lets WndProc pass the key messages on to this application
+	SetWindowLongPtr(_hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
 	ShowWindow(_hWnd, nCmdShow);
 
 	return S_OK;
@@ -585,99 +683,123 @@ HRESULT Application::InitDevice()
 	// Set primitive topology
 	_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Create the constant buffer
-	D3D11_BUFFER_DESC bd;
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(ConstantBuffer);
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.CPUAccessFlags = 0;
-	hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantBuffer);
+	// Create the constant buffers, and the instance buffer the asteroid belt is drawn from
+	hr = _renderDevice.Initialise(_pd3dDevice, _pImmediateContext, INITIAL_INSTANCE_CAPACITY);
 
 	if (FAILED(hr))
 		return hr;
 
+	// Give the render states their ids, so draws can refer to them in their sort keys
+	_renderDevice.RegisterRasterizerState(RS_SOLID, nullptr);
+	_renderDevice.RegisterRasterizerState(RS_WIREFRAME, _wireFrame);
+	_renderDevice.RegisterShader(SHADER_LIT, _pVertexShader, _pPixelShader, _pVertexLayout);
+	_renderDevice.RegisterShader(SHADER_INSTANCED, _pInstancedVertexShader, _pPixelShader, _pInstancedVertexLayout);
+
+	for (int format = VERTEX_FORMAT_QUANTISED_12; format < VERTEX_FORMAT_COUNT; format++)
+	{
+		_renderDevice.RegisterShaderVariant(SHADER_LIT, (MeshVertexFormat)format, _pQuantisedVertexShader, _pQuantisedVertexLayouts[format]);
+		_renderDevice.RegisterShaderVariant(SHADER_INSTANCED, (MeshVertexFormat)format, _pInstancedQuantisedVertexShader,
+			_pInstancedQuantisedVertexLayouts[format]);
+	}
+
 	return S_OK;
 }
 
-void Application::Input()
+void Application::Input(float elapsedSeconds)
 {
-	if (GetAsyncKeyState(0x57))
-	{
-		++upDown;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
-	}
+	PROFILE_ZONE("Application::Input");
+
+	_input.BeginFrame();
+	_viewController.Update(_input, elapsedSeconds);
+}
 
-	// Down
-	if (GetAsyncKeyState(0x53))
+void Application::HandleInput(UINT message, WPARAM wParam, LPARAM lParam)
+{
+	switch (message)
 	{
-		--upDown;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
-	}
+	case WM_KEYDOWN:
+		// Bit 30 is set for the repeats Windows sends while a key is held
+		if ((lParam & (1 << 30)) == 0)
+			_input.QueueEvent(INPUT_KEY_DOWN, (int)wParam);
+		break;
 
+	case WM_KEYUP:
+		_input.QueueEvent(INPUT_KEY_UP, (int)wParam);
+		break;
 
-	//Left
-	if (GetAsyncKeyState(0x41))
-	{
-		--leftRight;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
+	case WM_KILLFOCUS:
+		// The window won't see keys come up once it has lost focus
+		_input.QueueReleaseAll();
+		break;
 	}
+}
 
-	//Right
-	if (GetAsyncKeyState(0x44))
-	{
-		++leftRight;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
-	}
+void Application::RecordInput(const wstring& path)
+{
+	_recordingPath = path;
+	_input.StartRecording();
+}
 
-	//Back
-	if (GetAsyncKeyState(0x28))
-	{
-		++forwardBack;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
-	}
+bool Application::ReplayInput(const wstring& path)
+{
+	vector<InputEvent> events;
+	ifstream recording(path);
+	if (!InputSystem::LoadRecording(recording, events))
+		return false;
 
-	//Forward
-	if (GetAsyncKeyState(0x26))
-	{
-		--forwardBack;
-		//Eye = XMVectorSet(0.0f, up * elapsed, -10.0f, 0.0f);
-		Sleep(sleepTime);
-	}
+	_input.StartReplay(events);
+	return true;
+}
 
-	if (GetAsyncKeyState(VK_RETURN))
-	{
-		WFMode = !WFMode;
-		Sleep(sleepTime);
-	}
+void Application::TraceProfile(const wstring& path)
+{
+	_tracePath = path;
+}
 
-	if (GetAsyncKeyState(0x4B))
-	{
-		switchScene = true;
-		Sleep(sleepTime);
-	}
+void Application::SetScene(const wstring& path)
+{
+	_scenePath = path;
+}
 
-	if (GetAsyncKeyState(0x4C))
-	{
-		switchScene = false;
-		Sleep(sleepTime);
-	}
+void Application::SetBodyMesh(const wstring& path)
+{
+	_bodyMeshPath = path;
+}
+
+void Application::SetBodyVertexFormat(MeshVertexFormat vertexFormat)
+{
+	_bodyVertexFormat = vertexFormat;
+}
+
+void Application::SetAsteroidCount(int count)
+{
+	_solarSystem.SetAsteroidCount(count);
+}
+
+void Application::SetAsteroidGravity(bool gravity)
+{
+	_solarSystem.SetAsteroidGravity(gravity);
 }
 
 void Application::Cleanup()
 {
 	if (_pImmediateContext) _pImmediateContext->ClearState();
 
-	if (_pConstantBuffer) _pConstantBuffer->Release();
+	_renderDevice.Cleanup();
+
 	if (_pVertexBuffer) _pVertexBuffer->Release();
 	if (_pIndexBuffer) _pIndexBuffer->Release();
 	if (_pVertexLayout) _pVertexLayout->Release();
 	if (_pVertexShader) _pVertexShader->Release();
+	if (_pInstancedVertexLayout) _pInstancedVertexLayout->Release();
+	if (_pInstancedVertexShader) _pInstancedVertexShader->Release();
+	if (_pQuantisedVertexShader) _pQuantisedVertexShader->Release();
+	if (_pInstancedQuantisedVertexShader) _pInstancedQuantisedVertexShader->Release();
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		if (_pQuantisedVertexLayouts[i]) _pQuantisedVertexLayouts[i]->Release();
+		if (_pInstancedQuantisedVertexLayouts[i]) _pInstancedQuantisedVertexLayouts[i]->Release();
+	}
 	if (_pPixelShader) _pPixelShader->Release();
 	if (_pRenderTargetView) _pRenderTargetView->Release();
 	if (_pSwapChain) _pSwapChain->Release();
@@ -689,128 +811,44 @@ void Application::Cleanup()
 }
 
 void Application::Update()
-
 {
-	// Update our time
-	static float t = 0.0f;
-	static float elapsed = t;
-	static float oldT;
+	PROFILE_ZONE("Application::Update");
 
+	// Work out how many fixed steps the real time since the last frame covers. The reference
+	// driver is far too slow to keep up with real time, so it runs one step per frame.
+	int steps;
 	if (_driverType == D3D_DRIVER_TYPE_REFERENCE)
 	{
-		t += (float)XM_PI * 0.0125f;
+		steps = _simulationClock.Tick(_simulationClock.GetStepSeconds());
 	}
 	else
 	{
-		static DWORD dwTimeStart = 0;
-		DWORD dwTimeCur = GetTickCount();
-
-		if (dwTimeStart == 0)
-			dwTimeStart = dwTimeCur;
-		oldT = t;
-		t = (dwTimeCur - dwTimeStart) / 1000.0f;
-		elapsed = t - oldT;
+		steps = _simulationClock.Tick();
 	}
 
-	//
-	// Animate the cubes
-	//
+	// Animate the solar system, timing the steps on their own so the simulation's cost can be
+	// told apart from the rendering's
+	auto simulationStart = chrono::steady_clock::now();
 
-	// Cube 1 transformation (The Sun)
-	//XMStoreFloat4x4(&_sunWorld, XMMatrixScaling(0.75f, 0.75f, 0.75f) * XMMatrixRotationY(t));
-
-	// Cube 1 GameObject transformation (The Sun)
-	_sun.SetScale(0.75f, 0.75f, 0.75f);
-	_sun.SetRotation(0.0f, t, 0.0f);
-	_sun.SetTranslation(0.0f, 10.0f, 0.0f);
-	_sun.UpdateWorld();
-
-	// Cube 2 transformation (Planet 1 - left)
-	//XMStoreFloat4x4(&_planet1World, XMMatrixScaling(0.5f, 0.5f, 0.5f) *  XMMatrixRotationY(-t) * XMMatrixTranslation(-3.00f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
-	_planet1.SetScale((0.5f), (0.5f), (0.5f));
-	_planet1.SetRotation(0.0f, (-t), 0.0f);
-	_planet1.SetTranslation((-3.00f), 10.0f, 0.0f);
-	_planet1.SetRotation(0.0f, (-t), 0.0f);
-	_planet1.UpdateWorld();
-
-	// Cube 3 transformation (Planet 2 - right)
-	//XMStoreFloat4x4(&_planet2World, XMMatrixScaling(0.5f, 0.5f, 0.5f) *  XMMatrixRotationY(-t) * XMMatrixTranslation(3.00f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
-	_planet2.SetScale((0.5f), (0.5f), (0.5f));
-	_planet2.SetRotation(0.0f, (-t), 0.0f);
-	_planet2.SetTranslation((3.00f), 10.0f, 0.0f);
-	_planet2.SetRotation(0.0f, (-t), 0.0f);
-	_planet2.UpdateWorld();
-
-	// Cube 4 transformation (Moon 1 - left)
-	//XMStoreFloat4x4(&_moon1World, XMMatrixRotationY(-t) * XMMatrixTranslation(-5.00f, 0.0f, 0.0f) * XMMatrixScaling(0.25f, 0.25f, 0.25f) * XMMatrixRotationY(-t * 3) * XMMatrixTranslation(-3.00f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
-	_moon1.SetRotation(0.0f, (-t), 0.0f);
-	_moon1.SetTranslation((-5.00f), 0.0f, 0.0f);
-	_moon1.SetScale(0.25f, 0.25f, 0.25f);
-	_moon1.SetRotation(0.0f, (-t * 3), 0.0f);
-	_moon1.SetTranslation((-3.00f), 10.0f, 0.0f);
-	_moon1.SetRotation(0.0f, (-t), 0.0f);
-	_moon1.UpdateWorld();
-
-	// Cube 5 transformation (Moon 2 - right)
-	//XMStoreFloat4x4(&_moon2World, XMMatrixRotationY(-t) * XMMatrixTranslation(5.00f, 0.0f, 0.0f) * XMMatrixScaling(0.25f, 0.25f, 0.25f) * XMMatrixRotationY(-t * 3) * XMMatrixTranslation(3.00f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
-	_moon2.SetRotation(0.0f, (-t), 0.0f);
-	_moon2.SetTranslation(5.00f, 0.0f, 0.0f);
-	_moon2.SetScale(0.25f, 0.25f, 0.25f);
-	_moon2.SetRotation(0.0f, (-t * 3), 0.0f);
-	_moon2.SetTranslation(3.00f, 10.0f, 0.0f);
-	_moon2.SetRotation(0.0f, (-t), 0.0f);
-	_moon2.UpdateWorld();
-
-
-	for (int i = 0; i < ASTEROID_COUNT; i++)
-	{
-		//srand(time(NULL));
-		//float xDir = rand() % (2 + 1);
-		//float zDir = rand() % (2 + 1);
-
-		////need to normalize it
-		//float length = sqrt(xDir * xDir + zDir + zDir);
-		//xDir /= length;
-		//zDir /= length;
-
-		////we have a direction, now we need a radius to get the final position
-		//float radius = rand() % (3 + 1);
-		//xDir *= radius;
-		//zDir *= radius;
-
-		float xDir = asteroidBelt[i].GetXDir();
-		float zDir = asteroidBelt[i].GetZDir();
-
-		//asteroidBelt[i].SetRotation(0.0f, (-t), 0.0f);
-		//asteroidBelt[i].SetTranslation(6.0f, 0.0f, 0.0f);
-		////asteroidBelt[i].SetTranslation(3.0f, 0.0f, 0.0f);
-		//asteroidBelt[i].SetScale(0.01f, 0.01f, 0.01f);
-		//asteroidBelt[i].SetRotation(0.0f, (-t * 3), 0.0f);
-		////asteroidBelt[i].SetTranslation(xDir, 0.0f, zDir);
-		//asteroidBelt[i].SetTranslation(xDir, 0.0f, zDir);
-		////asteroidBelt[i].SetTranslation(3.0f, 0.0f, 0.0f);
-		//asteroidBelt[i].SetRotation(0.0f, (-t), 0.0f);
-		//asteroidBelt[i].UpdateWorld();
-
-		//asteroidBelt[i].SetRotation(0.0f, (-t), 0.0f);
-		//asteroidBelt[i].SetTranslation(6.0f, 0.0f, 0.0f);
-		//asteroidBelt[i].SetTranslation(3.0f, 0.0f, 0.0f);
-		asteroidBelt[i].SetScale(0.01f, 0.01f, 0.01f);
-		//asteroidBelt[i].SetRotation(0.0f, (-t * 3), 0.0f);
-		////asteroidBelt[i].SetTranslation(xDir, 0.0f, zDir);
-		asteroidBelt[i].SetTranslation(xDir, 0.0f, zDir);
-		////asteroidBelt[i].SetTranslation(3.0f, 0.0f, 0.0f);
-		//asteroidBelt[i].SetRotation(0.0f, (-t), 0.0f);
-		asteroidBelt[i].UpdateWorld();
+	for (int i = 0; i < steps; i++)
+	{
+		_solarSystem.Update((float)_simulationClock.Step(), &_jobSystem);
 	}
 
+	_reportSimulationSeconds += chrono::duration<double>(chrono::steady_clock::now() - simulationStart).count();
+	_reportSimulationSteps += steps;
+
+	// Draw the bodies between the last two steps, where they would be at this moment
+	_solarSystem.Interpolate(_simulationClock.GetAlpha());
 
-	Input();
+	// The camera moves with real time rather than the simulation's steps. The reference driver
+	// runs one step per frame, so it moves the camera by one step's time too.
+	Input((float)_simulationClock.GetLastTickSeconds());
 
 	//Eye = XMVectorSet(0.0f, upDown, -60.0f, 0.0f);
 	//Eye = XMVectorSet(0.0f, 0.0f, -60.0f, 0.0f);
 	// Moves right and left, up and down on the camera's own axis
-	At = XMVectorSet(leftRight, upDown, forwardBack, 0.0f);
+	At = _viewController.GetAt();
 	Up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 	XMStoreFloat4x4(&_view, XMMatrixLookAtLH(Eye, At, Up));
 
@@ -818,6 +856,8 @@ void Application::Update()
 
 void Application::Draw()
 {
+	PROFILE_ZONE("Application::Draw");
+
 	//
 	// Clear the back buffer
 	//
@@ -838,141 +878,77 @@ void Application::Draw()
 	_pImmediateContext->ClearDepthStencilView(_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
 
-	if (WFMode)
-	{
-		_pImmediateContext->RSSetState(_wireFrame);
-	}
-	else
-	{
-		_pImmediateContext->RSSetState(nullptr);
-	}
+	// Setup the constant buffers and draw the scene. The plane and the cubes follow the wireframe
+	// toggle, the planets are always drawn in wireframe.
+	_renderDevice.BindConstantBuffers();
 
-	// Declare and initialise the WVP matrices
-	XMMATRIX world;
-	XMMATRIX view = XMLoadFloat4x4(&_view);
-	XMMATRIX projection = XMLoadFloat4x4(&_projection);
+	XMFLOAT3 eyePosition;
+	XMStoreFloat3(&eyePosition, Eye);
+	_sceneRenderer.Render(_renderDevice, _jobSystem, _solarSystem, _view, _projection, eyePosition,
+		_viewController.IsWireframe(), _viewController.IsSolarSystemShown());
 
-	//
-	// Update variables
-	//
+	// Every 100 frames, report how many constant buffer bytes were sent per frame, compared with
+	// uploading all of the constants together for every object as a single buffer would. The
+	// object and material constants are uploaded from the command buffers, so they're counted by the queue.
+	const ConstantBufferStats& stats = _sceneRenderer.GetConstantBufferStats();
+	const RenderQueue::Stats& queueStats = _sceneRenderer.GetQueueStats();
+	_reportBytesUploaded += stats.bytesUploaded + (long long)queueStats.objectConstantUploads * sizeof(ObjectConstants) +
+		(long long)queueStats.materialConstantUploads * sizeof(MaterialConstants);
+	_reportBytesCombined += (long long)queueStats.draws * (sizeof(FrameConstants) + sizeof(MaterialConstants) + sizeof(ObjectConstants));
+	_reportTriangles += _sceneRenderer.GetLodStats().triangles;
+	_reportFullDetailTriangles += _sceneRenderer.GetLodStats().fullDetailTriangles;
 
-	// Setup the constant buffer
-	ConstantBuffer cb;
-	cb.mWorld;
-	cb.mView = XMMatrixTranspose(view);
-	cb.mProjection = XMMatrixTranspose(projection);
-	cb.diffuseMaterial = XMFLOAT4(0.25f, 0.5f, 1.0f, 1.0f);
-	cb.diffuseLight = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-	cb.lightVecW = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	cb.gAmbientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-	cb.gAmbientMtrl = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-	cb.gSpecularMtrl = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-	cb.gSpecularLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	cb.gSpecularPower = 10.0f;
-	XMStoreFloat3(&cb.gEyePosW, Eye);
-
-
-	// Setup our Vertex Shader and our Pixel Shader
-	_pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
-	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
-	_pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
-	_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
-
-	if (switchScene)
-	{
-		_pImmediateContext->IASetVertexBuffers(0, 1, &_pVertexBuffer, &stride, &offset);
-		_pImmediateContext->IASetIndexBuffer(_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-		// Load the first world (Sun) matrix to CPU
-		// (From GameObject object) Load the first world (Sun) matrix to CPU
-		//world = XMLoadFloat4x4(&_sunWorld);
-		world = XMLoadFloat4x4(&_sun.GetWorld());
-		// Prime the first world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the first world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the first world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);   
-		_sun.Draw(_pd3dDevice, _pImmediateContext);
-
-		for (int i = 0; i < ASTEROID_COUNT; i++)
+	if (++_reportFrameCount == 100)
+	{
+		char report[128];
+		sprintf_s(report, "Constant buffer bytes per frame: %lld (single buffer: %lld)\n",
+			_reportBytesUploaded / _reportFrameCount, _reportBytesCombined / _reportFrameCount);
+		OutputDebugStringA(report);
+
+		sprintf_s(report, "Simulation steps per frame: %.2f, %.1f us per step\n",
+			_reportSimulationSteps / (double)_reportFrameCount,
+			_reportSimulationSteps > 0 ? _reportSimulationSeconds * 1e6 / _reportSimulationSteps : 0.0);
+		OutputDebugStringA(report);
+
+		sprintf_s(report, "Triangles per frame: %lld (all at full detail: %lld)\n",
+			_reportTriangles / _reportFrameCount, _reportFullDetailTriangles / _reportFrameCount);
+		OutputDebugStringA(report);
+
+		// Allocations the rings refused were waited for, until the GPU finished an older frame
+		if (_renderDevice.IsConstantRingEnabled())
 		{
-			world = XMLoadFloat4x4(&asteroidBelt[i].GetWorld());
-			cb.mWorld = XMMatrixTranspose(world);
-			_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-			//asteroidBelt[i].Draw(_pd3dDevice, _pImmediateContext);
+			const UploadRingStats& constantStats = _renderDevice.GetConstantRing().GetStats();
+			const UploadRingStats& instanceStats = _renderDevice.GetInstanceRing().GetStats();
+			sprintf_s(report, "Upload ring bytes per frame: %lld constants, %lld instances, %lld waits\n",
+				constantStats.bytesAllocated / _reportFrameCount, instanceStats.bytesAllocated / _reportFrameCount,
+				constantStats.failedAllocations + instanceStats.failedAllocations);
+			OutputDebugStringA(report);
 		}
-
-
-		// Load the fourth world (Moon 1) matrix to CPU
-		//world = XMLoadFloat4x4(&_moon1World);
-		world = XMLoadFloat4x4(&_moon1.GetWorld());
-		// Prime the fourth world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the fourth world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the fourth world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);
-		_moon1.Draw(_pd3dDevice, _pImmediateContext);
-
-		// Load the fifth world (Moon 2) matrix to CPU
-		//world = XMLoadFloat4x4(&_moon2World);
-		world = XMLoadFloat4x4(&_moon2.GetWorld());
-		// Prime the fifth world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the fifth world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the fifth world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);
-		_moon2.Draw(_pd3dDevice, _pImmediateContext);
-
-
-
-		_pImmediateContext->RSSetState(_wireFrame);
-		// Load the second world (Planet 1) matrix to CPU
-		//world = XMLoadFloat4x4(&_planet1World);
-		world = XMLoadFloat4x4(&_planet1.GetWorld());
-		// Prime the second world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the second world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the second world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);
-		_planet1.Draw(_pd3dDevice, _pImmediateContext);
-
-		//_pImmediateContext->RSSetState(_wireFrame);
-		// Load the third world (Planet 2) matrix to CPU
-		//world = XMLoadFloat4x4(&_planet2World);
-		world = XMLoadFloat4x4(&_planet2.GetWorld());
-		// Prime the third world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the third world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the third world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);
-		_planet2.Draw(_pd3dDevice, _pImmediateContext);
-
-	}
-	else
-	{
-		_pImmediateContext->IASetVertexBuffers(0, 1, &_pVertexBufferPlane, &stride, &offset);
-		_pImmediateContext->IASetIndexBuffer(_pIndexBufferPlane, DXGI_FORMAT_R16_UINT, 0);
-
-		// Render the plane
-		world = XMLoadFloat4x4(&_plane.GetWorld());
-		// Prime the first world matrix for passing to GPU
-		cb.mWorld = XMMatrixTranspose(world);
-		// Pass the first world matrix to GPU
-		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-		// Draw the first world matrix
-		//_pImmediateContext->DrawIndexed(36, 0, 0);   
-		_plane.Draw(_pd3dDevice, _pImmediateContext);
+		_renderDevice.ResetUploadStats();
+
+		// The time spent in each profiled zone since the last report
+		vector<Profiler::Zone> zones = Profiler::Collect();
+		zones.erase(remove_if(zones.begin(), zones.end(),
+			[this](const Profiler::Zone& zone) { return zone.startNanoseconds < _reportProfileStart; }), zones.end());
+		OutputDebugStringA(Profiler::FormatSummary(Profiler::Summarise(zones)).c_str());
+		_reportProfileStart = Profiler::Now();
+
+		_reportFrameCount = 0;
+		_reportBytesUploaded = 0;
+		_reportBytesCombined = 0;
+		_reportSimulationSteps = 0;
+		_reportSimulationSeconds = 0.0;
+		_reportTriangles = 0;
+		_reportFullDetailTriangles = 0;
 	}
 
-
-
 	//
 	// Present our back buffer to our front buffer
 	//
-	_pSwapChain->Present(0, 0);
+	{
+		PROFILE_ZONE("Present");
+		_pSwapChain->Present(0, 0);
+	}
+
+	_renderDevice.EndFrame();
 }
\ No newline at end of file
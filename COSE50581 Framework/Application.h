@@ -7,41 +7,20 @@
 #include <directxcolors.h>
 #include "resource.h"
 #include "GameObject.h"
-
-
-#define ASTEROID_COUNT 100
+#include "SolarSystem.h"
+#include "D3D11RenderDevice.h"
+#include "JobSystem.h"
+#include "LodChain.h"
+#include "MeshGeometry.h"
+#include "SceneRenderer.h"
+#include "SimulationClock.h"
+#include "InputSystem.h"
+#include "ViewController.h"
+#include "Profiler.h"
+#include <string>
 
 using namespace DirectX;
 
-struct SimpleVertex
-{
-	XMFLOAT3 Pos;
-	XMFLOAT3 Normal;
-};
-
-struct ConstantBuffer
-
-{
-
-	XMMATRIX mWorld;
-	XMMATRIX mView;
-	XMMATRIX mProjection;
-
-	XMFLOAT4 diffuseMaterial;
-	XMFLOAT4 diffuseLight;
-
-	XMFLOAT4 gAmbientMtrl;
-	XMFLOAT4 gAmbientLight;
-
-	XMFLOAT4 gSpecularMtrl;
-	XMFLOAT4 gSpecularLight;
-	float gSpecularPower;
-
-	XMFLOAT3 gEyePosW;
-	XMFLOAT3 lightVecW;
-
-};
-
 class Application
 {
 private:
@@ -56,11 +35,19 @@ private:
 	ID3D11VertexShader*     _pVertexShader;
 	ID3D11PixelShader*      _pPixelShader;
 	ID3D11InputLayout*      _pVertexLayout;
+	// The vertex shader and input layout used to draw instanced objects, such as the asteroid belt
+	ID3D11VertexShader*     _pInstancedVertexShader;
+	ID3D11InputLayout*      _pInstancedVertexLayout;
+	// The vertex shaders that decode the quantised vertex formats, and their input layouts for
+	// each format. The SimpleVertex entries are unused.
+	ID3D11VertexShader*     _pQuantisedVertexShader;
+	ID3D11VertexShader*     _pInstancedQuantisedVertexShader;
+	ID3D11InputLayout*      _pQuantisedVertexLayouts[VERTEX_FORMAT_COUNT];
+	ID3D11InputLayout*      _pInstancedQuantisedVertexLayouts[VERTEX_FORMAT_COUNT];
 	ID3D11Buffer*           _pVertexBuffer;
 	ID3D11Buffer*           _pIndexBuffer;
 	ID3D11Buffer*           _pVertexBufferPlane;
 	ID3D11Buffer*           _pIndexBufferPlane;
-	ID3D11Buffer*           _pConstantBuffer;
 	// Declaration of the interface object which we'll use to set the render state
 	ID3D11RasterizerState*  _wireFrame;
 	// Store the Depth/Stencil view
@@ -72,11 +59,26 @@ private:
 
 	// Create Object instances
 	//Object* _pSun, _pWorld1, _pWorld2, _pMoon1, _pMoon2;
-	GameObject _sun, _planet1, _planet2, _moon1, _moon2, _asteroid;
-	GameObject asteroidBelt[ASTEROID_COUNT];
-	GameObject _plane;
+	SolarSystem _solarSystem;
+
+	// Advances the solar system in fixed steps, and says how far between two steps to draw it
+	SimulationClock _simulationClock;
+
+	// Shares the per-frame transform updates, culling and constant packing between threads
+	JobSystem _jobSystem;
 	MeshData _meshData;
 
+	// Culls, sorts and draws the scene through the render device
+	D3D11RenderDevice _renderDevice;
+	SceneRenderer _sceneRenderer;
+	int _reportFrameCount;
+	long long _reportBytesUploaded;
+	long long _reportBytesCombined;
+	int _reportSimulationSteps;
+	double _reportSimulationSeconds;
+	long long _reportTriangles;
+	long long _reportFullDetailTriangles;
+
 
 	// Sun's world matrix
 	XMFLOAT4X4              _sunWorld;
@@ -90,6 +92,28 @@ private:
 	// Plane's world matrix
 	XMFLOAT4X4              _planeWorld;
 
+	// Key events from the window, applied once a frame, and the camera and toggles they drive
+	InputSystem _input;
+	ViewController _viewController;
+
+	// Where to save the input recorded this session, if it's being recorded
+	wstring _recordingPath;
+
+	// The scene the solar system is built from, as text or compiled
+	wstring _scenePath;
+
+	// The mesh file to draw the bodies of the solar system with, if not the icospheres
+	wstring _bodyMeshPath;
+	// The icosphere levels of detail the bodies are drawn with when there is no mesh file
+	LodChain _bodyLodChain;
+	// The format the icospheres' vertices are stored in
+	MeshVertexFormat _bodyVertexFormat;
+
+	// Where to write the profiler's Chrome trace when the application closes, if anywhere
+	wstring _tracePath;
+	// When the zones in the next profiler report started
+	long long _reportProfileStart;
+
 	// Camera positions
 	XMVECTOR Eye;
 	XMVECTOR At;
@@ -109,9 +133,10 @@ private:
 	void Cleanup();
 	HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
 	HRESULT InitShadersAndInputLayout();
+	HRESULT InitQuantisedShaders();
 	HRESULT InitVertexBuffer();
 	HRESULT InitIndexBuffer();
-	void Input();
+	void Input(float elapsedSeconds);
 
 	UINT _WindowHeight;
 	UINT _WindowWidth;
@@ -119,13 +144,6 @@ private:
 	UINT stride = sizeof(SimpleVertex);
 	UINT offset = 0;
 
-	float upDown = 6.5f;
-	float leftRight = 0.0f;
-	float forwardBack = 0.0f;
-	int sleepTime = 16;
-	bool WFMode = false;
-	bool switchScene = false;
-
 
 
 public:
@@ -134,6 +152,32 @@ public:
 
 	HRESULT Initialise(HINSTANCE hInstance, int nCmdShow);
 
+	// Queues the key messages WndProc receives as input events
+	void HandleInput(UINT message, WPARAM wParam, LPARAM lParam);
+
+	// Records the input from now until the application closes, then saves it to path
+	void RecordInput(const wstring& path);
+
+	// Replays the input saved by an earlier recording instead of reading the keyboard
+	bool ReplayInput(const wstring& path);
+
+	// Writes the profiled zones still held as a Chrome trace to path when the application closes
+	void TraceProfile(const wstring& path);
+
+	// Builds the solar system from another scene than SolarSystem.scene. Call before Initialise.
+	void SetScene(const wstring& path);
+
+	// Draws the bodies of the solar system with the mesh in a mesh file. Call before Initialise.
+	void SetBodyMesh(const wstring& path);
+
+	// Stores the bodies' icospheres in a compressed vertex format. Call before Initialise.
+	void SetBodyVertexFormat(MeshVertexFormat vertexFormat);
+
+	// Puts count asteroids in the belt instead of the scene's count. Call before Initialise.
+	void SetAsteroidCount(int count);
+	// Puts the belt in orbit around the scene's first body with mass under gravity. Call before Initialise.
+	void SetAsteroidGravity(bool gravity);
+
 	void Update();
 	void Draw();
 };
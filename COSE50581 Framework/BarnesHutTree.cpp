@@ -0,0 +1,466 @@
+#include "BarnesHutTree.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+const int BarnesHutTree::MAX_LEAF_SIZE;
+const int BarnesHutTree::MAX_DEPTH;
+const int BarnesHutTree::SPLIT_DEPTH;
+const int BarnesHutTree::RADIX_BITS;
+const int BarnesHutTree::BUILD_GRAIN_SIZE;
+const int BarnesHutTree::MAX_GROUP_SIZE;
+const int BarnesHutTree::FORCE_GRAIN_SIZE;
+
+// Calls body for consecutive chunks of grainSize covering [0, count), on the job system's
+// threads when there is one. The chunks are the same either way, so a chunk can keep its
+// results at begin / grainSize.
+static void ForEachChunk(JobSystem * jobSystem, int count, int grainSize, const function<void(int, int)>& body)
+{
+	if (jobSystem)
+	{
+		jobSystem->ParallelFor(count, grainSize, body);
+		return;
+	}
+
+	for (int begin = 0; begin < count; begin += grainSize)
+	{
+		body(begin, min(count, begin + grainSize));
+	}
+}
+
+// Spreads the low 21 bits of v out to every third bit
+static uint64_t SpreadBits(uint32_t v)
+{
+	uint64_t x = v & 0x1FFFFF;
+	x = (x | x << 32) & 0x1F00000000FFFFull;
+	x = (x | x << 16) & 0x1F0000FF0000FFull;
+	x = (x | x << 8) & 0x100F00F00F00F00Full;
+	x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+BarnesHutTree::BarnesHutTree()
+{
+	_rootX = 0.0f;
+	_rootY = 0.0f;
+	_rootZ = 0.0f;
+	_rootSize = 1.0f;
+}
+
+BarnesHutTree::~BarnesHutTree()
+{
+}
+
+void BarnesHutTree::ComputeCodes(const float * x, const float * y, const float * z, int count, JobSystem * jobSystem)
+{
+	// Each chunk finds the box around its own bodies, then the boxes are merged here
+	int chunkCount = (count + BUILD_GRAIN_SIZE - 1) / BUILD_GRAIN_SIZE;
+	vector<float> chunkBounds(chunkCount * 6);
+
+	ForEachChunk(jobSystem, count, BUILD_GRAIN_SIZE, [&](int begin, int end)
+	{
+		float * bounds = &chunkBounds[(begin / BUILD_GRAIN_SIZE) * 6];
+		bounds[0] = bounds[3] = x[begin];
+		bounds[1] = bounds[4] = y[begin];
+		bounds[2] = bounds[5] = z[begin];
+
+		for (int i = begin + 1; i < end; i++)
+		{
+			bounds[0] = min(bounds[0], x[i]);
+			bounds[1] = min(bounds[1], y[i]);
+			bounds[2] = min(bounds[2], z[i]);
+			bounds[3] = max(bounds[3], x[i]);
+			bounds[4] = max(bounds[4], y[i]);
+			bounds[5] = max(bounds[5], z[i]);
+		}
+	});
+
+	float bounds[6] = { chunkBounds[0], chunkBounds[1], chunkBounds[2], chunkBounds[3], chunkBounds[4], chunkBounds[5] };
+	for (int chunk = 1; chunk < chunkCount; chunk++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bounds[axis] = min(bounds[axis], chunkBounds[chunk * 6 + axis]);
+			bounds[axis + 3] = max(bounds[axis + 3], chunkBounds[chunk * 6 + axis + 3]);
+		}
+	}
+
+	// The root is the cube around the box, so that every cell below it is a cube too
+	_rootX = bounds[0];
+	_rootY = bounds[1];
+	_rootZ = bounds[2];
+	_rootSize = (max)(bounds[3] - bounds[0], (max)(bounds[4] - bounds[1], bounds[5] - bounds[2]));
+	if (_rootSize <= 0.0f)
+		_rootSize = 1.0f;
+
+	const float cellsPerAxis = (float)(1 << MAX_DEPTH);
+	const float scale = cellsPerAxis / _rootSize;
+
+	_sorted.resize(count);
+	ForEachChunk(jobSystem, count, BUILD_GRAIN_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			// The bodies on the far faces of the root would land one cell outside it
+			uint32_t cellX = (uint32_t)(min)((x[i] - _rootX) * scale, cellsPerAxis - 1.0f);
+			uint32_t cellY = (uint32_t)(min)((y[i] - _rootY) * scale, cellsPerAxis - 1.0f);
+			uint32_t cellZ = (uint32_t)(min)((z[i] - _rootZ) * scale, cellsPerAxis - 1.0f);
+
+			_sorted[i].code = SpreadBits(cellX) << 2 | SpreadBits(cellY) << 1 | SpreadBits(cellZ);
+			_sorted[i].body = i;
+		}
+	});
+}
+
+void BarnesHutTree::SortCodes(JobSystem * jobSystem)
+{
+	// A least significant digit first radix sort. Every chunk counts its own digits, and then
+	// scatters its bodies after those of the chunks before it with the same digit, which keeps
+	// the sort stable without the chunks waiting on each other.
+	const int bucketCount = 1 << RADIX_BITS;
+	const int count = (int)_sorted.size();
+	const int chunkCount = (count + BUILD_GRAIN_SIZE - 1) / BUILD_GRAIN_SIZE;
+
+	_sortScratch.resize(count);
+	_histograms.resize(chunkCount * bucketCount);
+
+	for (int shift = 0; shift < 3 * MAX_DEPTH; shift += RADIX_BITS)
+	{
+		ForEachChunk(jobSystem, count, BUILD_GRAIN_SIZE, [&](int begin, int end)
+		{
+			int * histogram = &_histograms[(begin / BUILD_GRAIN_SIZE) * bucketCount];
+			fill(histogram, histogram + bucketCount, 0);
+
+			for (int i = begin; i < end; i++)
+			{
+				histogram[(_sorted[i].code >> shift) & (bucketCount - 1)]++;
+			}
+		});
+
+		// Clustered bodies often share the high digits, and a pass where they all do changes nothing
+		bool oneDigit = false;
+		for (int digit = 0; digit < bucketCount && !oneDigit; digit++)
+		{
+			int total = 0;
+			for (int chunk = 0; chunk < chunkCount; chunk++)
+			{
+				total += _histograms[chunk * bucketCount + digit];
+			}
+			oneDigit = total == count;
+		}
+
+		if (oneDigit)
+			continue;
+
+		// Turn the counts into where each chunk's first body with each digit goes
+		int offset = 0;
+		for (int digit = 0; digit < bucketCount; digit++)
+		{
+			for (int chunk = 0; chunk < chunkCount; chunk++)
+			{
+				int digitCount = _histograms[chunk * bucketCount + digit];
+				_histograms[chunk * bucketCount + digit] = offset;
+				offset += digitCount;
+			}
+		}
+
+		ForEachChunk(jobSystem, count, BUILD_GRAIN_SIZE, [&](int begin, int end)
+		{
+			int * offsets = &_histograms[(begin / BUILD_GRAIN_SIZE) * bucketCount];
+
+			for (int i = begin; i < end; i++)
+			{
+				_sortScratch[offsets[(_sorted[i].code >> shift) & (bucketCount - 1)]++] = _sorted[i];
+			}
+		});
+
+		_sorted.swap(_sortScratch);
+	}
+}
+
+void BarnesHutTree::Build(const float * x, const float * y, const float * z, const float * mass, int count, JobSystem * jobSystem)
+{
+	_nodes.clear();
+	_groups.clear();
+	_bodies.resize(count);
+	_x.resize(count);
+	_y.resize(count);
+	_z.resize(count);
+	_mass.resize(count);
+
+	if (count == 0)
+		return;
+
+	ComputeCodes(x, y, z, count, jobSystem);
+	SortCodes(jobSystem);
+
+	// Copy the bodies in sorted order, so that a leaf's bodies are next to each other in memory
+	ForEachChunk(jobSystem, count, BUILD_GRAIN_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			int body = _sorted[i].body;
+			_bodies[i] = body;
+			_x[i] = x[body];
+			_y[i] = y[body];
+			_z[i] = z[body];
+			_mass[i] = mass[body];
+		}
+	});
+
+	// Every cell at the split depth is a run of sorted bodies that shares the top bits of its
+	// code, and nothing outside it, so the cells are built independently
+	const int cellCount = 1 << (3 * SPLIT_DEPTH);
+	const int cellShift = 3 * (MAX_DEPTH - SPLIT_DEPTH);
+
+	vector<int> cellStarts(cellCount + 1);
+	for (int cell = 0; cell <= cellCount; cell++)
+	{
+		cellStarts[cell] = (int)(lower_bound(_sorted.begin(), _sorted.end(), (uint64_t)cell << cellShift,
+			[](const SortEntry& entry, uint64_t code) { return entry.code < code; }) - _sorted.begin());
+	}
+
+	_cellNodes.resize(cellCount);
+	ForEachChunk(jobSystem, cellCount, 1, [&](int begin, int end)
+	{
+		for (int cell = begin; cell < end; cell++)
+		{
+			_cellNodes[cell].clear();
+			if (cellStarts[cell] < cellStarts[cell + 1])
+				BuildNode(cellStarts[cell], cellStarts[cell + 1], SPLIT_DEPTH, _cellNodes[cell], false);
+		}
+	});
+
+	BuildNode(0, count, 0, _nodes, true);
+
+	// The nodes are in the order of their bodies, so a node's bodies end where the node after it
+	// and everything under it starts
+	_groups.clear();
+	for (int i = 0; i < (int)_nodes.size();)
+	{
+		int bodyEnd = _nodes[i].next < (int)_nodes.size() ? _nodes[_nodes[i].next].firstBody : count;
+
+		if (bodyEnd - _nodes[i].firstBody <= MAX_GROUP_SIZE)
+		{
+			_groups.push_back(i);
+			i = _nodes[i].next;
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void BarnesHutTree::BuildNode(int begin, int end, int depth, vector<Node>& nodes, bool spliceCells) const
+{
+	// The cells at the split depth have been built already, and only need their links moving
+	if (spliceCells && depth == SPLIT_DEPTH)
+	{
+		const vector<Node>& cellNodes = _cellNodes[_sorted[begin].code >> (3 * (MAX_DEPTH - SPLIT_DEPTH))];
+		int offset = (int)nodes.size();
+
+		nodes.insert(nodes.end(), cellNodes.begin(), cellNodes.end());
+		for (int i = offset; i < (int)nodes.size(); i++)
+		{
+			nodes[i].next += offset;
+		}
+
+		return;
+	}
+
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+
+	Node node;
+	node.size = _rootSize / (float)(1 << depth);
+	node.firstBody = begin;
+	node.bodyCount = 0;
+
+	float mass = 0.0f;
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+
+	if (end - begin <= MAX_LEAF_SIZE || depth == MAX_DEPTH)
+	{
+		node.bodyCount = end - begin;
+
+		for (int i = begin; i < end; i++)
+		{
+			mass += _mass[i];
+			x += _mass[i] * _x[i];
+			y += _mass[i] * _y[i];
+			z += _mass[i] * _z[i];
+		}
+	}
+	else
+	{
+		// The bodies are sorted, so each child is the run of bodies with the same next digit
+		int shift = 3 * (MAX_DEPTH - 1 - depth);
+		for (int childBegin = begin; childBegin < end;)
+		{
+			uint64_t prefix = _sorted[childBegin].code >> shift;
+			int childEnd = (int)(upper_bound(_sorted.begin() + childBegin, _sorted.begin() + end, prefix,
+				[shift](uint64_t value, const SortEntry& entry) { return value < (entry.code >> shift); }) - _sorted.begin());
+
+			BuildNode(childBegin, childEnd, depth + 1, nodes, spliceCells);
+			childBegin = childEnd;
+		}
+
+		for (int child = index + 1; child < (int)nodes.size(); child = nodes[child].next)
+		{
+			mass += nodes[child].mass;
+			x += nodes[child].mass * nodes[child].x;
+			y += nodes[child].mass * nodes[child].y;
+			z += nodes[child].mass * nodes[child].z;
+		}
+	}
+
+	// Massless bodies pull on nothing, so any point in the node will do
+	if (mass > 0.0f)
+	{
+		node.x = x / mass;
+		node.y = y / mass;
+		node.z = z / mass;
+	}
+	else
+	{
+		node.x = _x[begin];
+		node.y = _y[begin];
+		node.z = _z[begin];
+	}
+
+	node.mass = mass;
+	node.next = (int)nodes.size();
+	nodes[index] = node;
+}
+
+long long BarnesHutTree::ComputeAccelerations(float openingAngle, float softening, float * ax, float * ay, float * az,
+	JobSystem * jobSystem) const
+{
+	const int nodeCount = (int)_nodes.size();
+	const int groupCount = (int)_groups.size();
+	const float openingAngleSquared = openingAngle * openingAngle;
+	const float softeningSquared = softening * softening;
+
+	vector<long long> chunkInteractions((groupCount + FORCE_GRAIN_SIZE - 1) / FORCE_GRAIN_SIZE);
+
+	// Rather than every body walking the tree, every group walks it once for all its bodies and
+	// lists what pulls on them: the nodes far enough from every one of them to pull as one body,
+	// and the bodies of the rest. Its bodies then sum the list in a loop with no branches.
+	ForEachChunk(jobSystem, groupCount, FORCE_GRAIN_SIZE, [&](int begin, int end)
+	{
+		vector<float> listX, listY, listZ, listMass;
+		long long interactions = 0;
+
+		for (int groupIndex = begin; groupIndex < end; groupIndex++)
+		{
+			const int groupNode = _groups[groupIndex];
+			const Node& group = _nodes[groupNode];
+			const int groupEnd = group.next < nodeCount ? _nodes[group.next].firstBody : (int)_bodies.size();
+
+			float minX = _x[group.firstBody], minY = _y[group.firstBody], minZ = _z[group.firstBody];
+			float maxX = minX, maxY = minY, maxZ = minZ;
+			for (int i = group.firstBody + 1; i < groupEnd; i++)
+			{
+				minX = min(minX, _x[i]);
+				minY = min(minY, _y[i]);
+				minZ = min(minZ, _z[i]);
+				maxX = max(maxX, _x[i]);
+				maxY = max(maxY, _y[i]);
+				maxZ = max(maxZ, _z[i]);
+			}
+
+			listX.clear();
+			listY.clear();
+			listZ.clear();
+			listMass.clear();
+
+			int nodeIndex = 0;
+			while (nodeIndex < nodeCount)
+			{
+				const Node& node = _nodes[nodeIndex];
+
+				// The distance from the centre of mass to the nearest point of the group's box. With
+				// a wide opening angle a node around the group can seem far enough from it, but the
+				// group must never pull on itself as one body.
+				float dx = max(0.0f, max(minX - node.x, node.x - maxX));
+				float dy = max(0.0f, max(minY - node.y, node.y - maxY));
+				float dz = max(0.0f, max(minZ - node.z, node.z - maxZ));
+				bool containsGroup = nodeIndex <= groupNode && groupNode < node.next;
+
+				if (!containsGroup && node.size * node.size < openingAngleSquared * (dx * dx + dy * dy + dz * dz))
+				{
+					listX.push_back(node.x);
+					listY.push_back(node.y);
+					listZ.push_back(node.z);
+					listMass.push_back(node.mass);
+					nodeIndex = node.next;
+				}
+				else if (node.bodyCount > 0)
+				{
+					listX.insert(listX.end(), &_x[node.firstBody], &_x[node.firstBody] + node.bodyCount);
+					listY.insert(listY.end(), &_y[node.firstBody], &_y[node.firstBody] + node.bodyCount);
+					listZ.insert(listZ.end(), &_z[node.firstBody], &_z[node.firstBody] + node.bodyCount);
+					listMass.insert(listMass.end(), &_mass[node.firstBody], &_mass[node.firstBody] + node.bodyCount);
+					nodeIndex = node.next;
+				}
+				else
+				{
+					nodeIndex++;
+				}
+			}
+
+			const int listSize = (int)listX.size();
+			const float * sourceX = listX.data();
+			const float * sourceY = listY.data();
+			const float * sourceZ = listZ.data();
+			const float * sourceMass = listMass.data();
+
+			for (int i = group.firstBody; i < groupEnd; i++)
+			{
+				float px = _x[i];
+				float py = _y[i];
+				float pz = _z[i];
+				float accelerationX = 0.0f;
+				float accelerationY = 0.0f;
+				float accelerationZ = 0.0f;
+
+				for (int source = 0; source < listSize; source++)
+				{
+					float dx = sourceX[source] - px;
+					float dy = sourceY[source] - py;
+					float dz = sourceZ[source] - pz;
+					float distanceSquared = dx * dx + dy * dy + dz * dz + softeningSquared;
+
+					// The body itself is on the list, at no distance, and must pull on nothing
+					float inverseDistance = distanceSquared > 0.0f ? 1.0f / sqrtf(distanceSquared) : 0.0f;
+					float strength = sourceMass[source] * inverseDistance * inverseDistance * inverseDistance;
+					accelerationX += strength * dx;
+					accelerationY += strength * dy;
+					accelerationZ += strength * dz;
+				}
+
+				int body = _bodies[i];
+				ax[body] = accelerationX;
+				ay[body] = accelerationY;
+				az[body] = accelerationZ;
+			}
+
+			// The list includes each body itself
+			interactions += (long long)(groupEnd - group.firstBody) * (listSize - 1);
+		}
+
+		chunkInteractions[begin / FORCE_GRAIN_SIZE] = interactions;
+	});
+
+	long long interactions = 0;
+	for (long long chunk : chunkInteractions)
+		interactions += chunk;
+
+	return interactions;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class JobSystem;
+
+// An octree over point masses for the Barnes-Hut approximation of gravity. Every node keeps the
+// total mass and centre of mass of the bodies under it, so a group far enough away from a body
+// pulls on it as one body would, and the acceleration on each body costs O(log n) rather than
+// O(n).
+//
+// The bodies are sorted along a Morton curve, which puts every cell of the octree's bodies next
+// to each other, so a node's children are found by splitting its run of bodies instead of by
+// inserting bodies one at a time. The cells a few levels down are built on separate threads.
+// Nodes are stored depth first: an inner node's first child is the node after it, and next
+// skips the node and everything under it, so walking the tree needs no stack. Bodies close
+// together share one walk, which lists what pulls on all of them.
+//
+// Masses are gravitational parameters, G times the mass, so G never appears.
+class BarnesHutTree
+{
+private:
+	struct Node
+	{
+		// Centre of mass and total mass of the bodies under the node
+		float x, y, z, mass;
+		// The side of the node's cube
+		float size;
+		// The node after this one and everything under it
+		int next;
+		// A leaf's bodies, in sorted order. Inner nodes have a body count of 0, and their bodies
+		// run from their first body to the first body of the node after them.
+		int firstBody;
+		int bodyCount;
+	};
+
+	struct SortEntry
+	{
+		uint64_t code;
+		int body;
+	};
+
+	static const int MAX_LEAF_SIZE = 8;
+	// The Morton codes have this many bits for each axis, which limits the depth
+	static const int MAX_DEPTH = 21;
+	// The tree down to this depth is built on the calling thread, and the cells at it in parallel
+	static const int SPLIT_DEPTH = 2;
+	static const int RADIX_BITS = 8;
+	static const int BUILD_GRAIN_SIZE = 16384;
+	// Bodies that share a walk of the tree, and groups per job when the accelerations are summed
+	static const int MAX_GROUP_SIZE = 32;
+	static const int FORCE_GRAIN_SIZE = 16;
+
+	vector<Node> _nodes;
+	// The nodes whose bodies share a walk of the tree, each the highest with few enough bodies
+	vector<int> _groups;
+	// The subtrees under each cell at SPLIT_DEPTH, before they are spliced into _nodes
+	vector<vector<Node>> _cellNodes;
+
+	// The bodies in Morton order, with their index in the arrays the tree was built from
+	vector<float> _x, _y, _z, _mass;
+	vector<int> _bodies;
+	vector<SortEntry> _sorted;
+	vector<SortEntry> _sortScratch;
+	vector<int> _histograms;
+
+	float _rootX, _rootY, _rootZ;
+	float _rootSize;
+
+	void ComputeCodes(const float * x, const float * y, const float * z, int count, JobSystem * jobSystem);
+	void SortCodes(JobSystem * jobSystem);
+	void BuildNode(int begin, int end, int depth, vector<Node>& nodes, bool spliceCells) const;
+
+public:
+	BarnesHutTree();
+	~BarnesHutTree();
+
+	// Builds the tree over count bodies, on the job system's threads when one is given
+	void Build(const float * x, const float * y, const float * z, const float * mass, int count, JobSystem * jobSystem = nullptr);
+
+	// Writes the acceleration on every body the tree was built from into ax, ay and az, indexed
+	// as the bodies were. A node is treated as one body when its size is less than openingAngle
+	// times its distance, so an opening angle of 0 sums every pair exactly. Distances are
+	// softened by softening so that close passes don't fling bodies away. Returns the number
+	// of bodies and nodes that pulled on a body, summed over every body.
+	long long ComputeAccelerations(float openingAngle, float softening, float * ax, float * ay, float * az,
+		JobSystem * jobSystem = nullptr) const;
+
+	int GetNodeCount() const { return (int)_nodes.size(); }
+	int GetBodyCount() const { return (int)_bodies.size(); }
+};
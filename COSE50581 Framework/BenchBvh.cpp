@@ -0,0 +1,187 @@
+// Measures building and refitting a BoundingVolumeHierarchy over an asteroid field, and how
+// many frustum, range and ray queries it answers per second. Every query is checked against
+// testing each sphere in turn.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Camera.h"
+
+using namespace std;
+
+namespace
+{
+	const float FIELD_SIZE = 1000.0f;
+
+	int RaycastEverything(const vector<SphereBounds>& spheres, const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance)
+	{
+		int hitObject = -1;
+		float closest = maxDistance;
+
+		for (int i = 0; i < (int)spheres.size(); i++)
+		{
+			float distance = BoundingVolumeHierarchy::IntersectRaySphere(origin, direction, spheres[i]);
+			if (distance >= 0.0f && distance < closest)
+			{
+				closest = distance;
+				hitObject = i;
+			}
+		}
+
+		return hitObject;
+	}
+
+	bool SameObjects(vector<int> a, vector<int> b)
+	{
+		sort(a.begin(), a.end());
+		sort(b.begin(), b.end());
+		return a == b;
+	}
+}
+
+void BenchmarkBvh()
+{
+	Camera camera(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f),
+		1280.0f, 720.0f, 0.01f, 100.0f);
+	camera.CalculateViewProjection();
+	Frustum frustum = Frustum::FromViewProjection(camera.GetViewProjection());
+
+	const int objectCounts[] = { 10000, 100000, 1000000 };
+	const int RAY_COUNT = 10000;
+	const int CHECKED_QUERIES = 100;
+
+	printf("%9s %9s %9s %9s %12s %12s %12s %12s %8s\n",
+		"objects", "nodes", "build ms", "refit ms", "frustum us", "(brute us)", "range us", "ray us", "match");
+
+	for (int objectCount : objectCounts)
+	{
+		mt19937 randomGenerator(1);
+		uniform_real_distribution<float> position(-FIELD_SIZE, FIELD_SIZE);
+		uniform_real_distribution<float> radius(0.5f, 2.0f);
+		uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+		vector<SphereBounds> spheres(objectCount);
+		for (SphereBounds& sphere : spheres)
+		{
+			sphere.Center = XMFLOAT3(position(randomGenerator), position(randomGenerator), position(randomGenerator));
+			sphere.Radius = radius(randomGenerator);
+		}
+
+		BoundingVolumeHierarchy bvh;
+		BenchmarkTimer buildTimer;
+		bvh.Build(spheres.data(), objectCount);
+		double buildMs = buildTimer.GetSeconds() * 1e3;
+
+		// Move every object a little, as a frame of simulation would, and refit
+		for (SphereBounds& sphere : spheres)
+		{
+			sphere.Center.x += signedUnit(randomGenerator);
+			sphere.Center.y += signedUnit(randomGenerator);
+			sphere.Center.z += signedUnit(randomGenerator);
+		}
+
+		BenchmarkTimer refitTimer;
+		bvh.Refit(spheres.data());
+		double refitMs = refitTimer.GetSeconds() * 1e3;
+
+		bool match = true;
+
+		// Frustum queries, against the SIMD culler testing every sphere
+		vector<int> results;
+		int frames = 0;
+		BenchmarkTimer frustumTimer;
+		do
+		{
+			results.clear();
+			bvh.QueryFrustum(frustum, results);
+			frames++;
+		} while (frustumTimer.GetSeconds() < 0.25);
+		double frustumUs = frustumTimer.GetSeconds() * 1e6 / frames;
+
+		FrustumCuller frustumCuller;
+		frustumCuller.Reserve(objectCount);
+		for (const SphereBounds& sphere : spheres)
+		{
+			frustumCuller.Add(sphere);
+		}
+
+		frames = 0;
+		BenchmarkTimer bruteTimer;
+		do
+		{
+			frustumCuller.Cull(frustum);
+			frames++;
+		} while (bruteTimer.GetSeconds() < 0.25);
+		double bruteUs = bruteTimer.GetSeconds() * 1e6 / frames;
+
+		vector<int> expected;
+		for (int i = 0; i < objectCount; i++)
+		{
+			if (frustumCuller.IsVisible(i))
+				expected.push_back(i);
+		}
+		match = match && SameObjects(results, expected);
+
+		// Range queries around random points, such as finding everything near an explosion
+		vector<SphereBounds> ranges(RAY_COUNT);
+		for (SphereBounds& range : ranges)
+		{
+			range.Center = XMFLOAT3(position(randomGenerator), position(randomGenerator), position(randomGenerator));
+			range.Radius = 50.0f;
+		}
+
+		BenchmarkTimer rangeTimer;
+		for (const SphereBounds& range : ranges)
+		{
+			results.clear();
+			bvh.QuerySphere(range, results);
+		}
+		double rangeUs = rangeTimer.GetSeconds() * 1e6 / RAY_COUNT;
+
+		for (int q = 0; q < CHECKED_QUERIES; q++)
+		{
+			results.clear();
+			bvh.QuerySphere(ranges[q], results);
+
+			expected.clear();
+			for (int i = 0; i < objectCount; i++)
+			{
+				float x = spheres[i].Center.x - ranges[q].Center.x;
+				float y = spheres[i].Center.y - ranges[q].Center.y;
+				float z = spheres[i].Center.z - ranges[q].Center.z;
+				float reach = spheres[i].Radius + ranges[q].Radius;
+				if (x * x + y * y + z * z <= reach * reach)
+					expected.push_back(i);
+			}
+			match = match && SameObjects(results, expected);
+		}
+
+		// Picking rays from random points in random directions
+		vector<XMFLOAT3> origins(RAY_COUNT), directions(RAY_COUNT);
+		for (int r = 0; r < RAY_COUNT; r++)
+		{
+			origins[r] = XMFLOAT3(position(randomGenerator), position(randomGenerator), position(randomGenerator));
+			XMStoreFloat3(&directions[r], XMVector3Normalize(XMVectorSet(signedUnit(randomGenerator), signedUnit(randomGenerator), signedUnit(randomGenerator), 0.0f)));
+		}
+
+		vector<int> hits(RAY_COUNT);
+		BenchmarkTimer rayTimer;
+		for (int r = 0; r < RAY_COUNT; r++)
+		{
+			float distance;
+			hits[r] = bvh.Raycast(origins[r], directions[r], 2.0f * FIELD_SIZE, &distance);
+		}
+		double rayUs = rayTimer.GetSeconds() * 1e6 / RAY_COUNT;
+
+		for (int r = 0; r < CHECKED_QUERIES; r++)
+		{
+			match = match && hits[r] == RaycastEverything(spheres, origins[r], directions[r], 2.0f * FIELD_SIZE);
+		}
+
+		printf("%9d %9d %9.2f %9.2f %12.1f %12.1f %12.2f %12.2f %8s\n",
+			objectCount, bvh.GetNodeCount(), buildMs, refitMs, frustumUs, bruteUs, rangeUs, rayUs, BenchmarkCheck(match) ? "yes" : "NO");
+	}
+}
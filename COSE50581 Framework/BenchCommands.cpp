@@ -0,0 +1,128 @@
+// Measures recording the render queue into command buffers on 1 to N threads, and checks that
+// replaying the buffers in order makes exactly the same calls, with the same data, as flushing
+// the queue straight to a device on one thread.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Benchmarks.h"
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "LoggingRenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+namespace
+{
+	const int DRAW_COUNT = 100000;
+	const int MESH_COUNT = 64;
+	const int DRAWS_PER_BUFFER = 1024;
+	const int MATERIAL_COUNT = 4;
+
+	// The draws mix materials too, so that a buffer starting partway through a material has to
+	// carry it over from the buffer before, as it does the other state. Materials come in
+	// identical pairs, whose changes skip the upload only when the carried over data is known.
+	void SubmitDraws(RenderQueue& renderQueue, const vector<MeshData>& meshes)
+	{
+		mt19937 randomGenerator(1);
+		uniform_int_distribution<int> state(0, 255);
+		uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+		MaterialConstants materials[MATERIAL_COUNT] = {};
+		for (int i = 0; i < MATERIAL_COUNT; i++)
+			materials[i].gSpecularPower = 10.0f * (i / 2 + 1);
+
+		renderQueue.SetMaterials(materials, MATERIAL_COUNT);
+		renderQueue.Begin();
+
+		for (int i = 0; i < DRAW_COUNT; i++)
+		{
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixTranslation(position(randomGenerator), position(randomGenerator), position(randomGenerator)));
+
+			int bits = state(randomGenerator);
+			renderQueue.Submit(0, bits & 1, (bits >> 1) & 7, (bits >> 4) % MATERIAL_COUNT, meshes[state(randomGenerator) % MESH_COUNT], world._43 + 100.0f, world);
+		}
+	}
+}
+
+void BenchmarkCommands()
+{
+	// Fake buffer pointers are enough to tell the meshes apart, nothing dereferences them
+	vector<MeshData> meshes(MESH_COUNT);
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		meshes[i] = MeshData();
+		meshes[i].VertexBuffer = reinterpret_cast<ID3D11Buffer *>((size_t)(i + 1) * 16);
+		meshes[i].IndexBuffer = reinterpret_cast<ID3D11Buffer *>((size_t)(i + 1) * 16 + 8);
+		meshes[i].IndexCount = 36 + i;
+	}
+
+	// What a single thread flushing straight to the device does
+	RenderQueue referenceQueue;
+	LoggingRenderDevice referenceDevice;
+	ConstantBufferCache constantBufferCache;
+	SubmitDraws(referenceQueue, meshes);
+	referenceQueue.Flush(referenceDevice, constantBufferCache);
+
+	int hardwareThreads = max(1, (int)thread::hardware_concurrency());
+	vector<int> threadCounts;
+	for (int threads = 1; threads < max(4, hardwareThreads); threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(max(4, hardwareThreads));
+
+	printf("hardware threads: %d, %d draws, %d draws per buffer\n", hardwareThreads, DRAW_COUNT, DRAWS_PER_BUFFER);
+	printf("%8s %10s %16s %10s %12s %12s\n", "threads", "record ms", "draws/ms/thread", "replay ms", "buffer KB", "same calls");
+
+	for (int threads : threadCounts)
+	{
+		JobSystem jobSystem(threads - 1);
+		RenderQueue renderQueue;
+		vector<CommandBuffer> commandBuffers;
+		SubmitDraws(renderQueue, meshes);
+
+		int frames = 0;
+		BenchmarkTimer recordTimer;
+		do
+		{
+			renderQueue.Record(jobSystem, commandBuffers, DRAWS_PER_BUFFER);
+			frames++;
+		} while (recordTimer.GetSeconds() < 0.25);
+		double recordMs = recordTimer.GetSeconds() * 1e3 / frames;
+
+		RecordingRenderDevice renderDevice;
+		frames = 0;
+		BenchmarkTimer replayTimer;
+		do
+		{
+			renderDevice.Clear();
+			for (const CommandBuffer& commandBuffer : commandBuffers)
+				commandBuffer.Replay(renderDevice);
+			frames++;
+		} while (replayTimer.GetSeconds() < 0.25);
+		double replayMs = replayTimer.GetSeconds() * 1e3 / frames;
+
+		LoggingRenderDevice loggingDevice;
+		long long bufferBytes = 0;
+		for (const CommandBuffer& commandBuffer : commandBuffers)
+		{
+			commandBuffer.Replay(loggingDevice);
+			bufferBytes += commandBuffer.GetSize();
+		}
+
+		const RenderQueue::Stats& stats = renderQueue.GetStats();
+		const RenderQueue::Stats& referenceStats = referenceQueue.GetStats();
+		bool same = loggingDevice.GetLog() == referenceDevice.GetLog() && renderDevice.GetDraws() == DRAW_COUNT &&
+			stats.draws == referenceStats.draws && stats.meshChanges == referenceStats.meshChanges &&
+			stats.materialChanges == referenceStats.materialChanges &&
+			stats.objectConstantUploads == referenceStats.objectConstantUploads &&
+			stats.materialConstantUploads == referenceStats.materialConstantUploads;
+
+		printf("%8d %10.3f %16.0f %10.3f %12.1f %12s\n", threads, recordMs, DRAW_COUNT / recordMs / threads, replayMs,
+			bufferBytes / 1024.0, BenchmarkCheck(same) ? "yes" : "NO");
+	}
+}
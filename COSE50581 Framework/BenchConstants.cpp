@@ -0,0 +1,147 @@
+// Compares the constant buffer traffic of the solar system scene before and after the constants
+// were split into per-frame, per-material and per-object buffers. Both sides upload the same
+// objects, the bodies and then the asteroids one at a time, with the materials the scene gives them.
+
+#include <cstdio>
+#include "Benchmarks.h"
+#include "ConstantBuffers.h"
+#include "RecordingRenderDevice.h"
+#include "SolarSystem.h"
+
+namespace
+{
+	// The single constant buffer Application used to upload in full for every object
+	struct LegacyConstantBuffer
+	{
+		XMMATRIX mWorld;
+		XMMATRIX mView;
+		XMMATRIX mProjection;
+
+		XMFLOAT4 diffuseMaterial;
+		XMFLOAT4 diffuseLight;
+
+		XMFLOAT4 gAmbientMtrl;
+		XMFLOAT4 gAmbientLight;
+
+		XMFLOAT4 gSpecularMtrl;
+		XMFLOAT4 gSpecularLight;
+		float gSpecularPower;
+
+		XMFLOAT3 gEyePosW;
+		XMFLOAT3 lightVecW;
+	};
+
+	MaterialConstants MakeMaterialConstants(const SolarSystem::Material& material)
+	{
+		MaterialConstants materialConstants = {};
+		materialConstants.diffuseMaterial = material.diffuse;
+		materialConstants.gAmbientMtrl = material.ambient;
+		materialConstants.gSpecularMtrl = material.specular;
+		materialConstants.gSpecularPower = material.specularPower;
+		return materialConstants;
+	}
+
+	// Sends the whole buffer for the object, as Application did before the split
+	void UploadLegacyObject(RenderDevice& renderDevice, const GameObject& gameObject, const MaterialConstants& material)
+	{
+		XMFLOAT4X4 world = gameObject.GetWorld();
+
+		LegacyConstantBuffer legacyConstants = {};
+		legacyConstants.mWorld = XMMatrixTranspose(XMLoadFloat4x4(&world));
+		legacyConstants.diffuseMaterial = material.diffuseMaterial;
+		legacyConstants.gAmbientMtrl = material.gAmbientMtrl;
+		legacyConstants.gSpecularMtrl = material.gSpecularMtrl;
+		legacyConstants.gSpecularPower = material.gSpecularPower;
+		renderDevice.UpdateConstantBuffer(CB_OBJECT, &legacyConstants, sizeof(legacyConstants));
+	}
+
+	// Sends the object's material if it differs from the last one, then its world matrix
+	void UploadObject(ConstantBufferCache& cache, RenderDevice& renderDevice, const GameObject& gameObject, const MaterialConstants& material)
+	{
+		XMFLOAT4X4 world = gameObject.GetWorld();
+
+		ObjectConstants objectConstants;
+		objectConstants.mWorld = XMMatrixTranspose(XMLoadFloat4x4(&world));
+		cache.Update(renderDevice, CB_MATERIAL, &material, sizeof(material));
+		cache.Update(renderDevice, CB_OBJECT, &objectConstants, sizeof(objectConstants));
+	}
+}
+
+void BenchmarkConstants()
+{
+	SceneFile scene;
+	if (!scene.Load(SOLAR_SYSTEM_SCENE_PATH))
+	{
+		printf("%s\n", scene.GetError().c_str());
+		BenchmarkCheck(false);
+		return;
+	}
+
+	MeshData meshData = {};
+	SolarSystem solarSystem;
+	solarSystem.Initialise(scene, meshData, meshData);
+
+	vector<MaterialConstants> materials(solarSystem.GetMaterialCount());
+	for (int i = 0; i < solarSystem.GetMaterialCount(); i++)
+		materials[i] = MakeMaterialConstants(solarSystem.GetMaterial(i));
+
+	const MaterialConstants& beltMaterial = materials[solarSystem.GetBeltMaterialIndex()];
+	int objectCount = solarSystem.GetBodyCount() + solarSystem.GetAsteroidCount();
+
+	ConstantBufferCache cache;
+	RecordingRenderDevice legacyDevice;
+	RecordingRenderDevice renderDevice;
+
+	FrameConstants frameConstants = {};
+
+	const int frameCount = 1000;
+	double legacySeconds = 0.0;
+	double seconds = 0.0;
+
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		solarSystem.Update(frame / 60.0f);
+
+		BenchmarkTimer legacyTimer;
+
+		for (int i = 0; i < solarSystem.GetBodyCount(); i++)
+			UploadLegacyObject(legacyDevice, solarSystem.GetBody(i), materials[solarSystem.GetBodyMaterialIndex(i)]);
+
+		for (int i = 0; i < solarSystem.GetAsteroidCount(); i++)
+			UploadLegacyObject(legacyDevice, solarSystem.GetAsteroid(i), beltMaterial);
+
+		legacySeconds += legacyTimer.GetSeconds();
+		BenchmarkTimer timer;
+
+		// The camera is still, so the frame constants only change on the first frame
+		cache.Update(renderDevice, CB_FRAME, &frameConstants, sizeof(frameConstants));
+
+		for (int i = 0; i < solarSystem.GetBodyCount(); i++)
+			UploadObject(cache, renderDevice, solarSystem.GetBody(i), materials[solarSystem.GetBodyMaterialIndex(i)]);
+
+		for (int i = 0; i < solarSystem.GetAsteroidCount(); i++)
+			UploadObject(cache, renderDevice, solarSystem.GetAsteroid(i), beltMaterial);
+
+		seconds += timer.GetSeconds();
+	}
+
+	double legacyBytesPerFrame = (double)legacyDevice.GetConstantBufferBytes() / frameCount;
+	double bytesPerFrame = (double)renderDevice.GetConstantBufferBytes() / frameCount;
+
+	printf("objects per frame: %d (%d bodies, %d asteroids)\n", objectCount, solarSystem.GetBodyCount(), solarSystem.GetAsteroidCount());
+	printf("bytes per frame before: %.1f (%d uploads of %d bytes), ns per frame: %.1f\n", legacyBytesPerFrame,
+		legacyDevice.GetConstantBufferUploads(CB_OBJECT) / frameCount, (int)sizeof(LegacyConstantBuffer), legacySeconds * 1e9 / frameCount);
+	printf("bytes per frame after:  %.1f (frame %d, material %d, object %d uploads over %d frames), ns per frame: %.1f\n",
+		bytesPerFrame, renderDevice.GetConstantBufferUploads(CB_FRAME), renderDevice.GetConstantBufferUploads(CB_MATERIAL),
+		renderDevice.GetConstantBufferUploads(CB_OBJECT), frameCount, seconds * 1e9 / frameCount);
+	printf("skipped uploads: %d\n", cache.GetStats().skipped);
+
+	// Every object still sends its world matrix, so the split can only save the rest of the buffer
+	bool sameObjects = legacyDevice.GetConstantBufferUploads(CB_OBJECT) == objectCount * frameCount &&
+		renderDevice.GetConstantBufferUploads(CB_OBJECT) == objectCount * frameCount;
+	bool smaller = bytesPerFrame < legacyBytesPerFrame;
+
+	printf("same objects uploaded on both sides: %s\n", BenchmarkCheck(sameObjects) ? "yes" : "NO");
+	printf("fewer bytes after the split: %s (%.1f%% of before)\n", BenchmarkCheck(smaller) ? "yes" : "NO",
+		legacyBytesPerFrame > 0.0 ? bytesPerFrame * 100.0 / legacyBytesPerFrame : 0.0);
+}
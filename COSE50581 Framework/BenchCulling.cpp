@@ -0,0 +1,91 @@
+// Measures frustum culling of bounding spheres with the scalar, SSE and AVX paths of
+// FrustumCuller, and the widest path split over the job system's threads, and checks every one
+// against Frustum::Intersects.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+
+using namespace std;
+
+void BenchmarkCulling()
+{
+	// The same view as the application: looking at the origin from just behind it
+	Camera camera(XMFLOAT4(0.0f, 0.0f, -3.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f),
+		1280.0f, 720.0f, 0.01f, 100.0f);
+	camera.CalculateViewProjection();
+	Frustum frustum = Frustum::FromViewProjection(camera.GetViewProjection());
+
+	const int sphereCounts[] = { 1000, 100000, 1000000 };
+	const CullPath paths[] = { CULL_SCALAR, CULL_SIMD4, CULL_SIMD8 };
+	const char * pathNames[] = { "scalar", "sse", "avx" };
+
+	CullPath widestPath = FrustumCuller::GetWidestPath();
+	JobSystem jobSystem;
+	char threadedName[32];
+	snprintf(threadedName, sizeof(threadedName), "%s x%d", pathNames[widestPath], jobSystem.GetThreadCount());
+
+	printf("widest path on this machine: %s\n", pathNames[widestPath]);
+	printf("%10s %8s %12s %10s %12s\n", "spheres", "path", "ns/sphere", "visible", "matches ref");
+
+	for (int sphereCount : sphereCounts)
+	{
+		// Spheres scattered through a box around the camera, so that a good share of them
+		// straddle a plane
+		mt19937 randomGenerator(1);
+		uniform_real_distribution<float> position(-100.0f, 100.0f);
+		uniform_real_distribution<float> radius(0.1f, 5.0f);
+
+		FrustumCuller frustumCuller;
+		frustumCuller.Reserve(sphereCount);
+		vector<unsigned char> reference(sphereCount);
+		int referenceVisible = 0;
+
+		for (int i = 0; i < sphereCount; i++)
+		{
+			SphereBounds sphere = { XMFLOAT3(position(randomGenerator), position(randomGenerator), position(randomGenerator)), radius(randomGenerator) };
+			frustumCuller.Add(sphere);
+			reference[i] = frustum.Intersects(sphere) ? 1 : 0;
+			referenceVisible += reference[i];
+		}
+
+		// The last run is the widest path on every thread
+		for (int p = 0; p < 4; p++)
+		{
+			bool threaded = p == 3;
+			CullPath path = threaded ? widestPath : paths[p];
+			const char * pathName = threaded ? threadedName : pathNames[p];
+
+			if (path > widestPath)
+			{
+				printf("%10d %8s %12s\n", sphereCount, pathName, "not supported");
+				continue;
+			}
+
+			int frames = 0;
+			int visibleCount = 0;
+			BenchmarkTimer timer;
+
+			do
+			{
+				visibleCount = threaded ? frustumCuller.Cull(frustum, jobSystem, path) : frustumCuller.Cull(frustum, path);
+				frames++;
+			} while (timer.GetSeconds() < 0.25);
+
+			double nsPerSphere = timer.GetSeconds() * 1e9 / (static_cast<double>(frames) * sphereCount);
+
+			int mismatches = 0;
+			for (int i = 0; i < sphereCount; i++)
+			{
+				mismatches += frustumCuller.IsVisible(i) != (reference[i] != 0);
+			}
+
+			printf("%10d %8s %12.3f %10d %12s\n", sphereCount, pathName, nsPerSphere, visibleCount,
+				BenchmarkCheck(mismatches == 0 && visibleCount == referenceVisible) ? "yes" : "NO");
+		}
+	}
+}
@@ -0,0 +1,80 @@
+// Measures how fast InstanceBatcher turns a belt of asteroids into instanced draws, recording
+// the draws instead of sending them to a GPU.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmarks.h"
+#include "InstanceBatcher.h"
+#include "RecordingRenderDevice.h"
+
+using namespace std;
+
+void BenchmarkInstancing()
+{
+	// Two meshes, to show that objects are grouped by the mesh they share
+	MeshData cubeMeshData = {};
+	cubeMeshData.VBStride = sizeof(XMFLOAT3) * 2;
+	cubeMeshData.IndexCount = 36;
+	MeshData rockMeshData = cubeMeshData;
+	rockMeshData.IndexCount = 60;
+
+	const int instanceCounts[] = { 100, 100000, 1000000 };
+
+	printf("%10s %8s %14s %12s\n", "instances", "draws", "ns/instance", "draws ok");
+
+	for (int instanceCount : instanceCounts)
+	{
+		vector<XMFLOAT4X4> worlds(instanceCount);
+		for (int i = 0; i < instanceCount; i++)
+		{
+			XMStoreFloat4x4(&worlds[i], XMMatrixTranslation((float)i, 0.0f, 0.0f));
+		}
+
+		InstanceBatcher instanceBatcher;
+		RecordingRenderDevice renderDevice;
+		int frames = 0;
+		BenchmarkTimer timer;
+
+		do
+		{
+			renderDevice.Clear();
+			instanceBatcher.Begin();
+
+			for (int i = 0; i < instanceCount; i++)
+			{
+				instanceBatcher.Add(i % 4 == 0 ? rockMeshData : cubeMeshData, worlds[i]);
+			}
+
+			instanceBatcher.Submit(renderDevice);
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		double nsPerInstance = timer.GetSeconds() * 1e9 / (static_cast<double>(frames) * instanceCount);
+
+		// Every instance has to be drawn exactly once, from one upload, with one draw per mesh.
+		// The worlds are translated by their object's index, which says which mesh it was given.
+		const vector<RecordingRenderDevice::DrawCall>& drawCalls = renderDevice.GetDrawCalls();
+		const vector<XMFLOAT4X4>& instances = renderDevice.GetInstances();
+		int drawnInstances = 0;
+		bool rangesOk = true;
+
+		for (const RecordingRenderDevice::DrawCall& drawCall : drawCalls)
+		{
+			rangesOk = rangesOk && drawCall.startInstance == drawnInstances &&
+				drawCall.startInstance + drawCall.instanceCount <= (int)instances.size();
+
+			for (int i = 0; rangesOk && i < drawCall.instanceCount; i++)
+			{
+				int object = (int)instances[drawCall.startInstance + i]._41;
+				rangesOk = (object % 4 == 0 ? rockMeshData : cubeMeshData).IndexCount == drawCall.meshData.IndexCount;
+			}
+
+			drawnInstances += drawCall.instanceCount;
+		}
+
+		bool drawsOk = rangesOk && drawCalls.size() == 2 && drawnInstances == instanceCount &&
+			renderDevice.GetInstanceUploads() == 1 && (int)instances.size() == instanceCount;
+
+		printf("%10d %8d %14.2f %12s\n", instanceCount, (int)drawCalls.size(), nsPerInstance, BenchmarkCheck(drawsOk) ? "yes" : "NO");
+	}
+}
@@ -0,0 +1,184 @@
+// Measures how the per-frame work shared out by the JobSystem scales from one thread upwards:
+// scene graph transform updates, frustum culling and packing object constants in the render
+// queue. Every thread count has to produce exactly the same results as one thread.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Benchmarks.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "RecordingRenderDevice.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+
+using namespace std;
+
+namespace
+{
+	const int ROOT_COUNT = 256;
+	const int CHILDREN_PER_ROOT = 1024;
+	const int SPHERE_COUNT = 1000000;
+	const int DRAW_COUNT = 100000;
+
+	// Hashes the constant data it's sent, so that runs can be compared byte for byte
+	class ChecksumRenderDevice : public RecordingRenderDevice
+	{
+	private:
+		uint64_t _checksum;
+
+	public:
+		ChecksumRenderDevice() : _checksum(14695981039346656037ull) {}
+
+		void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override
+		{
+			const unsigned char * bytes = static_cast<const unsigned char *>(data);
+			for (int i = 0; i < size; i++)
+				_checksum = (_checksum ^ bytes[i]) * 1099511628211ull;
+
+			RecordingRenderDevice::UpdateConstantBuffer(slot, data, size);
+		}
+
+		uint64_t GetChecksum() const { return _checksum; }
+	};
+
+	struct Results
+	{
+		vector<XMFLOAT4X4> worlds;
+		vector<unsigned char> visible;
+		uint64_t constantsChecksum;
+	};
+
+	// Milliseconds per call of frame
+	double TimeFrames(const function<void()>& frame)
+	{
+		int frames = 0;
+		BenchmarkTimer timer;
+
+		do
+		{
+			frame();
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e3 / frames;
+	}
+}
+
+void BenchmarkJobs()
+{
+	int hardwareThreads = max(1, (int)thread::hardware_concurrency());
+	printf("hardware threads: %d\n", hardwareThreads);
+
+	// A wide scene graph: every root moves each frame, so all of its children are updated
+	SceneGraph sceneGraph;
+	vector<int> roots, nodes;
+	for (int r = 0; r < ROOT_COUNT; r++)
+	{
+		roots.push_back(sceneGraph.AddNode());
+		for (int c = 0; c < CHILDREN_PER_ROOT; c++)
+		{
+			int node = sceneGraph.AddNode(roots[r]);
+			sceneGraph.SetLocal(node, XMMatrixTranslation((float)c, 0.0f, 0.0f));
+			nodes.push_back(node);
+		}
+	}
+
+	mt19937 randomGenerator(1);
+	uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+	FrustumCuller frustumCuller;
+	frustumCuller.Reserve(SPHERE_COUNT);
+	for (int i = 0; i < SPHERE_COUNT; i++)
+	{
+		SphereBounds sphere = { XMFLOAT3(position(randomGenerator), position(randomGenerator), position(randomGenerator)), 1.0f };
+		frustumCuller.Add(sphere);
+	}
+
+	Camera camera(XMFLOAT4(0.0f, 0.0f, -3.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f),
+		1280.0f, 720.0f, 0.01f, 100.0f);
+	camera.CalculateViewProjection();
+	Frustum frustum = Frustum::FromViewProjection(camera.GetViewProjection());
+
+	MeshData meshData = {};
+	meshData.IndexCount = 36;
+	vector<XMFLOAT4X4> drawWorlds(DRAW_COUNT);
+	vector<float> drawDepths(DRAW_COUNT);
+	for (int i = 0; i < DRAW_COUNT; i++)
+	{
+		XMStoreFloat4x4(&drawWorlds[i], XMMatrixTranslation(position(randomGenerator), position(randomGenerator), position(randomGenerator)));
+		drawDepths[i] = drawWorlds[i]._43 + 100.0f;
+	}
+
+	// Up to the hardware thread count, and always at least 4 so that stealing gets exercised
+	vector<int> threadCounts;
+	for (int threads = 1; threads < max(4, hardwareThreads); threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(max(4, hardwareThreads));
+
+	printf("%8s %12s %8s %12s %8s %12s %8s %14s\n", "threads", "scene ms", "speedup", "culling ms", "speedup", "packing ms", "speedup", "same as 1");
+
+	Results reference;
+	double baseline[3] = {};
+
+	for (int threads : threadCounts)
+	{
+		JobSystem jobSystem(threads - 1);
+
+		double sceneMs = TimeFrames([&]()
+		{
+			for (int root : roots)
+				sceneGraph.SetLocal(root, XMMatrixTranslation((float)root, 1.0f, 0.0f));
+			sceneGraph.UpdateWorlds(&jobSystem);
+		});
+
+		double cullMs = TimeFrames([&]() { frustumCuller.Cull(frustum, jobSystem); });
+
+		RenderQueue renderQueue;
+		ChecksumRenderDevice renderDevice;
+		ConstantBufferCache constantBufferCache;
+		double packMs = TimeFrames([&]()
+		{
+			renderQueue.Begin();
+			for (int i = 0; i < DRAW_COUNT; i++)
+				renderQueue.Submit(0, 0, 0, 0, meshData, drawDepths[i], drawWorlds[i]);
+			constantBufferCache.Invalidate();
+			renderQueue.Flush(renderDevice, constantBufferCache, &jobSystem);
+		});
+
+		// One more frame of each from a known state, to compare with the single thread run
+		ChecksumRenderDevice checkDevice;
+		constantBufferCache.Invalidate();
+		renderQueue.Begin();
+		for (int i = 0; i < DRAW_COUNT; i++)
+			renderQueue.Submit(0, 0, 0, 0, meshData, drawDepths[i], drawWorlds[i]);
+		renderQueue.Flush(checkDevice, constantBufferCache, &jobSystem);
+
+		Results results;
+		for (int node : nodes)
+			results.worlds.push_back(sceneGraph.GetWorld(node));
+		frustumCuller.Cull(frustum, jobSystem);
+		results.visible.assign(frustumCuller.GetVisibility(), frustumCuller.GetVisibility() + frustumCuller.GetCount());
+		results.constantsChecksum = checkDevice.GetChecksum();
+
+		if (threads == 1)
+		{
+			reference = results;
+			baseline[0] = sceneMs;
+			baseline[1] = cullMs;
+			baseline[2] = packMs;
+		}
+
+		bool same = memcmp(results.worlds.data(), reference.worlds.data(), results.worlds.size() * sizeof(XMFLOAT4X4)) == 0 &&
+			results.visible == reference.visible && results.constantsChecksum == reference.constantsChecksum;
+
+		printf("%8d %12.3f %8.2f %12.3f %8.2f %12.3f %8.2f %14s\n", threads,
+			sceneMs, baseline[0] / sceneMs, cullMs, baseline[1] / cullMs, packMs, baseline[2] / packMs, BenchmarkCheck(same) ? "yes" : "NO");
+	}
+}
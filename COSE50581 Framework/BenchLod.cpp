@@ -0,0 +1,160 @@
+// Measures what levels of detail save in the asteroid belt scene. The solar system is drawn with
+// the software rasteriser from a few points of view, once with the bodies' icosphere chain and
+// once with every body at the most detailed level, comparing the triangles submitted and the
+// frame time. Then checks that the hysteresis stops an object whose size on screen wobbles
+// around a switch radius from changing level every frame.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "LodChain.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+#include "SolarSystem.h"
+
+using namespace std;
+
+namespace
+{
+	const int WIDTH = 1280;
+	const int HEIGHT = 720;
+
+	struct View
+	{
+		const char * name;
+		XMFLOAT3 eye;
+		XMFLOAT3 at;
+	};
+
+	const View VIEWS[] =
+	{
+		{ "start", XMFLOAT3(0.0f, 10.0f, -10.0f), XMFLOAT3(0.0f, 6.5f, 0.0f) },
+		{ "above belt", XMFLOAT3(0.0f, 4.0f, -8.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) },
+		{ "in belt", XMFLOAT3(0.0f, 0.05f, -1.0f), XMFLOAT3(1.0f, 0.0f, 2.0f) },
+		{ "near sun", XMFLOAT3(0.0f, 10.0f, -2.5f), XMFLOAT3(0.0f, 10.0f, 0.0f) },
+	};
+
+	void DrawView(SoftwareRenderDevice& renderDevice, JobSystem& jobSystem, SceneRenderer& sceneRenderer, SolarSystem& solarSystem,
+		const View& view)
+	{
+		XMFLOAT4X4 viewMatrix, projection;
+		XMStoreFloat4x4(&viewMatrix, XMMatrixLookAtLH(XMLoadFloat3(&view.eye), XMLoadFloat3(&view.at), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, WIDTH / (float)HEIGHT, 0.01f, 100.0f));
+
+		float clearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f };
+		renderDevice.Clear(clearColor);
+		sceneRenderer.Render(renderDevice, jobSystem, solarSystem, viewMatrix, projection, view.eye, false, true);
+		renderDevice.Rasterise(jobSystem);
+	}
+
+	double TimeView(SoftwareRenderDevice& renderDevice, JobSystem& jobSystem, SceneRenderer& sceneRenderer, SolarSystem& solarSystem,
+		const View& view)
+	{
+		int frames = 0;
+		BenchmarkTimer timer;
+		do
+		{
+			DrawView(renderDevice, jobSystem, sceneRenderer, solarSystem, view);
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e3 / frames;
+	}
+
+	// How often an object changes level over a run of frames whose screen radius wobbles by
+	// wobble either side of the chain's switch radius for the level
+	int CountSwitches(const LodChain& chain, int level, float wobble, float hysteresis)
+	{
+		float switchRadius = chain.GetMinScreenRadius(level);
+		int current = chain.SelectLevel(switchRadius, level, hysteresis);
+		int switches = 0;
+
+		for (int frame = 0; frame < 1000; frame++)
+		{
+			int next = chain.SelectLevel(switchRadius * (1.0f + wobble * sinf(frame * 0.7f)), current, hysteresis);
+			switches += next != current ? 1 : 0;
+			current = next;
+		}
+
+		return switches;
+	}
+}
+
+void BenchmarkLod()
+{
+	static SoftwareRenderDevice renderDevice(WIDTH, HEIGHT);
+	renderDevice.RegisterRasterizerState(RS_SOLID, false);
+	renderDevice.RegisterRasterizerState(RS_WIREFRAME, true);
+
+	// The bodies' chain, as the application builds it, and one with only its most detailed level
+	LodChain lodChain;
+	LodChain fullDetailChain;
+	for (int subdivisions = SolarSystem::BODY_LOD_SUBDIVISIONS; subdivisions >= 0; subdivisions--)
+	{
+		MeshGeometry sphere = CreateIcosphereGeometry(subdivisions);
+		MeshData meshData = renderDevice.CreateMesh(sphere);
+		lodChain.AddLevel(sphere, meshData);
+
+		if (subdivisions == SolarSystem::BODY_LOD_SUBDIVISIONS)
+			fullDetailChain.AddLevel(sphere, meshData);
+	}
+
+	printf("levels:");
+	for (int level = 0; level < lodChain.GetLevelCount(); level++)
+		printf("  %d triangles from %.1f px", lodChain.GetTriangleCount(level), lodChain.GetMinScreenRadius(level));
+	printf("\n");
+
+	SceneFile scene;
+	if (!scene.Load(SOLAR_SYSTEM_SCENE_PATH))
+	{
+		printf("%s\n", scene.GetError().c_str());
+		return;
+	}
+
+	static SolarSystem solarSystem;
+	srand(0);
+	solarSystem.Initialise(scene, renderDevice.CreateMesh(CreateCubeGeometry()), renderDevice.CreateMesh(CreatePlaneGeometry()));
+	int bodyMesh = scene.FindMesh("body");
+	solarSystem.Update(1.0f);
+
+	JobSystem jobSystem;
+	SceneRenderer sceneRenderer;
+	sceneRenderer.SetViewportHeight(HEIGHT);
+
+	printf("%12s %8s %12s %12s %8s %10s %10s  %s\n", "view", "objects", "triangles", "full detail", "saved", "lod ms",
+		"full ms", "objects per level");
+
+	for (const View& view : VIEWS)
+	{
+		solarSystem.SetMeshLodChain(bodyMesh, &fullDetailChain);
+		double fullMs = TimeView(renderDevice, jobSystem, sceneRenderer, solarSystem, view);
+		long long fullTriangles = sceneRenderer.GetLodStats().triangles;
+
+		solarSystem.SetMeshLodChain(bodyMesh, &lodChain);
+		double lodMs = TimeView(renderDevice, jobSystem, sceneRenderer, solarSystem, view);
+		SceneRenderer::LodStats stats = sceneRenderer.GetLodStats();
+
+		string levels;
+		for (int level = 0; level < lodChain.GetLevelCount(); level++)
+			levels += to_string(stats.levelObjects[level]) + (level + 1 < lodChain.GetLevelCount() ? " / " : "");
+
+		// The full detail draw has to submit exactly what the renderer counted as full detail
+		printf("%12s %8d %12lld %12lld %7.1f%% %10.2f %10.2f  %s%s\n", view.name, stats.objects, stats.triangles, fullTriangles,
+			100.0 * (1.0 - stats.triangles / (double)fullTriangles), lodMs, fullMs, levels.c_str(),
+			fullTriangles == stats.fullDetailTriangles ? "" : "  (full detail count differs)");
+	}
+
+	// Level changes over 1000 frames, without hysteresis and with it
+	printf("\n%8s %12s %8s %10s %10s %8s\n", "level", "switch px", "wobble", "without", "with", "stable");
+	for (int level = 0; level + 1 < lodChain.GetLevelCount(); level++)
+	{
+		const float wobble = 0.05f;
+		int withoutHysteresis = CountSwitches(lodChain, level, wobble, 0.0f);
+		int withHysteresis = CountSwitches(lodChain, level, wobble, LodChain::HYSTERESIS);
+
+		printf("%8d %12.1f %7.0f%% %10d %10d %8s\n", level, lodChain.GetMinScreenRadius(level), wobble * 100.0f, withoutHysteresis,
+			withHysteresis, BenchmarkCheck(withHysteresis == 0) ? "yes" : "NO");
+	}
+}
@@ -0,0 +1,178 @@
+// Measures loading a multi-million triangle mesh from Wavefront OBJ text against mapping the
+// same mesh as a mesh file, and checks that both give exactly the same vertices and indices.
+// The files are written to the working directory and deleted afterwards.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Benchmarks.h"
+#include "MeshFile.h"
+#include "ObjParser.h"
+
+using namespace std;
+
+namespace
+{
+	const char * OBJ_PATH = "BenchMeshLoad.obj";
+	const char * MESH_PATH = "BenchMeshLoad.mesh";
+	const int RUNS = 3;
+
+	// A rolling height field of gridSize x gridSize quads, split into two groups, with a normal
+	// for every position
+	bool WriteGridObj(const char * path, int gridSize)
+	{
+		FILE * file = fopen(path, "wb");
+		if (!file)
+			return false;
+
+		int side = gridSize + 1;
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				float height = sinf(x * 0.05f) * cosf(z * 0.07f) * 4.0f;
+				fprintf(file, "v %.6f %.6f %.6f\n", x * 0.1f, height, z * 0.1f);
+			}
+		}
+
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				float dx = cosf(x * 0.05f) * 0.05f * cosf(z * 0.07f) * 4.0f / 0.1f;
+				float dz = -sinf(x * 0.05f) * sinf(z * 0.07f) * 0.07f * 4.0f / 0.1f;
+				float length = sqrtf(dx * dx + 1.0f + dz * dz);
+				fprintf(file, "vn %.6f %.6f %.6f\n", -dx / length, 1.0f / length, -dz / length);
+			}
+		}
+
+		for (int z = 0; z < gridSize; z++)
+		{
+			if (z == 0 || z == gridSize / 2)
+				fprintf(file, "g half%d\n", z == 0 ? 0 : 1);
+
+			for (int x = 0; x < gridSize; x++)
+			{
+				int a = z * side + x + 1;
+				int b = a + 1;
+				int c = a + side;
+				int d = c + 1;
+				fprintf(file, "f %d//%d %d//%d %d//%d\n", a, a, c, c, b, b);
+				fprintf(file, "f %d//%d %d//%d %d//%d\n", b, b, c, c, d, d);
+			}
+		}
+
+		return fclose(file) == 0;
+	}
+
+	long long FileSize(const char * path)
+	{
+		FILE * file = fopen(path, "rb");
+		if (!file)
+			return 0;
+
+		fseek(file, 0, SEEK_END);
+		long long size = ftell(file);
+		fclose(file);
+		return size;
+	}
+
+	// Reads every byte of the mapped data, as uploading it to a buffer would
+	uint64_t TouchMesh(const MeshFile& meshFile)
+	{
+		uint64_t sum = 0;
+
+		const uint64_t * words = static_cast<const uint64_t *>(meshFile.GetVertexData());
+		for (size_t i = 0; i < meshFile.GetVertexDataSize() / sizeof(uint64_t); i++)
+			sum += words[i];
+
+		words = static_cast<const uint64_t *>(meshFile.GetIndexData());
+		for (size_t i = 0; i < meshFile.GetIndexDataSize() / sizeof(uint64_t); i++)
+			sum += words[i];
+
+		return sum;
+	}
+}
+
+void BenchmarkMeshLoad()
+{
+	const int gridSizes[] = { 500, 1000 };
+
+	printf("%10s %10s %10s %14s %10s %14s %14s %10s %10s\n", "triangles", "obj MB", "mesh MB", "parse obj ms",
+		"Mtris/s", "map mesh ms", "map+read ms", "speedup", "same");
+
+	for (int gridSize : gridSizes)
+	{
+		if (!WriteGridObj(OBJ_PATH, gridSize))
+		{
+			printf("could not write %s\n", OBJ_PATH);
+			return;
+		}
+
+		// Parse the text, keeping the fastest run so the file is in the page cache for both
+		MeshAsset asset;
+		string error;
+		double parseMs = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			BenchmarkTimer timer;
+			if (!LoadObj(OBJ_PATH, asset, error))
+			{
+				printf("%s: %s\n", OBJ_PATH, error.c_str());
+				remove(OBJ_PATH);
+				return;
+			}
+			parseMs = fmin(parseMs, timer.GetSeconds() * 1e3);
+		}
+
+		if (!WriteMeshFile(MESH_PATH, asset, error))
+		{
+			printf("%s: %s\n", MESH_PATH, error.c_str());
+			remove(OBJ_PATH);
+			return;
+		}
+
+		// Map the mesh file, on its own and then reading all of the data as an upload would
+		double mapMs = 1e30;
+		double mapAndReadMs = 1e30;
+		bool same = false;
+		volatile uint64_t sink = 0;
+
+		for (int run = 0; run < RUNS; run++)
+		{
+			MeshFile meshFile;
+			BenchmarkTimer timer;
+			bool opened = meshFile.Open(MESH_PATH);
+			mapMs = fmin(mapMs, timer.GetSeconds() * 1e3);
+
+			if (!opened)
+			{
+				printf("%s: %s\n", MESH_PATH, meshFile.GetError().c_str());
+				break;
+			}
+			meshFile.Close();
+
+			BenchmarkTimer readTimer;
+			meshFile.Open(MESH_PATH);
+			sink = sink + TouchMesh(meshFile);
+			mapAndReadMs = fmin(mapAndReadMs, readTimer.GetSeconds() * 1e3);
+
+			// The mapped data has to be exactly what was parsed
+			const MeshFileHeader& header = meshFile.GetHeader();
+			same = header.vertexCount == asset.vertices.size() && header.indexCount == asset.indices.size() &&
+				header.indexSize == 4 && header.submeshCount == 2 &&
+				memcmp(meshFile.GetVertexData(), asset.vertices.data(), meshFile.GetVertexDataSize()) == 0 &&
+				memcmp(meshFile.GetIndexData(), asset.indices.data(), meshFile.GetIndexDataSize()) == 0;
+		}
+
+		double triangles = asset.indices.size() / 3.0;
+		printf("%10.0f %10.1f %10.1f %14.1f %10.2f %14.3f %14.1f %9.0fx %10s\n", triangles, FileSize(OBJ_PATH) / 1e6,
+			FileSize(MESH_PATH) / 1e6, parseMs, triangles / parseMs / 1e3, mapMs, mapAndReadMs, parseMs / mapAndReadMs,
+			BenchmarkCheck(same) ? "yes" : "NO");
+
+		remove(OBJ_PATH);
+		remove(MESH_PATH);
+	}
+}
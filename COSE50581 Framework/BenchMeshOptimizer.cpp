@@ -0,0 +1,261 @@
+// Measures the mesh optimiser's stages on a few meshes: how long each takes, what it does to
+// the simulated vertex cache and vertex fetch, and the overdraw the software rasteriser sees
+// drawing the mesh from several sides. Checks after every stage that the mesh still has exactly
+// the same triangles, with the same winding.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "ConstantBuffers.h"
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+
+using namespace std;
+
+namespace
+{
+	const int WIDTH = 640;
+	const int HEIGHT = 480;
+	const int VIEW_COUNT = 6;
+
+	// One triangle as the vertices themselves, so it can be compared whatever the numbering
+	typedef array<float, 18> TriangleKey;
+
+	// A rolling height field, its triangles in row order as a simple exporter would write them
+	MeshAsset CreateGrid(int gridSize)
+	{
+		MeshAsset asset;
+		int side = gridSize + 1;
+
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				float u = x / (float)gridSize * XM_2PI * 3.0f;
+				float v = z / (float)gridSize * XM_2PI * 2.0f;
+
+				SimpleVertex vertex;
+				vertex.Pos = XMFLOAT3(x / (float)gridSize * 2.0f - 1.0f, sinf(u) * cosf(v) * 0.3f, z / (float)gridSize * 2.0f - 1.0f);
+				XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVectorSet(-cosf(u) * cosf(v) * 0.3f * 3.0f * XM_PI, 1.0f,
+					sinf(u) * sinf(v) * 0.3f * 2.0f * XM_PI, 0.0f)));
+				asset.vertices.push_back(vertex);
+			}
+		}
+
+		for (int z = 0; z < gridSize; z++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				uint32_t a = z * side + x;
+				uint32_t b = a + 1;
+				uint32_t c = a + side;
+				uint32_t d = c + 1;
+				uint32_t quad[6] = { a, c, b, b, c, d };
+				asset.indices.insert(asset.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return asset;
+	}
+
+	// The same grid with its triangles and vertices in random order, as after careless processing
+	MeshAsset CreateShuffledGrid(int gridSize)
+	{
+		MeshAsset asset = CreateGrid(gridSize);
+		mt19937 randomGenerator(1);
+
+		vector<array<uint32_t, 3>> triangles(asset.indices.size() / 3);
+		memcpy(triangles.data(), asset.indices.data(), asset.indices.size() * sizeof(uint32_t));
+		shuffle(triangles.begin(), triangles.end(), randomGenerator);
+		memcpy(asset.indices.data(), triangles.data(), asset.indices.size() * sizeof(uint32_t));
+
+		vector<uint32_t> remap(asset.vertices.size());
+		for (size_t i = 0; i < remap.size(); i++)
+			remap[i] = (uint32_t)i;
+		shuffle(remap.begin(), remap.end(), randomGenerator);
+
+		vector<SimpleVertex> vertices(asset.vertices.size());
+		for (size_t i = 0; i < remap.size(); i++)
+			vertices[remap[i]] = asset.vertices[i];
+		asset.vertices.swap(vertices);
+
+		for (uint32_t& index : asset.indices)
+			index = remap[index];
+
+		return asset;
+	}
+
+	// A ring with a wavy tube, which hides parts of itself from most sides
+	MeshAsset CreateTorus(int rings, int sides)
+	{
+		MeshAsset asset;
+
+		for (int ring = 0; ring < rings; ring++)
+		{
+			float u = ring / (float)rings * XM_2PI;
+
+			for (int side = 0; side < sides; side++)
+			{
+				float v = side / (float)sides * XM_2PI;
+				float tube = 0.3f + 0.05f * sinf(u * 8.0f);
+
+				XMVECTOR normal = XMVectorSet(cosf(v) * cosf(u), sinf(v), cosf(v) * sinf(u), 0.0f);
+				XMVECTOR centre = XMVectorSet(cosf(u), 0.0f, sinf(u), 0.0f);
+
+				SimpleVertex vertex;
+				XMStoreFloat3(&vertex.Pos, XMVectorAdd(centre, XMVectorScale(normal, tube)));
+				XMStoreFloat3(&vertex.Normal, normal);
+				asset.vertices.push_back(vertex);
+			}
+		}
+
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int side = 0; side < sides; side++)
+			{
+				uint32_t a = ring * sides + side;
+				uint32_t b = ring * sides + (side + 1) % sides;
+				uint32_t c = (ring + 1) % rings * sides + side;
+				uint32_t d = (ring + 1) % rings * sides + (side + 1) % sides;
+				uint32_t quad[6] = { a, b, c, b, d, c };
+				asset.indices.insert(asset.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return asset;
+	}
+
+	// Every triangle, each turned to start at its smallest vertex so the winding is kept, sorted
+	vector<TriangleKey> GetTriangleSet(const MeshAsset& asset)
+	{
+		vector<TriangleKey> triangles(asset.indices.size() / 3);
+
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			array<array<float, 6>, 3> corners;
+			for (int corner = 0; corner < 3; corner++)
+				memcpy(corners[corner].data(), &asset.vertices[asset.indices[i * 3 + corner]], sizeof(SimpleVertex));
+
+			int first = (int)(min_element(corners.begin(), corners.end()) - corners.begin());
+			for (int corner = 0; corner < 3; corner++)
+				memcpy(&triangles[i][corner * 6], corners[(first + corner) % 3].data(), sizeof(SimpleVertex));
+		}
+
+		sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Pixels shaded per pixel covered, drawing the mesh front to back in its own order from
+	// several points around it
+	double MeasureOverdraw(const MeshAsset& asset, JobSystem& jobSystem)
+	{
+		SoftwareRenderDevice renderDevice(WIDTH, HEIGHT);
+		renderDevice.RegisterRasterizerState(RS_SOLID, false);
+		MeshData meshData = renderDevice.CreateMesh(asset);
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+		long long shaded = 0;
+		long long covered = 0;
+
+		for (int view = 0; view < VIEW_COUNT; view++)
+		{
+			float angle = view / (float)VIEW_COUNT * XM_2PI;
+			float height = (view % 2 == 0 ? 0.6f : 1.5f) * meshData.BoundsRadius;
+			XMVECTOR center = XMLoadFloat3(&meshData.BoundsCenter);
+			XMVECTOR eye = XMVectorAdd(center, XMVectorSet(cosf(angle) * 2.5f * meshData.BoundsRadius, height,
+				sinf(angle) * 2.5f * meshData.BoundsRadius, 0.0f));
+
+			FrameConstants frameConstants = {};
+			frameConstants.mView = XMMatrixTranspose(XMMatrixLookAtLH(eye, center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+			frameConstants.mProjection = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, WIDTH / (float)HEIGHT, 0.01f,
+				100.0f * meshData.BoundsRadius));
+			frameConstants.diffuseLight = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+			frameConstants.gAmbientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+			XMStoreFloat3(&frameConstants.gEyePosW, eye);
+			frameConstants.lightVecW = XMFLOAT3(0.0f, 1.0f, -1.0f);
+
+			MaterialConstants materialConstants = {};
+			materialConstants.diffuseMaterial = XMFLOAT4(0.25f, 0.5f, 1.0f, 1.0f);
+			materialConstants.gAmbientMtrl = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+
+			// Ambient light keeps every drawn pixel off the black clear colour, so those are the covered ones
+			float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			renderDevice.Clear(clearColor);
+			renderDevice.UpdateConstantBuffer(CB_FRAME, &frameConstants, sizeof(frameConstants));
+			renderDevice.UpdateConstantBuffer(CB_MATERIAL, &materialConstants, sizeof(materialConstants));
+			renderDevice.SetRasterizerState(RS_SOLID);
+			renderDevice.UpdateInstanceBuffer(&world, 1);
+			renderDevice.DrawIndexedInstanced(meshData, 1, 0);
+			renderDevice.Rasterise(jobSystem);
+
+			shaded += renderDevice.GetStats().pixelsShaded;
+			for (uint32_t color : renderDevice.GetColorBuffer())
+				covered += color != 0 ? 1 : 0;
+		}
+
+		return covered ? shaded / (double)covered : 0.0;
+	}
+
+	void PrintStage(const char * mesh, const char * stage, double ms, const MeshAsset& asset, JobSystem& jobSystem,
+		const vector<TriangleKey>& triangles)
+	{
+		VertexCacheStats stats = AnalyzeVertexCache(asset.indices.data(), asset.indices.size(), asset.vertices.size(), sizeof(SimpleVertex));
+
+		printf("%14s %16s %10.2f %8.3f %8.3f %10.3f %10.3f %6s\n", mesh, stage, ms, stats.acmr, stats.atvr, stats.overfetch,
+			MeasureOverdraw(asset, jobSystem), BenchmarkCheck(GetTriangleSet(asset) == triangles) ? "yes" : "NO");
+	}
+}
+
+void BenchmarkMeshOptimizer()
+{
+	struct TestMesh
+	{
+		const char * name;
+		MeshAsset asset;
+	};
+
+	TestMesh meshes[] =
+	{
+		{ "grid", CreateGrid(256) },
+		{ "shuffled grid", CreateShuffledGrid(256) },
+		{ "torus", CreateTorus(512, 64) },
+	};
+
+	JobSystem jobSystem(0);
+
+	printf("cache of %d vertices, %dx%d overdraw from %d views\n", ANALYSIS_CACHE_SIZE, WIDTH, HEIGHT, VIEW_COUNT);
+	printf("%14s %16s %10s %8s %8s %10s %10s %6s\n", "mesh", "stage", "ms", "ACMR", "ATVR", "overfetch", "overdraw", "same");
+
+	for (TestMesh& mesh : meshes)
+	{
+		MeshAsset& asset = mesh.asset;
+		vector<TriangleKey> triangles = GetTriangleSet(asset);
+
+		PrintStage(mesh.name, "input", 0.0, asset, jobSystem, triangles);
+
+		BenchmarkTimer cacheTimer;
+		OptimizeVertexCache(asset.indices.data(), asset.indices.size(), asset.vertices.size());
+		double cacheMs = cacheTimer.GetSeconds() * 1e3;
+		PrintStage(mesh.name, "vertex cache", cacheMs, asset, jobSystem, triangles);
+
+		BenchmarkTimer overdrawTimer;
+		OptimizeOverdraw(asset.indices.data(), asset.indices.size(), asset.vertices);
+		double overdrawMs = overdrawTimer.GetSeconds() * 1e3;
+		PrintStage(mesh.name, "+ overdraw", overdrawMs, asset, jobSystem, triangles);
+
+		BenchmarkTimer fetchTimer;
+		OptimizeVertexFetch(asset.vertices, asset.indices);
+		double fetchMs = fetchTimer.GetSeconds() * 1e3;
+		PrintStage(mesh.name, "+ vertex fetch", fetchMs, asset, jobSystem, triangles);
+	}
+}
@@ -0,0 +1,192 @@
+// Micro benchmarks of the engine's hot paths, one operation at a time: updating world matrices,
+// the camera's view-projection, packing object constants and initialising asteroids. Each
+// reports ns, allocations and, where the hardware counters can be read, cache misses per
+// operation, and goes into the JSON report written with --json.
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "Camera.h"
+#include "ConstantBuffers.h"
+#include "GameObject.h"
+#include "MicroBenchmark.h"
+#include "ObjectPool.h"
+#include "RecordingRenderDevice.h"
+#include "SceneGraph.h"
+#include "SolarSystem.h"
+#include "TransformKernels.h"
+#include "TransformStack.h"
+
+using namespace std;
+
+namespace
+{
+	void Report(const MicroBenchmarkResult& result)
+	{
+		PrintMicroBenchmarkResult(result);
+		RecordMicroBenchmarkResult("micro", result);
+	}
+}
+
+void BenchmarkMicro()
+{
+	SceneFile scene;
+	if (!scene.Load(SOLAR_SYSTEM_SCENE_PATH))
+	{
+		printf("%s\n", scene.GetError().c_str());
+		return;
+	}
+
+	PrintMicroBenchmarkHeader();
+
+	// What GameObject::UpdateWorld did for the moons, the longest chain in the scene, and what
+	// SolarSystem does for each body now
+	{
+		const int objectCount = 1000;
+		vector<GameObject> objects(objectCount);
+		float t = 0.0f;
+
+		Report(RunMicroBenchmark("gameobject.updateworld", objectCount, [&]()
+		{
+			t += 0.016f;
+
+			for (GameObject& object : objects)
+			{
+				TransformStack local;
+				local.Rotate(0.0f, -t, 0.0f);
+				local.Translate(-5.00f, 0.0f, 0.0f);
+				local.Scale(0.25f, 0.25f, 0.25f);
+				local.Rotate(0.0f, -t * 3, 0.0f);
+
+				XMFLOAT4X4 world;
+				XMStoreFloat4x4(&world, local.GetMatrix());
+				object.SetWorld(world);
+			}
+		}));
+	}
+
+	// A whole frame of the scripted scene, with the default belt
+	{
+		MeshData meshData = {};
+		unique_ptr<SolarSystem> solarSystem(new SolarSystem());
+		solarSystem->Initialise(scene, meshData, meshData);
+		float t = 0.0f;
+
+		Report(RunMicroBenchmark("solarsystem.update", 1, [&]()
+		{
+			t += 0.016f;
+			solarSystem->Update(t);
+		}));
+	}
+
+	// A hundred parents with 99 children each, every one of them moved each call
+	{
+		const int parentCount = 100;
+		const int childCount = 99;
+
+		SceneGraph sceneGraph;
+		vector<int> parents;
+		for (int parent = 0; parent < parentCount; parent++)
+		{
+			parents.push_back(sceneGraph.AddNode());
+			for (int child = 0; child < childCount; child++)
+			{
+				sceneGraph.SetLocal(sceneGraph.AddNode(parents.back()), XMMatrixTranslation((float)child, 0.0f, 0.0f));
+			}
+		}
+
+		sceneGraph.UpdateWorlds();
+		float t = 0.0f;
+
+		Report(RunMicroBenchmark("scenegraph.updateworlds", sceneGraph.GetNodeCount(), [&]()
+		{
+			t += 0.016f;
+			for (int parent : parents)
+			{
+				sceneGraph.SetLocal(parent, XMMatrixRotationY(t));
+			}
+
+			sceneGraph.UpdateWorlds();
+		}));
+	}
+
+	// The camera moves every call, as it does under the view controller
+	{
+		Camera camera(XMFLOAT4(0.0f, 0.0f, -3.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f),
+			1280.0f, 720.0f, 0.01f, 100.0f);
+		float t = 0.0f;
+		float sum = 0.0f;
+
+		Report(RunMicroBenchmark("camera.viewprojection", 1, [&]()
+		{
+			t += 0.001f;
+			camera.SetEye(XMFLOAT4(t, 0.0f, -3.0f, 1.0f));
+			camera.CalculateViewProjection();
+			sum += camera.GetViewProjection()._11;
+		}));
+
+		// Keeps the results used
+		if (sum == 12345.0f)
+			printf("\n");
+	}
+
+	// Object constants packed and uploaded one object at a time, as RenderQueue and
+	// Application::Draw do, then transposed as one batch. Every object has its own world, so the
+	// cache never skips an upload.
+	{
+		const int objectCount = 1000;
+		vector<XMFLOAT4X4> worlds(objectCount);
+		vector<ObjectConstants> objectConstants(objectCount);
+		ConstantBufferCache constantBufferCache;
+		RecordingRenderDevice renderDevice;
+
+		for (int i = 0; i < objectCount; i++)
+		{
+			XMStoreFloat4x4(&worlds[i], XMMatrixRotationY(i * 0.01f) * XMMatrixTranslation((float)i, 0.0f, 0.0f));
+		}
+
+		Report(RunMicroBenchmark("constants.packobject", objectCount, [&]()
+		{
+			renderDevice.Clear();
+
+			for (int i = 0; i < objectCount; i++)
+			{
+				ObjectConstants constants;
+				constants.mWorld = XMMatrixTranspose(XMLoadFloat4x4(&worlds[i]));
+				constantBufferCache.Update(renderDevice, CB_OBJECT, &constants, sizeof(constants));
+			}
+		}));
+
+		static_assert(sizeof(ObjectConstants) == sizeof(XMFLOAT4X4), "ObjectConstants must be one matrix");
+
+		Report(RunMicroBenchmark("constants.transposebatch", objectCount, [&]()
+		{
+			TransposeTransforms(worlds.data(), (XMFLOAT4X4 *)objectConstants.data(), objectCount);
+		}));
+	}
+
+	// Filling a new belt: GameObject::Initialise alone, then everything SolarSystem::Initialise
+	// does for each asteroid, including its place in the bounding volume hierarchy
+	{
+		const int asteroidCount = 10000;
+		MeshData meshData = {};
+
+		Report(RunMicroBenchmark("gameobject.initialise", asteroidCount, [&]()
+		{
+			ObjectPool<GameObject> asteroids;
+			asteroids.Resize(asteroidCount);
+
+			for (int i = 0; i < asteroidCount; i++)
+			{
+				asteroids[i].Initialise(&meshData);
+			}
+		}));
+
+		Report(RunMicroBenchmark("solarsystem.initialise", asteroidCount, [&]()
+		{
+			unique_ptr<SolarSystem> solarSystem(new SolarSystem());
+			solarSystem->SetAsteroidCount(asteroidCount);
+			solarSystem->Initialise(scene, meshData, meshData);
+		}));
+	}
+}
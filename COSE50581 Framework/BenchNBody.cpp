@@ -0,0 +1,339 @@
+// Checks and times the Barnes-Hut gravity that moves the simulated asteroid belt. The tree's
+// accelerations are first compared with the exact sum over every pair at a few opening angles.
+// Then a belt around a fixed sun and a cluster held together by its own gravity are stepped
+// thousands of times, and leapfrog has to keep their energy within a small bound that doesn't
+// grow with time. Summing every pair, the error has to fall by about four times when the step
+// is halved, as a second order integrator's does; with the tree, the tree's own error sets a
+// floor the step can't go below. Last, whole steps are timed from a thousand bodies to a
+// million, on one thread and over the job system, against summing every pair where that
+// finishes in reasonable time.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "BarnesHutTree.h"
+#include "JobSystem.h"
+#include "NBodySimulation.h"
+
+using namespace std;
+
+namespace
+{
+	// The ring SolarSystem puts its belt in, around a sun that stays put. The belts here are
+	// heavier than SolarSystem's, so that the asteroids' pull on each other matters.
+	const float SUN_MASS = 27.0f;
+	const float BELT_INNER_RADIUS = 4.5f;
+	const float BELT_OUTER_RADIUS = 6.5f;
+	const float BELT_THICKNESS = 0.1f;
+
+	void CreateBelt(NBodySimulation& simulation, int count, float beltMass, unsigned int seed)
+	{
+		mt19937 randomGenerator(seed);
+		uniform_real_distribution<float> angle(0.0f, XM_2PI);
+		uniform_real_distribution<float> radius(BELT_INNER_RADIUS, BELT_OUTER_RADIUS);
+		uniform_real_distribution<float> height(-0.5f * BELT_THICKNESS, 0.5f * BELT_THICKNESS);
+
+		simulation.Clear();
+		simulation.AddAttractor(XMFLOAT3(0.0f, 0.0f, 0.0f), SUN_MASS);
+
+		for (int i = 0; i < count; i++)
+		{
+			float a = angle(randomGenerator);
+			float r = radius(randomGenerator);
+			float speed = sqrtf(SUN_MASS / r);
+
+			simulation.AddBody(XMFLOAT3(r * cosf(a), height(randomGenerator), r * sinf(a)),
+				XMFLOAT3(-speed * sinf(a), 0.0f, speed * cosf(a)), beltMass / count);
+		}
+	}
+
+	// A Plummer sphere of unit mass and radius, in equilibrium under its own gravity, sampled as
+	// Aarseth, Henon and Wielen describe
+	void CreateCluster(vector<XMFLOAT3>& positions, vector<XMFLOAT3>& velocities, int count, unsigned int seed)
+	{
+		mt19937 randomGenerator(seed);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		auto randomDirection = [&](float length)
+		{
+			float z = 2.0f * unit(randomGenerator) - 1.0f;
+			float a = XM_2PI * unit(randomGenerator);
+			float r = sqrtf((max)(0.0f, 1.0f - z * z));
+			return XMFLOAT3(length * r * cosf(a), length * r * sinf(a), length * z);
+		};
+
+		positions.resize(count);
+		velocities.resize(count);
+
+		for (int i = 0; i < count; i++)
+		{
+			// The few bodies the distribution would throw far out are left out
+			float radius;
+			do
+			{
+				radius = 1.0f / sqrtf(powf((max)(unit(randomGenerator), 1e-6f), -2.0f / 3.0f) - 1.0f);
+			} while (radius > 10.0f);
+
+			// The speed as a fraction of the escape speed, by rejection from q^2 (1 - q^2)^3.5
+			float q, g;
+			do
+			{
+				q = unit(randomGenerator);
+				g = 0.1f * unit(randomGenerator);
+			} while (g > q * q * powf(1.0f - q * q, 3.5f));
+
+			float escapeSpeed = sqrtf(2.0f) * powf(1.0f + radius * radius, -0.25f);
+
+			positions[i] = randomDirection(radius);
+			velocities[i] = randomDirection(q * escapeSpeed);
+		}
+	}
+
+	void CreateCluster(NBodySimulation& simulation, int count, unsigned int seed)
+	{
+		vector<XMFLOAT3> positions, velocities;
+		CreateCluster(positions, velocities, count, seed);
+
+		simulation.Clear();
+		for (int i = 0; i < count; i++)
+		{
+			simulation.AddBody(positions[i], velocities[i], 1.0f / count);
+		}
+	}
+
+	void CheckAccuracy()
+	{
+		const int BODY_COUNT = 10000;
+		const float SOFTENING = 0.01f;
+
+		struct Row
+		{
+			float openingAngle;
+			// The worst the 99th percentile of the relative error may be
+			double maxError;
+		};
+		const Row rows[] = { { 0.3f, 0.002 }, { 0.5f, 0.01 }, { 0.7f, 0.02 }, { 1.0f, 0.06 } };
+
+		vector<XMFLOAT3> positions, velocities;
+		CreateCluster(positions, velocities, BODY_COUNT, 1);
+
+		vector<float> x(BODY_COUNT), y(BODY_COUNT), z(BODY_COUNT), mass(BODY_COUNT, 1.0f / BODY_COUNT);
+		for (int i = 0; i < BODY_COUNT; i++)
+		{
+			x[i] = positions[i].x;
+			y[i] = positions[i].y;
+			z[i] = positions[i].z;
+		}
+
+		BarnesHutTree tree;
+		tree.Build(x.data(), y.data(), z.data(), mass.data(), BODY_COUNT);
+
+		// An opening angle of 0 opens every node, which sums every pair
+		vector<float> exactX(BODY_COUNT), exactY(BODY_COUNT), exactZ(BODY_COUNT);
+		BenchmarkTimer exactTimer;
+		tree.ComputeAccelerations(0.0f, SOFTENING, exactX.data(), exactY.data(), exactZ.data());
+		double exactMs = exactTimer.GetSeconds() * 1e3;
+
+		printf("accelerations of a %d body cluster against every pair (%.1f ms)\n", BODY_COUNT, exactMs);
+		printf("%8s %12s %12s %12s %10s %8s\n", "angle", "per body", "median err", "p99 err", "ms", "within");
+
+		for (const Row& row : rows)
+		{
+			vector<float> ax(BODY_COUNT), ay(BODY_COUNT), az(BODY_COUNT);
+			BenchmarkTimer timer;
+			long long interactions = tree.ComputeAccelerations(row.openingAngle, SOFTENING, ax.data(), ay.data(), az.data());
+			double ms = timer.GetSeconds() * 1e3;
+
+			vector<double> errors(BODY_COUNT);
+			for (int i = 0; i < BODY_COUNT; i++)
+			{
+				double dx = (double)ax[i] - exactX[i];
+				double dy = (double)ay[i] - exactY[i];
+				double dz = (double)az[i] - exactZ[i];
+				double exact = sqrt((double)exactX[i] * exactX[i] + (double)exactY[i] * exactY[i] + (double)exactZ[i] * exactZ[i]);
+				errors[i] = sqrt(dx * dx + dy * dy + dz * dz) / exact;
+			}
+
+			sort(errors.begin(), errors.end());
+			double median = errors[BODY_COUNT / 2];
+			double p99 = errors[BODY_COUNT * 99 / 100];
+
+			printf("%8.1f %12.0f %11.4f%% %11.4f%% %10.2f %8s\n", row.openingAngle, (double)interactions / BODY_COUNT,
+				100.0 * median, 100.0 * p99, ms, BenchmarkCheck(p99 <= row.maxError) ? "yes" : "NO");
+		}
+	}
+
+	struct DriftScenario
+	{
+		const char * name;
+		bool belt;
+		int bodyCount;
+		float openingAngle;
+		float dt;
+		int steps;
+		float softening;
+		// The worst the relative energy error may get at dt
+		double maxDrift;
+		// Whether to check the error falls as the step is halved
+		bool checkOrder;
+	};
+
+	// Runs the scenario with dt and returns the largest relative energy error seen in each half of the run
+	void MeasureDrift(const DriftScenario& scenario, float dt, int steps, double& firstHalf, double& secondHalf)
+	{
+		const int SAMPLES = 50;
+
+		NBodySimulation simulation;
+		if (scenario.belt)
+			CreateBelt(simulation, scenario.bodyCount, 0.01f * SUN_MASS, 2);
+		else
+			CreateCluster(simulation, scenario.bodyCount, 2);
+
+		simulation.SetOpeningAngle(scenario.openingAngle);
+		simulation.SetSoftening(scenario.softening);
+
+		double initialEnergy = simulation.ComputeEnergy();
+		firstHalf = 0.0;
+		secondHalf = 0.0;
+
+		for (int sample = 1; sample <= SAMPLES; sample++)
+		{
+			for (int step = 0; step < steps / SAMPLES; step++)
+			{
+				simulation.Step(dt);
+			}
+
+			double drift = fabs((simulation.ComputeEnergy() - initialEnergy) / initialEnergy);
+			double& half = sample <= SAMPLES / 2 ? firstHalf : secondHalf;
+			half = (max)(half, drift);
+		}
+	}
+
+	void CheckEnergyDrift()
+	{
+		const DriftScenario scenarios[] =
+		{
+			// A minute of the belt, about 5 orbits of its inner edge
+			{ "belt", true, 200, 0.0f, 1.0f / 60.0f, 3600, 0.01f, 5e-4, true },
+			{ "belt", true, 1000, NBodySimulation::DEFAULT_OPENING_ANGLE, 1.0f / 60.0f, 3600, 0.01f, 2e-4, false },
+			// About 15 crossing times of the cluster
+			{ "cluster", false, 1000, NBodySimulation::DEFAULT_OPENING_ANGLE, 0.02f, 2000, 0.05f, 2e-3, false },
+		};
+
+		printf("\nrelative energy error with leapfrog, largest in the first and second halves of the run\n");
+		printf("%8s %7s %6s %9s %7s %12s %12s %12s %8s %8s\n", "system", "bodies", "angle", "dt", "steps", "first half",
+			"second half", "at dt/2", "order", "within");
+
+		for (const DriftScenario& scenario : scenarios)
+		{
+			double firstHalf, secondHalf;
+			MeasureDrift(scenario, scenario.dt, scenario.steps, firstHalf, secondHalf);
+			double drift = (max)(firstHalf, secondHalf);
+
+			// Bounded means the second half is no worse than the first would be doubled, as a
+			// steady build up would make it
+			bool within = drift <= scenario.maxDrift && secondHalf < 2.0 * firstHalf;
+
+			char halfStepColumn[32] = "-";
+			char orderColumn[32] = "-";
+			if (scenario.checkOrder)
+			{
+				double halfStepFirst, halfStepSecond;
+				MeasureDrift(scenario, 0.5f * scenario.dt, 2 * scenario.steps, halfStepFirst, halfStepSecond);
+
+				double halfStepDrift = (max)(halfStepFirst, halfStepSecond);
+				double order = log2(drift / halfStepDrift);
+				within = within && order > 1.5;
+
+				snprintf(halfStepColumn, sizeof(halfStepColumn), "%.2e", halfStepDrift);
+				snprintf(orderColumn, sizeof(orderColumn), "%.2f", order);
+			}
+
+			printf("%8s %7d %6.1f %9.4f %7d %12.2e %12.2e %12s %8s %8s\n", scenario.name, scenario.bodyCount,
+				scenario.openingAngle, scenario.dt, scenario.steps, firstHalf, secondHalf, halfStepColumn, orderColumn,
+				BenchmarkCheck(within) ? "yes" : "NO");
+		}
+	}
+
+	// Milliseconds per step, over at least a quarter of a second and at least one step
+	double TimeSteps(NBodySimulation& simulation, JobSystem * jobSystem)
+	{
+		int steps = 0;
+		BenchmarkTimer timer;
+		do
+		{
+			simulation.Step(1.0f / 60.0f, jobSystem);
+			steps++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e3 / steps;
+	}
+
+	void MeasureThroughput()
+	{
+		const int bodyCounts[] = { 1000, 10000, 100000, 1000000 };
+		// Above this summing every pair takes too long to time
+		const int MAX_DIRECT_BODIES = 10000;
+
+		JobSystem jobSystem;
+
+		printf("\nsteps of the belt, %d threads with the job system\n", jobSystem.GetThreadCount());
+		printf("%9s %9s %10s %10s %12s %12s %12s %12s %9s\n", "bodies", "nodes", "build ms", "step ms", "jobs step ms",
+			"bodies/s", "per body", "direct ms", "speedup");
+
+		for (int count : bodyCounts)
+		{
+			NBodySimulation simulation;
+			CreateBelt(simulation, count, 0.01f * SUN_MASS, 3);
+
+			// The first step also works out the accelerations it starts from
+			simulation.Step(1.0f / 60.0f, &jobSystem);
+
+			double stepMs = TimeSteps(simulation, nullptr);
+			double jobsStepMs = TimeSteps(simulation, &jobSystem);
+
+			// The tree by itself, over where the bodies ended up
+			vector<float> x(count), y(count), z(count), mass(count, 0.01f * SUN_MASS / count);
+			for (int i = 0; i < count; i++)
+			{
+				XMFLOAT3 position = simulation.GetPosition(i);
+				x[i] = position.x;
+				y[i] = position.y;
+				z[i] = position.z;
+			}
+
+			BarnesHutTree tree;
+			BenchmarkTimer buildTimer;
+			tree.Build(x.data(), y.data(), z.data(), mass.data(), count, &jobSystem);
+			double buildMs = buildTimer.GetSeconds() * 1e3;
+
+			char directColumn[32] = "-";
+			char speedupColumn[32] = "-";
+			if (count <= MAX_DIRECT_BODIES)
+			{
+				NBodySimulation direct;
+				CreateBelt(direct, count, 0.01f * SUN_MASS, 3);
+				direct.SetOpeningAngle(0.0f);
+				direct.Step(1.0f / 60.0f, &jobSystem);
+
+				double directMs = TimeSteps(direct, &jobSystem);
+				snprintf(directColumn, sizeof(directColumn), "%.2f", directMs);
+				snprintf(speedupColumn, sizeof(speedupColumn), "%.1fx", directMs / jobsStepMs);
+			}
+
+			printf("%9d %9d %10.2f %10.2f %12.2f %12.3g %12.0f %12s %9s\n", count, tree.GetNodeCount(), buildMs, stepMs,
+				jobsStepMs, count / (jobsStepMs * 1e-3), (double)simulation.GetInteractionCount() / count, directColumn,
+				speedupColumn);
+		}
+	}
+}
+
+void BenchmarkNBody()
+{
+	CheckAccuracy();
+	CheckEnergyDrift();
+	MeasureThroughput();
+}
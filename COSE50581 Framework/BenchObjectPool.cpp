@@ -0,0 +1,180 @@
+// Compares GameObject as it was, carrying its own Mersenne Twister, distribution, placement and
+// transform stack, with the trimmed GameObject kept in an ObjectPool. Reports the bytes each
+// object takes, then the time to move every asteroid along its orbit and write its world
+// matrix, on one thread and over the job system's slabs, up to a million objects. The old
+// layout is only measured at sizes that fit in memory, and both must produce the same matrices.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "GameObject.h"
+#include "JobSystem.h"
+#include "ObjectPool.h"
+#include "TransformStack.h"
+
+using namespace std;
+
+namespace
+{
+	// The members GameObject had before it was trimmed
+	class OldGameObject
+	{
+	private:
+		MeshData _meshData;
+		const LodChain * _lodChain;
+		int _lodLevel;
+		XMFLOAT4X4 _world;
+		float xDir;
+		float zDir;
+		mt19937 randomGenerator;
+		uniform_real_distribution<float> bla{ 0.0f, 1.0f };
+		TransformStack transformations;
+
+	public:
+		void SetWorld(const XMFLOAT4X4& world) { _world = world; }
+		XMFLOAT4X4 GetWorld() const { return _world; }
+	};
+
+	// The old layout is 5 KB an object, so it is only measured up to this many
+	const int MAX_OLD_OBJECTS = 32768;
+
+	struct Orbit
+	{
+		float radius;
+		float speed;
+		float phase;
+	};
+
+	vector<Orbit> CreateOrbits(int count)
+	{
+		mt19937 randomGenerator(3);
+		uniform_real_distribution<float> radius(1.0f, 6.0f);
+		uniform_real_distribution<float> phase(0.0f, XM_2PI);
+
+		vector<Orbit> orbits(count);
+		for (Orbit& orbit : orbits)
+		{
+			orbit.radius = radius(randomGenerator);
+			// Further out goes slower, as in Kepler's third law
+			orbit.speed = 1.0f / (orbit.radius * sqrtf(orbit.radius));
+			orbit.phase = phase(randomGenerator);
+		}
+
+		return orbits;
+	}
+
+	// A small asteroid at its place on its orbit at time t
+	XMFLOAT4X4 OrbitWorld(const Orbit& orbit, float t)
+	{
+		float angle = orbit.phase + orbit.speed * t;
+
+		XMFLOAT4X4 world;
+		memset(&world, 0, sizeof(world));
+		world._11 = 0.01f;
+		world._22 = 0.01f;
+		world._33 = 0.01f;
+		world._41 = orbit.radius * cosf(angle);
+		world._43 = orbit.radius * sinf(angle);
+		world._44 = 1.0f;
+		return world;
+	}
+
+	template <typename T>
+	void UpdateRange(T * objects, const Orbit * orbits, int begin, int end, float t)
+	{
+		for (int i = begin; i < end; i++)
+			objects[i].SetWorld(OrbitWorld(orbits[i], t));
+	}
+
+	// Nanoseconds per object for update(t), repeated for about a quarter of a second
+	template <typename Update>
+	double TimeUpdates(int count, Update update)
+	{
+		int frames = 0;
+		BenchmarkTimer timer;
+		do
+		{
+			update(frames * 0.01f);
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e9 / ((double)frames * count);
+	}
+}
+
+void BenchmarkObjectPool()
+{
+	const int objectCounts[] = { 100, 4096, 32768, 1 << 20 };
+
+	printf("bytes per object: before %d, after %d\n\n", (int)sizeof(OldGameObject), (int)sizeof(GameObject));
+
+	JobSystem jobSystem;
+
+	printf("%10s %12s %12s %12s %12s %14s %8s\n", "objects", "pool MB", "old ns/obj", "pool ns/obj", "jobs ns/obj",
+		"M updates/s", "same");
+
+	for (int count : objectCounts)
+	{
+		vector<Orbit> orbits = CreateOrbits(count);
+
+		ObjectPool<GameObject> pool;
+		pool.Resize(count);
+
+		// Each slab is an array of its own, so the updates walk them slab by slab
+		auto updatePool = [&](float t)
+		{
+			for (int slab = 0; slab < pool.GetSlabCount(); slab++)
+			{
+				UpdateRange(pool.GetSlab(slab), &orbits[slab * ObjectPool<GameObject>::SLAB_SIZE], 0,
+					pool.GetSlabObjectCount(slab), t);
+			}
+		};
+
+		auto updatePoolJobs = [&](float t)
+		{
+			jobSystem.ParallelFor(pool.GetSlabCount(), 1, [&](int begin, int end)
+			{
+				for (int slab = begin; slab < end; slab++)
+				{
+					UpdateRange(pool.GetSlab(slab), &orbits[slab * ObjectPool<GameObject>::SLAB_SIZE], 0,
+						pool.GetSlabObjectCount(slab), t);
+				}
+			});
+		};
+
+		double poolNs = TimeUpdates(count, updatePool);
+		double jobsNs = TimeUpdates(count, updatePoolJobs);
+
+		double oldNs = 0.0;
+		bool same = true;
+
+		if (count <= MAX_OLD_OBJECTS)
+		{
+			vector<OldGameObject> oldObjects(count);
+			oldNs = TimeUpdates(count, [&](float t) { UpdateRange(oldObjects.data(), orbits.data(), 0, count, t); });
+
+			// One more update of each at the same time, then compare the matrices
+			UpdateRange(oldObjects.data(), orbits.data(), 0, count, 1.0f);
+			updatePool(1.0f);
+
+			for (int i = 0; i < count && same; i++)
+			{
+				XMFLOAT4X4 oldWorld = oldObjects[i].GetWorld();
+				XMFLOAT4X4 poolWorld = pool[i].GetWorld();
+				same = memcmp(&oldWorld, &poolWorld, sizeof(XMFLOAT4X4)) == 0;
+			}
+		}
+
+		char oldColumn[32];
+		if (oldNs > 0.0)
+			snprintf(oldColumn, sizeof(oldColumn), "%.2f", oldNs);
+		else
+			snprintf(oldColumn, sizeof(oldColumn), "(%.0f MB)", (double)count * sizeof(OldGameObject) / (1024.0 * 1024.0));
+
+		printf("%10d %12.1f %12s %12.2f %12.2f %14.1f %8s\n", count, pool.GetBytesReserved() / (1024.0 * 1024.0), oldColumn, poolNs,
+			jobsNs, 1e3 / jobsNs, BenchmarkCheck(same) ? "yes" : "NO");
+	}
+}
@@ -0,0 +1,132 @@
+// Measures what a profiled zone costs to record and to collect, and checks that the zones come
+// back complete: every zone from a loop shared out over several threads, only the newest ones
+// once a ring has wrapped, and never a zone overwritten while it was being collected. Threads
+// started one after another must share one ring rather than each leaving one behind.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+using namespace std;
+
+namespace
+{
+	const int ITEM_COUNT = 40000;
+
+	// Whether each thread's zones are in the order they were recorded, which they can't be if a
+	// zone was overwritten partway through being copied out
+	bool InRecordedOrder(const vector<Profiler::Zone>& zones)
+	{
+		for (size_t i = 1; i < zones.size(); i++)
+		{
+			if (zones[i].thread == zones[i - 1].thread && zones[i].startNanoseconds < zones[i - 1].startNanoseconds)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+void BenchmarkProfiler()
+{
+#if PROFILER_ENABLED
+	volatile int sink = 0;
+
+	// The cost of a zone around nearly nothing
+	Profiler::Clear();
+	int zones = 0;
+	BenchmarkTimer timer;
+	do
+	{
+		for (int i = 0; i < 10000; i++)
+		{
+			PROFILE_ZONE("empty");
+			sink = sink + 1;
+		}
+		zones += 10000;
+	} while (timer.GetSeconds() < 0.25);
+	double zoneNanoseconds = timer.GetSeconds() * 1e9 / zones;
+
+	BenchmarkTimer collectTimer;
+	vector<Profiler::Zone> collected = Profiler::Collect();
+	double collectMilliseconds = collectTimer.GetSeconds() * 1e3;
+
+	printf("%-36s %10.1f ns\n", "record one zone", zoneNanoseconds);
+	printf("%-36s %10.3f ms (%zu zones)\n", "collect a full ring", collectMilliseconds, collected.size());
+
+	// A full ring keeps only its newest zones, less the slot the next zone would go in
+	printf("%-36s %10s\n", "ring keeps the newest zones", BenchmarkCheck(collected.size() == (size_t)Profiler::RING_SIZE - 1 &&
+		InRecordedOrder(collected)) ? "yes" : "NO");
+
+	// Every zone from a loop over several threads comes back
+	Profiler::Clear();
+	{
+		JobSystem jobSystem(3);
+		jobSystem.ParallelFor(ITEM_COUNT, 64, [&sink](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				PROFILE_ZONE("item");
+				sink = sink + 1;
+			}
+		});
+	}
+
+	collected = Profiler::Collect();
+	vector<Profiler::ZoneSummary> summaries = Profiler::Summarise(collected);
+	printf("%-36s %10s\n", "all zones from 4 threads", BenchmarkCheck(collected.size() == ITEM_COUNT && summaries.size() == 1 &&
+		summaries[0].count == ITEM_COUNT) ? "yes" : "NO");
+
+	ostringstream trace;
+	Profiler::WriteChromeTrace(trace, collected);
+	printf("%-36s %10.1f bytes per zone\n", "Chrome trace", trace.str().size() / (double)collected.size());
+
+	// Collecting while another thread records as fast as it can
+	Profiler::Clear();
+	atomic<bool> stop(false);
+	thread recorder([&stop, &sink]()
+	{
+		while (!stop.load(memory_order_relaxed))
+		{
+			PROFILE_ZONE("busy");
+			sink = sink + 1;
+		}
+	});
+
+	bool ordered = true;
+	for (int i = 0; i < 50; i++)
+		ordered = ordered && InRecordedOrder(Profiler::Collect());
+
+	stop = true;
+	recorder.join();
+	printf("%-36s %10s\n", "collect during recording", BenchmarkCheck(ordered) ? "yes" : "NO");
+
+	// Each thread gives its ring back when it exits, and the zones in it can still be collected
+	Profiler::Clear();
+	const int threadCount = 8;
+	for (int i = 0; i < threadCount; i++)
+	{
+		thread([&sink]()
+		{
+			PROFILE_ZONE("short-lived");
+			sink = sink + 1;
+		}).join();
+	}
+
+	collected = Profiler::Collect();
+	bool reused = collected.size() == threadCount;
+	for (const Profiler::Zone& zone : collected)
+		reused = reused && zone.thread == collected[0].thread;
+	printf("%-36s %10s\n", "exited threads' rings reused", BenchmarkCheck(reused) ? "yes" : "NO");
+
+	Profiler::Clear();
+#else
+	printf("built with PROFILER_ENABLED=0, PROFILE_ZONE records nothing\n");
+#endif
+}
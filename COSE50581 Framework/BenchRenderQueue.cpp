@@ -0,0 +1,185 @@
+// Counts the state binds RenderQueue saves on a shuffled scene, and times the sort. Also checks
+// that meshes past the first few thousand still get sort keys of their own.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "RecordingRenderDevice.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+namespace
+{
+	struct SubmittedDraw
+	{
+		int rasterizerState;
+		int shader;
+		int material;
+		int mesh;
+		float depth;
+	};
+}
+
+static bool CheckManyMeshes()
+{
+	// Each mesh is drawn twice, shuffled, so sorting has to bring the two draws together
+	const int meshCount = 5000;
+	vector<MeshData> meshes(meshCount, MeshData());
+	vector<int> order;
+	for (int i = 0; i < meshCount; i++)
+	{
+		meshes[i].IndexCount = 3 * (i + 1);
+		order.push_back(i);
+		order.push_back(i);
+	}
+
+	shuffle(order.begin(), order.end(), mt19937(1234));
+
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+	RenderQueue renderQueue;
+	RecordingRenderDevice renderDevice;
+	ConstantBufferCache constantBufferCache;
+	renderQueue.Begin();
+
+	for (int mesh : order)
+		renderQueue.Submit(0, 0, 0, 0, meshes[mesh], 1.0f, world);
+
+	renderQueue.Flush(renderDevice, constantBufferCache);
+
+	bool sortedApart = renderQueue.GetStats().meshChanges == meshCount && renderDevice.GetMeshChanges() == meshCount;
+
+	// The next frame's one mesh gets the first id again, and is the only one the table holds
+	MeshData nextMesh = {};
+	nextMesh.IndexCount = 6;
+	renderQueue.Begin();
+	renderQueue.Submit(0, 0, 0, 0, nextMesh, 1.0f, world);
+	renderQueue.Submit(0, 0, 0, 0, nextMesh, 2.0f, world);
+	renderDevice.Clear();
+	renderQueue.Flush(renderDevice, constantBufferCache);
+
+	bool tableReset = (renderQueue.GetSortKey(0) >> 20 & (RenderQueue::MAX_MESHES - 1)) == 0 &&
+		renderDevice.GetMeshChanges() == 1 && renderDevice.GetDraws() == 2;
+
+	return sortedApart && tableReset;
+}
+
+// Ids past what their bits in the sort key hold are refused instead of running into the fields above
+static bool CheckRejectedIds()
+{
+	MeshData meshData = {};
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+	RenderQueue renderQueue;
+	renderQueue.Begin();
+
+	bool refused = !renderQueue.Submit(RenderQueue::MAX_PASSES, 0, 0, 0, meshData, 1.0f, world) &&
+		!renderQueue.Submit(0, RenderQueue::MAX_RASTERIZER_STATES, 0, 0, meshData, 1.0f, world) &&
+		!renderQueue.Submit(0, 0, RenderQueue::MAX_SHADERS, 0, meshData, 1.0f, world) &&
+		!renderQueue.Submit(0, 0, 0, RenderQueue::MAX_MATERIALS, meshData, 1.0f, world) &&
+		!renderQueue.Submit(0, 0, 0, -1, meshData, 1.0f, world);
+
+	// With materials set, an index past them has nothing to upload
+	MaterialConstants material = {};
+	renderQueue.SetMaterials(&material, 1);
+	refused = refused && !renderQueue.Submit(0, 0, 0, 1, meshData, 1.0f, world);
+
+	bool accepted = renderQueue.Submit(RenderQueue::MAX_PASSES - 1, RenderQueue::MAX_RASTERIZER_STATES - 1,
+		RenderQueue::MAX_SHADERS - 1, 0, meshData, 1.0f, world);
+
+	return refused && accepted && renderQueue.GetPacketCount() == 1;
+}
+
+void BenchmarkRenderQueue()
+{
+	const int meshCount = 4;
+	MeshData meshes[meshCount] = {};
+	for (int i = 0; i < meshCount; i++)
+	{
+		meshes[i].VBStride = sizeof(XMFLOAT3) * 2;
+		meshes[i].IndexCount = 36 * (i + 1);
+	}
+
+	const int materialCount = 3;
+	MaterialConstants materials[materialCount] = {};
+	for (int i = 0; i < materialCount; i++)
+		materials[i].gSpecularPower = 10.0f * (i + 1);
+
+	const int drawCounts[] = { 100, 10000, 100000 };
+
+	printf("%8s %10s %10s %10s %12s %10s\n", "draws", "naive", "unsorted", "sorted", "ns/draw", "sorted ok");
+
+	for (int drawCount : drawCounts)
+	{
+		// Draws arrive in a random order, the way hand-written Draw code tends to mix them up
+		mt19937 random(1234);
+		vector<SubmittedDraw> draws(drawCount);
+		for (SubmittedDraw& draw : draws)
+		{
+			draw.rasterizerState = random() % 2;
+			draw.shader = random() % 2;
+			draw.material = random() % materialCount;
+			draw.mesh = random() % meshCount;
+			draw.depth = (random() % 10000) * 0.01f;
+		}
+
+		// The binds needed when drawing in submission order but skipping redundant ones
+		int unsortedBinds = 0;
+		for (int i = 0; i < drawCount; i++)
+		{
+			bool first = i == 0;
+			unsortedBinds += first || draws[i].rasterizerState != draws[i - 1].rasterizerState;
+			unsortedBinds += first || draws[i].shader != draws[i - 1].shader;
+			unsortedBinds += first || draws[i].material != draws[i - 1].material;
+			unsortedBinds += first || draws[i].mesh != draws[i - 1].mesh;
+		}
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+		RenderQueue renderQueue;
+		RecordingRenderDevice renderDevice;
+		ConstantBufferCache constantBufferCache;
+		renderQueue.SetMaterials(materials, materialCount);
+		int frames = 0;
+		BenchmarkTimer timer;
+
+		do
+		{
+			renderDevice.Clear();
+			renderQueue.Begin();
+
+			for (const SubmittedDraw& draw : draws)
+				renderQueue.Submit(0, draw.rasterizerState, draw.shader, draw.material, meshes[draw.mesh], draw.depth, world);
+
+			renderQueue.Flush(renderDevice, constantBufferCache);
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		double nsPerDraw = timer.GetSeconds() * 1e9 / (static_cast<double>(frames) * drawCount);
+
+		// The keys have to come out in order, and the device has to see exactly the binds the queue
+		// counted. A material change only uploads when the last frame didn't end on that material.
+		bool sortedOk = renderQueue.GetPacketCount() == drawCount;
+		for (int i = 1; i < renderQueue.GetPacketCount(); i++)
+			sortedOk = sortedOk && renderQueue.GetSortKey(i - 1) <= renderQueue.GetSortKey(i);
+
+		const RenderQueue::Stats& stats = renderQueue.GetStats();
+		int sortedBinds = stats.rasterizerStateChanges + stats.shaderChanges + stats.materialChanges + stats.meshChanges;
+		sortedOk = sortedOk && renderDevice.GetDraws() == drawCount && stats.bindsRequested == drawCount * 4 &&
+			renderDevice.GetRasterizerStateChanges() + renderDevice.GetShaderChanges() + renderDevice.GetMeshChanges() ==
+				stats.rasterizerStateChanges + stats.shaderChanges + stats.meshChanges &&
+			renderDevice.GetConstantBufferUploads(CB_MATERIAL) == stats.materialConstantUploads &&
+			stats.materialChanges - stats.materialConstantUploads <= 1;
+
+		printf("%8d %10d %10d %10d %12.2f %10s\n", drawCount, stats.bindsRequested, unsortedBinds, sortedBinds, nsPerDraw, BenchmarkCheck(sortedOk) ? "yes" : "NO");
+	}
+
+	printf("more than 4096 meshes sorted apart: %s\n", BenchmarkCheck(CheckManyMeshes()) ? "yes" : "NO");
+	printf("ids past the sort key's fields refused: %s\n", BenchmarkCheck(CheckRejectedIds()) ? "yes" : "NO");
+}
@@ -0,0 +1,197 @@
+// Checks the SceneGraph's dirty flags against walking every object's parent chain, as GameObject
+// did before the scene graph: the world matrices must match, and an update must only recompute
+// the nodes below something that changed. Then measures a full update against one where a
+// single leaf moved.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+
+using namespace std;
+
+namespace
+{
+	const int NODE_COUNT = 100000;
+	const int ROOT_COUNT = 16;
+	const int DIRTY_NODE_COUNT = 10;
+
+	// The kernels multiply in a different order from XMMatrixMultiply, so only rounding may differ
+	const float MAX_RELATIVE_DIFFERENCE = 1e-4f;
+
+	// A tree whose nodes are added in no particular order: each node's parent is any node added
+	// before it, so siblings are scattered through the insertion order
+	struct TestTree
+	{
+		vector<int> parents;
+		vector<vector<int>> children;
+		vector<XMFLOAT4X4> locals;
+	};
+
+	XMFLOAT4X4 RandomLocal(mt19937& randomGenerator)
+	{
+		uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		uniform_real_distribution<float> offset(-2.0f, 2.0f);
+		uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+		XMFLOAT4X4 local;
+		float s = scale(randomGenerator);
+		XMStoreFloat4x4(&local, XMMatrixScaling(s, s, s) * XMMatrixRotationY(angle(randomGenerator)) *
+			XMMatrixTranslation(offset(randomGenerator), offset(randomGenerator), offset(randomGenerator)));
+		return local;
+	}
+
+	TestTree BuildTree(SceneGraph& sceneGraph, mt19937& randomGenerator)
+	{
+		TestTree tree;
+		tree.parents.resize(NODE_COUNT);
+		tree.children.resize(NODE_COUNT);
+		tree.locals.resize(NODE_COUNT);
+
+		for (int i = 0; i < NODE_COUNT; i++)
+		{
+			int parent = i < ROOT_COUNT ? SceneGraph::NO_PARENT : uniform_int_distribution<int>(0, i - 1)(randomGenerator);
+			tree.parents[i] = parent;
+			if (parent != SceneGraph::NO_PARENT)
+				tree.children[parent].push_back(i);
+
+			// Handles are given out in order, so they match the tree's indices
+			sceneGraph.AddNode(parent);
+			tree.locals[i] = RandomLocal(randomGenerator);
+			sceneGraph.SetLocal(i, XMLoadFloat4x4(&tree.locals[i]));
+		}
+
+		return tree;
+	}
+
+	// Every node's world matrix from its parent chain. Parents come before their children.
+	vector<XMFLOAT4X4> ParentChainWorlds(const TestTree& tree)
+	{
+		vector<XMFLOAT4X4> worlds(NODE_COUNT);
+		for (int i = 0; i < NODE_COUNT; i++)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&tree.locals[i]);
+			if (tree.parents[i] != SceneGraph::NO_PARENT)
+				world = XMMatrixMultiply(world, XMLoadFloat4x4(&worlds[tree.parents[i]]));
+
+			XMStoreFloat4x4(&worlds[i], world);
+		}
+
+		return worlds;
+	}
+
+	bool MatchesParentChains(const SceneGraph& sceneGraph, const TestTree& tree)
+	{
+		vector<XMFLOAT4X4> expected = ParentChainWorlds(tree);
+
+		for (int i = 0; i < NODE_COUNT; i++)
+		{
+			XMFLOAT4X4 world = sceneGraph.GetWorld(i);
+
+			for (int element = 0; element < 16; element++)
+			{
+				float a = (&world._11)[element];
+				float b = (&expected[i]._11)[element];
+				if (fabsf(a - b) > MAX_RELATIVE_DIFFERENCE * (1.0f + fabsf(b)))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Moves a few random nodes and gives back how many nodes are in their subtrees together
+	int MoveRandomNodes(SceneGraph& sceneGraph, TestTree& tree, mt19937& randomGenerator)
+	{
+		vector<unsigned char> below(NODE_COUNT, 0);
+		vector<int> stack;
+
+		for (int i = 0; i < DIRTY_NODE_COUNT; i++)
+		{
+			int node = uniform_int_distribution<int>(0, NODE_COUNT - 1)(randomGenerator);
+			tree.locals[node] = RandomLocal(randomGenerator);
+			sceneGraph.SetLocal(node, XMLoadFloat4x4(&tree.locals[node]));
+			stack.push_back(node);
+		}
+
+		int count = 0;
+		while (!stack.empty())
+		{
+			int node = stack.back();
+			stack.pop_back();
+
+			if (below[node])
+				continue;
+
+			below[node] = 1;
+			count++;
+			stack.insert(stack.end(), tree.children[node].begin(), tree.children[node].end());
+		}
+
+		return count;
+	}
+}
+
+void BenchmarkSceneGraph()
+{
+	mt19937 randomGenerator(42);
+	SceneGraph sceneGraph;
+	TestTree tree = BuildTree(sceneGraph, randomGenerator);
+
+	sceneGraph.UpdateWorlds();
+	bool fullUpdate = sceneGraph.GetUpdatedCount() == NODE_COUNT && MatchesParentChains(sceneGraph, tree);
+	printf("first update matches the parent chains: %s\n", BenchmarkCheck(fullUpdate) ? "yes" : "NO");
+
+	sceneGraph.UpdateWorlds();
+	printf("nothing recomputed when nothing moved: %s\n", BenchmarkCheck(sceneGraph.GetUpdatedCount() == 0) ? "yes" : "NO");
+
+	int expectedCount = MoveRandomNodes(sceneGraph, tree, randomGenerator);
+	sceneGraph.UpdateWorlds();
+	int updatedCount = sceneGraph.GetUpdatedCount();
+	bool onlyDirty = updatedCount == expectedCount && MatchesParentChains(sceneGraph, tree);
+	printf("only the moved subtrees recomputed: %s (%d of %d nodes)\n", BenchmarkCheck(onlyDirty) ? "yes" : "NO",
+		updatedCount, NODE_COUNT);
+
+	{
+		JobSystem jobSystem(3);
+		expectedCount = MoveRandomNodes(sceneGraph, tree, randomGenerator);
+		sceneGraph.UpdateWorlds(&jobSystem);
+		updatedCount = sceneGraph.GetUpdatedCount();
+		bool threaded = updatedCount == expectedCount && MatchesParentChains(sceneGraph, tree);
+		printf("the same on 4 threads: %s (%d of %d nodes)\n", BenchmarkCheck(threaded) ? "yes" : "NO",
+			updatedCount, NODE_COUNT);
+	}
+
+	// A root moving recomputes everything below it, and a leaf only itself
+	int leaf = NODE_COUNT - 1;
+	while (!tree.children[leaf].empty())
+		leaf--;
+
+	XMMATRIX leafLocal = XMLoadFloat4x4(&tree.locals[leaf]);
+	double rootNanoseconds = 0.0, leafNanoseconds = 0.0;
+	int frames = 0;
+	BenchmarkTimer timer;
+
+	do
+	{
+		BenchmarkTimer rootTimer;
+		for (int root = 0; root < ROOT_COUNT; root++)
+			sceneGraph.SetLocal(root, XMLoadFloat4x4(&tree.locals[root]));
+		sceneGraph.UpdateWorlds();
+		rootNanoseconds += rootTimer.GetSeconds() * 1e9;
+
+		BenchmarkTimer leafTimer;
+		sceneGraph.SetLocal(leaf, leafLocal);
+		sceneGraph.UpdateWorlds();
+		leafNanoseconds += leafTimer.GetSeconds() * 1e9;
+
+		frames++;
+	} while (timer.GetSeconds() < 0.5);
+
+	printf("every root moved: %.1f ns per node, one leaf moved: %.1f ns per update\n",
+		rootNanoseconds / frames / NODE_COUNT, leafNanoseconds / frames);
+}
@@ -0,0 +1,216 @@
+// Checks that compiled scenes with broken headers are refused, then measures loading scenes of
+// up to a million bodies from their text against loading the same scenes compiled, with one read
+// and the references fixed up in place, and checks that both give back exactly the scene that
+// was written. The files are written to the working directory and deleted afterwards.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Benchmarks.h"
+#include "SceneFile.h"
+
+using namespace std;
+
+namespace
+{
+	const char * TEXT_PATH = "BenchSceneLoad.scene";
+	const char * FILE_PATH = "BenchSceneLoad.bscene";
+	const int RUNS = 3;
+	// Each generated planet is its orbit, itself and its moons
+	const int MOONS_PER_PLANET = 3;
+	// An offset that wraps around when a section's size is added to it
+	const uint64_t NEAR_TOP = ~(uint64_t)0 - 63;
+
+	long long FileSize(const char * path)
+	{
+		FILE * file = fopen(path, "rb");
+		if (!file)
+			return 0;
+
+		fseek(file, 0, SEEK_END);
+		long long size = ftell(file);
+		fclose(file);
+		return size;
+	}
+
+	bool SameFloats(const float * a, const float * b, int count)
+	{
+		return memcmp(a, b, count * sizeof(float)) == 0;
+	}
+
+	bool SameScene(const SceneDescription& a, const SceneDescription& b)
+	{
+		if (a.meshes != b.meshes || a.materials.size() != b.materials.size() || a.bodies.size() != b.bodies.size())
+			return false;
+
+		for (size_t i = 0; i < a.materials.size(); i++)
+		{
+			const SceneDescription::Material& x = a.materials[i];
+			const SceneDescription::Material& y = b.materials[i];
+			if (x.name != y.name || !SameFloats(x.diffuse, y.diffuse, 4) || !SameFloats(x.ambient, y.ambient, 4) ||
+				!SameFloats(x.specular, y.specular, 4) || x.specularPower != y.specularPower || x.wireframe != y.wireframe)
+				return false;
+		}
+
+		for (size_t i = 0; i < a.bodies.size(); i++)
+		{
+			const SceneDescription::Body& x = a.bodies[i];
+			const SceneDescription::Body& y = b.bodies[i];
+			if (x.name != y.name || x.parent != y.parent || x.mesh != y.mesh || x.material != y.material ||
+				x.scale != y.scale || x.spinPhase != y.spinPhase || x.spinRate != y.spinRate ||
+				x.orbitRadius != y.orbitRadius || x.orbitPhase != y.orbitPhase || x.orbitRate != y.orbitRate ||
+				!SameFloats(x.offset, y.offset, 3) || x.mass != y.mass || x.radius != y.radius)
+				return false;
+		}
+
+		const SceneDescription::Belt& x = a.belt;
+		const SceneDescription::Belt& y = b.belt;
+		return x.mesh == y.mesh && x.material == y.material && x.count == y.count && x.scale == y.scale &&
+			x.innerRadius == y.innerRadius && x.outerRadius == y.outerRadius && x.thickness == y.thickness && x.mass == y.mass;
+	}
+
+	void RemoveFiles()
+	{
+		remove(TEXT_PATH);
+		remove(FILE_PATH);
+	}
+
+	bool ReadFile(const char * path, vector<char>& data)
+	{
+		data.resize((size_t)FileSize(path));
+		FILE * file = fopen(path, "rb");
+		if (!file)
+			return false;
+
+		bool read = fread(data.data(), 1, data.size(), file) == data.size();
+		fclose(file);
+		return read;
+	}
+
+	// Each change to the header has to make the load fail, rather than read outside the file
+	bool CheckCorruptFiles(const SceneDescription& scene)
+	{
+		vector<char> data;
+		string error;
+		if (!WriteSceneFile(FILE_PATH, scene, error) || !ReadFile(FILE_PATH, data))
+			return false;
+
+		SceneFileHeader header;
+		memcpy(&header, data.data(), sizeof(header));
+
+		SceneFile intact;
+		if (!intact.Load(data.data(), data.size()))
+			return false;
+
+		void (*corruptions[])(SceneFileHeader&) =
+		{
+			[](SceneFileHeader& h) { h.meshOffset = NEAR_TOP; h.meshCount = 10; },
+			[](SceneFileHeader& h) { h.materialOffset = NEAR_TOP; h.materialCount = 10; },
+			[](SceneFileHeader& h) { h.bodyOffset = NEAR_TOP; h.bodyCount = 10; },
+			[](SceneFileHeader& h) { h.nameOffset = NEAR_TOP; },
+			[](SceneFileHeader& h) { h.meshCount = 0xFFFFFFFFu; },
+			[](SceneFileHeader& h) { h.bodyCount += 1; },
+			[](SceneFileHeader& h) { h.fileSize += 8; },
+		};
+
+		for (auto corrupt : corruptions)
+		{
+			SceneFileHeader corrupted = header;
+			corrupt(corrupted);
+
+			vector<char> corruptData = data;
+			memcpy(corruptData.data(), &corrupted, sizeof(corrupted));
+
+			SceneFile sceneFile;
+			if (sceneFile.Load(corruptData.data(), corruptData.size()) || sceneFile.IsLoaded())
+				return false;
+		}
+
+		// Cut short, the file's size no longer matches its header
+		SceneFile truncated;
+		return !truncated.Load(data.data(), data.size() - 1);
+	}
+}
+
+void BenchmarkSceneLoad()
+{
+	SceneDescription baseScene;
+	string error;
+	if (!LoadSceneText(SOLAR_SYSTEM_SCENE_PATH, baseScene, error))
+	{
+		printf("%s: %s\n", SOLAR_SYSTEM_SCENE_PATH, error.c_str());
+		return;
+	}
+
+	printf("corrupt scene files refused: %s\n\n", BenchmarkCheck(CheckCorruptFiles(baseScene)) ? "yes" : "NO");
+	RemoveFiles();
+
+	const int bodyCounts[] = { 10000, 100000, 1000000 };
+
+	printf("%10s %9s %9s %10s %12s %10s %12s %10s %10s\n", "bodies", "text MB", "file MB", "parse ms", "parse+comp ms",
+		"load ms", "Mbodies/s", "speedup", "same");
+
+	for (int bodyCount : bodyCounts)
+	{
+		SceneDescription scene = baseScene;
+		AddGeneratedBodies(scene, bodyCount / (2 + MOONS_PER_PLANET), MOONS_PER_PLANET);
+
+		if (!WriteSceneText(TEXT_PATH, scene, error) || !WriteSceneFile(FILE_PATH, scene, error))
+		{
+			printf("%s\n", error.c_str());
+			RemoveFiles();
+			return;
+		}
+
+		// Keeping the fastest run of each, so the files are in the page cache for both
+		double parseMs = 1e30;
+		double compileMs = 1e30;
+		double loadMs = 1e30;
+		bool same = true;
+
+		for (int run = 0; run < RUNS; run++)
+		{
+			SceneDescription parsed;
+			BenchmarkTimer parseTimer;
+			bool ok = LoadSceneText(TEXT_PATH, parsed, error);
+			parseMs = fmin(parseMs, parseTimer.GetSeconds() * 1e3);
+
+			// What Application does given the text, which parses it and then compiles it
+			SceneFile fromText;
+			BenchmarkTimer compileTimer;
+			ok = ok && fromText.Load(TEXT_PATH);
+			compileMs = fmin(compileMs, compileTimer.GetSeconds() * 1e3);
+
+			SceneFile fromFile;
+			BenchmarkTimer loadTimer;
+			ok = ok && fromFile.Load(FILE_PATH);
+			loadMs = fmin(loadMs, loadTimer.GetSeconds() * 1e3);
+
+			if (!ok)
+			{
+				printf("%s%s%s\n", error.c_str(), fromText.GetError().c_str(), fromFile.GetError().c_str());
+				RemoveFiles();
+				return;
+			}
+
+			// Both forms have to give back exactly the scene that was written
+			if (run == 0)
+			{
+				SceneDescription textScene, fileScene;
+				fromText.GetDescription(textScene);
+				fromFile.GetDescription(fileScene);
+				same = SameScene(scene, parsed) && SameScene(scene, textScene) && SameScene(scene, fileScene) &&
+					fromText.GetSize() == fromFile.GetSize();
+			}
+		}
+
+		int bodies = (int)scene.bodies.size();
+		printf("%10d %9.1f %9.1f %10.1f %12.1f %10.2f %12.1f %9.0fx %10s\n", bodies, FileSize(TEXT_PATH) / 1e6,
+			FileSize(FILE_PATH) / 1e6, parseMs, compileMs, loadMs, bodies / loadMs / 1e3, compileMs / loadMs,
+			BenchmarkCheck(same) ? "yes" : "NO");
+
+		RemoveFiles();
+	}
+}
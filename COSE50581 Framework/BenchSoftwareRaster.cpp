@@ -0,0 +1,143 @@
+// Measures the software rasteriser drawing a field of lit cubes over the ground plane on 1 to
+// N threads, solid and in wireframe, and checks that every thread count draws exactly the same
+// image as a single thread does.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Benchmarks.h"
+#include "ConstantBuffers.h"
+#include "JobSystem.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+
+using namespace std;
+
+namespace
+{
+	const int WIDTH = 1280;
+	const int HEIGHT = 720;
+	const int GRID_SIZE = 64;
+
+	struct Scene
+	{
+		MeshData cube;
+		MeshData plane;
+		vector<XMFLOAT4X4> worlds;
+	};
+
+	Scene CreateScene(SoftwareRenderDevice& renderDevice)
+	{
+		Scene scene;
+		scene.cube = renderDevice.CreateMesh(CreateCubeGeometry());
+		scene.plane = renderDevice.CreateMesh(CreatePlaneGeometry());
+
+		// A grid of randomly turned cubes, then the plane beneath them
+		mt19937 randomGenerator(1);
+		uniform_real_distribution<float> angle(0.0f, XM_2PI);
+
+		for (int z = 0; z < GRID_SIZE; z++)
+		{
+			for (int x = 0; x < GRID_SIZE; x++)
+			{
+				XMMATRIX world = XMMatrixRotationRollPitchYaw(angle(randomGenerator), angle(randomGenerator), 0.0f) *
+					XMMatrixTranslation((x - GRID_SIZE / 2) * 3.0f, 0.0f, (z - GRID_SIZE / 2) * 3.0f);
+
+				XMFLOAT4X4 stored;
+				XMStoreFloat4x4(&stored, world);
+				scene.worlds.push_back(stored);
+			}
+		}
+
+		XMFLOAT4X4 planeWorld;
+		XMStoreFloat4x4(&planeWorld, XMMatrixTranslation(0.0f, 90.0f, 0.0f));
+		scene.worlds.push_back(planeWorld);
+
+		return scene;
+	}
+
+	void DrawScene(SoftwareRenderDevice& renderDevice, JobSystem& jobSystem, const Scene& scene, bool wireframe)
+	{
+		XMVECTOR eye = XMVectorSet(0.0f, 60.0f, -120.0f, 0.0f);
+
+		FrameConstants frameConstants;
+		frameConstants.mView = XMMatrixTranspose(XMMatrixLookAtLH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		frameConstants.mProjection = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, WIDTH / (float)HEIGHT, 0.1f, 500.0f));
+		frameConstants.diffuseLight = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		frameConstants.gAmbientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		frameConstants.gSpecularLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+		XMStoreFloat3(&frameConstants.gEyePosW, eye);
+		frameConstants.lightVecW = XMFLOAT3(0.0f, 0.0f, -1.0f);
+		frameConstants.pad0 = 0.0f;
+		frameConstants.pad1 = 0.0f;
+
+		MaterialConstants materialConstants;
+		materialConstants.diffuseMaterial = XMFLOAT4(0.25f, 0.5f, 1.0f, 1.0f);
+		materialConstants.gAmbientMtrl = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		materialConstants.gSpecularMtrl = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		materialConstants.gSpecularPower = 10.0f;
+		materialConstants.pad = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		float clearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f };
+		renderDevice.Clear(clearColor);
+		renderDevice.UpdateConstantBuffer(CB_FRAME, &frameConstants, sizeof(frameConstants));
+		renderDevice.UpdateConstantBuffer(CB_MATERIAL, &materialConstants, sizeof(materialConstants));
+		renderDevice.SetRasterizerState(wireframe ? RS_WIREFRAME : RS_SOLID);
+		renderDevice.SetShader(SHADER_INSTANCED);
+		renderDevice.UpdateInstanceBuffer(scene.worlds.data(), (int)scene.worlds.size());
+		renderDevice.DrawIndexedInstanced(scene.cube, (int)scene.worlds.size() - 1, 0);
+		renderDevice.DrawIndexedInstanced(scene.plane, 1, (int)scene.worlds.size() - 1);
+		renderDevice.Rasterise(jobSystem);
+	}
+}
+
+void BenchmarkSoftwareRaster()
+{
+	int hardwareThreads = max(1, (int)thread::hardware_concurrency());
+	vector<int> threadCounts;
+	for (int threads = 1; threads < max(4, hardwareThreads); threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(max(4, hardwareThreads));
+
+	printf("hardware threads: %d, %dx%d, %d cubes, %d pixel tiles\n", hardwareThreads, WIDTH, HEIGHT, GRID_SIZE * GRID_SIZE,
+		SoftwareRenderDevice::TILE_SIZE);
+	printf("%10s %8s %10s %12s %10s %16s %12s\n", "mode", "threads", "frame ms", "Mprims/s", "MP/s", "MP/s/thread", "same image");
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		bool wireframe = mode == 1;
+		vector<uint32_t> reference;
+
+		for (int threads : threadCounts)
+		{
+			JobSystem jobSystem(threads - 1);
+			SoftwareRenderDevice renderDevice(WIDTH, HEIGHT);
+			renderDevice.RegisterRasterizerState(RS_SOLID, false);
+			renderDevice.RegisterRasterizerState(RS_WIREFRAME, true);
+			Scene scene = CreateScene(renderDevice);
+
+			int frames = 0;
+			BenchmarkTimer timer;
+			do
+			{
+				DrawScene(renderDevice, jobSystem, scene, wireframe);
+				frames++;
+			} while (timer.GetSeconds() < 0.25);
+			double frameMs = timer.GetSeconds() * 1e3 / frames;
+
+			if (reference.empty())
+				reference = renderDevice.GetColorBuffer();
+
+			const SoftwareRenderDevice::Stats& stats = renderDevice.GetStats();
+			double primitives = wireframe ? stats.lines : stats.triangles;
+			double megapixels = stats.pixelsShaded / 1e6;
+
+			printf("%10s %8d %10.3f %12.2f %10.1f %16.1f %12s\n", wireframe ? "wireframe" : "solid", threads, frameMs,
+				primitives / frameMs / 1e3, megapixels / frameMs * 1e3, megapixels / frameMs * 1e3 / threads,
+				BenchmarkCheck(renderDevice.GetColorBuffer() == reference) ? "yes" : "NO");
+		}
+	}
+}
@@ -0,0 +1,216 @@
+// Measures the batch transform kernels on every path against the per-object DirectXMath code
+// they replace, and checks that every path gives the same matrices and spheres.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "TransformKernels.h"
+
+using namespace std;
+
+namespace
+{
+	// The per-object code from before the kernels, as SceneGraph, RenderQueue and
+	// GameObject::GetBoundingSphere had it
+	void ComposeReference(const vector<TransformTRS>& transforms, vector<XMFLOAT4X4>& worlds)
+	{
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			XMMATRIX world = XMMatrixScalingFromVector(XMLoadFloat4(&transforms[i].scale)) *
+				XMMatrixRotationQuaternion(XMLoadFloat4(&transforms[i].rotation)) *
+				XMMatrixTranslationFromVector(XMLoadFloat4(&transforms[i].translation));
+			XMStoreFloat4x4(&worlds[i], world);
+		}
+	}
+
+	void MultiplyReference(const vector<XMFLOAT4X4>& locals, const XMFLOAT4X4& parent, vector<XMFLOAT4X4>& worlds)
+	{
+		for (size_t i = 0; i < locals.size(); i++)
+		{
+			XMStoreFloat4x4(&worlds[i], XMMatrixMultiply(XMLoadFloat4x4(&locals[i]), XMLoadFloat4x4(&parent)));
+		}
+	}
+
+	void TransposeReference(const vector<XMFLOAT4X4>& matrices, vector<XMFLOAT4X4>& transposed)
+	{
+		for (size_t i = 0; i < matrices.size(); i++)
+		{
+			XMStoreFloat4x4(&transposed[i], XMMatrixTranspose(XMLoadFloat4x4(&matrices[i])));
+		}
+	}
+
+	void SpheresReference(const SphereBounds& localSphere, const vector<XMFLOAT4X4>& worlds, vector<SphereBounds>& spheres)
+	{
+		for (size_t i = 0; i < worlds.size(); i++)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+			XMStoreFloat3(&spheres[i].Center, XMVector3TransformCoord(XMLoadFloat3(&localSphere.Center), world));
+
+			float scaleX = XMVectorGetX(XMVector3Length(world.r[0]));
+			float scaleY = XMVectorGetX(XMVector3Length(world.r[1]));
+			float scaleZ = XMVectorGetX(XMVector3Length(world.r[2]));
+			spheres[i].Radius = localSphere.Radius * (max)(scaleX, (max)(scaleY, scaleZ));
+		}
+	}
+
+	// Runs the kernel until a quarter of a second has passed and returns the time per object
+	template <typename Kernel>
+	double TimeKernel(Kernel kernel, int objectCount)
+	{
+		// Warm up
+		kernel();
+
+		int runs = 0;
+		BenchmarkTimer timer;
+
+		do
+		{
+			kernel();
+			runs++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e9 / ((double)runs * objectCount);
+	}
+
+	// The largest difference between two arrays of matrices or spheres, each of size floats,
+	// relative to the largest float of the reference it belongs to. The fused multiply-adds of the
+	// wider paths round differently, which shows most where large terms cancel.
+	float MaxRelativeDifference(const float * values, const float * reference, int count, int size)
+	{
+		float maxDifference = 0.0f;
+
+		for (int first = 0; first < count * size; first += size)
+		{
+			float magnitude = 1.0f;
+			for (int i = first; i < first + size; i++)
+			{
+				magnitude = (max)(magnitude, fabsf(reference[i]));
+			}
+
+			for (int i = first; i < first + size; i++)
+			{
+				maxDifference = (max)(maxDifference, fabsf(values[i] - reference[i]) / magnitude);
+			}
+		}
+
+		return maxDifference;
+	}
+
+	const float TOLERANCE = 1e-5f;
+
+	void PrintRow(const char * kernel, int objectCount, const char * path, double nsPerObject, double referenceNs, bool matches)
+	{
+		printf("%10s %10d %12s %12.2f %10.2fx %12s\n", kernel, objectCount, path, nsPerObject, referenceNs / nsPerObject, BenchmarkCheck(matches) ? "yes" : "NO");
+	}
+
+	void PrintUnsupported(const char * kernel, int objectCount, TransformPath path)
+	{
+		printf("%10s %10d %12s %12s\n", kernel, objectCount, GetTransformPathName(path), "unsupported");
+	}
+}
+
+void BenchmarkTransformKernels()
+{
+	printf("best path on this machine: %s\n", GetTransformPathName(GetBestTransformPath()));
+	printf("%10s %10s %12s %12s %11s %12s\n", "kernel", "objects", "path", "ns/object", "speedup", "matches ref");
+
+	// An odd count as well, so the transforms left over after the last whole register are checked
+	const int objectCounts[] = { 1001, 100000 };
+
+	for (int objectCount : objectCounts)
+	{
+		mt19937 randomGenerator(1);
+		uniform_real_distribution<float> scale(0.5f, 2.0f);
+		uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+		vector<TransformTRS> transforms(objectCount);
+		for (TransformTRS& transform : transforms)
+		{
+			transform.scale = XMFLOAT4(scale(randomGenerator), scale(randomGenerator), scale(randomGenerator), 0.0f);
+			XMStoreFloat4(&transform.rotation, XMQuaternionNormalize(XMVectorSet(unit(randomGenerator), unit(randomGenerator),
+				unit(randomGenerator), unit(randomGenerator))));
+			transform.translation = XMFLOAT4(position(randomGenerator), position(randomGenerator), position(randomGenerator), 0.0f);
+		}
+
+		XMFLOAT4X4 parent;
+		XMStoreFloat4x4(&parent, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixRotationRollPitchYaw(0.3f, 1.1f, -0.4f) *
+			XMMatrixTranslation(10.0f, -5.0f, 2.0f));
+		SphereBounds localSphere = { XMFLOAT3(0.1f, -0.2f, 0.3f), 1.5f };
+
+		vector<XMFLOAT4X4> locals(objectCount), referenceMatrices(objectCount), matrices(objectCount);
+		vector<SphereBounds> referenceSpheres(objectCount), spheres(objectCount);
+		ComposeReference(transforms, locals);
+
+		// Composing
+		double referenceNs = TimeKernel([&]() { ComposeReference(transforms, referenceMatrices); }, objectCount);
+		PrintRow("compose", objectCount, "directxmath", referenceNs, referenceNs, true);
+
+		for (int path = 0; path < TRANSFORM_PATH_COUNT; path++)
+		{
+			if (!IsTransformPathSupported((TransformPath)path))
+			{
+				PrintUnsupported("compose", objectCount, (TransformPath)path);
+				continue;
+			}
+
+			double ns = TimeKernel([&]() { ComposeTransforms(transforms.data(), matrices.data(), objectCount, (TransformPath)path); }, objectCount);
+			bool matches = MaxRelativeDifference(&matrices[0]._11, &referenceMatrices[0]._11, objectCount, 16) <= TOLERANCE;
+			PrintRow("compose", objectCount, GetTransformPathName((TransformPath)path), ns, referenceNs, matches);
+		}
+
+		// Multiplying by a parent
+		referenceNs = TimeKernel([&]() { MultiplyReference(locals, parent, referenceMatrices); }, objectCount);
+		PrintRow("multiply", objectCount, "directxmath", referenceNs, referenceNs, true);
+
+		for (int path = 0; path < TRANSFORM_PATH_COUNT; path++)
+		{
+			if (!IsTransformPathSupported((TransformPath)path))
+			{
+				PrintUnsupported("multiply", objectCount, (TransformPath)path);
+				continue;
+			}
+
+			double ns = TimeKernel([&]() { MultiplyTransforms(locals.data(), parent, matrices.data(), objectCount, (TransformPath)path); }, objectCount);
+			bool matches = MaxRelativeDifference(&matrices[0]._11, &referenceMatrices[0]._11, objectCount, 16) <= TOLERANCE;
+			PrintRow("multiply", objectCount, GetTransformPathName((TransformPath)path), ns, referenceNs, matches);
+		}
+
+		// Transposing only moves floats, so it has to match exactly
+		referenceNs = TimeKernel([&]() { TransposeReference(locals, referenceMatrices); }, objectCount);
+		PrintRow("transpose", objectCount, "directxmath", referenceNs, referenceNs, true);
+
+		for (int path = 0; path < TRANSFORM_PATH_COUNT; path++)
+		{
+			if (!IsTransformPathSupported((TransformPath)path))
+			{
+				PrintUnsupported("transpose", objectCount, (TransformPath)path);
+				continue;
+			}
+
+			double ns = TimeKernel([&]() { TransposeTransforms(locals.data(), matrices.data(), objectCount, (TransformPath)path); }, objectCount);
+			bool matches = MaxRelativeDifference(&matrices[0]._11, &referenceMatrices[0]._11, objectCount, 16) == 0.0f;
+			PrintRow("transpose", objectCount, GetTransformPathName((TransformPath)path), ns, referenceNs, matches);
+		}
+
+		// Moving bounding spheres
+		referenceNs = TimeKernel([&]() { SpheresReference(localSphere, locals, referenceSpheres); }, objectCount);
+		PrintRow("spheres", objectCount, "directxmath", referenceNs, referenceNs, true);
+
+		for (int path = 0; path < TRANSFORM_PATH_COUNT; path++)
+		{
+			if (!IsTransformPathSupported((TransformPath)path))
+			{
+				PrintUnsupported("spheres", objectCount, (TransformPath)path);
+				continue;
+			}
+
+			double ns = TimeKernel([&]() { TransformSpheres(localSphere, locals.data(), spheres.data(), objectCount, (TransformPath)path); }, objectCount);
+			bool matches = MaxRelativeDifference(&spheres[0].Center.x, &referenceSpheres[0].Center.x, objectCount, 4) <= TOLERANCE;
+			PrintRow("spheres", objectCount, GetTransformPathName((TransformPath)path), ns, referenceNs, matches);
+		}
+	}
+}
@@ -0,0 +1,157 @@
+// Compares TransformStack, which SolarSystem places the asteroids with, against the
+// vector<XMMATRIX> stack GameObject built its world matrix with before it.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "Benchmarks.h"
+#include "TransformStack.h"
+
+using namespace std;
+
+namespace
+{
+	// The stack multiplies in the same order as the vector, so only rounding may differ
+	const float MAX_PATH_DIFFERENCE = 1e-5f;
+
+	// The transform path GameObject used to have: every step is pushed into a vector and the
+	// vector is multiplied out and cleared in UpdateWorld
+	struct VectorTransforms
+	{
+		XMFLOAT4X4 world;
+		vector<XMMATRIX> transformations;
+
+		void SetScale(float x, float y, float z) { transformations.push_back(XMMatrixScaling(x, y, z)); }
+		void SetRotation(float x, float y, float z) { transformations.push_back(XMMatrixRotationX(x) * XMMatrixRotationY(y) * XMMatrixRotationZ(z)); }
+		void SetTranslation(float x, float y, float z) { transformations.push_back(XMMatrixTranslation(x, y, z)); }
+
+		void UpdateWorld()
+		{
+			XMMATRIX newWorld = XMMatrixIdentity();
+			for (auto T : transformations)
+			{
+				newWorld *= T;
+			}
+			XMStoreFloat4x4(&world, newWorld);
+			transformations.clear();
+		}
+	};
+
+	struct StackTransforms
+	{
+		XMFLOAT4X4 world;
+		TransformStack transformations;
+
+		void SetScale(float x, float y, float z) { transformations.Scale(x, y, z); }
+		void SetRotation(float x, float y, float z) { transformations.Rotate(x, y, z); }
+		void SetTranslation(float x, float y, float z) { transformations.Translate(x, y, z); }
+
+		void UpdateWorld()
+		{
+			XMStoreFloat4x4(&world, transformations.GetMatrix());
+			transformations.Reset();
+		}
+	};
+
+	// The chain GameObject built each moon with before the scene graph, the longest one there was
+	template <typename T>
+	void UpdateMoons(vector<T>& objects, float t)
+	{
+		for (auto& object : objects)
+		{
+			object.SetRotation(0.0f, (-t), 0.0f);
+			object.SetTranslation((-5.00f), 0.0f, 0.0f);
+			object.SetScale(0.25f, 0.25f, 0.25f);
+			object.SetRotation(0.0f, (-t * 3), 0.0f);
+			object.SetTranslation((-3.00f), 10.0f, 0.0f);
+			object.SetRotation(0.0f, (-t), 0.0f);
+		}
+
+		for (auto& object : objects)
+			object.UpdateWorld();
+	}
+
+	// The scale and translation each asteroid was placed with, as SolarSystem::Initialise still does
+	template <typename T>
+	void UpdateAsteroids(vector<T>& objects, float t)
+	{
+		float offset = t * 0.001f;
+
+		for (auto& object : objects)
+		{
+			object.SetScale(0.01f, 0.01f, 0.01f);
+			object.SetTranslation(offset, 0.0f, offset);
+		}
+
+		for (auto& object : objects)
+			object.UpdateWorld();
+	}
+
+	template <typename T>
+	double TimeUpdate(void (*update)(vector<T>&, float), int objectCount)
+	{
+		vector<T> objects(objectCount);
+
+		// Warm up, which also lets the vector path reach its steady state capacity
+		update(objects, 0.0f);
+
+		int frames = 0;
+		BenchmarkTimer timer;
+
+		do
+		{
+			update(objects, frames * 0.016f);
+			frames++;
+		} while (timer.GetSeconds() < 0.25);
+
+		return timer.GetSeconds() * 1e9 / (static_cast<double>(frames) * objectCount);
+	}
+
+	float MaxDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		float maxDifference = 0.0f;
+
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				float difference = a.m[row][column] - b.m[row][column];
+				if (difference < 0.0f)
+					difference = -difference;
+				if (difference > maxDifference)
+					maxDifference = difference;
+			}
+		}
+
+		return maxDifference;
+	}
+}
+
+void BenchmarkTransforms()
+{
+	// Both paths have to produce the same world matrix
+	vector<VectorTransforms> vectorObjects(1);
+	vector<StackTransforms> stackObjects(1);
+	UpdateMoons(vectorObjects, 1.234f);
+	UpdateMoons(stackObjects, 1.234f);
+	float difference = MaxDifference(vectorObjects[0].world, stackObjects[0].world);
+	UpdateAsteroids(vectorObjects, 1.234f);
+	UpdateAsteroids(stackObjects, 1.234f);
+	difference = (max)(difference, MaxDifference(vectorObjects[0].world, stackObjects[0].world));
+	printf("max difference from the vector path: %g, within %g: %s\n", difference, MAX_PATH_DIFFERENCE,
+		BenchmarkCheck(difference <= MAX_PATH_DIFFERENCE) ? "yes" : "NO");
+
+	const int objectCounts[] = { 100, 10000, 1000000 };
+
+	printf("%10s %20s %20s %24s %24s\n", "objects", "moon vector ns/obj", "moon stack ns/obj", "asteroid vector ns/obj", "asteroid stack ns/obj");
+
+	for (int objectCount : objectCounts)
+	{
+		double moonVector = TimeUpdate<VectorTransforms>(UpdateMoons<VectorTransforms>, objectCount);
+		double moonStack = TimeUpdate<StackTransforms>(UpdateMoons<StackTransforms>, objectCount);
+		double asteroidVector = TimeUpdate<VectorTransforms>(UpdateAsteroids<VectorTransforms>, objectCount);
+		double asteroidStack = TimeUpdate<StackTransforms>(UpdateAsteroids<StackTransforms>, objectCount);
+
+		printf("%10d %20.2f %20.2f %24.2f %24.2f\n", objectCount, moonVector, moonStack, asteroidVector, asteroidStack);
+	}
+}
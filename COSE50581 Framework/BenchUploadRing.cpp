@@ -0,0 +1,214 @@
+// Steps a small upload ring through alignment, wrapping and fences, checking each offset. Then
+// runs the ring through frames of constant and instance sized allocations with a GPU simulated
+// as some frames behind, and checks every allocation: aligned, inside the ring, and never over
+// space a frame still in flight owns. The ring is sized so that it never has to wait, so that it
+// has to wait for the GPU, and so that one frame overflows it on its own. Then times Allocate by
+// itself.
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "UploadRing.h"
+
+using namespace std;
+
+namespace
+{
+	struct Scenario
+	{
+		const char * name;
+		size_t capacity;
+		// How many frames the simulated GPU finishes behind the CPU
+		int gpuLag;
+		int allocationsPerFrame;
+		// Whether waiting for the GPU and overflowing within a frame should happen
+		bool expectWaits;
+		bool expectOverflows;
+	};
+
+	const Scenario SCENARIOS[] =
+	{
+		{ "roomy", 1024 * 1024, 2, 200, false, false },
+		{ "tight", 256 * 1024, 3, 200, true, false },
+		{ "overflow", 64 * 1024, 1, 200, true, true },
+	};
+
+	const int FRAMES = 2000;
+
+	// The size of D3D11RenderDevice's constant ring
+	const size_t CONSTANT_RING_BYTES = 2 * 1024 * 1024;
+
+	// Constant buffers take 256-byte blocks and instance data 64-byte matrices
+	void NextAllocation(mt19937& randomGenerator, size_t& size, size_t& alignment)
+	{
+		if (randomGenerator() % 4 == 0)
+		{
+			alignment = 64;
+			size = 64 * (1 + randomGenerator() % 32);
+		}
+		else
+		{
+			alignment = 256;
+			size = 256 * (1 + randomGenerator() % 2);
+		}
+	}
+
+	// Each step's offset is worked out by hand for a 1024 byte ring
+	bool CheckRingSteps()
+	{
+		UploadRing ring;
+		ring.Reset(1024);
+		bool correct = true;
+		uint64_t oldest = 0;
+
+		// Nothing empty, and nothing bigger than the ring
+		correct = correct && ring.Allocate(0, 4) == UploadRing::INVALID_OFFSET;
+		correct = correct && ring.Allocate(2048, 4) == UploadRing::INVALID_OFFSET;
+
+		// The second allocation is padded up to its alignment
+		correct = correct && ring.Allocate(10, 1) == 0;
+		correct = correct && ring.Allocate(16, 256) == 256;
+		ring.EndFrame(1);
+
+		// This one ends exactly at the end of the ring. The next has to wrap back to the start,
+		// which the first frame still owns.
+		correct = correct && ring.Allocate(512, 256) == 512;
+		correct = correct && ring.Allocate(256, 256) == UploadRing::INVALID_OFFSET;
+		correct = correct && ring.GetOldestFence(oldest) && oldest == 1;
+		ring.EndFrame(2);
+
+		// Once the first frame is retired the start is free, but the second frame's space is not
+		ring.Retire(1);
+		correct = correct && ring.Allocate(256, 256) == 0 && ring.GetStats().wraps == 1;
+		correct = correct && ring.Allocate(32, 16) == UploadRing::INVALID_OFFSET;
+		correct = correct && ring.GetOldestFence(oldest) && oldest == 2;
+
+		ring.Retire(2);
+		correct = correct && ring.Allocate(700, 4) == 256;
+		ring.EndFrame(3);
+
+		// With every frame retired the ring is empty and starts from the beginning again
+		ring.Retire(3);
+		correct = correct && ring.GetUsed() == 0 && ring.GetFramesInFlight() == 0 && !ring.GetOldestFence(oldest);
+		correct = correct && ring.Allocate(8, 8) == 0;
+
+		return correct;
+	}
+
+	void RunScenario(const Scenario& scenario)
+	{
+		UploadRing ring;
+		ring.Reset(scenario.capacity);
+
+		// The fence of the frame owning each byte, or 0, and what each frame allocated
+		vector<uint64_t> owner(scenario.capacity, 0);
+		vector<vector<pair<size_t, size_t>>> frameAllocations(FRAMES + 1);
+		uint64_t completed = 0;
+
+		mt19937 randomGenerator(7);
+		bool correct = true;
+		long long waits = 0;
+		long long overflows = 0;
+
+		auto retire = [&](uint64_t fence)
+		{
+			for (; completed < fence; completed++)
+			{
+				for (const pair<size_t, size_t>& allocation : frameAllocations[completed + 1])
+				{
+					for (size_t i = allocation.first; i < allocation.first + allocation.second; i++)
+						owner[i] = 0;
+				}
+			}
+
+			ring.Retire(fence);
+		};
+
+		for (uint64_t fence = 1; fence <= (uint64_t)FRAMES; fence++)
+		{
+			for (int i = 0; i < scenario.allocationsPerFrame; i++)
+			{
+				size_t size, alignment;
+				NextAllocation(randomGenerator, size, alignment);
+
+				// Wait for the oldest frame as D3D11RenderDevice does, until it fits or nothing is left to wait for
+				size_t offset = ring.Allocate(size, alignment);
+				uint64_t oldest;
+				while (offset == UploadRing::INVALID_OFFSET && ring.GetOldestFence(oldest))
+				{
+					waits++;
+					retire(oldest);
+					offset = ring.Allocate(size, alignment);
+				}
+
+				if (offset == UploadRing::INVALID_OFFSET)
+				{
+					overflows++;
+					continue;
+				}
+
+				if (offset % alignment != 0 || offset + size > scenario.capacity)
+					correct = false;
+
+				for (size_t byte = offset; byte < offset + size && correct; byte++)
+				{
+					if (owner[byte] != 0)
+						correct = false;
+					owner[byte] = fence;
+				}
+
+				frameAllocations[fence].push_back(make_pair(offset, size));
+			}
+
+			ring.EndFrame(fence);
+
+			if (fence > (uint64_t)scenario.gpuLag)
+				retire(fence - scenario.gpuLag);
+		}
+
+		// Once the GPU catches up everything is free again
+		retire(FRAMES);
+		correct = correct && ring.GetUsed() == 0 && ring.GetFramesInFlight() == 0;
+
+		const UploadRingStats& stats = ring.GetStats();
+		bool expected = stats.wraps > 0 && (waits > 0) == scenario.expectWaits && (overflows > 0) == scenario.expectOverflows;
+
+		printf("%10s %10d %5d %12lld %8lld %8lld %10lld %9.1f%% %8s\n", scenario.name, (int)scenario.capacity, scenario.gpuLag,
+			stats.allocations, stats.wraps, waits, overflows, 100.0 * stats.paddingBytes / (double)stats.bytesAllocated,
+			BenchmarkCheck(correct && expected) ? "yes" : "NO");
+	}
+}
+
+void BenchmarkUploadRing()
+{
+	printf("alignment, wrapping and fences step by step: %s\n\n", BenchmarkCheck(CheckRingSteps()) ? "yes" : "NO");
+
+	printf("%10s %10s %5s %12s %8s %8s %10s %10s %8s\n", "ring", "bytes", "lag", "allocations", "wraps", "waits", "overflows",
+		"padding", "correct");
+
+	for (const Scenario& scenario : SCENARIOS)
+		RunScenario(scenario);
+
+	// Allocate alone, in frames that always retire two behind
+	UploadRing ring;
+	ring.Reset(CONSTANT_RING_BYTES);
+
+	long long allocations = 0;
+	uint64_t fence = 0;
+	BenchmarkTimer timer;
+	do
+	{
+		for (int i = 0; i < 1000; i++)
+			ring.Allocate(256, 256);
+
+		ring.EndFrame(++fence);
+		if (fence > 2)
+			ring.Retire(fence - 2);
+
+		allocations += 1000;
+	} while (timer.GetSeconds() < 0.25);
+
+	printf("\nAllocate: %.1f ns each, %lld failed\n", timer.GetSeconds() * 1e9 / allocations, ring.GetStats().failedAllocations);
+}
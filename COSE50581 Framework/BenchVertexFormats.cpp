@@ -0,0 +1,314 @@
+// Measures the compressed vertex formats. Checks that octahedral normals stay within their
+// stated angle of the original over random and awkward normals, and that quantised positions stay
+// within GetPositionErrorBound, then compares the memory each format takes for a few meshes, how
+// fast they encode and decode, and how much a software rendered image of each changes.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+#include "Benchmarks.h"
+#include "ConstantBuffers.h"
+#include "JobSystem.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+#include "VertexCompression.h"
+
+using namespace std;
+
+namespace
+{
+	const int WIDTH = 640;
+	const int HEIGHT = 480;
+
+	const char * FORMAT_NAMES[VERTEX_FORMAT_COUNT] = { "simple", "quantised 12", "quantised 8" };
+
+	// Worked out in double precision from both the sine and cosine, since an arc cosine of a float
+	// can't resolve angles much under a few hundredths of a degree
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double cross[3] = { (double)a.y * b.z - (double)a.z * b.y, (double)a.z * b.x - (double)a.x * b.z, (double)a.x * b.y - (double)a.y * b.x };
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		double sine = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+		return (float)(atan2(sine, dot) * 180.0 / XM_PI);
+	}
+
+	// Random directions, and the ones most likely to go wrong: the axes, the octahedron's edges and
+	// the seam where the lower half is folded out, and normals with tiny components
+	vector<XMFLOAT3> CreateTestNormals(int randomCount)
+	{
+		vector<XMFLOAT3> normals;
+		const float values[] = { -1.0f, -0.5f, -1e-6f, 0.0f, 1e-6f, 0.5f, 1.0f };
+
+		for (float x : values)
+		{
+			for (float y : values)
+			{
+				for (float z : values)
+				{
+					if (x != 0.0f || y != 0.0f || z != 0.0f)
+					{
+						XMFLOAT3 normal;
+						XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+						normals.push_back(normal);
+					}
+				}
+			}
+		}
+
+		mt19937 randomGenerator(1);
+		normal_distribution<float> gaussian(0.0f, 1.0f);
+
+		while ((int)normals.size() < randomCount)
+		{
+			XMVECTOR direction = XMVectorSet(gaussian(randomGenerator), gaussian(randomGenerator), gaussian(randomGenerator), 0.0f);
+			if (XMVectorGetX(XMVector3LengthSq(direction)) < 1e-12f)
+				continue;
+
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(direction));
+			normals.push_back(normal);
+		}
+
+		return normals;
+	}
+
+	void CheckNormals(int bits, float bound, const vector<XMFLOAT3>& normals)
+	{
+		double sumAngle = 0.0;
+		float maxAngle = 0.0f;
+
+		for (const XMFLOAT3& normal : normals)
+		{
+			int encoded[2];
+			EncodeOctahedral(normal, bits, encoded);
+			float angle = AngleDegrees(normal, DecodeOctahedral(encoded, bits));
+
+			sumAngle += angle;
+			maxAngle = (std::max)(maxAngle, angle);
+		}
+
+		// Encoding and decoding together, timed on the same normals
+		int checksum = 0;
+		long long count = 0;
+		BenchmarkTimer timer;
+		do
+		{
+			for (const XMFLOAT3& normal : normals)
+			{
+				int encoded[2];
+				EncodeOctahedral(normal, bits, encoded);
+				checksum += DecodeOctahedral(encoded, bits).x > 0.0f ? 1 : 0;
+			}
+			count += normals.size();
+		} while (timer.GetSeconds() < 0.25);
+
+		double seconds = timer.GetSeconds();
+
+		printf("%6d %10d %12.5f %12.5f %12.5f %14.1f %6s\n", bits, (int)normals.size(), sumAngle / normals.size(), maxAngle, bound,
+			count / seconds / 1e6, BenchmarkCheck(maxAngle <= bound && checksum >= 0) ? "yes" : "NO");
+	}
+
+	// Normals without a direction have to come out as +z, rather than as whatever was on the stack
+	bool CheckDegenerateNormals(int bits)
+	{
+		const float nan = numeric_limits<float>::quiet_NaN();
+		const float infinity = numeric_limits<float>::infinity();
+		const XMFLOAT3 normals[] =
+		{
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(nan, nan, nan),
+			XMFLOAT3(nan, 0.0f, -1.0f),
+			XMFLOAT3(infinity, 0.0f, 0.0f),
+			XMFLOAT3(-infinity, infinity, -1.0f),
+		};
+
+		for (const XMFLOAT3& normal : normals)
+		{
+			int encoded[2] = { 12345, 12345 };
+			EncodeOctahedral(normal, bits, encoded);
+			if (encoded[0] != 0 || encoded[1] != 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	// A height field with more triangles than the spheres, spread over a wide flat box
+	MeshGeometry CreateTerrain(int gridSize)
+	{
+		MeshGeometry geometry;
+		int side = gridSize + 1;
+
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				float u = x / (float)gridSize * XM_2PI * 3.0f;
+				float v = z / (float)gridSize * XM_2PI * 2.0f;
+
+				SimpleVertex vertex;
+				vertex.Pos = XMFLOAT3(x / (float)gridSize * 20.0f - 10.0f, sinf(u) * cosf(v), z / (float)gridSize * 20.0f - 10.0f);
+				XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVectorSet(-cosf(u) * cosf(v) * 0.3f * XM_PI, 1.0f,
+					sinf(u) * sinf(v) * 0.2f * XM_PI, 0.0f)));
+				geometry.vertices.push_back(vertex);
+			}
+		}
+
+		for (int z = 0; z < gridSize; z++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				unsigned short a = (unsigned short)(z * side + x);
+				unsigned short b = (unsigned short)(a + 1);
+				unsigned short c = (unsigned short)(a + side);
+				unsigned short d = (unsigned short)(c + 1);
+				unsigned short quad[6] = { a, c, b, b, c, d };
+				geometry.indices.insert(geometry.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return geometry;
+	}
+
+	// The mesh lit and drawn filling most of the screen, as its colour buffer
+	vector<uint32_t> Render(SoftwareRenderDevice& renderDevice, JobSystem& jobSystem, const MeshData& meshData)
+	{
+		XMVECTOR center = XMLoadFloat3(&meshData.BoundsCenter);
+		XMVECTOR eye = XMVectorAdd(center, XMVectorScale(XMVectorSet(0.6f, 0.5f, -1.0f, 0.0f), 1.6f * meshData.BoundsRadius));
+
+		FrameConstants frameConstants = {};
+		frameConstants.mView = XMMatrixTranspose(XMMatrixLookAtLH(eye, center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		frameConstants.mProjection = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, WIDTH / (float)HEIGHT, 0.01f,
+			100.0f * meshData.BoundsRadius));
+		frameConstants.diffuseLight = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		frameConstants.gAmbientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		frameConstants.gSpecularLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+		XMStoreFloat3(&frameConstants.gEyePosW, eye);
+		frameConstants.lightVecW = XMFLOAT3(0.25f, 0.5f, -1.0f);
+
+		MaterialConstants materialConstants = {};
+		materialConstants.diffuseMaterial = XMFLOAT4(0.25f, 0.5f, 1.0f, 1.0f);
+		materialConstants.gAmbientMtrl = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		materialConstants.gSpecularMtrl = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		materialConstants.gSpecularPower = 10.0f;
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+		float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		renderDevice.Clear(clearColor);
+		renderDevice.UpdateConstantBuffer(CB_FRAME, &frameConstants, sizeof(frameConstants));
+		renderDevice.UpdateConstantBuffer(CB_MATERIAL, &materialConstants, sizeof(materialConstants));
+		renderDevice.SetRasterizerState(RS_SOLID);
+		renderDevice.UpdateInstanceBuffer(&world, 1);
+		renderDevice.DrawIndexedInstanced(meshData, 1, 0);
+		renderDevice.Rasterise(jobSystem);
+
+		return renderDevice.GetColorBuffer();
+	}
+
+	// Pixels that differ by more than one step in any channel
+	int CompareImages(const vector<uint32_t>& a, const vector<uint32_t>& b)
+	{
+		int differing = 0;
+
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			int difference = 0;
+			for (int shift = 0; shift < 32; shift += 8)
+				difference = (std::max)(difference, abs((int)((a[i] >> shift) & 0xFF) - (int)((b[i] >> shift) & 0xFF)));
+
+			differing += difference > 1 ? 1 : 0;
+		}
+
+		return differing;
+	}
+}
+
+void BenchmarkVertexFormats()
+{
+	vector<XMFLOAT3> normals = CreateTestNormals(1 << 20);
+
+	printf("octahedral normals, angle in degrees\n");
+	printf("%6s %10s %12s %12s %12s %14s %6s\n", "bits", "normals", "mean", "max", "bound", "M per second", "within");
+	CheckNormals(16, OCTAHEDRAL_16_ERROR_DEGREES, normals);
+	CheckNormals(8, OCTAHEDRAL_8_ERROR_DEGREES, normals);
+	printf("zero, infinite and NaN normals encoded as +z: %s\n",
+		BenchmarkCheck(CheckDegenerateNormals(16) && CheckDegenerateNormals(8)) ? "yes" : "NO");
+
+	struct TestMesh
+	{
+		const char * name;
+		MeshGeometry geometry;
+	};
+
+	TestMesh meshes[] =
+	{
+		{ "icosphere 6", CreateIcosphereGeometry(6) },
+		{ "uv sphere", CreateUVSphereGeometry(128, 256) },
+		{ "terrain", CreateTerrain(200) },
+	};
+
+	JobSystem jobSystem(0);
+	SoftwareRenderDevice renderDevice(WIDTH, HEIGHT);
+	renderDevice.RegisterRasterizerState(RS_SOLID, false);
+
+	printf("\n%12s %13s %8s %10s %7s %12s %12s %10s %10s %10s %11s %6s\n", "mesh", "format", "vertices", "bytes", "size",
+		"position", "bound", "normal", "encode ms", "decode ms", "pixels off", "within");
+
+	for (TestMesh& mesh : meshes)
+	{
+		const vector<SimpleVertex>& vertices = mesh.geometry.vertices;
+		vector<uint32_t> reference;
+
+		for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+		{
+			CompressedVertices compressed;
+			int encodes = 0;
+			BenchmarkTimer encodeTimer;
+			do
+			{
+				CompressVertices(vertices, (MeshVertexFormat)format, compressed);
+				encodes++;
+			} while (encodeTimer.GetSeconds() < 0.25);
+			double encodeMs = encodeTimer.GetSeconds() * 1e3 / encodes;
+
+			vector<SimpleVertex> decoded;
+			int decodes = 0;
+			BenchmarkTimer decodeTimer;
+			do
+			{
+				DecompressVertices(compressed, decoded);
+				decodes++;
+			} while (decodeTimer.GetSeconds() < 0.25);
+			double decodeMs = decodeTimer.GetSeconds() * 1e3 / decodes;
+
+			float positionError = 0.0f;
+			float normalError = 0.0f;
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&decoded[i].Pos), XMLoadFloat3(&vertices[i].Pos));
+				positionError = (std::max)(positionError, XMVectorGetX(XMVector3Length(offset)));
+				normalError = (std::max)(normalError, AngleDegrees(vertices[i].Normal, decoded[i].Normal));
+			}
+
+			float positionBound = format == VERTEX_FORMAT_SIMPLE ? 0.0f : GetPositionErrorBound(compressed.quantisation);
+			float normalBound = format == VERTEX_FORMAT_QUANTISED_12 ? OCTAHEDRAL_16_ERROR_DEGREES :
+				format == VERTEX_FORMAT_QUANTISED_8 ? OCTAHEDRAL_8_ERROR_DEGREES : 0.0f;
+
+			vector<uint32_t> image = Render(renderDevice, jobSystem, renderDevice.CreateMesh(mesh.geometry, (MeshVertexFormat)format));
+			if (format == VERTEX_FORMAT_SIMPLE)
+				reference = image;
+
+			printf("%12s %13s %8d %10d %6.0f%% %12.3g %12.3g %10.4f %10.2f %10.2f %11d %6s\n", mesh.name, FORMAT_NAMES[format],
+				(int)vertices.size(), (int)compressed.data.size(), 100.0 * compressed.data.size() / (sizeof(SimpleVertex) * vertices.size()),
+				positionError, positionBound, normalError, encodeMs, decodeMs, CompareImages(reference, image),
+				BenchmarkCheck(positionError <= positionBound && normalError <= normalBound) ? "yes" : "NO");
+		}
+	}
+}
@@ -0,0 +1,154 @@
+// Runs the benchmarks for the simulation core.
+//
+// Usage: Benchmarks [--json report.json] [--baseline report.json [--tolerance fraction]] [name...]
+// With no names every benchmark is run. With --json the micro benchmarks' results are also
+// written to a report, and with --baseline they are compared against an earlier one. Any
+// operation more than the tolerance (0.1 unless given) slower, or allocating more often, makes
+// the exit code 2, so that a build can be failed on it. A failed correctness check, printed as
+// NO, makes the exit code 3, and each benchmark with checks is registered with CTest.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Benchmarks.h"
+#include "MicroBenchmark.h"
+
+struct Benchmark
+{
+	const char * name;
+	void (*run)();
+};
+
+static const Benchmark benchmarks[] =
+{
+	{ "transforms", BenchmarkTransforms },
+	{ "scenegraph", BenchmarkSceneGraph },
+	{ "instancing", BenchmarkInstancing },
+	{ "constants", BenchmarkConstants },
+	{ "renderqueue", BenchmarkRenderQueue },
+	{ "culling", BenchmarkCulling },
+	{ "bvh", BenchmarkBvh },
+	{ "jobs", BenchmarkJobs },
+	{ "commands", BenchmarkCommands },
+	{ "softraster", BenchmarkSoftwareRaster },
+	{ "profiler", BenchmarkProfiler },
+	{ "meshload", BenchmarkMeshLoad },
+	{ "meshopt", BenchmarkMeshOptimizer },
+	{ "lod", BenchmarkLod },
+	{ "vertexformats", BenchmarkVertexFormats },
+	{ "uploadring", BenchmarkUploadRing },
+	{ "objectpool", BenchmarkObjectPool },
+	{ "nbody", BenchmarkNBody },
+	{ "transformkernels", BenchmarkTransformKernels },
+	{ "sceneload", BenchmarkSceneLoad },
+	{ "micro", BenchmarkMicro },
+};
+
+static bool checkFailed = false;
+
+bool BenchmarkCheck(bool passed)
+{
+	if (!passed)
+		checkFailed = true;
+
+	return passed;
+}
+
+int main(int argc, char* argv[])
+{
+	int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	const char * jsonPath = nullptr;
+	const char * baselinePath = nullptr;
+	double tolerance = 0.1;
+	std::vector<const char *> names;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		bool hasValue = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--json") == 0 || strcmp(argv[arg], "--baseline") == 0 || strcmp(argv[arg], "--tolerance") == 0)
+		{
+			if (!hasValue)
+			{
+				fprintf(stderr, "%s needs a value\n", argv[arg]);
+				return 1;
+			}
+
+			if (strcmp(argv[arg], "--json") == 0)
+				jsonPath = argv[arg + 1];
+			else if (strcmp(argv[arg], "--baseline") == 0)
+				baselinePath = argv[arg + 1];
+			else
+				tolerance = atof(argv[arg + 1]);
+
+			arg++;
+		}
+		else
+		{
+			names.push_back(argv[arg]);
+		}
+	}
+
+	if (names.empty())
+	{
+		for (int i = 0; i < benchmarkCount; i++)
+		{
+			printf("== %s ==\n", benchmarks[i].name);
+			benchmarks[i].run();
+		}
+	}
+
+	for (const char * name : names)
+	{
+		bool found = false;
+
+		for (int i = 0; i < benchmarkCount; i++)
+		{
+			if (strcmp(name, benchmarks[i].name) == 0)
+			{
+				printf("== %s ==\n", benchmarks[i].name);
+				benchmarks[i].run();
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			fprintf(stderr, "Unknown benchmark: %s\n", name);
+			return 1;
+		}
+	}
+
+	if (jsonPath && !WriteMicroBenchmarkJson(jsonPath))
+	{
+		fprintf(stderr, "Couldn't write %s\n", jsonPath);
+		return 1;
+	}
+
+	int result = 0;
+
+	if (baselinePath)
+	{
+		printf("== compared with %s ==\n", baselinePath);
+		int regressions = CompareMicroBenchmarkJson(baselinePath, tolerance);
+
+		if (regressions < 0)
+		{
+			fprintf(stderr, "Couldn't read %s\n", baselinePath);
+			return 1;
+		}
+
+		if (regressions > 0)
+			result = 2;
+	}
+
+	if (checkFailed)
+	{
+		fflush(stdout);
+		fprintf(stderr, "A correctness check failed\n");
+		result = 3;
+	}
+
+	return result;
+}
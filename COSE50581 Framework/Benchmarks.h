@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+
+// Every benchmark is a free function that prints its own results. They are listed by name in
+// Benchmarks.cpp so that a single one can be run from the command line.
+void BenchmarkTransforms();
+void BenchmarkSceneGraph();
+void BenchmarkInstancing();
+void BenchmarkConstants();
+void BenchmarkRenderQueue();
+void BenchmarkCulling();
+void BenchmarkBvh();
+void BenchmarkJobs();
+void BenchmarkCommands();
+void BenchmarkSoftwareRaster();
+void BenchmarkProfiler();
+void BenchmarkMeshLoad();
+void BenchmarkMeshOptimizer();
+void BenchmarkLod();
+void BenchmarkVertexFormats();
+void BenchmarkUploadRing();
+void BenchmarkObjectPool();
+void BenchmarkNBody();
+void BenchmarkTransformKernels();
+void BenchmarkSceneLoad();
+void BenchmarkMicro();
+
+// Records the result of one of a benchmark's correctness checks and gives it back, so that it
+// can be printed as it is made. Benchmarks exits with 3 once everything asked for has run if any
+// check failed.
+bool BenchmarkCheck(bool passed);
+
+// Wall clock timer used by the benchmarks
+class BenchmarkTimer
+{
+private:
+	std::chrono::steady_clock::time_point _start;
+
+public:
+	BenchmarkTimer() : _start(std::chrono::steady_clock::now()) {}
+
+	double GetSeconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+	}
+};
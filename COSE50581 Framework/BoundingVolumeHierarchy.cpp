@@ -0,0 +1,556 @@
+#include "BoundingVolumeHierarchy.h"
+#include "GameObject.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+const int BoundingVolumeHierarchy::MAX_LEAF_SIZE;
+const int BoundingVolumeHierarchy::BIN_COUNT;
+const int BoundingVolumeHierarchy::MAX_SAH_DEPTH;
+const int BoundingVolumeHierarchy::STACK_SIZE;
+
+// Half the surface area of a box, which is all the surface area heuristic needs
+static float HalfArea(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	float x = boundsMax.x - boundsMin.x;
+	float y = boundsMax.y - boundsMin.y;
+	float z = boundsMax.z - boundsMin.z;
+
+	return x * y + y * z + z * x;
+}
+
+static void GrowBounds(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const XMFLOAT3& pointMin, const XMFLOAT3& pointMax)
+{
+	boundsMin.x = (std::min)(boundsMin.x, pointMin.x);
+	boundsMin.y = (std::min)(boundsMin.y, pointMin.y);
+	boundsMin.z = (std::min)(boundsMin.z, pointMin.z);
+	boundsMax.x = (std::max)(boundsMax.x, pointMax.x);
+	boundsMax.y = (std::max)(boundsMax.y, pointMax.y);
+	boundsMax.z = (std::max)(boundsMax.z, pointMax.z);
+}
+
+static float GetAxis(const XMFLOAT3& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+	_builtCost = 0.0f;
+	_cost = 0.0f;
+}
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+}
+
+void BoundingVolumeHierarchy::Build(const SphereBounds * spheres, int count)
+{
+	_entries.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		_entries[i].sphere = spheres[i];
+		_entries[i].object = i;
+	}
+
+	_nodes.clear();
+	_builtCost = 0.0f;
+	_cost = 0.0f;
+
+	if (count == 0)
+		return;
+
+	// A binary tree with at least one object per leaf never has more than 2n - 1 nodes
+	_nodes.reserve(2 * count - 1);
+
+	Node root;
+	root.leftOrFirst = 0;
+	root.count = count;
+	_nodes.push_back(root);
+	UpdateNodeBounds(0);
+
+	// Split the nodes depth first, keeping the nodes still to split on a stack
+	int stack[STACK_SIZE][2];
+	int stackSize = 0;
+	stack[stackSize][0] = 0;
+	stack[stackSize][1] = 0;
+	stackSize++;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		int nodeIndex = stack[stackSize][0];
+		int depth = stack[stackSize][1];
+
+		if (Split(nodeIndex, depth))
+		{
+			int left = _nodes[nodeIndex].leftOrFirst;
+
+			stack[stackSize][0] = left;
+			stack[stackSize][1] = depth + 1;
+			stack[stackSize + 1][0] = left + 1;
+			stack[stackSize + 1][1] = depth + 1;
+			stackSize += 2;
+		}
+	}
+
+	for (const Node& node : _nodes)
+	{
+		_builtCost += HalfArea(node.boundsMin, node.boundsMax);
+	}
+
+	_cost = _builtCost;
+}
+
+void BoundingVolumeHierarchy::Build(const GameObject * gameObjects, int count)
+{
+	vector<SphereBounds> spheres(count);
+	for (int i = 0; i < count; i++)
+	{
+		spheres[i] = gameObjects[i].GetBoundingSphere();
+	}
+
+	Build(spheres.data(), count);
+}
+
+void BoundingVolumeHierarchy::UpdateNodeBounds(int nodeIndex)
+{
+	Node& node = _nodes[nodeIndex];
+	node.boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+	{
+		const SphereBounds& sphere = _entries[i].sphere;
+		XMFLOAT3 sphereMin(sphere.Center.x - sphere.Radius, sphere.Center.y - sphere.Radius, sphere.Center.z - sphere.Radius);
+		XMFLOAT3 sphereMax(sphere.Center.x + sphere.Radius, sphere.Center.y + sphere.Radius, sphere.Center.z + sphere.Radius);
+		GrowBounds(node.boundsMin, node.boundsMax, sphereMin, sphereMax);
+	}
+}
+
+bool BoundingVolumeHierarchy::Split(int nodeIndex, int depth)
+{
+	int first = _nodes[nodeIndex].leftOrFirst;
+	int count = _nodes[nodeIndex].count;
+
+	if (count <= MAX_LEAF_SIZE)
+		return false;
+
+	// Split along the axis the sphere centres are most spread out on
+	XMFLOAT3 centreMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 centreMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		GrowBounds(centreMin, centreMax, _entries[i].sphere.Center, _entries[i].sphere.Center);
+	}
+
+	XMFLOAT3 extent(centreMax.x - centreMin.x, centreMax.y - centreMin.y, centreMax.z - centreMin.z);
+	int axis = 0;
+	if (extent.y > GetAxis(extent, axis))
+		axis = 1;
+	if (extent.z > GetAxis(extent, axis))
+		axis = 2;
+
+	float axisMin = GetAxis(centreMin, axis);
+	float axisExtent = GetAxis(extent, axis);
+	int leftCount = 0;
+
+	if (axisExtent > 0.0f && depth < MAX_SAH_DEPTH)
+	{
+		// Drop the centres into bins along the axis, then pick the boundary between bins where
+		// the children's surface area times their object count is smallest
+		struct Bin
+		{
+			XMFLOAT3 boundsMin;
+			XMFLOAT3 boundsMax;
+			int count;
+		};
+
+		Bin bins[BIN_COUNT];
+		for (Bin& bin : bins)
+		{
+			bin.boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			bin.boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			bin.count = 0;
+		}
+
+		float binScale = BIN_COUNT / axisExtent;
+		for (int i = first; i < first + count; i++)
+		{
+			const SphereBounds& sphere = _entries[i].sphere;
+			int binIndex = (std::min)(BIN_COUNT - 1, (int)((GetAxis(sphere.Center, axis) - axisMin) * binScale));
+
+			XMFLOAT3 sphereMin(sphere.Center.x - sphere.Radius, sphere.Center.y - sphere.Radius, sphere.Center.z - sphere.Radius);
+			XMFLOAT3 sphereMax(sphere.Center.x + sphere.Radius, sphere.Center.y + sphere.Radius, sphere.Center.z + sphere.Radius);
+			GrowBounds(bins[binIndex].boundsMin, bins[binIndex].boundsMax, sphereMin, sphereMax);
+			bins[binIndex].count++;
+		}
+
+		// Sweep from the right to get the cost of everything right of each boundary, then from
+		// the left to add the cost of everything left of it
+		float rightCosts[BIN_COUNT];
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int rightCount = 0;
+		for (int b = BIN_COUNT - 1; b > 0; b--)
+		{
+			GrowBounds(boundsMin, boundsMax, bins[b].boundsMin, bins[b].boundsMax);
+			rightCount += bins[b].count;
+			rightCosts[b] = rightCount > 0 ? HalfArea(boundsMin, boundsMax) * rightCount : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestBoundary = -1;
+		boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int runningLeftCount = 0;
+		for (int b = 1; b < BIN_COUNT; b++)
+		{
+			GrowBounds(boundsMin, boundsMax, bins[b - 1].boundsMin, bins[b - 1].boundsMax);
+			runningLeftCount += bins[b - 1].count;
+
+			if (runningLeftCount == 0 || runningLeftCount == count)
+				continue;
+
+			float cost = HalfArea(boundsMin, boundsMax) * runningLeftCount + rightCosts[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBoundary = b;
+			}
+		}
+
+		if (bestBoundary > 0)
+		{
+			// Move the entries left of the boundary to the front
+			int i = first;
+			int j = first + count - 1;
+			while (i <= j)
+			{
+				int binIndex = (std::min)(BIN_COUNT - 1, (int)((GetAxis(_entries[i].sphere.Center, axis) - axisMin) * binScale));
+				if (binIndex < bestBoundary)
+				{
+					i++;
+				}
+				else
+				{
+					swap(_entries[i], _entries[j]);
+					j--;
+				}
+			}
+
+			leftCount = i - first;
+		}
+	}
+
+	if (leftCount == 0 || leftCount == count)
+	{
+		// Every centre is in the same place, or the tree is already deep: split in half
+		leftCount = count / 2;
+		nth_element(_entries.begin() + first, _entries.begin() + first + leftCount, _entries.begin() + first + count,
+			[axis](const Entry& a, const Entry& b) { return GetAxis(a.sphere.Center, axis) < GetAxis(b.sphere.Center, axis); });
+	}
+
+	int left = (int)_nodes.size();
+	_nodes.resize(left + 2);
+
+	_nodes[left].leftOrFirst = first;
+	_nodes[left].count = leftCount;
+	_nodes[left + 1].leftOrFirst = first + leftCount;
+	_nodes[left + 1].count = count - leftCount;
+	UpdateNodeBounds(left);
+	UpdateNodeBounds(left + 1);
+
+	_nodes[nodeIndex].leftOrFirst = left;
+	_nodes[nodeIndex].count = 0;
+
+	return true;
+}
+
+void BoundingVolumeHierarchy::Refit(const SphereBounds * spheres)
+{
+	for (Entry& entry : _entries)
+	{
+		entry.sphere = spheres[entry.object];
+	}
+
+	Refit();
+}
+
+void BoundingVolumeHierarchy::Refit(const GameObject * gameObjects)
+{
+	for (Entry& entry : _entries)
+	{
+		entry.sphere = gameObjects[entry.object].GetBoundingSphere();
+	}
+
+	Refit();
+}
+
+void BoundingVolumeHierarchy::Refit()
+{
+	// Children always come after their parents, so walking backwards updates every child
+	// before the node that contains it
+	_cost = 0.0f;
+
+	for (int i = (int)_nodes.size() - 1; i >= 0; i--)
+	{
+		Node& node = _nodes[i];
+
+		if (node.count > 0)
+		{
+			UpdateNodeBounds(i);
+		}
+		else
+		{
+			const Node& left = _nodes[node.leftOrFirst];
+			const Node& right = _nodes[node.leftOrFirst + 1];
+			node.boundsMin = left.boundsMin;
+			node.boundsMax = left.boundsMax;
+			GrowBounds(node.boundsMin, node.boundsMax, right.boundsMin, right.boundsMax);
+		}
+
+		_cost += HalfArea(node.boundsMin, node.boundsMax);
+	}
+}
+
+bool BoundingVolumeHierarchy::NeedsRebuild() const
+{
+	return _cost > 2.0f * _builtCost;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, vector<int>& results) const
+{
+	if (_nodes.empty())
+		return;
+
+	const int ALL_PLANES = (1 << Frustum::PLANE_COUNT) - 1;
+
+	// Each entry is a node and the planes it still has to be tested against. Once a box is
+	// completely inside a plane, nothing below it needs testing against that plane again.
+	int stack[STACK_SIZE][2];
+	int stackSize = 0;
+	stack[stackSize][0] = 0;
+	stack[stackSize][1] = ALL_PLANES;
+	stackSize++;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		const Node& node = _nodes[stack[stackSize][0]];
+		int planeMask = stack[stackSize][1];
+
+		XMFLOAT3 centre((node.boundsMin.x + node.boundsMax.x) * 0.5f, (node.boundsMin.y + node.boundsMax.y) * 0.5f, (node.boundsMin.z + node.boundsMax.z) * 0.5f);
+		XMFLOAT3 halfSize((node.boundsMax.x - node.boundsMin.x) * 0.5f, (node.boundsMax.y - node.boundsMin.y) * 0.5f, (node.boundsMax.z - node.boundsMin.z) * 0.5f);
+		bool outside = false;
+
+		for (int p = 0; p < Frustum::PLANE_COUNT && !outside; p++)
+		{
+			if ((planeMask & (1 << p)) == 0)
+				continue;
+
+			const XMFLOAT4& plane = frustum.planes[p];
+			float distance = plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w;
+			float reach = fabsf(plane.x) * halfSize.x + fabsf(plane.y) * halfSize.y + fabsf(plane.z) * halfSize.z;
+
+			if (distance + reach < 0.0f)
+				outside = true;
+			else if (distance - reach > 0.0f)
+				planeMask &= ~(1 << p);
+		}
+
+		if (outside)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[stackSize][0] = node.leftOrFirst;
+			stack[stackSize][1] = planeMask;
+			stack[stackSize + 1][0] = node.leftOrFirst + 1;
+			stack[stackSize + 1][1] = planeMask;
+			stackSize += 2;
+			continue;
+		}
+
+		for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+		{
+			const SphereBounds& sphere = _entries[i].sphere;
+			bool inside = true;
+
+			for (int p = 0; p < Frustum::PLANE_COUNT && inside; p++)
+			{
+				if ((planeMask & (1 << p)) == 0)
+					continue;
+
+				const XMFLOAT4& plane = frustum.planes[p];
+				float distance = plane.x * sphere.Center.x + plane.y * sphere.Center.y + plane.z * sphere.Center.z + plane.w;
+				inside = distance >= -sphere.Radius;
+			}
+
+			if (inside)
+				results.push_back(_entries[i].object);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::QuerySphere(const SphereBounds& range, vector<int>& results) const
+{
+	if (_nodes.empty())
+		return;
+
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+
+		// Squared distance from the centre of the range to the closest point of the box
+		float dx = (std::max)(0.0f, (std::max)(node.boundsMin.x - range.Center.x, range.Center.x - node.boundsMax.x));
+		float dy = (std::max)(0.0f, (std::max)(node.boundsMin.y - range.Center.y, range.Center.y - node.boundsMax.y));
+		float dz = (std::max)(0.0f, (std::max)(node.boundsMin.z - range.Center.z, range.Center.z - node.boundsMax.z));
+		if (dx * dx + dy * dy + dz * dz > range.Radius * range.Radius)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[stackSize++] = node.leftOrFirst;
+			stack[stackSize++] = node.leftOrFirst + 1;
+			continue;
+		}
+
+		for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+		{
+			const SphereBounds& sphere = _entries[i].sphere;
+			float x = sphere.Center.x - range.Center.x;
+			float y = sphere.Center.y - range.Center.y;
+			float z = sphere.Center.z - range.Center.z;
+			float reach = sphere.Radius + range.Radius;
+
+			if (x * x + y * y + z * z <= reach * reach)
+				results.push_back(_entries[i].object);
+		}
+	}
+}
+
+// Distance along the ray to where it enters the box, or FLT_MAX when it misses
+static float IntersectRayBox(const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, float maxDistance)
+{
+	float tx1 = (boundsMin.x - origin.x) * inverseDirection.x, tx2 = (boundsMax.x - origin.x) * inverseDirection.x;
+	float ty1 = (boundsMin.y - origin.y) * inverseDirection.y, ty2 = (boundsMax.y - origin.y) * inverseDirection.y;
+	float tz1 = (boundsMin.z - origin.z) * inverseDirection.z, tz2 = (boundsMax.z - origin.z) * inverseDirection.z;
+
+	float tNear = (std::max)((std::max)((std::min)(tx1, tx2), (std::min)(ty1, ty2)), (std::max)((std::min)(tz1, tz2), 0.0f));
+	float tFar = (std::min)((std::min)((std::max)(tx1, tx2), (std::max)(ty1, ty2)), (std::min)((std::max)(tz1, tz2), maxDistance));
+
+	return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+float BoundingVolumeHierarchy::IntersectRaySphere(const XMFLOAT3& origin, const XMFLOAT3& direction, const SphereBounds& sphere)
+{
+	float x = sphere.Center.x - origin.x;
+	float y = sphere.Center.y - origin.y;
+	float z = sphere.Center.z - origin.z;
+
+	// Distance along the ray to the point closest to the centre, and the squared distance
+	// from the centre to that point
+	float along = x * direction.x + y * direction.y + z * direction.z;
+	float missSquared = x * x + y * y + z * z - along * along;
+	float radiusSquared = sphere.Radius * sphere.Radius;
+
+	if (missSquared > radiusSquared)
+		return -1.0f;
+
+	float halfChord = sqrtf(radiusSquared - missSquared);
+	if (along + halfChord < 0.0f)
+		return -1.0f;
+
+	return (std::max)(0.0f, along - halfChord);
+}
+
+int BoundingVolumeHierarchy::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, float * hitDistance) const
+{
+	int hitObject = -1;
+	float closest = maxDistance;
+
+	if (_nodes.empty())
+		return hitObject;
+
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// Nodes waiting to be visited, with the distance at which the ray enters them. The nearer
+	// child is always visited first, so most of the far ones are skipped once something is hit.
+	struct Pending
+	{
+		int node;
+		float distance;
+	};
+
+	Pending stack[STACK_SIZE];
+	int stackSize = 0;
+
+	float rootDistance = IntersectRayBox(origin, inverseDirection, _nodes[0].boundsMin, _nodes[0].boundsMax, closest);
+	if (rootDistance != FLT_MAX)
+	{
+		stack[stackSize].node = 0;
+		stack[stackSize].distance = rootDistance;
+		stackSize++;
+	}
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		if (stack[stackSize].distance > closest)
+			continue;
+
+		const Node& node = _nodes[stack[stackSize].node];
+
+		if (node.count > 0)
+		{
+			for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				float distance = IntersectRaySphere(origin, direction, _entries[i].sphere);
+
+				// Ties go to the lowest object index, so the answer doesn't depend on the tree
+				if (distance >= 0.0f && (distance < closest || (distance == closest && _entries[i].object < hitObject)))
+				{
+					closest = distance;
+					hitObject = _entries[i].object;
+				}
+			}
+
+			continue;
+		}
+
+		int nearChild = node.leftOrFirst;
+		int farChild = node.leftOrFirst + 1;
+		float nearDistance = IntersectRayBox(origin, inverseDirection, _nodes[nearChild].boundsMin, _nodes[nearChild].boundsMax, closest);
+		float farDistance = IntersectRayBox(origin, inverseDirection, _nodes[farChild].boundsMin, _nodes[farChild].boundsMax, closest);
+
+		if (farDistance < nearDistance)
+		{
+			swap(nearChild, farChild);
+			swap(nearDistance, farDistance);
+		}
+
+		if (farDistance != FLT_MAX)
+		{
+			stack[stackSize].node = farChild;
+			stack[stackSize].distance = farDistance;
+			stackSize++;
+		}
+
+		if (nearDistance != FLT_MAX)
+		{
+			stack[stackSize].node = nearChild;
+			stack[stackSize].distance = nearDistance;
+			stackSize++;
+		}
+	}
+
+	if (hitObject >= 0 && hitDistance)
+		*hitDistance = closest;
+
+	return hitObject;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Frustum.h"
+
+using namespace DirectX;
+using namespace std;
+
+class GameObject;
+
+// A bounding volume hierarchy over the bounding spheres of a set of objects. Frustum culling,
+// ray picking and range queries only visit the boxes that can contain an answer, instead of
+// testing every object.
+//
+// Objects are referred to by their index in the array the hierarchy was built from. When the
+// objects move, Refit updates the boxes in place without changing the tree. The tree gets worse
+// the further objects move from where it was built, so rebuild it when NeedsRebuild says so.
+class BoundingVolumeHierarchy
+{
+private:
+	// Children are allocated in pairs, so an inner node's right child is always left + 1 and
+	// every child comes after its parent in _nodes
+	struct Node
+	{
+		XMFLOAT3 boundsMin;
+		int leftOrFirst;	// First child for inner nodes, first entry of _entries for leaves
+		XMFLOAT3 boundsMax;
+		int count;			// Number of objects in a leaf, 0 for inner nodes
+	};
+
+	// The objects in leaf order, each with a copy of its sphere so that leaves are tested
+	// without following the index
+	struct Entry
+	{
+		SphereBounds sphere;
+		int object;
+	};
+
+	static const int MAX_LEAF_SIZE = 4;
+	static const int BIN_COUNT = 12;
+	// Below this depth nodes are split by the surface area heuristic. Deeper nodes are split
+	// in half, which keeps the depth, and so the query stacks, bounded.
+	static const int MAX_SAH_DEPTH = 32;
+	static const int STACK_SIZE = 128;
+
+	vector<Node> _nodes;
+	vector<Entry> _entries;
+
+	// Total surface area of the nodes when the tree was built and after the last refit
+	float _builtCost;
+	float _cost;
+
+	void UpdateNodeBounds(int nodeIndex);
+	bool Split(int nodeIndex, int depth);
+	void Refit();
+
+public:
+	BoundingVolumeHierarchy();
+	~BoundingVolumeHierarchy();
+
+	void Build(const SphereBounds * spheres, int count);
+	void Build(const GameObject * gameObjects, int count);
+
+	// The objects must be the same ones, in the same order, that the tree was built from
+	void Refit(const SphereBounds * spheres);
+	void Refit(const GameObject * gameObjects);
+
+	// True when refitting has made the tree much slower to query than a fresh build would be
+	bool NeedsRebuild() const;
+
+	// Appends the index of every object whose sphere intersects the frustum
+	void QueryFrustum(const Frustum& frustum, vector<int>& results) const;
+	// Appends the index of every object whose sphere overlaps the given sphere
+	void QuerySphere(const SphereBounds& range, vector<int>& results) const;
+	// Returns the index of the first object hit by the ray, or -1. The direction must be
+	// normalised. The distance to the hit is returned through hitDistance.
+	int Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, float * hitDistance) const;
+
+	int GetNodeCount() const { return (int)_nodes.size(); }
+	int GetObjectCount() const { return (int)_entries.size(); }
+
+	// Distance along a normalised ray to a sphere, or a negative number when it misses. Rays
+	// that start inside the sphere hit it at distance 0.
+	static float IntersectRaySphere(const XMFLOAT3& origin, const XMFLOAT3& direction, const SphereBounds& sphere);
+};
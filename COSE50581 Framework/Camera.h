@@ -1,7 +1,5 @@
 #pragma once
 
-#include <windows.h>
-#include <d3d11_1.h>
 #include <DirectXMath.h>
 //#include "Application.h"
 using namespace DirectX;
@@ -13,16 +11,16 @@ private:
 	XMFLOAT4 _at;
 	XMFLOAT4 _up;
 
-	FLOAT _windowWidth;
-	FLOAT _windowHeight;
-	FLOAT _nearDepth;
-	FLOAT _farDepth;
+	float _windowWidth;
+	float _windowHeight;
+	float _nearDepth;
+	float _farDepth;
 
 	XMFLOAT4X4 _view;
 	XMFLOAT4X4 _projection;
 
 public:
-	Camera(XMFLOAT4 eye, XMFLOAT4 at, XMFLOAT4 up, FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDepth, FLOAT farDepth);
+	Camera(XMFLOAT4 eye, XMFLOAT4 at, XMFLOAT4 up, float windowWidth, float windowHeight, float nearDepth, float farDepth);
 	~Camera();
 
 	void CalculateViewProjection();
@@ -40,6 +38,6 @@ public:
 	void SetAt(XMFLOAT4 at) { _at = at; }
 	void SetUp(XMFLOAT4 up) { _up = up; }
 
-	void Reshape(FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDepth, FLOAT farDepth);
+	void Reshape(float windowWidth, float windowHeight, float nearDepth, float farDepth);
 };
 
@@ -0,0 +1,146 @@
+#include "CommandBuffer.h"
+#include "Profiler.h"
+
+#include <cstring>
+
+static int PaddedSize(int size)
+{
+	return (size + 3) & ~3;
+}
+
+CommandBuffer::CommandBuffer()
+{
+	_drawCount = 0;
+}
+
+CommandBuffer::~CommandBuffer()
+{
+}
+
+unsigned char * CommandBuffer::AddCommand(CommandType type, int size)
+{
+	CommandHeader header;
+	header.type = type;
+	header.size = PaddedSize(size);
+
+	size_t offset = _stream.size();
+	_stream.resize(offset + sizeof(header) + header.size);
+	memcpy(&_stream[offset], &header, sizeof(header));
+
+	return &_stream[offset + sizeof(header)];
+}
+
+int CommandBuffer::AddMesh(const MeshData& meshData)
+{
+	// Consecutive draws nearly always share a mesh, so only the last one is checked
+	if (!_meshes.empty() && memcmp(&_meshes.back(), &meshData, sizeof(MeshData)) == 0)
+		return (int)_meshes.size() - 1;
+
+	_meshes.push_back(meshData);
+	return (int)_meshes.size() - 1;
+}
+
+void CommandBuffer::SetRasterizerState(int rasterizerState)
+{
+	memcpy(AddCommand(CMD_SET_RASTERIZER_STATE, sizeof(int)), &rasterizerState, sizeof(int));
+}
+
+void CommandBuffer::SetShader(int shader)
+{
+	memcpy(AddCommand(CMD_SET_SHADER, sizeof(int)), &shader, sizeof(int));
+}
+
+void CommandBuffer::SetMesh(const MeshData& meshData)
+{
+	int mesh = AddMesh(meshData);
+	memcpy(AddCommand(CMD_SET_MESH, sizeof(int)), &mesh, sizeof(int));
+}
+
+void CommandBuffer::DrawIndexed(int indexCount)
+{
+	memcpy(AddCommand(CMD_DRAW_INDEXED, sizeof(int)), &indexCount, sizeof(int));
+	_drawCount++;
+}
+
+void CommandBuffer::UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size)
+{
+	int arguments[2] = { slot, size };
+
+	unsigned char * command = AddCommand(CMD_UPDATE_CONSTANT_BUFFER, sizeof(arguments) + size);
+	memcpy(command, arguments, sizeof(arguments));
+	memcpy(command + sizeof(arguments), data, size);
+}
+
+void CommandBuffer::UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count)
+{
+	int size = count * (int)sizeof(XMFLOAT4X4);
+
+	unsigned char * command = AddCommand(CMD_UPDATE_INSTANCE_BUFFER, sizeof(int) + size);
+	memcpy(command, &count, sizeof(int));
+	memcpy(command + sizeof(int), worlds, size);
+}
+
+void CommandBuffer::DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance)
+{
+	int arguments[3] = { AddMesh(meshData), instanceCount, startInstance };
+	memcpy(AddCommand(CMD_DRAW_INDEXED_INSTANCED, sizeof(arguments)), arguments, sizeof(arguments));
+	_drawCount++;
+}
+
+void CommandBuffer::Clear()
+{
+	_stream.clear();
+	_meshes.clear();
+	_drawCount = 0;
+}
+
+void CommandBuffer::Replay(RenderDevice& renderDevice) const
+{
+	PROFILE_ZONE("CommandBuffer::Replay");
+
+	const unsigned char * command = _stream.data();
+	const unsigned char * end = command + _stream.size();
+
+	while (command < end)
+	{
+		CommandHeader header;
+		memcpy(&header, command, sizeof(header));
+		const unsigned char * data = command + sizeof(header);
+
+		int arguments[3];
+		memcpy(arguments, data, header.size < (int)sizeof(arguments) ? header.size : sizeof(arguments));
+
+		switch (header.type)
+		{
+		case CMD_SET_RASTERIZER_STATE:
+			renderDevice.SetRasterizerState(arguments[0]);
+			break;
+
+		case CMD_SET_SHADER:
+			renderDevice.SetShader(arguments[0]);
+			break;
+
+		case CMD_SET_MESH:
+			renderDevice.SetMesh(_meshes[arguments[0]]);
+			break;
+
+		case CMD_DRAW_INDEXED:
+			renderDevice.DrawIndexed(arguments[0]);
+			break;
+
+		case CMD_UPDATE_CONSTANT_BUFFER:
+			renderDevice.UpdateConstantBuffer((ConstantBufferSlot)arguments[0], data + 2 * sizeof(int), arguments[1]);
+			break;
+
+		case CMD_UPDATE_INSTANCE_BUFFER:
+			renderDevice.UpdateInstanceBuffer(reinterpret_cast<const XMFLOAT4X4 *>(data + sizeof(int)), arguments[0]);
+			break;
+
+		case CMD_DRAW_INDEXED_INSTANCED:
+			renderDevice.DrawIndexedInstanced(_meshes[arguments[0]], arguments[1], arguments[2]);
+			break;
+		}
+
+		command = data + header.size;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include "RenderDevice.h"
+
+using namespace std;
+
+// A RenderDevice that stores the calls it receives in a compact byte stream, to be replayed on
+// another RenderDevice later. Anything that draws through a RenderDevice can record into one,
+// so several threads can each record a command buffer for their own share of the draws, and
+// the buffers are then replayed one after another, in a fixed order, on the real device.
+//
+// The stream doesn't depend on the graphics API. On D3D11 the replay goes through the immediate
+// context; recording straight into deferred contexts would be a D3D11RenderDevice of its own.
+class CommandBuffer : public RenderDevice
+{
+private:
+	enum CommandType
+	{
+		CMD_SET_RASTERIZER_STATE,
+		CMD_SET_SHADER,
+		CMD_SET_MESH,
+		CMD_DRAW_INDEXED,
+		CMD_UPDATE_CONSTANT_BUFFER,
+		CMD_UPDATE_INSTANCE_BUFFER,
+		CMD_DRAW_INDEXED_INSTANCED,
+	};
+
+	// Every command starts with its type and the size of what follows, which is padded to a
+	// multiple of four bytes so that the data after it stays aligned for float reads
+	struct CommandHeader
+	{
+		int type;
+		int size;
+	};
+
+	vector<unsigned char> _stream;
+	// Meshes are stored once each and referred to by index from the stream
+	vector<MeshData> _meshes;
+	int _drawCount;
+
+	unsigned char * AddCommand(CommandType type, int size);
+	int AddMesh(const MeshData& meshData);
+
+public:
+	CommandBuffer();
+	~CommandBuffer();
+
+	void SetRasterizerState(int rasterizerState) override;
+	void SetShader(int shader) override;
+	void SetMesh(const MeshData& meshData) override;
+	void DrawIndexed(int indexCount) override;
+	void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override;
+	void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) override;
+	void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) override;
+
+	// Forgets the recorded commands, keeping the memory for the next recording
+	void Clear();
+
+	// Makes every recorded call on renderDevice, in the order they were recorded
+	void Replay(RenderDevice& renderDevice) const;
+
+	int GetDrawCount() const { return _drawCount; }
+	int GetSize() const { return (int)_stream.size(); }
+};
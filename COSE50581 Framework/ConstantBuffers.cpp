@@ -0,0 +1,59 @@
+#include "ConstantBuffers.h"
+
+#include <cstring>
+
+ConstantBufferCache::ConstantBufferCache()
+{
+	ResetStats();
+}
+
+ConstantBufferCache::~ConstantBufferCache()
+{
+}
+
+void ConstantBufferCache::Update(RenderDevice& renderDevice, ConstantBufferSlot slot, const void * data, int size)
+{
+	vector<unsigned char>& contents = _contents[slot];
+
+	if ((int)contents.size() == size && memcmp(contents.data(), data, size) == 0)
+	{
+		_stats.skipped++;
+		return;
+	}
+
+	contents.resize(size);
+	memcpy(contents.data(), data, size);
+
+	renderDevice.UpdateConstantBuffer(slot, data, size);
+
+	_stats.uploads++;
+	_stats.bytesUploaded += size;
+}
+
+void ConstantBufferCache::Assume(ConstantBufferSlot slot, const void * data, int size)
+{
+	vector<unsigned char>& contents = _contents[slot];
+
+	contents.resize(size);
+	memcpy(contents.data(), data, size);
+}
+
+void ConstantBufferCache::Invalidate()
+{
+	for (int i = 0; i < CB_COUNT; i++)
+	{
+		_contents[i].clear();
+	}
+}
+
+void ConstantBufferCache::Invalidate(ConstantBufferSlot slot)
+{
+	_contents[slot].clear();
+}
+
+void ConstantBufferCache::ResetStats()
+{
+	_stats.uploads = 0;
+	_stats.skipped = 0;
+	_stats.bytesUploaded = 0;
+}
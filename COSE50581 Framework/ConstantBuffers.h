@@ -0,0 +1,87 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "RenderDevice.h"
+
+using namespace DirectX;
+using namespace std;
+
+// The contents of the constant buffers in Lighting.fx. Each struct matches the HLSL packing of
+// its cbuffer, so the explicit padding keeps every float3 in a 16-byte register of its own.
+// Matrices are stored transposed, the way the shaders read them.
+
+// cbFrame, register b0: set once per frame
+struct FrameConstants
+{
+	XMMATRIX mView;
+	XMMATRIX mProjection;
+
+	XMFLOAT4 diffuseLight;
+	XMFLOAT4 gAmbientLight;
+	XMFLOAT4 gSpecularLight;
+
+	XMFLOAT3 gEyePosW;
+	float pad0;
+	XMFLOAT3 lightVecW;
+	float pad1;
+};
+
+// cbMaterial, register b1: set when the material changes
+struct MaterialConstants
+{
+	XMFLOAT4 diffuseMaterial;
+	XMFLOAT4 gAmbientMtrl;
+	XMFLOAT4 gSpecularMtrl;
+	float gSpecularPower;
+	XMFLOAT3 pad;
+};
+
+// cbObject, register b2: set for every object drawn
+struct ObjectConstants
+{
+	XMMATRIX mWorld;
+};
+
+// cbMesh, register b3: set by D3D11RenderDevice when a mesh with quantised positions is bound,
+// from the mesh's PositionQuantisation
+struct MeshConstants
+{
+	XMFLOAT4 positionScale;
+	XMFLOAT4 positionOffset;
+};
+
+struct ConstantBufferStats
+{
+	int uploads;
+	int skipped;
+	int bytesUploaded;
+};
+
+// Keeps a copy of what was last uploaded to each constant buffer slot, and only passes an
+// update on to the RenderDevice when the data actually differs. It also counts the uploads,
+// so the number of bytes sent each frame can be reported.
+class ConstantBufferCache
+{
+private:
+	vector<unsigned char> _contents[CB_COUNT];
+	ConstantBufferStats _stats;
+
+public:
+	ConstantBufferCache();
+	~ConstantBufferCache();
+
+	void Update(RenderDevice& renderDevice, ConstantBufferSlot slot, const void * data, int size);
+
+	// Remembers data as the slot's contents without uploading it, for when something else has
+	// already uploaded it, such as another command buffer replayed earlier
+	void Assume(ConstantBufferSlot slot, const void * data, int size);
+
+	// Forgets the cached contents, so the next update of every slot is uploaded
+	void Invalidate();
+	// Forgets one slot's contents, for when something else has changed it since
+	void Invalidate(ConstantBufferSlot slot);
+
+	const ConstantBufferStats& GetStats() const { return _stats; }
+	void ResetStats();
+};
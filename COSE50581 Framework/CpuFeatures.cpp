@@ -0,0 +1,73 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CPU_FEATURES_CPUID 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_FEATURES_CPUID 1
+#endif
+
+#if CPU_FEATURES_CPUID
+static void Cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i < 4; i++)
+	{
+		registers[i] = (unsigned int)values[i];
+	}
+#else
+	if (!__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]))
+		registers[0] = registers[1] = registers[2] = registers[3] = 0;
+#endif
+}
+
+static unsigned long long ReadXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int low, high;
+	__asm__ __volatile__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((unsigned long long)high << 32) | low;
+#endif
+}
+#endif
+
+static CpuFeatures DetectCpuFeatures()
+{
+	CpuFeatures features = {};
+
+#if CPU_FEATURES_CPUID
+	unsigned int leaf0[4], leaf1[4], leaf7[4] = {};
+	Cpuid(0, 0, leaf0);
+	Cpuid(1, 0, leaf1);
+	if (leaf0[0] >= 7)
+		Cpuid(7, 0, leaf7);
+
+	features.sse2 = (leaf1[3] & (1u << 26)) != 0;
+
+	// XSAVE enabled by the operating system, then which register states it saves
+	bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+	unsigned long long xcr0 = osxsave ? ReadXcr0() : 0;
+	bool ymmSaved = (xcr0 & 0x06) == 0x06;
+	bool zmmSaved = (xcr0 & 0xE6) == 0xE6;
+
+	bool fma = (leaf1[2] & (1u << 12)) != 0;
+	features.avx = ymmSaved && (leaf1[2] & (1u << 28)) != 0;
+	features.avx2 = features.avx && fma && (leaf7[1] & (1u << 5)) != 0;
+	features.avx512 = zmmSaved && features.avx2 && (leaf7[1] & (1u << 16)) != 0;
+#endif
+
+	return features;
+}
+
+const CpuFeatures& GetCpuFeatures()
+{
+	// Found the first time it is asked for, even during another file's static initialisation.
+	// The initialisation of a local static is thread safe, so no thread ever sees it half written.
+	static const CpuFeatures cpuFeatures = DetectCpuFeatures();
+	return cpuFeatures;
+}
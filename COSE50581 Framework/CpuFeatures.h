@@ -0,0 +1,14 @@
+#pragma once
+
+// What the processor and operating system support, found with CPUID the first time it is asked
+// for. The wider instruction sets also need the operating system to save their registers on a
+// context switch, which XGETBV reports. Everything is false on processors other than x86.
+struct CpuFeatures
+{
+	bool sse2;
+	bool avx;
+	bool avx2;
+	bool avx512;
+};
+
+const CpuFeatures& GetCpuFeatures();
@@ -0,0 +1,610 @@
+#include "D3D11RenderDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+const int D3D11RenderDevice::MAX_FRAMES_IN_FLIGHT;
+const int D3D11RenderDevice::CONSTANT_RING_BYTES;
+const int D3D11RenderDevice::CONSTANT_RING_ALIGNMENT;
+
+// Polls of a frame query that only yield before the wait starts to sleep, and the longest sleep
+static const int FENCE_POLL_YIELDS = 64;
+static const int FENCE_POLL_MAX_SLEEP_MICROSECONDS = 1000;
+
+// A frame is usually finished within a few polls, so the wait yields at first and then sleeps
+// for longer each poll, rather than keeping a core busy while the GPU catches up
+static void BackOffFencePoll(int poll)
+{
+	if (poll < FENCE_POLL_YIELDS)
+	{
+		this_thread::yield();
+		return;
+	}
+
+	int sleepMicroseconds = (min)(FENCE_POLL_MAX_SLEEP_MICROSECONDS, 50 << (min)(poll - FENCE_POLL_YIELDS, 5));
+	this_thread::sleep_for(chrono::microseconds(sleepMicroseconds));
+}
+
+static DXGI_FORMAT IndexBufferFormat(const MeshData& meshData)
+{
+	return meshData.IndexFormat == INDEX_FORMAT_32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+}
+
+D3D11RenderDevice::D3D11RenderDevice()
+{
+	_pd3dDevice = nullptr;
+	_pImmediateContext = nullptr;
+	_pImmediateContext1 = nullptr;
+	_pInstanceBuffer = nullptr;
+	_instanceCapacity = 0;
+	_instanceOffset = 0;
+	_instanceBufferMapped = false;
+	_pMeshConstantBuffer = nullptr;
+	_pConstantRingBuffer = nullptr;
+	_constantRingMapped = false;
+	_frameFence = 0;
+	_completedFence = 0;
+	_currentShader = -1;
+	_currentVertexFormat = VERTEX_FORMAT_SIMPLE;
+	_meshConstantsValid = false;
+
+	for (int i = 0; i < CB_COUNT; i++)
+		_pConstantBuffers[i] = nullptr;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		_pFrameQueries[i] = nullptr;
+}
+
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+	Cleanup();
+}
+
+HRESULT D3D11RenderDevice::Initialise(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pImmediateContext, int instanceCapacity)
+{
+	_pd3dDevice = pd3dDevice;
+	_pImmediateContext = pImmediateContext;
+
+	// Create a constant buffer for each slot
+	UINT constantBufferSizes[CB_COUNT] = { sizeof(FrameConstants), sizeof(MaterialConstants), sizeof(ObjectConstants) };
+
+	for (int i = 0; i < CB_COUNT; i++)
+	{
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = constantBufferSizes[i];
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		HRESULT hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantBuffers[i]);
+
+		if (FAILED(hr))
+			return hr;
+	}
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = sizeof(MeshConstants);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HRESULT hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pMeshConstantBuffer);
+
+	if (FAILED(hr))
+		return hr;
+
+	// The queries that tell when the GPU has finished with each frame's uploads
+	D3D11_QUERY_DESC queryDesc;
+	ZeroMemory(&queryDesc, sizeof(queryDesc));
+	queryDesc.Query = D3D11_QUERY_EVENT;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		hr = _pd3dDevice->CreateQuery(&queryDesc, &_pFrameQueries[i]);
+
+		if (FAILED(hr))
+			return hr;
+	}
+
+	hr = CreateConstantRing();
+
+	if (FAILED(hr))
+		return hr;
+
+	return CreateInstanceBuffer(instanceCapacity);
+}
+
+HRESULT D3D11RenderDevice::CreateConstantRing()
+{
+	// Offsets need the 11.1 runtime, and writing to a constant buffer without discarding it needs
+	// driver support too. Without either the constants stay in their own buffer per slot.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(options));
+
+	if (FAILED(_pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+		!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer ||
+		FAILED(_pImmediateContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&_pImmediateContext1))))
+	{
+		return S_OK;
+	}
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = CONSTANT_RING_BYTES;
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HRESULT hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantRingBuffer);
+
+	if (FAILED(hr))
+	{
+		_pImmediateContext1->Release();
+		_pImmediateContext1 = nullptr;
+		return hr;
+	}
+
+	_constantRing.Reset(CONSTANT_RING_BYTES);
+	_constantRingMapped = false;
+
+	return S_OK;
+}
+
+void D3D11RenderDevice::Cleanup()
+{
+	if (_pInstanceBuffer) _pInstanceBuffer->Release();
+	_pInstanceBuffer = nullptr;
+	_instanceCapacity = 0;
+
+	for (int i = 0; i < CB_COUNT; i++)
+	{
+		if (_pConstantBuffers[i]) _pConstantBuffers[i]->Release();
+		_pConstantBuffers[i] = nullptr;
+	}
+
+	if (_pMeshConstantBuffer) _pMeshConstantBuffer->Release();
+	_pMeshConstantBuffer = nullptr;
+	_meshConstantsValid = false;
+
+	if (_pConstantRingBuffer) _pConstantRingBuffer->Release();
+	_pConstantRingBuffer = nullptr;
+	if (_pImmediateContext1) _pImmediateContext1->Release();
+	_pImmediateContext1 = nullptr;
+	_constantRing.Reset(0);
+
+	for (int i = 0; i < CB_COUNT; i++)
+		_slotContents[i].clear();
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (_pFrameQueries[i]) _pFrameQueries[i]->Release();
+		_pFrameQueries[i] = nullptr;
+	}
+	_frameFence = 0;
+	_completedFence = 0;
+
+	for (ID3D11Buffer* pBuffer : _meshBuffers)
+		pBuffer->Release();
+	_meshBuffers.clear();
+}
+
+HRESULT D3D11RenderDevice::CreateMesh(const MeshFile& meshFile, MeshData& meshData)
+{
+	const MeshFileHeader& header = meshFile.GetHeader();
+
+	if (header.vertexFormat != VertexFormat::SimpleVertexFormat() || (header.indexSize != sizeof(WORD) && header.indexSize != sizeof(DWORD)) ||
+		header.vertexCount == 0 || header.indexCount == 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	HRESULT hr = CreateMeshBuffers(meshFile.GetVertexData(), (UINT)meshFile.GetVertexDataSize(), meshFile.GetIndexData(),
+		(UINT)meshFile.GetIndexDataSize(), meshData);
+
+	if (FAILED(hr))
+		return hr;
+
+	meshData.VBStride = header.vertexFormat.stride;
+	meshData.VBOffset = 0;
+	meshData.IndexCount = header.indexCount;
+	meshData.IndexFormat = header.indexSize == sizeof(DWORD) ? INDEX_FORMAT_32 : INDEX_FORMAT_16;
+	meshData.VertexFormat = VERTEX_FORMAT_SIMPLE;
+	meshData.Quantisation = PositionQuantisation();
+	meshData.BoundsCenter = XMFLOAT3(header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2]);
+	meshData.BoundsRadius = header.boundsRadius;
+
+	return S_OK;
+}
+
+HRESULT D3D11RenderDevice::CreateMesh(const MeshGeometry& geometry, MeshData& meshData, MeshVertexFormat vertexFormat)
+{
+	if (geometry.vertices.empty() || geometry.indices.empty())
+		return E_INVALIDARG;
+
+	CompressedVertices vertices;
+	CompressVertices(geometry.vertices, vertexFormat, vertices);
+
+	HRESULT hr = CreateMeshBuffers(vertices.data.data(), (UINT)vertices.data.size(),
+		geometry.indices.data(), (UINT)(sizeof(WORD) * geometry.indices.size()), meshData);
+
+	if (FAILED(hr))
+		return hr;
+
+	meshData.VBStride = (UINT)vertices.stride;
+	meshData.VBOffset = 0;
+	meshData.IndexCount = (UINT)geometry.indices.size();
+	meshData.IndexFormat = INDEX_FORMAT_16;
+	meshData.VertexFormat = vertexFormat;
+	meshData.Quantisation = vertices.quantisation;
+	geometry.GetBounds(meshData.BoundsCenter, meshData.BoundsRadius);
+
+	return S_OK;
+}
+
+HRESULT D3D11RenderDevice::CreateMeshBuffers(const void* vertexData, UINT vertexDataSize, const void* indexData, UINT indexDataSize,
+	MeshData& meshData)
+{
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = vertexDataSize;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = vertexData;
+
+	ID3D11Buffer* pVertexBuffer = nullptr;
+	HRESULT hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &pVertexBuffer);
+
+	if (FAILED(hr))
+		return hr;
+
+	_meshBuffers.push_back(pVertexBuffer);
+
+	bd.ByteWidth = indexDataSize;
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	InitData.pSysMem = indexData;
+
+	ID3D11Buffer* pIndexBuffer = nullptr;
+	hr = _pd3dDevice->CreateBuffer(&bd, &InitData, &pIndexBuffer);
+
+	if (FAILED(hr))
+		return hr;
+
+	_meshBuffers.push_back(pIndexBuffer);
+
+	meshData.VertexBuffer = pVertexBuffer;
+	meshData.IndexBuffer = pIndexBuffer;
+
+	return S_OK;
+}
+
+void D3D11RenderDevice::BindConstantBuffers()
+{
+	_pImmediateContext->VSSetConstantBuffers(0, CB_COUNT, _pConstantBuffers);
+	_pImmediateContext->PSSetConstantBuffers(0, CB_COUNT, _pConstantBuffers);
+
+	// cbMesh comes straight after the slots, and only the vertex shader reads it
+	_pImmediateContext->VSSetConstantBuffers(CB_COUNT, 1, &_pMeshConstantBuffer);
+
+	// The ring space the slots were last written to may be reused from now on, so give them
+	// fresh copies this frame
+	if (_pConstantRingBuffer)
+	{
+		for (int i = 0; i < CB_COUNT; i++)
+		{
+			if (!_slotContents[i].empty())
+				UploadToConstantRing((ConstantBufferSlot)i);
+		}
+	}
+}
+
+void D3D11RenderDevice::EndFrame()
+{
+	if (!_pFrameQueries[0])
+		return;
+
+	// The query about to be reused must have been passed, which also keeps the CPU from getting
+	// more than MAX_FRAMES_IN_FLIGHT frames ahead
+	uint64_t fence = _frameFence + 1;
+	if (fence > (uint64_t)MAX_FRAMES_IN_FLIGHT)
+		IsFenceComplete(fence - MAX_FRAMES_IN_FLIGHT, true);
+
+	_pImmediateContext->End(_pFrameQueries[fence % MAX_FRAMES_IN_FLIGHT]);
+	_frameFence = fence;
+
+	_constantRing.EndFrame(fence);
+	_instanceRing.EndFrame(fence);
+
+	// Release whatever has finished already, without waiting
+	while (_completedFence < _frameFence && IsFenceComplete(_completedFence + 1, false))
+	{
+	}
+}
+
+bool D3D11RenderDevice::IsFenceComplete(uint64_t fence, bool wait)
+{
+	if (fence <= _completedFence)
+		return true;
+
+	// Frames finish in order, so every fence before this one must be passed first
+	int poll = 0;
+	while (_completedFence < fence)
+	{
+		uint64_t next = _completedFence + 1;
+		HRESULT hr = _pImmediateContext->GetData(_pFrameQueries[next % MAX_FRAMES_IN_FLIGHT], nullptr, 0,
+			wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+		// A failure means the device has been lost, and then nothing is reading the buffers
+		if (hr == S_FALSE)
+		{
+			if (!wait)
+				return false;
+
+			BackOffFencePoll(poll++);
+			continue;
+		}
+
+		poll = 0;
+		_completedFence = next;
+		_constantRing.Retire(next);
+		_instanceRing.Retire(next);
+	}
+
+	return true;
+}
+
+size_t D3D11RenderDevice::AllocateUpload(UploadRing& ring, size_t size, size_t alignment)
+{
+	size_t offset = ring.Allocate(size, alignment);
+	uint64_t fence;
+
+	while (offset == UploadRing::INVALID_OFFSET && ring.GetOldestFence(fence))
+	{
+		IsFenceComplete(fence, true);
+		offset = ring.Allocate(size, alignment);
+	}
+
+	return offset;
+}
+
+void D3D11RenderDevice::UploadToConstantRing(ConstantBufferSlot slot)
+{
+	const std::vector<unsigned char>& contents = _slotContents[slot];
+	size_t size = (contents.size() + CONSTANT_RING_ALIGNMENT - 1) & ~(size_t)(CONSTANT_RING_ALIGNMENT - 1);
+	size_t offset = AllocateUpload(_constantRing, size, CONSTANT_RING_ALIGNMENT);
+
+	// The frame has filled the whole ring by itself, so fall back to the slot's own buffer
+	if (offset == UploadRing::INVALID_OFFSET)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (FAILED(_pImmediateContext->Map(_pConstantBuffers[slot], 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			return;
+
+		memcpy(mapped.pData, contents.data(), contents.size());
+		_pImmediateContext->Unmap(_pConstantBuffers[slot], 0);
+
+		_pImmediateContext->VSSetConstantBuffers(slot, 1, &_pConstantBuffers[slot]);
+		_pImmediateContext->PSSetConstantBuffers(slot, 1, &_pConstantBuffers[slot]);
+		return;
+	}
+
+	// The first map discards, to start the buffer off in a state no-overwrite maps can follow
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_pImmediateContext->Map(_pConstantRingBuffer, 0, _constantRingMapped ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD,
+		0, &mapped)))
+	{
+		return;
+	}
+
+	memcpy(static_cast<unsigned char*>(mapped.pData) + offset, contents.data(), contents.size());
+	_pImmediateContext->Unmap(_pConstantRingBuffer, 0);
+	_constantRingMapped = true;
+
+	UINT firstConstant = (UINT)(offset / 16);
+	UINT numConstants = (UINT)(size / 16);
+	_pImmediateContext1->VSSetConstantBuffers1(slot, 1, &_pConstantRingBuffer, &firstConstant, &numConstants);
+	_pImmediateContext1->PSSetConstantBuffers1(slot, 1, &_pConstantRingBuffer, &firstConstant, &numConstants);
+}
+
+void D3D11RenderDevice::ResetUploadStats()
+{
+	_constantRing.ResetStats();
+	_instanceRing.ResetStats();
+}
+
+void D3D11RenderDevice::RegisterRasterizerState(int rasterizerState, ID3D11RasterizerState* pRasterizerState)
+{
+	if (rasterizerState >= (int)_rasterizerStates.size())
+		_rasterizerStates.resize(rasterizerState + 1, nullptr);
+
+	_rasterizerStates[rasterizerState] = pRasterizerState;
+}
+
+void D3D11RenderDevice::RegisterShader(int shader, ID3D11VertexShader* pVertexShader, ID3D11PixelShader* pPixelShader, ID3D11InputLayout* pInputLayout)
+{
+	if (shader >= (int)_shaders.size())
+	{
+		Shader none = {};
+		_shaders.resize(shader + 1, none);
+	}
+
+	_shaders[shader].pVertexShaders[VERTEX_FORMAT_SIMPLE] = pVertexShader;
+	_shaders[shader].pInputLayouts[VERTEX_FORMAT_SIMPLE] = pInputLayout;
+	_shaders[shader].pPixelShader = pPixelShader;
+}
+
+void D3D11RenderDevice::RegisterShaderVariant(int shader, MeshVertexFormat vertexFormat, ID3D11VertexShader* pVertexShader,
+	ID3D11InputLayout* pInputLayout)
+{
+	if (shader >= (int)_shaders.size())
+	{
+		Shader none = {};
+		_shaders.resize(shader + 1, none);
+	}
+
+	_shaders[shader].pVertexShaders[vertexFormat] = pVertexShader;
+	_shaders[shader].pInputLayouts[vertexFormat] = pInputLayout;
+}
+
+void D3D11RenderDevice::SetRasterizerState(int rasterizerState)
+{
+	_pImmediateContext->RSSetState(_rasterizerStates[rasterizerState]);
+}
+
+void D3D11RenderDevice::SetShader(int shader)
+{
+	// Keep the format of the last mesh bound, since the next draw is most likely to use it too
+	_currentShader = shader;
+	_pImmediateContext->VSSetShader(_shaders[shader].pVertexShaders[_currentVertexFormat], nullptr, 0);
+	_pImmediateContext->PSSetShader(_shaders[shader].pPixelShader, nullptr, 0);
+	_pImmediateContext->IASetInputLayout(_shaders[shader].pInputLayouts[_currentVertexFormat]);
+}
+
+void D3D11RenderDevice::BindVertexFormat(const MeshData& meshData)
+{
+	if (meshData.VertexFormat != _currentVertexFormat)
+	{
+		_currentVertexFormat = meshData.VertexFormat;
+
+		if (_currentShader >= 0)
+		{
+			_pImmediateContext->VSSetShader(_shaders[_currentShader].pVertexShaders[_currentVertexFormat], nullptr, 0);
+			_pImmediateContext->IASetInputLayout(_shaders[_currentShader].pInputLayouts[_currentVertexFormat]);
+		}
+	}
+
+	if (meshData.VertexFormat == VERTEX_FORMAT_SIMPLE)
+		return;
+
+	const PositionQuantisation& quantisation = meshData.Quantisation;
+	MeshConstants meshConstants;
+	meshConstants.positionScale = XMFLOAT4(quantisation.scale.x, quantisation.scale.y, quantisation.scale.z, 0.0f);
+	meshConstants.positionOffset = XMFLOAT4(quantisation.offset.x, quantisation.offset.y, quantisation.offset.z, 1.0f);
+
+	if (_meshConstantsValid && memcmp(&meshConstants, &_meshConstants, sizeof(meshConstants)) == 0)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_pImmediateContext->Map(_pMeshConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+
+	memcpy(mapped.pData, &meshConstants, sizeof(meshConstants));
+	_pImmediateContext->Unmap(_pMeshConstantBuffer, 0);
+
+	_meshConstants = meshConstants;
+	_meshConstantsValid = true;
+}
+
+void D3D11RenderDevice::SetMesh(const MeshData& meshData)
+{
+	BindVertexFormat(meshData);
+	_pImmediateContext->IASetVertexBuffers(0, 1, &meshData.VertexBuffer, &meshData.VBStride, &meshData.VBOffset);
+	_pImmediateContext->IASetIndexBuffer(meshData.IndexBuffer, IndexBufferFormat(meshData), 0);
+}
+
+void D3D11RenderDevice::DrawIndexed(int indexCount)
+{
+	_pImmediateContext->DrawIndexed(indexCount, 0, 0);
+}
+
+void D3D11RenderDevice::UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size)
+{
+	if (_pConstantRingBuffer)
+	{
+		const unsigned char * bytes = static_cast<const unsigned char*>(data);
+		_slotContents[slot].assign(bytes, bytes + size);
+		UploadToConstantRing(slot);
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_pImmediateContext->Map(_pConstantBuffers[slot], 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+
+	memcpy(mapped.pData, data, size);
+	_pImmediateContext->Unmap(_pConstantBuffers[slot], 0);
+}
+
+HRESULT D3D11RenderDevice::CreateInstanceBuffer(int instanceCapacity)
+{
+	if (_pInstanceBuffer) _pInstanceBuffer->Release();
+	_pInstanceBuffer = nullptr;
+	_instanceCapacity = 0;
+	_instanceRing.Reset(0);
+
+	// The buffer is a ring with room for MAX_FRAMES_IN_FLIGHT frames of instances, each frame's
+	// written after the last with Map(WRITE_NO_OVERWRITE)
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = sizeof(XMFLOAT4X4) * instanceCapacity * MAX_FRAMES_IN_FLIGHT;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HRESULT hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pInstanceBuffer);
+
+	if (FAILED(hr))
+		return hr;
+
+	_instanceCapacity = instanceCapacity;
+	_instanceRing.Reset(bd.ByteWidth);
+	_instanceBufferMapped = false;
+
+	return S_OK;
+}
+
+void D3D11RenderDevice::UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count)
+{
+	if (count <= 0)
+		return;
+
+	size_t offset = count > _instanceCapacity ? UploadRing::INVALID_OFFSET :
+		AllocateUpload(_instanceRing, sizeof(XMFLOAT4X4) * count, sizeof(XMFLOAT4X4));
+
+	if (offset == UploadRing::INVALID_OFFSET)
+	{
+		// Grow by doubling so a slowly growing scene doesn't recreate the buffer every frame. The
+		// old buffer is kept alive by the runtime for the draws that still use it.
+		int instanceCapacity = _instanceCapacity > 0 ? _instanceCapacity * 2 : 1;
+		while (instanceCapacity < count)
+			instanceCapacity *= 2;
+
+		if (FAILED(CreateInstanceBuffer(instanceCapacity)))
+			return;
+
+		offset = _instanceRing.Allocate(sizeof(XMFLOAT4X4) * count, sizeof(XMFLOAT4X4));
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_pImmediateContext->Map(_pInstanceBuffer, 0, _instanceBufferMapped ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD,
+		0, &mapped)))
+	{
+		return;
+	}
+
+	memcpy(static_cast<unsigned char*>(mapped.pData) + offset, worlds, sizeof(XMFLOAT4X4) * count);
+	_pImmediateContext->Unmap(_pInstanceBuffer, 0);
+	_instanceBufferMapped = true;
+	_instanceOffset = (UINT)offset;
+}
+
+void D3D11RenderDevice::DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance)
+{
+	BindVertexFormat(meshData);
+
+	// Slot 0 holds the mesh's vertices and slot 1 the per-instance world matrices
+	ID3D11Buffer* vertexBuffers[2] = { meshData.VertexBuffer, _pInstanceBuffer };
+	UINT strides[2] = { meshData.VBStride, sizeof(XMFLOAT4X4) };
+	UINT offsets[2] = { meshData.VBOffset, _instanceOffset };
+
+	_pImmediateContext->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
+	_pImmediateContext->IASetIndexBuffer(meshData.IndexBuffer, IndexBufferFormat(meshData), 0);
+
+	_pImmediateContext->DrawIndexedInstanced(meshData.IndexCount, instanceCount, 0, 0, startInstance);
+}
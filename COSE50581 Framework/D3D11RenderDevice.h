@@ -0,0 +1,136 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <vector>
+#include "RenderDevice.h"
+#include "ConstantBuffers.h"
+#include "MeshFile.h"
+#include "MeshGeometry.h"
+#include "UploadRing.h"
+
+// Implements RenderDevice on top of a D3D11 device context. The world matrices are streamed to
+// the instanced vertex shader through a dynamic vertex buffer bound to input slot 1.
+// Each constant buffer slot is a dynamic buffer rewritten with Map(WRITE_DISCARD), which lets
+// the driver hand out a fresh copy from its ring instead of waiting for the GPU.
+// Where the runtime supports constant buffer offsets (Direct3D 11.1), the constants are written
+// instead into one large dynamic buffer with Map(WRITE_NO_OVERWRITE), each update at a new offset
+// handed out by an UploadRing, and bound with VSSetConstantBuffers1. The instance data goes
+// through a ring of its own in the same way. Call EndFrame once a frame, so the space the GPU has
+// finished reading can be reused.
+// Meshes can be stored in any MeshVertexFormat. Each shader has a vertex shader and input
+// layout for every format, and binding a mesh switches to the pair for its format.
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+	// The frames the CPU can get ahead of the GPU before EndFrame waits
+	static const int MAX_FRAMES_IN_FLIGHT = 3;
+	static const int CONSTANT_RING_BYTES = 2 * 1024 * 1024;
+	// Constant buffer offsets are counted in whole blocks of 16 constants
+	static const int CONSTANT_RING_ALIGNMENT = 256;
+
+private:
+	ID3D11Device*        _pd3dDevice;
+	ID3D11DeviceContext* _pImmediateContext;
+	// Only set when the constant ring is used
+	ID3D11DeviceContext1* _pImmediateContext1;
+	ID3D11Buffer*        _pInstanceBuffer;
+	int                  _instanceCapacity;
+	UploadRing           _instanceRing;
+	// Where the instance data last uploaded starts in _pInstanceBuffer
+	UINT                 _instanceOffset;
+	bool                 _instanceBufferMapped;
+	ID3D11Buffer*        _pConstantBuffers[CB_COUNT];
+
+	// The constant ring, and the contents last uploaded to each slot. The slots are uploaded
+	// again each frame, since the space they were written to is reused once the frame retires.
+	ID3D11Buffer*        _pConstantRingBuffer;
+	UploadRing           _constantRing;
+	bool                 _constantRingMapped;
+	std::vector<unsigned char> _slotContents[CB_COUNT];
+
+	// An event query ended with each frame, by fence modulo MAX_FRAMES_IN_FLIGHT
+	ID3D11Query*         _pFrameQueries[MAX_FRAMES_IN_FLIGHT];
+	uint64_t             _frameFence;
+	uint64_t             _completedFence;
+	// cbMesh, which holds the bound mesh's PositionQuantisation
+	ID3D11Buffer*        _pMeshConstantBuffer;
+
+	// The states SetRasterizerState and SetShader choose from. The device doesn't own them.
+	struct Shader
+	{
+		ID3D11VertexShader* pVertexShaders[VERTEX_FORMAT_COUNT];
+		ID3D11InputLayout*  pInputLayouts[VERTEX_FORMAT_COUNT];
+		ID3D11PixelShader*  pPixelShader;
+	};
+
+	std::vector<ID3D11RasterizerState*> _rasterizerStates;
+	std::vector<Shader>                 _shaders;
+
+	// The vertex and index buffers made by CreateMesh, which the device releases
+	std::vector<ID3D11Buffer*>          _meshBuffers;
+
+	// The shader last set, the vertex format its vertex shader was bound for, and the
+	// quantisation last uploaded to cbMesh
+	int                  _currentShader;
+	MeshVertexFormat     _currentVertexFormat;
+	MeshConstants        _meshConstants;
+	bool                 _meshConstantsValid;
+
+	HRESULT CreateInstanceBuffer(int instanceCapacity);
+	HRESULT CreateConstantRing();
+
+	// Checks whether the GPU has finished the frame with the fence, or waits for it to, and
+	// releases the ring space of the frames that have finished
+	bool IsFenceComplete(uint64_t fence, bool wait);
+	// Allocates from the ring, waiting for the oldest frames to finish while it is full
+	size_t AllocateUpload(UploadRing& ring, size_t size, size_t alignment);
+	// Writes the slot's contents to a new place in the constant ring and binds them there
+	void UploadToConstantRing(ConstantBufferSlot slot);
+	// Binds the current shader's vertex shader and layout for the mesh's format, and for a
+	// quantised mesh uploads its quantisation if it isn't there already
+	void BindVertexFormat(const MeshData& meshData);
+	// Creates an immutable vertex and index buffer pair and sets meshData's buffers to them
+	HRESULT CreateMeshBuffers(const void* vertexData, UINT vertexDataSize, const void* indexData, UINT indexDataSize, MeshData& meshData);
+
+public:
+	D3D11RenderDevice();
+	~D3D11RenderDevice();
+
+	HRESULT Initialise(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pImmediateContext, int instanceCapacity);
+	void Cleanup();
+
+	// Creates the vertex and index buffers straight from the mapped file's data, without a copy,
+	// and fills in meshData to draw the whole mesh, with the file's index width. Only SimpleVertex
+	// meshes can be drawn, so other files give E_INVALIDARG.
+	HRESULT CreateMesh(const MeshFile& meshFile, MeshData& meshData);
+	// Creates buffers holding the geometry, as SoftwareRenderDevice::CreateMesh copies it, with
+	// the vertices compressed to vertexFormat first
+	HRESULT CreateMesh(const MeshGeometry& geometry, MeshData& meshData, MeshVertexFormat vertexFormat = VERTEX_FORMAT_SIMPLE);
+
+	// Binds the constant buffers to the registers Lighting.fx expects
+	void BindConstantBuffers();
+
+	// Marks the end of the frame's draws, and waits if the GPU is MAX_FRAMES_IN_FLIGHT behind
+	void EndFrame();
+
+	bool IsConstantRingEnabled() const { return _pConstantRingBuffer != nullptr; }
+	const UploadRing& GetConstantRing() const { return _constantRing; }
+	const UploadRing& GetInstanceRing() const { return _instanceRing; }
+	void ResetUploadStats();
+
+	// Gives the state objects their ids. A null rasterizer state is the default solid state.
+	void RegisterRasterizerState(int rasterizerState, ID3D11RasterizerState* pRasterizerState);
+	// RegisterShader gives the shader for SimpleVertex meshes. RegisterShaderVariant adds the
+	// vertex shader and layout to draw meshes of another format with, which share the pixel shader.
+	void RegisterShader(int shader, ID3D11VertexShader* pVertexShader, ID3D11PixelShader* pPixelShader, ID3D11InputLayout* pInputLayout);
+	void RegisterShaderVariant(int shader, MeshVertexFormat vertexFormat, ID3D11VertexShader* pVertexShader, ID3D11InputLayout* pInputLayout);
+
+	void SetRasterizerState(int rasterizerState) override;
+	void SetShader(int shader) override;
+	void SetMesh(const MeshData& meshData) override;
+	void DrawIndexed(int indexCount) override;
+
+	void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override;
+	void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) override;
+	void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) override;
+};
@@ -1,12 +1,77 @@
 #include "Application.h"
+#include <shellapi.h>
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
 
 	Application * theApp = new Application();
 
+	// -record file saves this session's input when the application closes, -replay file plays
+	// a saved session's input back in place of the keyboard, -trace file writes the profiler's
+	// zones as a Chrome trace when the application closes, and -mesh file draws the bodies of
+	// the solar system with a mesh file made by MeshConverter instead of the icospheres. -scene
+	// file builds the solar system from another scene, as text or compiled by SceneConverter.
+	// -vertexformat q12 or q8 stores the icospheres' vertices quantised, in 12 or 8 bytes each.
+	// -asteroids count sets how many asteroids are in the belt, and -gravity puts them in orbit
+	// around the sun.
+	int argumentCount = 0;
+	LPWSTR* arguments = lpCmdLine[0] ? CommandLineToArgvW(lpCmdLine, &argumentCount) : nullptr;
+
+	for (int i = 0; i < argumentCount; i++)
+	{
+		// The only switch without a value
+		if (wcscmp(arguments[i], L"-gravity") == 0)
+		{
+			theApp->SetAsteroidGravity(true);
+			continue;
+		}
+
+		if (i + 1 == argumentCount)
+			break;
+
+		if (wcscmp(arguments[i], L"-record") == 0)
+		{
+			theApp->RecordInput(arguments[++i]);
+		}
+		else if (wcscmp(arguments[i], L"-replay") == 0)
+		{
+			if (!theApp->ReplayInput(arguments[++i]))
+				OutputDebugStringA("Could not read the input recording\n");
+		}
+		else if (wcscmp(arguments[i], L"-trace") == 0)
+		{
+			theApp->TraceProfile(arguments[++i]);
+		}
+		else if (wcscmp(arguments[i], L"-scene") == 0)
+		{
+			theApp->SetScene(arguments[++i]);
+		}
+		else if (wcscmp(arguments[i], L"-mesh") == 0)
+		{
+			theApp->SetBodyMesh(arguments[++i]);
+		}
+		else if (wcscmp(arguments[i], L"-vertexformat") == 0)
+		{
+			const wchar_t * format = arguments[++i];
+			if (wcscmp(format, L"q12") == 0)
+				theApp->SetBodyVertexFormat(VERTEX_FORMAT_QUANTISED_12);
+			else if (wcscmp(format, L"q8") == 0)
+				theApp->SetBodyVertexFormat(VERTEX_FORMAT_QUANTISED_8);
+			else if (wcscmp(format, L"simple") != 0)
+				OutputDebugStringA("The vertex format must be simple, q12 or q8\n");
+		}
+		else if (wcscmp(arguments[i], L"-asteroids") == 0)
+		{
+			int count = _wtoi(arguments[++i]);
+			if (count >= 0)
+				theApp->SetAsteroidCount(count);
+		}
+	}
+
+	if (arguments)
+		LocalFree(arguments);
+
 	if (FAILED(theApp->Initialise(hInstance, nCmdShow)))
 	{
 		return -1;
@@ -0,0 +1,224 @@
+#include "Frustum.h"
+#include "CpuFeatures.h"
+#include "FrustumAvx.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+static XMFLOAT4 NormalisePlane(float x, float y, float z, float w)
+{
+	float length = sqrtf(x * x + y * y + z * z);
+
+	return XMFLOAT4(x / length, y / length, z / length, w / length);
+}
+
+Frustum Frustum::FromViewProjection(const XMFLOAT4X4& m)
+{
+	// With row vectors clip = v * M, so each clip coordinate is v dotted with a column of M, and
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w become sums and differences of the columns
+	Frustum frustum;
+	frustum.planes[LEFT] = NormalisePlane(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+	frustum.planes[RIGHT] = NormalisePlane(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+	frustum.planes[BOTTOM] = NormalisePlane(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+	frustum.planes[TOP] = NormalisePlane(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+	frustum.planes[NEAR_PLANE] = NormalisePlane(m._13, m._23, m._33, m._43);
+	frustum.planes[FAR_PLANE] = NormalisePlane(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+
+	return frustum;
+}
+
+bool Frustum::Intersects(const SphereBounds& sphere) const
+{
+	for (int p = 0; p < PLANE_COUNT; p++)
+	{
+		const XMFLOAT4& plane = planes[p];
+		float distance = plane.x * sphere.Center.x + plane.y * sphere.Center.y + plane.z * sphere.Center.z + plane.w;
+
+		if (distance < -sphere.Radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// The kernels below all test spheres [start, count) and return how many are visible. The SIMD
+// ones leave the last count % width spheres for the scalar kernel. The AVX one is in
+// FrustumAvx.cpp.
+static int CullScalar(const Frustum& frustum, const float * x, const float * y, const float * z, const float * radius,
+	unsigned char * visible, int start, int count)
+{
+	int visibleCount = 0;
+
+	for (int i = start; i < count; i++)
+	{
+		SphereBounds sphere = { XMFLOAT3(x[i], y[i], z[i]), radius[i] };
+		visible[i] = frustum.Intersects(sphere) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+
+	return visibleCount;
+}
+
+#ifdef FRUSTUM_SSE
+static int CullSimd4(const Frustum& frustum, const float * x, const float * y, const float * z, const float * radius,
+	unsigned char * visible, int count, int * end)
+{
+	__m128 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeW[Frustum::PLANE_COUNT];
+	for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+	int visibleCount = 0;
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cz = _mm_loadu_ps(z + i);
+		__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(radius + i), signBit);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			// Same order of operations as Frustum::Intersects, so both give identical results
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)), _mm_mul_ps(planeZ[p], cz)), planeW[p]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		// The lanes' all ones or zeros narrowed to bytes and masked to one or zero, written with a
+		// single store and counted with one sum of absolute differences
+		__m128i words = _mm_packs_epi32(_mm_castps_si128(inside), _mm_castps_si128(inside));
+		__m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), one);
+		int lanes = _mm_cvtsi128_si32(bytes);
+		memcpy(visible + i, &lanes, sizeof(lanes));
+		visibleCount += _mm_cvtsi128_si32(_mm_sad_epu8(bytes, zero)) / 2;
+	}
+
+	*end = i;
+	return visibleCount;
+}
+#endif
+
+const int FrustumCuller::CULL_GRAIN_SIZE;
+
+FrustumCuller::FrustumCuller()
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Clear()
+{
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_radius.clear();
+	_visible.clear();
+}
+
+void FrustumCuller::Reserve(int count)
+{
+	_x.reserve(count);
+	_y.reserve(count);
+	_z.reserve(count);
+	_radius.reserve(count);
+	_visible.reserve(count);
+}
+
+int FrustumCuller::Add(const SphereBounds& sphere)
+{
+	_x.push_back(sphere.Center.x);
+	_y.push_back(sphere.Center.y);
+	_z.push_back(sphere.Center.z);
+	_radius.push_back(sphere.Radius);
+	_visible.push_back(0);
+
+	return (int)_x.size() - 1;
+}
+
+int FrustumCuller::CullRange(const Frustum& frustum, int begin, int end, CullPath path)
+{
+	const float * x = _x.data() + begin;
+	const float * y = _y.data() + begin;
+	const float * z = _z.data() + begin;
+	const float * radius = _radius.data() + begin;
+	unsigned char * visible = _visible.data() + begin;
+	int count = end - begin;
+
+	int start = 0;
+	int visibleCount = 0;
+	path = (min)(path, GetWidestPath());
+
+#if FRUSTUM_AVX
+	if (path == CULL_SIMD8)
+	{
+		visibleCount = CullSimd8(frustum, x, y, z, radius, visible, count, &start);
+	}
+	else
+#endif
+#ifdef FRUSTUM_SSE
+	if (path != CULL_SCALAR)
+	{
+		visibleCount = CullSimd4(frustum, x, y, z, radius, visible, count, &start);
+	}
+#endif
+
+	return visibleCount + CullScalar(frustum, x, y, z, radius, visible, start, count);
+}
+
+int FrustumCuller::Cull(const Frustum& frustum, CullPath path)
+{
+	return CullRange(frustum, 0, GetCount(), path);
+}
+
+int FrustumCuller::Cull(const Frustum& frustum, JobSystem& jobSystem, CullPath path)
+{
+	// Each chunk counts its own visible spheres, and the counts are added up afterwards
+	int count = GetCount();
+	int chunkCount = (count + CULL_GRAIN_SIZE - 1) / CULL_GRAIN_SIZE;
+	_chunkVisibleCounts.resize(chunkCount);
+
+	jobSystem.ParallelFor(count, CULL_GRAIN_SIZE, [this, &frustum, path](int begin, int end)
+	{
+		_chunkVisibleCounts[begin / CULL_GRAIN_SIZE] = CullRange(frustum, begin, end, path);
+	});
+
+	int visibleCount = 0;
+	for (int chunkVisibleCount : _chunkVisibleCounts)
+	{
+		visibleCount += chunkVisibleCount;
+	}
+
+	return visibleCount;
+}
+
+CullPath FrustumCuller::GetWidestPath()
+{
+#if FRUSTUM_AVX
+	if (GetCpuFeatures().avx)
+		return CULL_SIMD8;
+#endif
+#if defined(FRUSTUM_SSE)
+	return CULL_SIMD4;
+#else
+	return CULL_SCALAR;
+#endif
+}
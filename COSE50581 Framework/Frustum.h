@@ -0,0 +1,79 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+using namespace std;
+
+class JobSystem;
+
+struct SphereBounds
+{
+	XMFLOAT3 Center;
+	float Radius;
+};
+
+// The six planes of a view frustum, as (normal, distance) with the normals pointing inwards.
+// A point p is inside a plane when dot(normal, p) + distance >= 0.
+struct Frustum
+{
+	enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+	XMFLOAT4 planes[PLANE_COUNT];
+
+	// Extracts the planes from a row vector view-projection matrix, such as the one returned by
+	// Camera::GetViewProjection, with the D3D clip space depth range of 0 to w
+	static Frustum FromViewProjection(const XMFLOAT4X4& viewProjection);
+
+	bool Intersects(const SphereBounds& sphere) const;
+};
+
+// Which code path FrustumCuller::Cull uses. SIMD4 and SIMD8 fall back to the widest path the
+// build and the processor support, so asking for SIMD8 without AVX runs the SSE code.
+enum CullPath
+{
+	CULL_SCALAR,
+	CULL_SIMD4,
+	CULL_SIMD8,
+};
+
+// Tests many bounding spheres against a frustum at once. The spheres are kept as separate arrays
+// of x, y, z and radius so that four (SSE) or eight (AVX) of them are tested per instruction.
+class FrustumCuller
+{
+private:
+	vector<float> _x;
+	vector<float> _y;
+	vector<float> _z;
+	vector<float> _radius;
+	vector<unsigned char> _visible;
+	vector<int> _chunkVisibleCounts;
+
+	// Spheres per job when culling on several threads
+	static const int CULL_GRAIN_SIZE = 16384;
+
+	int CullRange(const Frustum& frustum, int begin, int end, CullPath path);
+
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	void Clear();
+	void Reserve(int count);
+
+	// Returns the index used to look up the sphere's visibility after Cull
+	int Add(const SphereBounds& sphere);
+
+	// Sets the visibility of every sphere added since Clear. Returns how many are visible.
+	int Cull(const Frustum& frustum, CullPath path = CULL_SIMD8);
+	// The same, with the spheres split between the job system's threads
+	int Cull(const Frustum& frustum, JobSystem& jobSystem, CullPath path = CULL_SIMD8);
+
+	bool IsVisible(int index) const { return _visible[index] != 0; }
+	const unsigned char * GetVisibility() const { return _visible.data(); }
+	int GetCount() const { return (int)_x.size(); }
+
+	// The widest path this build has and the processor can run, checked with CPUID
+	static CullPath GetWidestPath();
+};
@@ -0,0 +1,54 @@
+// The AVX frustum culling kernel. The CMake build compiles this file with AVX enabled, so that
+// nothing else is, and FrustumCuller only calls it when the processor has AVX.
+
+#include "FrustumAvx.h"
+
+#if FRUSTUM_AVX
+#include <immintrin.h>
+
+int CullSimd8(const Frustum& frustum, const float * x, const float * y, const float * z, const float * radius,
+	unsigned char * visible, int count, int * end)
+{
+	__m256 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeW[Frustum::PLANE_COUNT];
+	for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+	{
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+	int visibleCount = 0;
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(x + i);
+		__m256 cy = _mm256_loadu_ps(y + i);
+		__m256 cz = _mm256_loadu_ps(z + i);
+		__m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(radius + i), signBit);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			// Multiplies and adds rather than FMA, to round as Frustum::Intersects does
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)), _mm256_mul_ps(planeZ[p], cz)), planeW[p]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+
+		// The lanes' all ones or zeros narrowed to bytes and masked to one or zero, written with a
+		// single store and counted with one sum of absolute differences
+		__m256i insideBits = _mm256_castps_si256(inside);
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(insideBits), _mm256_extractf128_si256(insideBits, 1));
+		__m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), one);
+		_mm_storel_epi64((__m128i *)(visible + i), bytes);
+		visibleCount += _mm_cvtsi128_si32(_mm_sad_epu8(bytes, zero));
+	}
+
+	*end = i;
+	return visibleCount;
+}
+#endif
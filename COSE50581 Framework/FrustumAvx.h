@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Frustum.h"
+
+// MSVC compiles AVX intrinsics without any flags, so FrustumAvx.cpp always builds its kernel
+// there. Other compilers need AVX enabled for that file, which the CMake build does, defining
+// FRUSTUM_AVX when it has. Frustum.cpp only calls the kernel when CPUID has found AVX.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)) && _MSC_VER >= 1700 && !defined(FRUSTUM_AVX)
+#define FRUSTUM_AVX 1
+#endif
+
+#if FRUSTUM_AVX
+// Tests spheres [0, count) eight at a time and returns how many are visible. The last
+// count % 8 are left for the scalar kernel, from *end.
+int CullSimd8(const Frustum& frustum, const float * x, const float * y, const float * z, const float * radius,
+	unsigned char * visible, int count, int * end);
+#endif
@@ -1,105 +1,64 @@
 #include "GameObject.h"
+#include "LodChain.h"
+#include <algorithm>
 
 
 
 GameObject::GameObject(void)
 {
+	_meshData = nullptr;
+	_lodChain = nullptr;
+	_lodLevel = 0;
 }
 
 GameObject::~GameObject(void)
 {
 }
 
-void GameObject::Initialise(MeshData meshData)
+void GameObject::Initialise(const MeshData * meshData)
 {
 	_meshData = meshData;
 
 	XMStoreFloat4x4(&_world, XMMatrixIdentity());
-	//XMStoreFloat4x4(&_scale, XMMatrixIdentity());
-	//XMStoreFloat4x4(&_rotate, XMMatrixIdentity());
-	//XMStoreFloat4x4(&_translate, XMMatrixIdentity());
-
-	cout << "Number:" << bla << endl;
-
-	//srand(time(NULL));
-	xDir = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-	zDir = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-
-	//need to normalize it
-	float length = sqrt(xDir * xDir + zDir + zDir);
-	xDir /= length;
-	zDir /= length;
-
-	//we have a direction, now we need a radius to get the final position
-	float radius = static_cast <float> (rand()) / static_cast <float> (RAND_MAX/6.0f);
-	xDir *= radius;
-	zDir *= radius;
 }
 
-// I believe these three methods are to set the scale, rot, and trans for the initial creation of the object, not for updating with.
-void GameObject::SetScale(float x, float y, float z)
+void GameObject::SetLodChain(const LodChain * lodChain)
 {
-	//XMStoreFloat4x4(transformations.push_back, XMMatrixScaling(x, y, z));
-	transformations.push_back((XMMatrixScaling(x, y, z)));
-}
-
-void GameObject::SetRotation(float x, float y, float z)
-{
-	//XMStoreFloat4x4(transformations.push_back, XMMatrixRotationX(x) * XMMatrixRotationY(y) * XMMatrixRotationZ(z));
-	transformations.push_back((XMMatrixRotationX(x) * XMMatrixRotationY(y) * XMMatrixRotationZ(z)));
-}
-
-void GameObject::SetTranslation(float x, float y, float z)
-{
-	//XMStoreFloat4x4(transformations.push_back, XMMatrixTranslation(x, y, z));
-	transformations.push_back(XMMatrixTranslation(x, y, z));
-}
+	_lodChain = lodChain;
 
-void GameObject::UpdateWorld()
-{
-	XMFLOAT4X4 _newWorld;
-	XMStoreFloat4x4(&_newWorld, XMMatrixIdentity());
-	XMMATRIX newWorld = XMLoadFloat4x4(&_newWorld);
-	//XMStoreFloat4x4(newWorld, XMMatrixIdentity());
-	for (auto T : transformations) //assuming your vector is called "transformations"
+	if (_lodChain && _lodChain->GetLevelCount() > 0)
 	{
-		newWorld *= T;
+		_lodLevel = _lodChain->GetLevelCount() - 1;
+		_meshData = &_lodChain->GetLevel(_lodLevel);
 	}
-	XMStoreFloat4x4(&_world, newWorld);
-	//set the final world matrix equal to whatever is stored in the newWorld matrix
-	//_world = newWorld;
-	transformations.clear();
-	//XMMATRIX scale = XMLoadFloat4x4(&_scale);
-	//XMMATRIX rotate = XMLoadFloat4x4(&_rotate);
-	//XMMATRIX translate = XMLoadFloat4x4(&_translate);
-
-	//XMStoreFloat4x4(&_world, scale * rotate * translate);
 }
 
-void GameObject::Update(float elapsedTime)
+void GameObject::UpdateLod(float screenRadius)
 {
-	// TODO: Add GameObject logic 
-}
+	if (!_lodChain || _lodChain->GetLevelCount() == 0)
+		return;
 
-float GameObject::GetXDir()
-{
-	return xDir;
+	int level = _lodChain->SelectLevel(screenRadius, _lodLevel);
+	if (level != _lodLevel)
+	{
+		_lodLevel = level;
+		_meshData = &_lodChain->GetLevel(level);
+	}
 }
 
-float GameObject::GetZDir()
+SphereBounds GameObject::GetBoundingSphere() const
 {
-	return zDir;
-}
-
+	XMMATRIX world = XMLoadFloat4x4(&_world);
 
+	SphereBounds sphere;
+	XMStoreFloat3(&sphere.Center, XMVector3TransformCoord(XMLoadFloat3(&_meshData->BoundsCenter), world));
 
-void GameObject::Draw(ID3D11Device * pd3dDevice, ID3D11DeviceContext * pImmediateContext)
-{
-	// NOTE: We are assuming that the constant buffers and all other draw setup has already taken place
+	// Scale the radius by the largest axis scale so that the sphere still covers the mesh when
+	// it is scaled unevenly
+	float scaleX = XMVectorGetX(XMVector3Length(world.r[0]));
+	float scaleY = XMVectorGetX(XMVector3Length(world.r[1]));
+	float scaleZ = XMVectorGetX(XMVector3Length(world.r[2]));
+	sphere.Radius = _meshData->BoundsRadius * (std::max)(scaleX, (std::max)(scaleY, scaleZ));
 
-	// Set vertex and index buffers
-	pImmediateContext->IASetVertexBuffers(0, 1, &_meshData.VertexBuffer, &_meshData.VBStride, &_meshData.VBOffset);
-	pImmediateContext->IASetIndexBuffer(_meshData.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-	pImmediateContext->DrawIndexed(_meshData.IndexCount, 0, 0);
-}
\ No newline at end of file
+	return sphere;
+}
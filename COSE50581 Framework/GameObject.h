@@ -1,65 +1,78 @@
 #pragma once
 
-#include <d3d11_1.h>
 #include <DirectXMath.h>
-#include <iostream>
-#include <vector>
-#include <stdlib.h>     /* srand, rand */
-#include <time.h>       /* time */
-#include <random>
+#include "Frustum.h"
+#include "VertexCompression.h"
 
 using namespace DirectX;
 using namespace std;
 
+// The D3D11 buffers are only ever used through pointers here, so forward declaring them keeps
+// GameObject free of <d3d11_1.h> and lets the simulation build on platforms without Direct3D.
+struct ID3D11Buffer;
+
+class LodChain;
+
+// The width of a mesh's indices. Meshes that reach more than 65536 vertices need 32 bits.
+enum MeshIndexFormat
+{
+	INDEX_FORMAT_16,
+	INDEX_FORMAT_32
+};
+
 struct MeshData
 {
-	// This MeshData object will have 5 parameters.
 	ID3D11Buffer * VertexBuffer;
 	ID3D11Buffer * IndexBuffer;
-	UINT VBStride;
-	UINT VBOffset;
-	UINT IndexCount;
+	unsigned int VBStride;
+	unsigned int VBOffset;
+	unsigned int IndexCount;
+	MeshIndexFormat IndexFormat;
+	// How the vertices are stored, and for the quantised formats how their positions map back
+	MeshVertexFormat VertexFormat;
+	PositionQuantisation Quantisation;
+	// Sphere around every vertex of the mesh, in the mesh's own space
+	XMFLOAT3 BoundsCenter;
+	float BoundsRadius;
 };
 
+// Only what drawing an object needs every frame is kept here: its world matrix and a handle to its
+// mesh, which lives in a table shared by every object drawn with it. The transforms that produce
+// the world matrix live in the SceneGraph, and how each object moves is decided by SolarSystem,
+// with NBodySimulation for the belt under gravity, so thousands of objects can be stored next to
+// each other in an ObjectPool and walked without pulling in data nothing reads.
 class GameObject
 {
 private:
-	MeshData _meshData; // We create a MeshData object
-
 	XMFLOAT4X4 _world;
 
-	float xDir;
-	float zDir;
-	//XMFLOAT4X4 _newWorld;
+	// The mesh drawn, in the table of whoever initialised the object or in the chain of levels
+	const MeshData * _meshData;
 
-	mt19937 randomGenerator;
-	uniform_real_distribution<float> bla{ 0.0f, 1.0f };
-
-
-
-
-	//XMFLOAT4X4 _scale;
-	//XMFLOAT4X4 _rotate;
-	//XMFLOAT4X4 _translate;
-
-	vector<XMMATRIX> transformations;
+	// The levels of detail _meshData is chosen from, or null to always draw the same mesh
+	const LodChain * _lodChain;
+	int _lodLevel;
 
 public:
 	GameObject(void);
 	~GameObject(void);
 
 	XMFLOAT4X4 GetWorld() const { return _world; };
+	void SetWorld(const XMFLOAT4X4& world) { _world = world; }
+
+	const MeshData& GetMeshData() const { return *_meshData; }
 
-	void UpdateWorld();
+	// Draws the object with the chain's levels from now on, starting with the least detailed
+	void SetLodChain(const LodChain * lodChain);
+	const LodChain * GetLodChain() const { return _lodChain; }
+	int GetLodLevel() const { return _lodLevel; }
+	// Picks the level to draw for the radius, in pixels, the object covers on screen
+	void UpdateLod(float screenRadius);
 
-	void SetScale(float x, float y, float z);
-	void SetRotation(float x, float y, float z);
-	void SetTranslation(float x, float y, float z);
+	// The mesh's bounding sphere moved into world space by the current world matrix
+	SphereBounds GetBoundingSphere() const;
 
-	void Initialise(MeshData meshData);
-	void Update(float elapsedTime);
-	float GetXDir();
-	float GetZDir();
-	void Draw(ID3D11Device * pd3dDevice, ID3D11DeviceContext * pImmediateContext);
+	// meshData must outlive the object, or last until it is initialised again
+	void Initialise(const MeshData * meshData);
 };
 
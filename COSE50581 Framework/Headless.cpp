@@ -0,0 +1,286 @@
+// Headless driver for the solar system simulation. Runs a fixed number of frames at a fixed
+// timestep without a window or a GPU and reports how long each SolarSystem::Update took. With
+// --image, the last frame is drawn with the software rasteriser and saved as a PPM. With
+// --replay, an input recording is replayed one frame per step to move the camera the way it
+// moved in the application, and the image is drawn from where the camera ends up.
+//
+// The profiled zones are summarised at the end, and written as a Chrome trace with --trace.
+// --asteroids sets the size of the belt instead of the scene's count, and --gravity puts it in
+// orbit around the sun under gravity. The solar system is SolarSystem.scene unless --scene
+// names another.
+//
+// Usage: Headless [--frames n] [--dt seconds] [--image image.ppm] [--replay input.rec]
+//                 [--trace trace.json] [--asteroids n] [--gravity] [--scene file]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "InputSystem.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+#include "SolarSystem.h"
+#include "ViewController.h"
+
+using namespace std;
+
+struct HeadlessOptions
+{
+	int frames;
+	float dt;
+	const char * imagePath;
+	const char * recordingPath;
+	const char * tracePath;
+	// -1 for the scene's own count
+	int asteroids;
+	bool gravity;
+	const char * scenePath;
+};
+
+static double Percentile(const vector<double>& sortedTimes, double percentile)
+{
+	size_t index = static_cast<size_t>(percentile * (sortedTimes.size() - 1) + 0.5);
+	return sortedTimes[index];
+}
+
+// Draws the scene the way Application does, looking at the given point, and writes the image as
+// a binary PPM
+static bool WriteImage(const char* path, SolarSystem& solarSystem, SoftwareRenderDevice& renderDevice, FXMVECTOR at,
+	bool wireframe, bool drawSolarSystem)
+{
+	JobSystem jobSystem;
+	SceneRenderer sceneRenderer;
+	sceneRenderer.SetViewportHeight(renderDevice.GetHeight());
+
+	XMVECTOR eye = XMVectorSet(0.0f, 10.0f, -10.0f, 0.0f);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMFLOAT4X4 view, projection;
+	XMFLOAT3 eyePosition;
+	XMStoreFloat4x4(&view, XMMatrixLookAtLH(eye, at, up));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, renderDevice.GetWidth() / (float)renderDevice.GetHeight(), 0.01f, 100.0f));
+	XMStoreFloat3(&eyePosition, eye);
+
+	float clearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f };
+	renderDevice.Clear(clearColor);
+	sceneRenderer.Render(renderDevice, jobSystem, solarSystem, view, projection, eyePosition, wireframe, drawSolarSystem);
+	renderDevice.Rasterise(jobSystem);
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", renderDevice.GetWidth(), renderDevice.GetHeight());
+
+	vector<unsigned char> row(renderDevice.GetWidth() * 3);
+	for (int y = 0; y < renderDevice.GetHeight(); y++)
+	{
+		for (int x = 0; x < renderDevice.GetWidth(); x++)
+		{
+			uint32_t color = renderDevice.GetColorBuffer()[(size_t)y * renderDevice.GetWidth() + x];
+			row[x * 3] = color & 0xFF;
+			row[x * 3 + 1] = (color >> 8) & 0xFF;
+			row[x * 3 + 2] = (color >> 16) & 0xFF;
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	const SoftwareRenderDevice::Stats& stats = renderDevice.GetStats();
+	printf("image: %s  %dx%d  triangles %d  lines %d  pixels shaded %lld\n", path, renderDevice.GetWidth(),
+		renderDevice.GetHeight(), stats.triangles, stats.lines, stats.pixelsShaded);
+
+	const SceneRenderer::LodStats& lodStats = sceneRenderer.GetLodStats();
+	printf("objects drawn: %d  triangles submitted %lld  (all at full detail: %lld)\n", lodStats.objects, lodStats.triangles,
+		lodStats.fullDetailTriangles);
+
+	return fclose(file) == 0;
+}
+
+static bool ParseOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strcmp(argv[arg], "--gravity") == 0)
+		{
+			options.gravity = true;
+			continue;
+		}
+
+		if (arg + 1 >= argc)
+			return false;
+
+		const char * name = argv[arg];
+		const char * value = argv[++arg];
+
+		if (strcmp(name, "--frames") == 0)
+			options.frames = atoi(value);
+		else if (strcmp(name, "--dt") == 0)
+			options.dt = static_cast<float>(atof(value));
+		else if (strcmp(name, "--image") == 0)
+			options.imagePath = value;
+		else if (strcmp(name, "--replay") == 0)
+			options.recordingPath = value;
+		else if (strcmp(name, "--trace") == 0)
+			options.tracePath = value;
+		else if (strcmp(name, "--asteroids") == 0)
+			options.asteroids = atoi(value);
+		else if (strcmp(name, "--scene") == 0)
+			options.scenePath = value;
+		else
+			return false;
+	}
+
+	return options.frames > 0 && options.dt > 0.0f && options.asteroids >= -1;
+}
+
+int main(int argc, char* argv[])
+{
+	HeadlessOptions options;
+	options.frames = 10000;
+	options.dt = 1.0f / 60.0f;
+	options.imagePath = nullptr;
+	options.recordingPath = nullptr;
+	options.tracePath = nullptr;
+	options.asteroids = -1;
+	options.gravity = false;
+	options.scenePath = SOLAR_SYSTEM_SCENE_PATH;
+
+	if (!ParseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "Usage: %s [--frames n] [--dt seconds] [--image image.ppm] [--replay input.rec]\n"
+			"    [--trace trace.json] [--asteroids n] [--gravity] [--scene file]\n", argv[0]);
+		return 1;
+	}
+
+	int frameCount = options.frames;
+	float dt = options.dt;
+	const char* imagePath = options.imagePath;
+	const char* recordingPath = options.recordingPath;
+	const char* tracePath = options.tracePath;
+	const char* scenePath = options.scenePath;
+
+	SceneFile scene;
+	if (!scene.Load(scenePath))
+	{
+		fprintf(stderr, "%s: %s\n", scenePath, scene.GetError().c_str());
+		return 1;
+	}
+
+	InputSystem input;
+	ViewController viewController;
+
+	if (recordingPath)
+	{
+		vector<InputEvent> events;
+		ifstream recording(recordingPath);
+		if (!InputSystem::LoadRecording(recording, events))
+		{
+			fprintf(stderr, "Could not read the input recording %s\n", recordingPath);
+			return 1;
+		}
+
+		input.StartReplay(events);
+		printf("replaying %zu input events from %s\n", events.size(), recordingPath);
+	}
+
+	// The software rasteriser keeps its own copy of the meshes to draw the image with
+	static SoftwareRenderDevice renderDevice(1280, 720);
+	renderDevice.RegisterRasterizerState(RS_SOLID, false);
+	renderDevice.RegisterRasterizerState(RS_WIREFRAME, true);
+	MeshData cubeMeshData = renderDevice.CreateMesh(CreateCubeGeometry());
+	MeshData planeMeshData = renderDevice.CreateMesh(CreatePlaneGeometry());
+
+	// The bodies are icospheres, drawn with the detail their size on screen needs
+	static LodChain bodyLodChain;
+	for (int subdivisions = SolarSystem::BODY_LOD_SUBDIVISIONS; subdivisions >= 0; subdivisions--)
+	{
+		MeshGeometry sphere = CreateIcosphereGeometry(subdivisions);
+		bodyLodChain.AddLevel(sphere, renderDevice.CreateMesh(sphere));
+	}
+
+	static SolarSystem solarSystem;
+	srand(0);
+	solarSystem.SetAsteroidCount(options.asteroids);
+	solarSystem.SetAsteroidGravity(options.gravity);
+	solarSystem.Initialise(scene, cubeMeshData, planeMeshData);
+	solarSystem.SetMeshLodChain(scene.FindMesh("body"), &bodyLodChain);
+
+	vector<double> frameTimes(frameCount);
+	float t = 0.0f;
+
+	for (int i = 0; i < frameCount; i++)
+	{
+		t += dt;
+
+		auto start = chrono::steady_clock::now();
+		solarSystem.Update(t);
+		auto end = chrono::steady_clock::now();
+
+		frameTimes[i] = chrono::duration<double, micro>(end - start).count();
+
+		if (recordingPath)
+		{
+			input.BeginFrame();
+			viewController.Update(input, dt);
+		}
+	}
+
+	// Touch the results so the update can't be optimised away
+	XMFLOAT4X4 firstBodyWorld = solarSystem.GetBodyCount() > 0 ? solarSystem.GetBody(0).GetWorld() : XMFLOAT4X4();
+
+	double total = 0.0;
+	for (double frameTime : frameTimes)
+		total += frameTime;
+
+	sort(frameTimes.begin(), frameTimes.end());
+
+	printf("frames: %d  dt: %.6f s  bodies: %d\n", frameCount, dt, solarSystem.GetAsteroidCount() + solarSystem.GetBodyCount() + 1);
+	printf("frame time (us): min %.3f  mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+		frameTimes.front(), total / frameCount, Percentile(frameTimes, 0.50),
+		Percentile(frameTimes, 0.95), Percentile(frameTimes, 0.99), frameTimes.back());
+	printf("first body position: (%.3f, %.3f, %.3f)\n", firstBodyWorld._41, firstBodyWorld._42, firstBodyWorld._43);
+
+	// Without a recording the image shows the solar system from the camera's starting point
+	bool wireframe = false;
+	bool drawSolarSystem = true;
+
+	if (recordingPath)
+	{
+		XMFLOAT3 at;
+		XMStoreFloat3(&at, viewController.GetAt());
+		wireframe = viewController.IsWireframe();
+		drawSolarSystem = viewController.IsSolarSystemShown();
+		printf("camera target: (%.3f, %.3f, %.3f)  wireframe: %s  scene: %s%s\n", at.x, at.y, at.z, wireframe ? "yes" : "no",
+			drawSolarSystem ? "solar system" : "cubes", input.IsReplayFinished() ? "" : "  (recording longer than the run)");
+	}
+
+	if (imagePath && !WriteImage(imagePath, solarSystem, renderDevice, viewController.GetAt(), wireframe, drawSolarSystem))
+	{
+		fprintf(stderr, "Could not write %s\n", imagePath);
+		return 1;
+	}
+
+#if PROFILER_ENABLED
+	vector<Profiler::Zone> zones = Profiler::Collect();
+	printf("%s", Profiler::FormatSummary(Profiler::Summarise(zones)).c_str());
+
+	if (tracePath)
+	{
+		ofstream trace(tracePath);
+		Profiler::WriteChromeTrace(trace, zones);
+		if (!trace)
+		{
+			fprintf(stderr, "Could not write %s\n", tracePath);
+			return 1;
+		}
+		printf("trace: %s  %zu zones\n", tracePath, zones.size());
+	}
+#endif
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include "InputSystem.h"
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// The first line of a saved recording
+static const char * RECORDING_HEADER = "input-recording 1";
+
+InputSystem::InputSystem()
+{
+	memset(_down, 0, sizeof(_down));
+	memset(_pressed, 0, sizeof(_pressed));
+	memset(_released, 0, sizeof(_released));
+
+	_frame = 0;
+	_recording = false;
+	_recordingStartFrame = 0;
+	_replaying = false;
+	_replayStartFrame = 0;
+	_replayPosition = 0;
+}
+
+InputSystem::~InputSystem()
+{
+}
+
+void InputSystem::QueueEvent(InputEventType type, int key)
+{
+	if (key < 0 || key >= KEY_COUNT)
+		return;
+
+	InputEvent event;
+	event.frame = 0;
+	event.type = type;
+	event.key = key;
+	_queue.push_back(event);
+}
+
+void InputSystem::QueueReleaseAll()
+{
+	for (int key = 0; key < KEY_COUNT; key++)
+		QueueEvent(INPUT_KEY_UP, key);
+}
+
+bool InputSystem::Apply(InputEventType type, int key)
+{
+	if (type == INPUT_KEY_DOWN)
+	{
+		if (_down[key])
+			return false;
+
+		_down[key] = 1;
+		_pressed[key] = 1;
+	}
+	else
+	{
+		if (!_down[key])
+			return false;
+
+		_down[key] = 0;
+		_released[key] = 1;
+	}
+
+	return true;
+}
+
+void InputSystem::BeginFrame()
+{
+	memset(_pressed, 0, sizeof(_pressed));
+	memset(_released, 0, sizeof(_released));
+
+	if (_replaying)
+	{
+		_queue.clear();
+
+		int replayFrame = _frame - _replayStartFrame;
+		while (_replayPosition < _replayEvents.size() && _replayEvents[_replayPosition].frame <= replayFrame)
+		{
+			const InputEvent& event = _replayEvents[_replayPosition++];
+			_queue.push_back(event);
+		}
+	}
+
+	for (const InputEvent& event : _queue)
+	{
+		// Only events that change something are recorded, which drops key repeats
+		if (Apply(event.type, event.key) && _recording)
+		{
+			InputEvent recorded = event;
+			recorded.frame = _frame - _recordingStartFrame;
+			_recordedEvents.push_back(recorded);
+		}
+	}
+
+	_queue.clear();
+	_frame++;
+}
+
+void InputSystem::StartRecording()
+{
+	_recording = true;
+	_recordingStartFrame = _frame;
+	_recordedEvents.clear();
+}
+
+void InputSystem::StopRecording()
+{
+	_recording = false;
+}
+
+void InputSystem::StartReplay(const vector<InputEvent>& events)
+{
+	_replaying = true;
+	_replayStartFrame = _frame;
+	_replayEvents = events;
+	_replayPosition = 0;
+}
+
+void InputSystem::StopReplay()
+{
+	_replaying = false;
+	_replayEvents.clear();
+	_replayPosition = 0;
+}
+
+void InputSystem::SaveRecording(ostream& stream, const vector<InputEvent>& events)
+{
+	stream << RECORDING_HEADER << '\n';
+
+	for (const InputEvent& event : events)
+	{
+		stream << event.frame << ' ' << (event.type == INPUT_KEY_DOWN ? "down" : "up") << ' ' << event.key << '\n';
+	}
+}
+
+bool InputSystem::LoadRecording(istream& stream, vector<InputEvent>& events)
+{
+	events.clear();
+
+	string header;
+	if (!getline(stream, header) || header != RECORDING_HEADER)
+		return false;
+
+	InputEvent event;
+	string type;
+	while (stream >> event.frame >> type >> event.key)
+	{
+		if ((type != "down" && type != "up") || event.key < 0 || event.key >= KEY_COUNT)
+			return false;
+
+		// Events must be in frame order for the replay to find them
+		if (!events.empty() && event.frame < events.back().frame)
+			return false;
+
+		event.type = type == "down" ? INPUT_KEY_DOWN : INPUT_KEY_UP;
+		events.push_back(event);
+	}
+
+	return stream.eof();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+using namespace std;
+
+// The keys the application reads. The values are the Windows virtual key codes, so WndProc can
+// pass wParam straight through, and each letter is its upper case character.
+enum InputKey
+{
+	KEY_RETURN = 0x0D,
+	KEY_UP = 0x26,
+	KEY_DOWN = 0x28,
+	KEY_A = 'A',
+	KEY_D = 'D',
+	KEY_K = 'K',
+	KEY_L = 'L',
+	KEY_S = 'S',
+	KEY_W = 'W',
+	KEY_COUNT = 256
+};
+
+enum InputEventType
+{
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP
+};
+
+struct InputEvent
+{
+	// The frame the event is applied in, counted from the start of the recording
+	int frame;
+	InputEventType type;
+	int key;
+};
+
+// Buffers key events as the window receives them and applies them all at the start of the next
+// frame, so reading the keyboard never blocks and nothing pressed between frames is missed.
+// Besides which keys are held, it keeps which went down or up during the frame, so a toggle
+// fires once per press however long the key is held. Repeated key downs from holding a key,
+// and ups for keys that aren't down, are ignored.
+//
+// The events applied each frame can be recorded, and a recording replayed in place of the real
+// input, frame by frame, so the same camera motion can be run again without a window.
+class InputSystem
+{
+private:
+	vector<InputEvent> _queue;
+
+	unsigned char _down[KEY_COUNT];
+	unsigned char _pressed[KEY_COUNT];
+	unsigned char _released[KEY_COUNT];
+
+	int _frame;
+
+	bool _recording;
+	int _recordingStartFrame;
+	vector<InputEvent> _recordedEvents;
+
+	bool _replaying;
+	int _replayStartFrame;
+	vector<InputEvent> _replayEvents;
+	size_t _replayPosition;
+
+	// Returns whether the event changed the key's state
+	bool Apply(InputEventType type, int key);
+
+public:
+	InputSystem();
+	~InputSystem();
+
+	// Called from the message loop as the window receives key messages
+	void QueueEvent(InputEventType type, int key);
+
+	// Releases every key, for when the window loses focus and won't see them come up
+	void QueueReleaseAll();
+
+	// Applies the events queued since the last frame, or the next frame of the replay
+	void BeginFrame();
+
+	bool IsKeyDown(int key) const { return key >= 0 && key < KEY_COUNT && _down[key] != 0; }
+	bool WasKeyPressed(int key) const { return key >= 0 && key < KEY_COUNT && _pressed[key] != 0; }
+	bool WasKeyReleased(int key) const { return key >= 0 && key < KEY_COUNT && _released[key] != 0; }
+
+	void StartRecording();
+	void StopRecording();
+	const vector<InputEvent>& GetRecording() const { return _recordedEvents; }
+
+	// From the next frame on, the events come from the recording and the queued ones are dropped
+	void StartReplay(const vector<InputEvent>& events);
+	void StopReplay();
+	bool IsReplaying() const { return _replaying; }
+	bool IsReplayFinished() const { return _replayPosition >= _replayEvents.size(); }
+
+	int GetFrame() const { return _frame; }
+
+	// Recordings are stored as text, one event per line
+	static void SaveRecording(ostream& stream, const vector<InputEvent>& events);
+	static bool LoadRecording(istream& stream, vector<InputEvent>& events);
+};
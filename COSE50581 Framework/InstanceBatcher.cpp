@@ -0,0 +1,86 @@
+#include "InstanceBatcher.h"
+
+static bool SameMesh(const MeshData& a, const MeshData& b)
+{
+	return a.VertexBuffer == b.VertexBuffer && a.IndexBuffer == b.IndexBuffer &&
+		a.VBStride == b.VBStride && a.VBOffset == b.VBOffset && a.IndexCount == b.IndexCount &&
+		a.IndexFormat == b.IndexFormat && a.VertexFormat == b.VertexFormat;
+}
+
+InstanceBatcher::InstanceBatcher()
+{
+	_batchCount = 0;
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+}
+
+void InstanceBatcher::Begin()
+{
+	// The batches are kept around so their arrays can be reused next frame
+	for (int i = 0; i < _batchCount; i++)
+	{
+		_batches[i].worlds.clear();
+	}
+
+	_batchCount = 0;
+}
+
+InstanceBatcher::Batch& InstanceBatcher::FindBatch(const MeshData& meshData)
+{
+	// A scene only has a handful of meshes, so a linear search is the fastest lookup
+	for (int i = 0; i < _batchCount; i++)
+	{
+		if (SameMesh(_batches[i].meshData, meshData))
+			return _batches[i];
+	}
+
+	if (_batchCount == (int)_batches.size())
+		_batches.push_back(Batch());
+
+	Batch& batch = _batches[_batchCount++];
+	batch.meshData = meshData;
+	batch.worlds.clear();
+
+	return batch;
+}
+
+void InstanceBatcher::Add(const MeshData& meshData, const XMFLOAT4X4& world)
+{
+	// The instanced vertex shader builds its matrix from the rows, so unlike the
+	// constant buffer path the matrix doesn't need transposing
+	FindBatch(meshData).worlds.push_back(world);
+}
+
+void InstanceBatcher::Submit(RenderDevice& renderDevice)
+{
+	if (_batchCount == 0)
+		return;
+
+	if (_batchCount == 1)
+	{
+		// Everything is already in one array
+		renderDevice.UpdateInstanceBuffer(_batches[0].worlds.data(), (int)_batches[0].worlds.size());
+	}
+	else
+	{
+		_instances.clear();
+
+		for (int i = 0; i < _batchCount; i++)
+		{
+			_instances.insert(_instances.end(), _batches[i].worlds.begin(), _batches[i].worlds.end());
+		}
+
+		renderDevice.UpdateInstanceBuffer(_instances.data(), (int)_instances.size());
+	}
+
+	int startInstance = 0;
+
+	for (int i = 0; i < _batchCount; i++)
+	{
+		int instanceCount = (int)_batches[i].worlds.size();
+		renderDevice.DrawIndexedInstanced(_batches[i].meshData, instanceCount, startInstance);
+		startInstance += instanceCount;
+	}
+}
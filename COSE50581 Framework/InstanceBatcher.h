@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "RenderDevice.h"
+
+using namespace std;
+
+// Groups objects that share a mesh so each group is drawn with a single DrawIndexedInstanced.
+// The world matrices of every group are packed into one array and uploaded once per Submit,
+// then each group draws its own range of it. The arrays keep their capacity between frames,
+// so in the steady state building the batches doesn't allocate.
+class InstanceBatcher
+{
+private:
+	struct Batch
+	{
+		MeshData meshData;
+		vector<XMFLOAT4X4> worlds;
+	};
+
+	vector<Batch> _batches;
+	int _batchCount;
+	vector<XMFLOAT4X4> _instances;
+
+	Batch& FindBatch(const MeshData& meshData);
+
+public:
+	InstanceBatcher();
+	~InstanceBatcher();
+
+	// Starts a new frame, forgetting the objects added during the last one
+	void Begin();
+
+	void Add(const MeshData& meshData, const XMFLOAT4X4& world);
+	void Add(const GameObject& gameObject) { Add(gameObject.GetMeshData(), gameObject.GetWorld()); }
+
+	// Uploads the instances and issues one instanced draw per mesh
+	void Submit(RenderDevice& renderDevice);
+
+	int GetBatchCount() const { return _batchCount; }
+};
@@ -0,0 +1,150 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// The job system and queue the current thread works from, set on each worker as it starts
+static thread_local const JobSystem * currentJobSystem = nullptr;
+static thread_local int currentQueue = -1;
+
+JobSystem::JobSystem(int workerCount)
+{
+	if (workerCount < 0)
+		workerCount = max(1, (int)thread::hardware_concurrency()) - 1;
+
+	_queueCount = workerCount + 1;
+	_queues.reset(new WorkQueue[_queueCount]);
+	_quit = false;
+	_queuedJobs = 0;
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		_workers.push_back(thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> lock(_sleepLock);
+		_quit = true;
+	}
+	_wake.notify_all();
+
+	for (thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+int JobSystem::GetCurrentQueue() const
+{
+	return currentJobSystem == this ? currentQueue : _queueCount - 1;
+}
+
+bool JobSystem::RunOneJob(int queue)
+{
+	Job job;
+	bool found = false;
+
+	// Newest first from our own queue, while it's still warm in the cache
+	{
+		WorkQueue& own = _queues[queue];
+		lock_guard<mutex> lock(own.lock);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	// Otherwise oldest first from someone else's, which is the biggest piece of work left there
+	for (int i = 1; i < _queueCount && !found; i++)
+	{
+		WorkQueue& victim = _queues[(queue + i) % _queueCount];
+		lock_guard<mutex> lock(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+		return false;
+
+	_queuedJobs--;
+	(*job.body)(job.begin, job.end);
+	job.remaining->fetch_sub(1, memory_order_release);
+
+	return true;
+}
+
+void JobSystem::WorkerLoop(int queue)
+{
+	currentJobSystem = this;
+	currentQueue = queue;
+
+	while (!_quit)
+	{
+		if (RunOneJob(queue))
+			continue;
+
+		unique_lock<mutex> lock(_sleepLock);
+		_wake.wait(lock, [this]() { return _quit || _queuedJobs > 0; });
+	}
+}
+
+void JobSystem::ParallelFor(int count, int grainSize, const function<void(int, int)>& body)
+{
+	if (count <= 0)
+		return;
+
+	grainSize = max(1, grainSize);
+	int chunkCount = (count + grainSize - 1) / grainSize;
+
+	// Not worth waking anyone for, so run the chunks here in order
+	if (chunkCount == 1 || _workers.empty())
+	{
+		for (int begin = 0; begin < count; begin += grainSize)
+		{
+			body(begin, min(count, begin + grainSize));
+		}
+
+		return;
+	}
+
+	atomic<int> remaining(chunkCount);
+	int queue = GetCurrentQueue();
+
+	{
+		WorkQueue& own = _queues[queue];
+		lock_guard<mutex> lock(own.lock);
+
+		// Pushed last to first, so this thread works through the range from the start while
+		// thieves take chunks from the end
+		for (int chunk = chunkCount - 1; chunk >= 0; chunk--)
+		{
+			Job job;
+			job.body = &body;
+			job.begin = chunk * grainSize;
+			job.end = min(count, job.begin + grainSize);
+			job.remaining = &remaining;
+			own.jobs.push_back(job);
+		}
+	}
+
+	{
+		lock_guard<mutex> lock(_sleepLock);
+		_queuedJobs += chunkCount;
+	}
+	_wake.notify_all();
+
+	// Help out until every chunk is done. The jobs run here may belong to other loops.
+	while (remaining.load(memory_order_acquire) > 0)
+	{
+		if (!RunOneJob(queue))
+			this_thread::yield();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A pool of worker threads that share out loops over object ranges. Every thread has its own
+// queue of jobs. A thread takes the newest job from its own queue and, when that is empty,
+// steals the oldest job from another thread's, so idle threads keep themselves busy without
+// a single shared queue everyone waits on.
+//
+// ParallelFor splits a range into chunks whose bounds depend only on the count and the grain
+// size, never on the number of threads, so as long as each chunk writes its own outputs the
+// results are the same whichever thread runs which chunk.
+class JobSystem
+{
+private:
+	struct Job
+	{
+		const function<void(int, int)> * body;
+		int begin;
+		int end;
+		atomic<int> * remaining;
+	};
+
+	struct WorkQueue
+	{
+		mutex lock;
+		deque<Job> jobs;
+	};
+
+	vector<thread> _workers;
+	// One queue per worker, then one for threads outside the pool that call ParallelFor
+	unique_ptr<WorkQueue[]> _queues;
+	int _queueCount;
+
+	atomic<bool> _quit;
+	atomic<int> _queuedJobs;
+	mutex _sleepLock;
+	condition_variable _wake;
+
+	int GetCurrentQueue() const;
+	bool RunOneJob(int queue);
+	void WorkerLoop(int queue);
+
+public:
+	// With a negative count there is one worker for every hardware thread but the caller's
+	explicit JobSystem(int workerCount = -1);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Worker threads plus the thread that calls ParallelFor, which works too
+	int GetThreadCount() const { return (int)_workers.size() + 1; }
+
+	// Calls body(begin, end) for consecutive chunks of grainSize covering [0, count), spread
+	// over the threads, and returns once every chunk has finished
+	void ParallelFor(int count, int grainSize, const function<void(int, int)>& body);
+};
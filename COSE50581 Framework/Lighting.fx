@@ -1,27 +1,78 @@
-cbuffer cbData
+// Set once per frame
+cbuffer cbFrame : register(b0)
 {
-	float4x4 World;
 	float4x4 View;
 	float4x4 Projection;
 
-	float4 gDiffuseMtrl;
 	float4 gDiffuseLight;
-	float4 gAmbientMtrl;
 	float4 gAmbientLight;
-	float4 gSpecularMtrl;
 	float4 gSpecularLight;
-	float gSpecularPower;
 
 	float3 gEyePosW;
 	float3 gLightVecW;
 };
 
+// Set when the material changes
+cbuffer cbMaterial : register(b1)
+{
+	float4 gDiffuseMtrl;
+	float4 gAmbientMtrl;
+	float4 gSpecularMtrl;
+	float gSpecularPower;
+};
+
+// Set for every object drawn
+cbuffer cbObject : register(b2)
+{
+	float4x4 World;
+};
+
+// Set when a mesh with quantised positions is bound, to map them back from its bounding box
+cbuffer cbMesh : register(b3)
+{
+	float4 gPositionScale;
+	float4 gPositionOffset;
+};
+
 struct VS_IN
 {
 	float4 posL   : POSITION;
 	float3 normalL : NORMAL;
 };
 
+// Used by VSInstanced. Each instance carries the rows of its own world matrix
+struct VS_INSTANCED_IN
+{
+	float4 posL   : POSITION;
+	float3 normalL : NORMAL;
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+};
+
+// Used by VSQuantised, for the QuantisedVertex12 and QuantisedVertex8 formats. The position is
+// read as fractions of the mesh's bounding box, split over two elements since there is no
+// three-component 16-bit format, and the normal as the two coordinates of its octahedral encoding.
+struct VS_QUANTISED_IN
+{
+	float2 posXY : POSITION0;
+	float posZ : POSITION1;
+	float2 normalOct : NORMAL;
+};
+
+// Used by VSInstancedQuantised
+struct VS_INSTANCED_QUANTISED_IN
+{
+	float2 posXY : POSITION0;
+	float posZ : POSITION1;
+	float2 normalOct : NORMAL;
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+};
+
 struct VS_OUT
 {
 	float4 Pos    : SV_POSITION;
@@ -47,6 +98,64 @@ VS_OUT VS(VS_IN vIn)
 	return output;
 }
 
+// The same as VS, but the world matrix comes from the instance data instead of the constant buffer
+VS_OUT VSInstanced(VS_INSTANCED_IN vIn)
+{
+	VS_OUT output = (VS_OUT)0;
+
+	float4x4 world = float4x4(vIn.world0, vIn.world1, vIn.world2, vIn.world3);
+
+	output.Pos = mul(vIn.posL, world);
+	output.PosW = output.Pos.xyz;
+	output.Pos = mul(output.Pos, View);
+	output.Pos = mul(output.Pos, Projection);
+
+	// Convert from local to world normal
+	float3 normalW = mul(float4(vIn.normalL, 0.0f), world).xyz;
+	normalW = normalize(normalW);
+
+	output.Norm = normalW;
+
+	return output;
+}
+
+float3 DecodePosition(float2 posXY, float posZ)
+{
+	return float3(posXY, posZ) * gPositionScale.xyz + gPositionOffset.xyz;
+}
+
+// Unfolds the lower half of the octahedron, as DecodeOctahedral in VertexCompression.cpp does
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+
+	return normalize(n);
+}
+
+VS_OUT VSQuantised(VS_QUANTISED_IN vIn)
+{
+	VS_IN decoded;
+	decoded.posL = float4(DecodePosition(vIn.posXY, vIn.posZ), 1.0f);
+	decoded.normalL = DecodeOctahedral(vIn.normalOct);
+
+	return VS(decoded);
+}
+
+VS_OUT VSInstancedQuantised(VS_INSTANCED_QUANTISED_IN vIn)
+{
+	VS_INSTANCED_IN decoded;
+	decoded.posL = float4(DecodePosition(vIn.posXY, vIn.posZ), 1.0f);
+	decoded.normalL = DecodeOctahedral(vIn.normalOct);
+	decoded.world0 = vIn.world0;
+	decoded.world1 = vIn.world1;
+	decoded.world2 = vIn.world2;
+	decoded.world3 = vIn.world3;
+
+	return VSInstanced(decoded);
+}
+
 float4 PS(VS_OUT pIn) : SV_Target
 {
 	pIn.Norm = normalize(pIn.Norm);
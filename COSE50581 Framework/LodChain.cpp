@@ -0,0 +1,89 @@
+#include "LodChain.h"
+
+#include <cfloat>
+#include <cmath>
+
+const int LodChain::MAX_LEVELS;
+const float LodChain::DEFAULT_EDGE_PIXELS = 12.0f;
+const float LodChain::HYSTERESIS = 0.15f;
+
+LodChain::LodChain()
+{
+	_levelCount = 0;
+	_edgePixels = DEFAULT_EDGE_PIXELS;
+}
+
+LodChain::~LodChain()
+{
+}
+
+void LodChain::SetEdgePixels(float edgePixels)
+{
+	_edgePixels = edgePixels;
+	UpdateScreenRadii();
+}
+
+void LodChain::AddLevel(const MeshGeometry& geometry, const MeshData& meshData)
+{
+	if (_levelCount == MAX_LEVELS)
+		return;
+
+	double edgeLengthSum = 0.0;
+	for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+	{
+		XMVECTOR a = XMLoadFloat3(&geometry.vertices[geometry.indices[i]].Pos);
+		XMVECTOR b = XMLoadFloat3(&geometry.vertices[geometry.indices[i + 1]].Pos);
+		XMVECTOR c = XMLoadFloat3(&geometry.vertices[geometry.indices[i + 2]].Pos);
+
+		edgeLengthSum += XMVectorGetX(XMVector3Length(XMVectorSubtract(b, a))) + XMVectorGetX(XMVector3Length(XMVectorSubtract(c, b))) +
+			XMVectorGetX(XMVector3Length(XMVectorSubtract(a, c)));
+	}
+
+	XMFLOAT3 center;
+	float radius;
+	geometry.GetBounds(center, radius);
+
+	size_t edgeCount = geometry.indices.size() / 3 * 3;
+	_relativeEdgeLengths[_levelCount] = edgeCount > 0 && radius > 0.0f ? (float)(edgeLengthSum / edgeCount) / radius : 0.0f;
+	_levels[_levelCount] = meshData;
+	_levelCount++;
+
+	UpdateScreenRadii();
+}
+
+void LodChain::UpdateScreenRadii()
+{
+	// A level is needed once the next coarser one's edges would be longer than _edgePixels
+	for (int level = 0; level + 1 < _levelCount; level++)
+		_minScreenRadii[level] = _relativeEdgeLengths[level + 1] > 0.0f ? _edgePixels / _relativeEdgeLengths[level + 1] : 0.0f;
+
+	if (_levelCount > 0)
+		_minScreenRadii[_levelCount - 1] = 0.0f;
+}
+
+int LodChain::SelectLevel(float screenRadius, int currentLevel, float hysteresis) const
+{
+	if (_levelCount == 0)
+		return 0;
+
+	int level = currentLevel < 0 ? 0 : (currentLevel >= _levelCount ? _levelCount - 1 : currentLevel);
+
+	// Step to finer levels while the object has grown well past their switch radius, then to
+	// coarser ones while it has shrunk well below the current one's
+	while (level > 0 && screenRadius >= _minScreenRadii[level - 1] * (1.0f + hysteresis))
+		level--;
+
+	while (level + 1 < _levelCount && screenRadius < _minScreenRadii[level] * (1.0f - hysteresis))
+		level++;
+
+	return level;
+}
+
+float LodChain::GetScreenRadius(const SphereBounds& sphere, const XMFLOAT4X4& view, float projectionScale)
+{
+	float depth = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&sphere.Center), XMLoadFloat4x4(&view)));
+	if (depth <= sphere.Radius)
+		return FLT_MAX;
+
+	return sphere.Radius * projectionScale / depth;
+}
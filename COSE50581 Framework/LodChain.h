@@ -0,0 +1,62 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Frustum.h"
+#include "GameObject.h"
+#include "MeshGeometry.h"
+
+using namespace DirectX;
+
+// The levels of detail of one mesh, from the most detailed to the least, and the sizes on screen
+// at which each is drawn. A level is drawn while the mesh's bounding sphere covers at least its
+// switch radius in pixels. The switch radii come from the geometry: the next coarser level takes
+// over once its triangle edges would be no longer than the edge length asked for on screen.
+//
+// The levels are expected to share their bounds, as spheres of the same radius do, since the
+// culling and the asteroid hierarchy don't follow the level an object is drawn with.
+class LodChain
+{
+public:
+	static const int MAX_LEVELS = 8;
+
+	// How long, in pixels, a coarser level's edges may get on screen before the finer one is used
+	static const float DEFAULT_EDGE_PIXELS;
+
+	// A level only changes once the screen radius is this fraction past the switch radius, so
+	// an object sitting on the boundary doesn't flicker between the two
+	static const float HYSTERESIS;
+
+private:
+	int _levelCount;
+	MeshData _levels[MAX_LEVELS];
+	// The average edge length of each level, as a fraction of its bounding radius
+	float _relativeEdgeLengths[MAX_LEVELS];
+	float _minScreenRadii[MAX_LEVELS];
+	float _edgePixels;
+
+	void UpdateScreenRadii();
+
+public:
+	LodChain();
+	~LodChain();
+
+	void SetEdgePixels(float edgePixels);
+
+	// Adds a level less detailed than the ones before it. meshData draws the geometry. Levels
+	// past MAX_LEVELS are ignored.
+	void AddLevel(const MeshGeometry& geometry, const MeshData& meshData);
+
+	int GetLevelCount() const { return _levelCount; }
+	const MeshData& GetLevel(int level) const { return _levels[level]; }
+	int GetTriangleCount(int level) const { return (int)_levels[level].IndexCount / 3; }
+	// The smallest screen radius, in pixels, the level is drawn at. The last level's is 0.
+	float GetMinScreenRadius(int level) const { return _minScreenRadii[level]; }
+
+	// The level to draw at the given screen radius, moving from currentLevel only once the
+	// radius is hysteresis past the switch radius
+	int SelectLevel(float screenRadius, int currentLevel, float hysteresis = HYSTERESIS) const;
+
+	// The radius in pixels of a sphere seen through the view, where projectionScale is the
+	// projection's y scale times half the viewport's height. Spheres reaching the eye give FLT_MAX.
+	static float GetScreenRadius(const SphereBounds& sphere, const XMFLOAT4X4& view, float projectionScale);
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "RenderDevice.h"
+
+using namespace std;
+
+// A RenderDevice that writes a line of text for every call it receives. Constant and instance
+// data are logged as a hash of their bytes, so two logs are equal only when the same calls were
+// made with the same data in the same order.
+class LoggingRenderDevice : public RenderDevice
+{
+private:
+	string _log;
+
+	static uint64_t Hash(const void * data, int size)
+	{
+		const unsigned char * bytes = static_cast<const unsigned char *>(data);
+		uint64_t hash = 14695981039346656037ull;
+
+		for (int i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+		return hash;
+	}
+
+	void Write(const char * line)
+	{
+		_log += line;
+		_log += '\n';
+	}
+
+public:
+	void SetRasterizerState(int rasterizerState) override
+	{
+		char line[64];
+		snprintf(line, sizeof(line), "SetRasterizerState %d", rasterizerState);
+		Write(line);
+	}
+
+	void SetShader(int shader) override
+	{
+		char line[64];
+		snprintf(line, sizeof(line), "SetShader %d", shader);
+		Write(line);
+	}
+
+	void SetMesh(const MeshData& meshData) override
+	{
+		char line[128];
+		snprintf(line, sizeof(line), "SetMesh %p %p %u %u %u", (void *)meshData.VertexBuffer, (void *)meshData.IndexBuffer,
+			meshData.VBStride, meshData.VBOffset, meshData.IndexCount);
+		Write(line);
+	}
+
+	void DrawIndexed(int indexCount) override
+	{
+		char line[64];
+		snprintf(line, sizeof(line), "DrawIndexed %d", indexCount);
+		Write(line);
+	}
+
+	void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override
+	{
+		char line[96];
+		snprintf(line, sizeof(line), "UpdateConstantBuffer %d %d %016llx", slot, size, (unsigned long long)Hash(data, size));
+		Write(line);
+	}
+
+	void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) override
+	{
+		char line[96];
+		snprintf(line, sizeof(line), "UpdateInstanceBuffer %d %016llx", count, (unsigned long long)Hash(worlds, count * (int)sizeof(XMFLOAT4X4)));
+		Write(line);
+	}
+
+	void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) override
+	{
+		char line[128];
+		snprintf(line, sizeof(line), "DrawIndexedInstanced %p %u %d %d", (void *)meshData.VertexBuffer, meshData.IndexCount, instanceCount, startInstance);
+		Write(line);
+	}
+
+	void Clear() { _log.clear(); }
+
+	const string& GetLog() const { return _log; }
+};
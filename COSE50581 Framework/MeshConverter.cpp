@@ -0,0 +1,72 @@
+// Converts a Wavefront OBJ file into a mesh file that the application can map and upload
+// without parsing. The triangles and vertices are reordered for the GPU's caches first, unless
+// -nooptimize is given.
+//
+// Usage: MeshConverter [-nooptimize] input.obj output.mesh
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	bool optimize = !(argc == 4 && strcmp(argv[1], "-nooptimize") == 0);
+	if (argc != (optimize ? 3 : 4))
+	{
+		fprintf(stderr, "Usage: %s [-nooptimize] input.obj output.mesh\n", argv[0]);
+		return 1;
+	}
+
+	const char * inputPath = argv[argc - 2];
+	const char * outputPath = argv[argc - 1];
+
+	auto start = chrono::steady_clock::now();
+
+	MeshAsset asset;
+	string error;
+	if (!LoadObj(inputPath, asset, error))
+	{
+		fprintf(stderr, "%s: %s\n", inputPath, error.c_str());
+		return 1;
+	}
+
+	if (optimize)
+	{
+		VertexCacheStats before = AnalyzeVertexCache(asset.indices.data(), asset.indices.size(), asset.vertices.size(), sizeof(SimpleVertex));
+		OptimizeMesh(asset);
+		VertexCacheStats after = AnalyzeVertexCache(asset.indices.data(), asset.indices.size(), asset.vertices.size(), sizeof(SimpleVertex));
+
+		printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr,
+			before.overfetch, after.overfetch);
+	}
+
+	if (!WriteMeshFile(outputPath, asset, error))
+	{
+		fprintf(stderr, "%s: %s\n", outputPath, error.c_str());
+		return 1;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Read the file back to check it, and to report its bounds
+	MeshFile meshFile;
+	if (!meshFile.Open(outputPath))
+	{
+		fprintf(stderr, "%s: %s\n", outputPath, meshFile.GetError().c_str());
+		return 1;
+	}
+
+	const MeshFileHeader& header = meshFile.GetHeader();
+	printf("%s: %u vertices, %u triangles, %u submeshes, %u-bit indices, %llu bytes, %.3f s\n", outputPath, header.vertexCount,
+		header.indexCount / 3, header.submeshCount, header.indexSize * 8, (unsigned long long)header.fileSize, seconds);
+	printf("bounds: centre (%g, %g, %g) radius %g\n", header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2],
+		header.boundsRadius);
+
+	return 0;
+}
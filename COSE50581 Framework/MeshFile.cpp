@@ -0,0 +1,394 @@
+#include "MeshFile.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int VertexFormat::MAX_ATTRIBUTES;
+const uint32_t MeshFileHeader::VERSION;
+const uint32_t MeshFileHeader::DATA_ALIGNMENT;
+
+static const char MESH_FILE_MAGIC[8] = { 'S', 'S', 'M', 'E', 'S', 'H', 0, 0 };
+
+static_assert(sizeof(MeshFileHeader) == 144, "The mesh file header is written as it is laid out in memory");
+static_assert(sizeof(MeshFileSubmesh) == 24, "Submeshes are written as they are laid out in memory");
+static_assert(sizeof(SimpleVertex) == 24, "Vertices are written as they are laid out in memory");
+
+bool VertexFormat::operator==(const VertexFormat& other) const
+{
+	if (stride != other.stride || attributeCount != other.attributeCount)
+		return false;
+
+	for (uint32_t i = 0; i < attributeCount && i < (uint32_t)MAX_ATTRIBUTES; i++)
+	{
+		if (attributes[i].semantic != other.attributes[i].semantic || attributes[i].format != other.attributes[i].format ||
+			attributes[i].offset != other.attributes[i].offset)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+VertexFormat VertexFormat::SimpleVertexFormat()
+{
+	VertexFormat format;
+	memset(&format, 0, sizeof(format));
+	format.stride = sizeof(SimpleVertex);
+	format.attributeCount = 2;
+	format.attributes[0].semantic = VERTEX_POSITION;
+	format.attributes[0].format = VERTEX_FLOAT3;
+	format.attributes[0].offset = offsetof(SimpleVertex, Pos);
+	format.attributes[1].semantic = VERTEX_NORMAL;
+	format.attributes[1].format = VERTEX_FLOAT3;
+	format.attributes[1].offset = offsetof(SimpleVertex, Normal);
+	return format;
+}
+
+namespace
+{
+	uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + MeshFileHeader::DATA_ALIGNMENT - 1) & ~(uint64_t)(MeshFileHeader::DATA_ALIGNMENT - 1);
+	}
+
+	// The same sphere MeshGeometry::GetBounds gives: the centre of the box, and the distance from
+	// it to the furthest vertex. Also returns the box.
+	void GetBounds(const MeshAsset& asset, uint32_t firstIndex, uint32_t indexCount, bool wholeMesh, float center[3],
+		float& radius, float boundsMin[3], float boundsMax[3])
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = FLT_MAX;
+			boundsMax[axis] = -FLT_MAX;
+		}
+
+		size_t count = wholeMesh ? asset.vertices.size() : indexCount;
+		for (size_t i = 0; i < count; i++)
+		{
+			const XMFLOAT3& position = asset.vertices[wholeMesh ? i : asset.indices[firstIndex + i]].Pos;
+			const float coordinates[3] = { position.x, position.y, position.z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				boundsMin[axis] = fminf(boundsMin[axis], coordinates[axis]);
+				boundsMax[axis] = fmaxf(boundsMax[axis], coordinates[axis]);
+			}
+		}
+
+		if (count == 0)
+		{
+			for (int axis = 0; axis < 3; axis++)
+				boundsMin[axis] = boundsMax[axis] = 0.0f;
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+			center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			const XMFLOAT3& position = asset.vertices[wholeMesh ? i : asset.indices[firstIndex + i]].Pos;
+			float x = position.x - center[0];
+			float y = position.y - center[1];
+			float z = position.z - center[2];
+			radiusSquared = fmaxf(radiusSquared, x * x + y * y + z * z);
+		}
+
+		radius = sqrtf(radiusSquared);
+	}
+}
+
+bool WriteMeshFile(const char * path, const MeshAsset& asset, string& error)
+{
+	for (uint32_t index : asset.indices)
+	{
+		if (index >= asset.vertices.size())
+		{
+			error = "an index is past the last vertex";
+			return false;
+		}
+	}
+
+	vector<MeshFileSubmesh> submeshes = asset.submeshes;
+	if (submeshes.empty())
+	{
+		MeshFileSubmesh whole = {};
+		whole.indexCount = (uint32_t)asset.indices.size();
+		submeshes.push_back(whole);
+	}
+
+	float unusedMin[3], unusedMax[3];
+	for (MeshFileSubmesh& submesh : submeshes)
+	{
+		if ((uint64_t)submesh.firstIndex + submesh.indexCount > asset.indices.size())
+		{
+			error = "a submesh runs past the last index";
+			return false;
+		}
+
+		GetBounds(asset, submesh.firstIndex, submesh.indexCount, false, submesh.boundsCenter, submesh.boundsRadius,
+			unusedMin, unusedMax);
+	}
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version = MeshFileHeader::VERSION;
+	header.headerSize = sizeof(MeshFileHeader);
+	header.vertexFormat = VertexFormat::SimpleVertexFormat();
+	header.vertexCount = (uint32_t)asset.vertices.size();
+	header.indexCount = (uint32_t)asset.indices.size();
+	header.indexSize = asset.vertices.size() <= 65536 ? 2 : 4;
+	header.submeshCount = (uint32_t)submeshes.size();
+	header.vertexDataOffset = AlignUp(sizeof(MeshFileHeader));
+	header.indexDataOffset = AlignUp(header.vertexDataOffset + (uint64_t)header.vertexCount * header.vertexFormat.stride);
+	header.submeshDataOffset = AlignUp(header.indexDataOffset + (uint64_t)header.indexCount * header.indexSize);
+	header.fileSize = header.submeshDataOffset + (uint64_t)header.submeshCount * sizeof(MeshFileSubmesh);
+	GetBounds(asset, 0, 0, true, header.boundsCenter, header.boundsRadius, header.boundsMin, header.boundsMax);
+
+	FILE * file = fopen(path, "wb");
+	if (!file)
+	{
+		error = string("could not create ") + path;
+		return false;
+	}
+
+	static const uint8_t padding[MeshFileHeader::DATA_ALIGNMENT] = {};
+	uint64_t written = 0;
+	bool ok = true;
+
+	auto write = [&](const void * data, uint64_t size)
+	{
+		ok = ok && fwrite(data, 1, (size_t)size, file) == size;
+		written += size;
+	};
+	auto pad = [&](uint64_t offset) { write(padding, offset - written); };
+
+	write(&header, sizeof(header));
+	pad(header.vertexDataOffset);
+	write(asset.vertices.data(), (uint64_t)asset.vertices.size() * sizeof(SimpleVertex));
+	pad(header.indexDataOffset);
+
+	if (header.indexSize == 2)
+	{
+		vector<uint16_t> shortIndices(asset.indices.begin(), asset.indices.end());
+		write(shortIndices.data(), (uint64_t)shortIndices.size() * sizeof(uint16_t));
+	}
+	else
+	{
+		write(asset.indices.data(), (uint64_t)asset.indices.size() * sizeof(uint32_t));
+	}
+
+	pad(header.submeshDataOffset);
+	write(submeshes.data(), (uint64_t)submeshes.size() * sizeof(MeshFileSubmesh));
+
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		error = string("could not write ") + path;
+
+	return ok;
+}
+
+MeshFile::MeshFile()
+{
+	_data = nullptr;
+	_size = 0;
+#ifdef _WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+#else
+	_file = -1;
+#endif
+}
+
+MeshFile::~MeshFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MeshFile::Open(const char * path)
+{
+	Close();
+
+	_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_error = string("could not open ") + path;
+		return false;
+	}
+
+	return MapFile() && Validate();
+}
+
+bool MeshFile::Open(const wchar_t * path)
+{
+	Close();
+
+	_file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_error = "could not open the file";
+		return false;
+	}
+
+	return MapFile() && Validate();
+}
+
+bool MeshFile::MapFile()
+{
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || (uint64_t)size.QuadPart < sizeof(MeshFileHeader))
+	{
+		_error = "the file is too small to be a mesh file";
+		Close();
+		return false;
+	}
+
+	_size = (size_t)size.QuadPart;
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	_data = _mapping ? static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+	if (!_data)
+	{
+		_error = "could not map the file";
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFile::Close()
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+
+	_data = nullptr;
+	_size = 0;
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+}
+#else
+bool MeshFile::Open(const char * path)
+{
+	Close();
+
+	_file = open(path, O_RDONLY);
+	if (_file < 0)
+	{
+		_error = string("could not open ") + path;
+		return false;
+	}
+
+	return MapFile() && Validate();
+}
+
+bool MeshFile::MapFile()
+{
+	struct stat status;
+	if (fstat(_file, &status) != 0 || (uint64_t)status.st_size < sizeof(MeshFileHeader))
+	{
+		_error = "the file is too small to be a mesh file";
+		Close();
+		return false;
+	}
+
+	void * data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, _file, 0);
+	if (data == MAP_FAILED)
+	{
+		_error = "could not map the file";
+		Close();
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_size = (size_t)status.st_size;
+	return true;
+}
+
+void MeshFile::Close()
+{
+	if (_data)
+		munmap(const_cast<uint8_t *>(_data), _size);
+	if (_file >= 0)
+		close(_file);
+
+	_data = nullptr;
+	_size = 0;
+	_file = -1;
+}
+#endif
+
+bool MeshFile::Validate()
+{
+	const MeshFileHeader& header = GetHeader();
+	const char * problem = nullptr;
+
+	auto fits = [this](uint64_t offset, uint64_t size) { return offset <= _size && size <= _size - offset; };
+
+	if (memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) != 0)
+		problem = "not a mesh file";
+	else if (header.version != MeshFileHeader::VERSION)
+		problem = "unsupported mesh file version";
+	else if (header.headerSize != sizeof(MeshFileHeader))
+		problem = "unexpected header size";
+	else if (header.indexSize != 2 && header.indexSize != 4)
+		problem = "indices must be 2 or 4 bytes";
+	else if (header.vertexFormat.stride == 0 || header.vertexFormat.attributeCount > (uint32_t)VertexFormat::MAX_ATTRIBUTES)
+		problem = "bad vertex format";
+	else if (header.fileSize != _size)
+		problem = "the file is truncated";
+	else if (header.vertexDataOffset % MeshFileHeader::DATA_ALIGNMENT || header.indexDataOffset % MeshFileHeader::DATA_ALIGNMENT ||
+		header.submeshDataOffset % MeshFileHeader::DATA_ALIGNMENT)
+		problem = "data is not aligned";
+	else if (!fits(header.vertexDataOffset, (uint64_t)header.vertexCount * header.vertexFormat.stride) ||
+		!fits(header.indexDataOffset, (uint64_t)header.indexCount * header.indexSize) ||
+		!fits(header.submeshDataOffset, (uint64_t)header.submeshCount * sizeof(MeshFileSubmesh)))
+		problem = "data runs past the end of the file";
+
+	for (uint32_t i = 0; !problem && i < header.submeshCount; i++)
+	{
+		if ((uint64_t)GetSubmeshes()[i].firstIndex + GetSubmeshes()[i].indexCount > header.indexCount)
+			problem = "a submesh runs past the last index";
+	}
+
+	// The indices themselves aren't checked, since that would read the whole index buffer. The
+	// GPU clamps out of range vertex fetches, and the converter never writes them.
+	if (problem)
+	{
+		_error = problem;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshFile::GetGeometry(MeshGeometry& geometry) const
+{
+	const MeshFileHeader& header = GetHeader();
+	if (header.vertexFormat != VertexFormat::SimpleVertexFormat() || header.indexSize != 2)
+		return false;
+
+	const SimpleVertex * vertices = static_cast<const SimpleVertex *>(GetVertexData());
+	const unsigned short * indices = static_cast<const unsigned short *>(GetIndexData());
+	geometry.vertices.assign(vertices, vertices + header.vertexCount);
+	geometry.indices.assign(indices, indices + header.indexCount);
+	return true;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshGeometry.h"
+
+using namespace std;
+
+// A mesh file holds one mesh ready to upload: a header, then the vertex, index and submesh data,
+// each starting on a 64 byte boundary. The data is laid out exactly as the vertex and index
+// buffers want it, so a mapped file can be handed to buffer creation without being copied or
+// parsed. Everything is little endian.
+
+enum VertexAttributeSemantic
+{
+	VERTEX_POSITION,
+	VERTEX_NORMAL,
+	VERTEX_TEXCOORD
+};
+
+enum VertexAttributeFormat
+{
+	VERTEX_FLOAT2,
+	VERTEX_FLOAT3,
+	VERTEX_FLOAT4
+};
+
+struct VertexAttribute
+{
+	uint8_t semantic;
+	uint8_t format;
+	// Byte offset of the attribute in the vertex
+	uint16_t offset;
+};
+
+// Describes the layout of one vertex, so a loader can check it draws the format it's given
+struct VertexFormat
+{
+	static const int MAX_ATTRIBUTES = 8;
+
+	uint32_t stride;
+	uint32_t attributeCount;
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+
+	bool operator==(const VertexFormat& other) const;
+	bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+
+	// The format of SimpleVertex, which Lighting.fx draws
+	static VertexFormat SimpleVertexFormat();
+};
+
+// A range of the index data drawn as one piece, such as a group or material in the source file
+struct MeshFileSubmesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float boundsCenter[3];
+	float boundsRadius;
+};
+
+struct MeshFileHeader
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t DATA_ALIGNMENT = 64;
+
+	// "SSMESH" followed by two zero bytes
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+
+	VertexFormat vertexFormat;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// 2 or 4 bytes. Indices are stored in 16 bits whenever every vertex can be reached with them.
+	uint32_t indexSize;
+	uint32_t submeshCount;
+
+	uint64_t vertexDataOffset;
+	uint64_t indexDataOffset;
+	uint64_t submeshDataOffset;
+	uint64_t fileSize;
+
+	// A sphere and a box around every vertex
+	float boundsCenter[3];
+	float boundsRadius;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+// A mesh as it is built before being written, with 32-bit indices
+struct MeshAsset
+{
+	vector<SimpleVertex> vertices;
+	vector<uint32_t> indices;
+	// When there are none, the whole mesh is written as one submesh
+	vector<MeshFileSubmesh> submeshes;
+};
+
+// Writes the asset as a mesh file, working out the bounds of the mesh and each submesh
+bool WriteMeshFile(const char * path, const MeshAsset& asset, string& error);
+
+// A mesh file mapped read only into memory. The pointers it gives out point into the mapping,
+// and stay valid until the file is closed.
+class MeshFile
+{
+private:
+	const uint8_t * _data;
+	size_t _size;
+	string _error;
+
+#ifdef _WIN32
+	void * _file;
+	void * _mapping;
+#else
+	int _file;
+#endif
+
+	// Maps the whole of the open file
+	bool MapFile();
+	bool Validate();
+
+public:
+	MeshFile();
+	~MeshFile();
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	// Maps the file and checks its header. On failure GetError says why.
+	bool Open(const char * path);
+#ifdef _WIN32
+	bool Open(const wchar_t * path);
+#endif
+	void Close();
+
+	bool IsOpen() const { return _data != nullptr; }
+	const string& GetError() const { return _error; }
+
+	const MeshFileHeader& GetHeader() const { return *reinterpret_cast<const MeshFileHeader *>(_data); }
+	const void * GetVertexData() const { return _data + GetHeader().vertexDataOffset; }
+	const void * GetIndexData() const { return _data + GetHeader().indexDataOffset; }
+	const MeshFileSubmesh * GetSubmeshes() const { return reinterpret_cast<const MeshFileSubmesh *>(_data + GetHeader().submeshDataOffset); }
+
+	size_t GetVertexDataSize() const { return (size_t)GetHeader().vertexCount * GetHeader().vertexFormat.stride; }
+	size_t GetIndexDataSize() const { return (size_t)GetHeader().indexCount * GetHeader().indexSize; }
+
+	// Copies the mesh out as MeshGeometry, for meshes of SimpleVertex with 16-bit indices
+	bool GetGeometry(MeshGeometry& geometry) const;
+};
@@ -0,0 +1,246 @@
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+// The cube and the plane are both boxes with one vertex per corner, so they share their indices
+static const unsigned short boxIndices[] =
+{
+	//Front
+	0, 1, 2,
+	2, 1, 3,
+	//Left Side
+	4, 0, 6,
+	6, 0, 2,
+	//Back
+	5, 4, 6,
+	5, 6, 7,
+	//Right Side
+	3, 1, 5,
+	3, 5, 7,
+	//Top
+	4, 5, 1,
+	4, 1, 0,
+	//Bottom
+	6, 3, 7,
+	6, 2, 3
+};
+
+void MeshGeometry::GetBounds(XMFLOAT3& center, float& radius) const
+{
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (const SimpleVertex& vertex : vertices)
+	{
+		boundsMin.x = fminf(boundsMin.x, vertex.Pos.x);
+		boundsMin.y = fminf(boundsMin.y, vertex.Pos.y);
+		boundsMin.z = fminf(boundsMin.z, vertex.Pos.z);
+		boundsMax.x = fmaxf(boundsMax.x, vertex.Pos.x);
+		boundsMax.y = fmaxf(boundsMax.y, vertex.Pos.y);
+		boundsMax.z = fmaxf(boundsMax.z, vertex.Pos.z);
+	}
+
+	center = XMFLOAT3((boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f);
+
+	float radiusSquared = 0.0f;
+	for (const SimpleVertex& vertex : vertices)
+	{
+		float x = vertex.Pos.x - center.x;
+		float y = vertex.Pos.y - center.y;
+		float z = vertex.Pos.z - center.z;
+		radiusSquared = fmaxf(radiusSquared, x * x + y * y + z * z);
+	}
+
+	radius = sqrtf(radiusSquared);
+}
+
+MeshGeometry CreateCubeGeometry()
+{
+	MeshGeometry geometry;
+
+	// The normals point out through the corners, which smooths the lighting over the cube
+	geometry.vertices =
+	{	// Top Left - v0
+		{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT3(-1.0f, 1.0f, -1.0f) },
+		// Top right - v1
+		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, -1.0f) },
+		// Bottom left - v2
+		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, -1.0f, -1.0f) },
+		// Bottom right - v3
+		{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, -1.0f, -1.0f) },
+		// Top left Z=1 - v4
+		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(-1.0f, 1.0f, 1.0f) },
+		// Top right Z=1 - v5
+		{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) },
+		// Bottom left Z=1 - v6
+		{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT3(-1.0f, -1.0f, 1.0f) },
+		// Bottom right Z=1 - v7
+		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(1.0f, -1.0f, 1.0f) },
+	};
+
+	geometry.indices.assign(boxIndices, boxIndices + sizeof(boxIndices) / sizeof(boxIndices[0]));
+
+	return geometry;
+}
+
+MeshGeometry CreatePlaneGeometry()
+{
+	MeshGeometry geometry;
+
+	geometry.vertices =
+	{	// Top Left - v0
+		{ XMFLOAT3(-100.0f, -99.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Top right - v1
+		{ XMFLOAT3(100.0f, -99.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Bottom left - v2
+		{ XMFLOAT3(-100.0f, -100.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Bottom right - v3
+		{ XMFLOAT3(100.0f, -100.0f, -100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Top left Z=1 - v4
+		{ XMFLOAT3(-100.0f, -99.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Top right Z=1 - v5
+		{ XMFLOAT3(100.0f, -99.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Bottom left Z=1 - v6
+		{ XMFLOAT3(-100.0f, -100.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		// Bottom right Z=1 - v7
+		{ XMFLOAT3(100.0f, -100.0f, 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+	};
+
+	geometry.indices.assign(boxIndices, boxIndices + sizeof(boxIndices) / sizeof(boxIndices[0]));
+
+	return geometry;
+}
+
+MeshGeometry CreateUVSphereGeometry(int stacks, int slices)
+{
+	MeshGeometry geometry;
+	stacks = (std::max)(stacks, 2);
+	slices = (std::max)(slices, 3);
+
+	// On a unit sphere each vertex's normal is its position
+	auto addVertex = [&geometry](float x, float y, float z)
+	{
+		SimpleVertex vertex = { XMFLOAT3(x, y, z), XMFLOAT3(x, y, z) };
+		geometry.vertices.push_back(vertex);
+	};
+
+	addVertex(0.0f, 1.0f, 0.0f);
+	for (int stack = 1; stack < stacks; stack++)
+	{
+		float theta = XM_PI * stack / stacks;
+		for (int slice = 0; slice < slices; slice++)
+		{
+			float phi = XM_2PI * slice / slices;
+			addVertex(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+		}
+	}
+	addVertex(0.0f, -1.0f, 0.0f);
+
+	unsigned short top = 0;
+	unsigned short bottom = (unsigned short)(geometry.vertices.size() - 1);
+	auto ringVertex = [slices](int ring, int slice) { return (unsigned short)(1 + ring * slices + slice % slices); };
+
+	// Clockwise seen from outside, as the cube's triangles are
+	for (int slice = 0; slice < slices; slice++)
+	{
+		unsigned short fan[3] = { top, ringVertex(0, slice + 1), ringVertex(0, slice) };
+		geometry.indices.insert(geometry.indices.end(), fan, fan + 3);
+	}
+
+	for (int ring = 0; ring + 1 < stacks - 1; ring++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			unsigned short a = ringVertex(ring, slice);
+			unsigned short b = ringVertex(ring, slice + 1);
+			unsigned short c = ringVertex(ring + 1, slice);
+			unsigned short d = ringVertex(ring + 1, slice + 1);
+			unsigned short quad[6] = { a, b, c, b, d, c };
+			geometry.indices.insert(geometry.indices.end(), quad, quad + 6);
+		}
+	}
+
+	for (int slice = 0; slice < slices; slice++)
+	{
+		unsigned short fan[3] = { ringVertex(stacks - 2, slice), ringVertex(stacks - 2, slice + 1), bottom };
+		geometry.indices.insert(geometry.indices.end(), fan, fan + 3);
+	}
+
+	return geometry;
+}
+
+MeshGeometry CreateIcosphereGeometry(int subdivisions)
+{
+	// The icosahedron's corners lie on three golden rectangles
+	const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+	const XMFLOAT3 corners[12] =
+	{
+		XMFLOAT3(-1.0f, t, 0.0f), XMFLOAT3(1.0f, t, 0.0f), XMFLOAT3(-1.0f, -t, 0.0f), XMFLOAT3(1.0f, -t, 0.0f),
+		XMFLOAT3(0.0f, -1.0f, t), XMFLOAT3(0.0f, 1.0f, t), XMFLOAT3(0.0f, -1.0f, -t), XMFLOAT3(0.0f, 1.0f, -t),
+		XMFLOAT3(t, 0.0f, -1.0f), XMFLOAT3(t, 0.0f, 1.0f), XMFLOAT3(-t, 0.0f, -1.0f), XMFLOAT3(-t, 0.0f, 1.0f),
+	};
+	static const unsigned short faces[] =
+	{
+		0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+		1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+		3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+		4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+	};
+
+	MeshGeometry geometry;
+
+	auto addVertex = [&geometry](FXMVECTOR position)
+	{
+		SimpleVertex vertex;
+		XMStoreFloat3(&vertex.Pos, XMVector3Normalize(position));
+		vertex.Normal = vertex.Pos;
+		geometry.vertices.push_back(vertex);
+		return (unsigned short)(geometry.vertices.size() - 1);
+	};
+
+	for (const XMFLOAT3& corner : corners)
+		addVertex(XMLoadFloat3(&corner));
+
+	// The faces are clockwise seen from outside, as the cube's are, and splitting keeps that
+	geometry.indices.assign(faces, faces + sizeof(faces) / sizeof(faces[0]));
+
+	for (int level = 0; level < subdivisions; level++)
+	{
+		// Triangles sharing an edge share the vertex made at its middle
+		unordered_map<unsigned int, unsigned short> midpoints;
+		auto midpoint = [&](unsigned short a, unsigned short b)
+		{
+			unsigned int key = a < b ? ((unsigned int)a << 16) | b : ((unsigned int)b << 16) | a;
+			auto found = midpoints.find(key);
+			if (found != midpoints.end())
+				return found->second;
+
+			unsigned short vertex = addVertex(XMVectorAdd(XMLoadFloat3(&geometry.vertices[a].Pos), XMLoadFloat3(&geometry.vertices[b].Pos)));
+			midpoints.emplace(key, vertex);
+			return vertex;
+		};
+
+		vector<unsigned short> indices;
+		indices.reserve(geometry.indices.size() * 4);
+
+		for (size_t i = 0; i < geometry.indices.size(); i += 3)
+		{
+			unsigned short a = geometry.indices[i];
+			unsigned short b = geometry.indices[i + 1];
+			unsigned short c = geometry.indices[i + 2];
+			unsigned short ab = midpoint(a, b);
+			unsigned short bc = midpoint(b, c);
+			unsigned short ca = midpoint(c, a);
+
+			unsigned short split[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+			indices.insert(indices.end(), split, split + 12);
+		}
+
+		geometry.indices.swap(indices);
+	}
+
+	return geometry;
+}
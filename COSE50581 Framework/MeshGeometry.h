@@ -0,0 +1,41 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+using namespace std;
+
+// The vertex format read by Lighting.fx
+struct SimpleVertex
+{
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+};
+
+// A mesh's vertices and indices on the CPU, as they are uploaded to its vertex and index buffers
+struct MeshGeometry
+{
+	vector<SimpleVertex> vertices;
+	vector<unsigned short> indices;
+
+	// A sphere around every vertex: the centre of their bounding box, and the distance from it
+	// to the furthest vertex
+	void GetBounds(XMFLOAT3& center, float& radius) const;
+};
+
+// The cube every body in the solar system is drawn with, 2 units across
+MeshGeometry CreateCubeGeometry();
+
+// The ground plane, a 200 x 1 x 200 slab 100 units below the origin
+MeshGeometry CreatePlaneGeometry();
+
+// A sphere of radius 1 made of stacks bands from pole to pole, each cut into slices around the
+// y axis. It has (stacks - 1) * slices + 2 vertices and 2 * (stacks - 1) * slices triangles.
+MeshGeometry CreateUVSphereGeometry(int stacks, int slices);
+
+// A sphere of radius 1 made by splitting each triangle of an icosahedron into four, subdivisions
+// times, and pushing the new vertices out onto the sphere. It has 20 * 4^subdivisions triangles,
+// all about the same size, so it needs fewer than a UV sphere for the same roundness. Up to 6
+// subdivisions fit 16-bit indices.
+MeshGeometry CreateIcosphereGeometry(int subdivisions);
@@ -0,0 +1,420 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// The cache Forsyth's scores assume. Larger than the hardware's, so the order keeps working
+	// on bigger caches too.
+	const int SCORING_CACHE_SIZE = 32;
+	const int MAX_SCORED_VALENCE = 32;
+
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// Vertex fetch is measured through a 128 KB cache of 64 byte lines
+	const int CACHE_LINE_SIZE = 64;
+	const int ANALYSIS_LINE_CACHE_SIZE = 2048;
+
+	// How much a vertex is worth drawing next: more the more recently it was used, and more the
+	// fewer triangles it has left, so that lone triangles aren't left behind
+	class VertexScorer
+	{
+	private:
+		float _cacheScores[SCORING_CACHE_SIZE];
+		float _valenceScores[MAX_SCORED_VALENCE + 1];
+
+	public:
+		VertexScorer()
+		{
+			for (int position = 0; position < SCORING_CACHE_SIZE; position++)
+			{
+				// The last triangle's vertices get a fixed score, so its own triangles aren't
+				// preferred over the ones around it
+				_cacheScores[position] = position < 3 ? LAST_TRIANGLE_SCORE :
+					powf(1.0f - (position - 3) / (float)(SCORING_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+
+			for (int valence = 1; valence <= MAX_SCORED_VALENCE; valence++)
+				_valenceScores[valence] = VALENCE_BOOST_SCALE * powf((float)valence, -VALENCE_BOOST_POWER);
+			_valenceScores[0] = 0.0f;
+		}
+
+		float Score(int cachePosition, unsigned int remainingTriangles) const
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = cachePosition >= 0 ? _cacheScores[cachePosition] : 0.0f;
+			return score + (remainingTriangles <= (unsigned int)MAX_SCORED_VALENCE ? _valenceScores[remainingTriangles] :
+				VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER));
+		}
+	};
+
+	// Counts the misses each triangle has in a FIFO cache. A vertex is still cached while fewer
+	// than cacheSize misses have happened since it was loaded.
+	class FifoCache
+	{
+	private:
+		vector<unsigned int> _loadedAt;
+		unsigned int _time;
+		unsigned int _size;
+
+	public:
+		FifoCache(size_t vertexCount, unsigned int size) : _loadedAt(vertexCount, 0), _time(size + 1), _size(size) {}
+
+		bool Access(uint32_t vertex)
+		{
+			if (_time - _loadedAt[vertex] <= _size)
+				return true;
+
+			_loadedAt[vertex] = _time++;
+			return false;
+		}
+
+		// Empties the cache, as drawing something else in between would
+		void Flush()
+		{
+			_time += _size + 1;
+		}
+	};
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t vertexCount, size_t vertexStride)
+{
+	FifoCache transformCache(vertexCount, ANALYSIS_CACHE_SIZE);
+
+	size_t lineCount = (vertexCount * vertexStride + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+	FifoCache lineCache(lineCount, ANALYSIS_LINE_CACHE_SIZE);
+
+	vector<unsigned char> used(vertexCount, 0);
+	size_t usedCount = 0;
+	size_t misses = 0;
+	size_t linesFetched = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t vertex = indices[i];
+
+		if (!used[vertex])
+		{
+			used[vertex] = 1;
+			usedCount++;
+		}
+
+		if (transformCache.Access(vertex))
+			continue;
+
+		misses++;
+
+		// Only vertices that miss the transform cache are fetched
+		size_t firstLine = vertex * vertexStride / CACHE_LINE_SIZE;
+		size_t lastLine = ((vertex + 1) * vertexStride - 1) / CACHE_LINE_SIZE;
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			if (!lineCache.Access((uint32_t)line))
+				linesFetched++;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indexCount ? misses / (indexCount / 3.0) : 0.0;
+	stats.atvr = usedCount ? misses / (double)usedCount : 0.0;
+	stats.overfetch = usedCount ? linesFetched * CACHE_LINE_SIZE / (double)(usedCount * vertexStride) : 0.0;
+	return stats;
+}
+
+void OptimizeVertexCache(uint32_t * indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	static const VertexScorer scorer;
+
+	// The triangles around each vertex, as ranges of one shared array. A vertex's range shrinks as
+	// its triangles are drawn.
+	vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		adjacencyStart[vertex + 1] = adjacencyStart[vertex] + remaining[vertex];
+
+	vector<uint32_t> adjacency(triangleCount * 3);
+	vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+			adjacency[fill[indices[triangle * 3 + corner]]++] = (uint32_t)triangle;
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		vertexScores[vertex] = scorer.Score(-1, remaining[vertex]);
+
+	vector<float> triangleScores(triangleCount);
+	vector<unsigned char> drawn(triangleCount, 0);
+
+	size_t bestTriangle = 0;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const uint32_t * corners = &indices[triangle * 3];
+		triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+
+		if (triangleScores[triangle] > triangleScores[bestTriangle])
+			bestTriangle = triangle;
+	}
+
+	vector<uint32_t> order;
+	order.reserve(indexCount);
+
+	// Room for the cache plus the three vertices pushed in by each triangle
+	vector<uint32_t> cache;
+	vector<uint32_t> nextCache;
+	cache.reserve(SCORING_CACHE_SIZE + 3);
+	nextCache.reserve(SCORING_CACHE_SIZE + 3);
+
+	size_t searchCursor = 0;
+
+	while (order.size() < triangleCount * 3)
+	{
+		const uint32_t * corners = &indices[bestTriangle * 3];
+		drawn[bestTriangle] = 1;
+
+		// Draw the triangle, and take it off its vertices' lists
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = corners[corner];
+			order.push_back(vertex);
+
+			uint32_t * begin = &adjacency[adjacencyStart[vertex]];
+			uint32_t * end = begin + remaining[vertex];
+			*find(begin, end, (uint32_t)bestTriangle) = *(end - 1);
+			remaining[vertex]--;
+		}
+
+		// The triangle's vertices go to the front of the cache, and the rest move back
+		nextCache.clear();
+		nextCache.insert(nextCache.end(), corners, corners + 3);
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+				nextCache.push_back(vertex);
+		}
+		swap(cache, nextCache);
+
+		// Rescore every vertex the cache touched, including those just pushed out of it
+		for (size_t position = 0; position < cache.size(); position++)
+		{
+			uint32_t vertex = cache[position];
+			cachePosition[vertex] = position < (size_t)SCORING_CACHE_SIZE ? (int)position : -1;
+			vertexScores[vertex] = scorer.Score(cachePosition[vertex], remaining[vertex]);
+		}
+
+		// Rescore the triangles around the cached vertices, and pick the best of them next
+		float bestScore = -1.0f;
+		bool found = false;
+		for (uint32_t vertex : cache)
+		{
+			for (size_t i = 0; i < remaining[vertex]; i++)
+			{
+				uint32_t triangle = adjacency[adjacencyStart[vertex] + i];
+				const uint32_t * triangleCorners = &indices[triangle * 3];
+				float score = vertexScores[triangleCorners[0]] + vertexScores[triangleCorners[1]] + vertexScores[triangleCorners[2]];
+				triangleScores[triangle] = score;
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = triangle;
+					found = true;
+				}
+			}
+		}
+
+		if (cache.size() > (size_t)SCORING_CACHE_SIZE)
+			cache.resize(SCORING_CACHE_SIZE);
+
+		// Nothing left around the cache, so start again from the next triangle not yet drawn
+		if (!found)
+		{
+			while (searchCursor < triangleCount && drawn[searchCursor])
+				searchCursor++;
+			bestTriangle = searchCursor;
+		}
+	}
+
+	copy(order.begin(), order.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t * indices, size_t indexCount, const vector<SimpleVertex>& vertices, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	// Split the order wherever the cache starts again from nothing, since a triangle that misses
+	// on all three vertices loses nothing by being drawn somewhere else
+	FifoCache cache(vertices.size(), ANALYSIS_CACHE_SIZE);
+	vector<size_t> hardStarts;
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+			misses += cache.Access(indices[triangle * 3 + corner]) ? 0 : 1;
+
+		if (misses == 3 || triangle == 0)
+			hardStarts.push_back(triangle);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Then split those further wherever the cluster so far, drawn from an empty cache, has a miss
+	// ratio within the threshold of the whole piece's. Since a cluster may end up drawn after
+	// anything, each one is measured starting from an empty cache.
+	vector<size_t> clusterStarts;
+	for (size_t hard = 0; hard + 1 < hardStarts.size(); hard++)
+	{
+		size_t begin = hardStarts[hard];
+		size_t end = hardStarts[hard + 1];
+
+		cache.Flush();
+		size_t pieceMisses = 0;
+		for (size_t i = begin * 3; i < end * 3; i++)
+			pieceMisses += cache.Access(indices[i]) ? 0 : 1;
+		double pieceAcmr = pieceMisses / (double)(end - begin);
+
+		cache.Flush();
+		clusterStarts.push_back(begin);
+		size_t clusterMisses = 0;
+		size_t clusterTriangles = 0;
+
+		for (size_t triangle = begin; triangle + 1 < end; triangle++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+				clusterMisses += cache.Access(indices[triangle * 3 + corner]) ? 0 : 1;
+			clusterTriangles++;
+
+			if (clusterMisses <= threshold * pieceAcmr * clusterTriangles)
+			{
+				clusterStarts.push_back(triangle + 1);
+				clusterMisses = 0;
+				clusterTriangles = 0;
+				cache.Flush();
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Clusters facing away from the middle of the mesh are drawn first, since they are the ones
+	// most likely to be in front from wherever the mesh is seen
+	struct Cluster
+	{
+		size_t begin;
+		size_t end;
+		XMFLOAT3 centroid;
+		XMFLOAT3 normal;
+		float sortKey;
+	};
+
+	vector<Cluster> clusters(clusterStarts.size() - 1);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		Cluster& cluster = clusters[i];
+		cluster.begin = clusterStarts[i];
+		cluster.end = clusterStarts[i + 1];
+
+		// Centroid and normal weighted by area, which is the length of the cross product
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (size_t triangle = cluster.begin; triangle < cluster.end; triangle++)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[triangle * 3]].Pos);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[triangle * 3 + 1]].Pos);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[triangle * 3 + 2]].Pos);
+
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), triangleArea / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&cluster.centroid, area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&cluster.normal, XMVector3Normalize(normal));
+	}
+
+	meshCentroid = meshArea > 0.0f ? XMVectorScale(meshCentroid, 1.0f / meshArea) : meshCentroid;
+
+	for (Cluster& cluster : clusters)
+	{
+		XMVECTOR outwards = XMVectorSubtract(XMLoadFloat3(&cluster.centroid), meshCentroid);
+		cluster.sortKey = XMVectorGetX(XMVector3Dot(outwards, XMLoadFloat3(&cluster.normal)));
+	}
+
+	stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	vector<uint32_t> order;
+	order.reserve(triangleCount * 3);
+	for (const Cluster& cluster : clusters)
+		order.insert(order.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+
+	copy(order.begin(), order.end(), indices);
+}
+
+size_t OptimizeVertexFetch(vector<SimpleVertex>& vertices, vector<uint32_t>& indices)
+{
+	const uint32_t UNUSED = 0xFFFFFFFFu;
+	vector<uint32_t> remap(vertices.size(), UNUSED);
+	vector<SimpleVertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = (uint32_t)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(ordered);
+	return vertices.size();
+}
+
+void OptimizeMesh(MeshAsset& asset, float overdrawThreshold)
+{
+	vector<MeshFileSubmesh> ranges = asset.submeshes;
+	if (ranges.empty())
+	{
+		MeshFileSubmesh whole = {};
+		whole.indexCount = (uint32_t)asset.indices.size();
+		ranges.push_back(whole);
+	}
+
+	for (const MeshFileSubmesh& range : ranges)
+	{
+		uint32_t * indices = asset.indices.data() + range.firstIndex;
+		OptimizeVertexCache(indices, range.indexCount, asset.vertices.size());
+		OptimizeOverdraw(indices, range.indexCount, asset.vertices, overdrawThreshold);
+	}
+
+	OptimizeVertexFetch(asset.vertices, asset.indices);
+}
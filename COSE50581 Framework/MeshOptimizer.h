@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshFile.h"
+
+using namespace std;
+
+// Reorders a mesh's triangles and vertices so the GPU does less work drawing it, without
+// changing what is drawn. There are three stages, meant to run in this order:
+//
+//  - OptimizeVertexCache orders the triangles so that vertices are reused while they are still
+//    in the post-transform cache, using Tom Forsyth's linear-speed greedy scoring.
+//  - OptimizeOverdraw splits that order into clusters wherever it can without losing much cache
+//    reuse, and sorts the clusters so the ones facing outwards, which tend to hide the others,
+//    are drawn first (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+//    and Reduced Overdraw", 2007).
+//  - OptimizeVertexFetch renumbers the vertices in the order the triangles first use them, so
+//    vertex fetches walk through memory, and drops vertices nothing uses.
+//
+// The first two work on one range of indices, so each submesh can be done on its own.
+
+// What drawing a mesh costs, measured on a simulated FIFO post-transform cache
+struct VertexCacheStats
+{
+	// Average cache miss ratio: vertices transformed per triangle. 0.5 is the best a large regular
+	// mesh can do, 3 means no reuse at all.
+	double acmr;
+	// Average transform to vertex ratio: vertices transformed per vertex used. 1 is ideal.
+	double atvr;
+	// Bytes of vertex data fetched, in 64 byte lines through a small cache, per byte of vertex used.
+	// 1 is ideal.
+	double overfetch;
+};
+
+// The size of the FIFO cache AnalyzeVertexCache simulates, typical of desktop GPUs
+static const int ANALYSIS_CACHE_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t vertexCount, size_t vertexStride);
+
+void OptimizeVertexCache(uint32_t * indices, size_t indexCount, size_t vertexCount);
+
+// threshold is how much worse than the cache order's miss ratio a cluster may get: 1 keeps the
+// cache order's reuse exactly, higher values allow more, smaller clusters
+void OptimizeOverdraw(uint32_t * indices, size_t indexCount, const vector<SimpleVertex>& vertices, float threshold = 1.05f);
+
+// Returns the number of vertices left
+size_t OptimizeVertexFetch(vector<SimpleVertex>& vertices, vector<uint32_t>& indices);
+
+// Runs every stage, each submesh on its own for the first two
+void OptimizeMesh(MeshAsset& asset, float overdrawThreshold = 1.05f);
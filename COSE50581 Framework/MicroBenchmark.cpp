@@ -0,0 +1,355 @@
+#include "MicroBenchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static atomic<long long> allocationCount(0);
+static atomic<long long> allocatedBytes(0);
+
+// The replacements of operator new and delete that count every allocation. The rest of the
+// forms forward to these.
+void * operator new(size_t size)
+{
+	allocationCount.fetch_add(1, memory_order_relaxed);
+	allocatedBytes.fetch_add((long long)size, memory_order_relaxed);
+
+	void * memory = malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+		throw bad_alloc();
+
+	return memory;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(size_t size, const nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch (const bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void * operator new[](size_t size, const nothrow_t&) noexcept
+{
+	return operator new(size, nothrow);
+}
+
+void operator delete(void * memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void * memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void * memory, const nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void * memory, const nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+AllocationCounts GetAllocationCounts()
+{
+	AllocationCounts counts;
+	counts.allocations = allocationCount.load(memory_order_relaxed);
+	counts.bytes = allocatedBytes.load(memory_order_relaxed);
+	return counts;
+}
+
+#if defined(__linux__)
+static int OpenCacheCounter(unsigned long long config)
+{
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.config = config;
+	attributes.disabled = 1;
+	// Only this process's own work, which is all perf_event_paranoid lets most users count
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+
+	return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+static long long ReadCacheCounter(int file)
+{
+	long long value = 0;
+	if (read(file, &value, sizeof(value)) != sizeof(value))
+		return -1;
+
+	return value;
+}
+#endif
+
+CacheCounters::CacheCounters()
+{
+	_missesFile = -1;
+	_referencesFile = -1;
+
+#if defined(__linux__)
+	// Virtual machines often have no hardware counters to give, which shows as the open failing
+	_missesFile = OpenCacheCounter(PERF_COUNT_HW_CACHE_MISSES);
+	_referencesFile = OpenCacheCounter(PERF_COUNT_HW_CACHE_REFERENCES);
+
+	if (_missesFile < 0 || _referencesFile < 0)
+	{
+		if (_missesFile >= 0)
+			close(_missesFile);
+		if (_referencesFile >= 0)
+			close(_referencesFile);
+
+		_missesFile = -1;
+		_referencesFile = -1;
+	}
+#endif
+}
+
+CacheCounters::~CacheCounters()
+{
+#if defined(__linux__)
+	if (IsAvailable())
+	{
+		close(_missesFile);
+		close(_referencesFile);
+	}
+#endif
+}
+
+void CacheCounters::Start()
+{
+#if defined(__linux__)
+	if (!IsAvailable())
+		return;
+
+	ioctl(_missesFile, PERF_EVENT_IOC_RESET, 0);
+	ioctl(_referencesFile, PERF_EVENT_IOC_RESET, 0);
+	ioctl(_missesFile, PERF_EVENT_IOC_ENABLE, 0);
+	ioctl(_referencesFile, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+void CacheCounters::Stop(long long& misses, long long& references)
+{
+	misses = -1;
+	references = -1;
+
+#if defined(__linux__)
+	if (!IsAvailable())
+		return;
+
+	ioctl(_missesFile, PERF_EVENT_IOC_DISABLE, 0);
+	ioctl(_referencesFile, PERF_EVENT_IOC_DISABLE, 0);
+	misses = ReadCacheCounter(_missesFile);
+	references = ReadCacheCounter(_referencesFile);
+#endif
+}
+
+CacheCounters& GetCacheCounters()
+{
+	static CacheCounters cacheCounters;
+	return cacheCounters;
+}
+
+void PrintMicroBenchmarkHeader()
+{
+	printf("%-28s %12s %12s %12s %14s %14s\n", "operation", "ns/op", "allocs/op", "bytes/op", "cache miss/op", "cache refs/op");
+}
+
+void PrintMicroBenchmarkResult(const MicroBenchmarkResult& result)
+{
+	printf("%-28s %12.2f %12.3f %12.1f", result.name.c_str(), result.nanoseconds, result.allocations, result.bytesAllocated);
+
+	if (result.cacheMisses < 0.0)
+		printf(" %14s %14s\n", "n/a", "n/a");
+	else
+		printf(" %14.3f %14.3f\n", result.cacheMisses, result.cacheReferences);
+}
+
+namespace
+{
+	struct RecordedResult
+	{
+		string benchmark;
+		MicroBenchmarkResult result;
+	};
+
+	vector<RecordedResult>& GetRecordedResults()
+	{
+		static vector<RecordedResult> results;
+		return results;
+	}
+
+	// The names are ours, but quotes and backslashes are escaped anyway so the file always parses
+	void WriteJsonString(FILE * file, const string& value)
+	{
+		fputc('"', file);
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+				fputc('\\', file);
+			fputc(c, file);
+		}
+		fputc('"', file);
+	}
+
+	// JSON has no way to write a missing number but null
+	void WriteJsonCounter(FILE * file, double value)
+	{
+		if (value < 0.0)
+			fprintf(file, "null");
+		else
+			fprintf(file, "%.6g", value);
+	}
+
+	// Reads a field from one line of a report. Only reports written by WriteMicroBenchmarkJson are
+	// read, which have a result to a line and no escapes in the names, so this is no JSON parser.
+	bool ReadJsonString(const char * line, const char * field, string& value)
+	{
+		string key = string("\"") + field + "\": \"";
+		const char * start = strstr(line, key.c_str());
+		if (start == nullptr)
+			return false;
+
+		start += key.size();
+		const char * end = strchr(start, '"');
+		if (end == nullptr)
+			return false;
+
+		value.assign(start, end);
+		return true;
+	}
+
+	bool ReadJsonNumber(const char * line, const char * field, double& value)
+	{
+		string key = string("\"") + field + "\": ";
+		const char * start = strstr(line, key.c_str());
+		return start != nullptr && sscanf(start + key.size(), "%lf", &value) == 1;
+	}
+}
+
+void RecordMicroBenchmarkResult(const char * benchmark, const MicroBenchmarkResult& result)
+{
+	RecordedResult recorded;
+	recorded.benchmark = benchmark;
+	recorded.result = result;
+	GetRecordedResults().push_back(recorded);
+}
+
+bool WriteMicroBenchmarkJson(const char * path)
+{
+	FILE * file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	const vector<RecordedResult>& results = GetRecordedResults();
+
+	// One result to a line, so that a diff of two reports lines up
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": 1,\n");
+	fprintf(file, "  \"cache_counters\": %s,\n", GetCacheCounters().IsAvailable() ? "true" : "false");
+	fprintf(file, "  \"results\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const MicroBenchmarkResult& result = results[i].result;
+
+		fprintf(file, "    { \"benchmark\": ");
+		WriteJsonString(file, results[i].benchmark);
+		fprintf(file, ", \"name\": ");
+		WriteJsonString(file, result.name);
+		fprintf(file, ", \"operations\": %lld, \"ns_per_op\": %.6g, \"allocations_per_op\": %.6g, \"bytes_allocated_per_op\": %.6g",
+			result.operations, result.nanoseconds, result.allocations, result.bytesAllocated);
+		fprintf(file, ", \"cache_misses_per_op\": ");
+		WriteJsonCounter(file, result.cacheMisses);
+		fprintf(file, ", \"cache_references_per_op\": ");
+		WriteJsonCounter(file, result.cacheReferences);
+		fprintf(file, " }%s\n", i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+
+	return fclose(file) == 0;
+}
+
+int CompareMicroBenchmarkJson(const char * baselinePath, double tolerance)
+{
+	FILE * file = fopen(baselinePath, "r");
+	if (file == nullptr)
+		return -1;
+
+	vector<RecordedResult> baseline;
+	char line[1024];
+
+	while (fgets(line, sizeof(line), file))
+	{
+		RecordedResult recorded;
+		if (ReadJsonString(line, "benchmark", recorded.benchmark) && ReadJsonString(line, "name", recorded.result.name) &&
+			ReadJsonNumber(line, "ns_per_op", recorded.result.nanoseconds) &&
+			ReadJsonNumber(line, "allocations_per_op", recorded.result.allocations))
+		{
+			baseline.push_back(recorded);
+		}
+	}
+
+	fclose(file);
+
+	printf("%-28s %12s %12s %9s %10s\n", "operation", "base ns/op", "ns/op", "change", "regressed");
+	int regressions = 0;
+
+	for (const RecordedResult& recorded : GetRecordedResults())
+	{
+		for (const RecordedResult& before : baseline)
+		{
+			if (before.benchmark != recorded.benchmark || before.result.name != recorded.result.name)
+				continue;
+
+			// The report rounds to six digits, so allocations only count as more beyond that
+			double change = recorded.result.nanoseconds / before.result.nanoseconds - 1.0;
+			bool regressed = change > tolerance || recorded.result.allocations > before.result.allocations * (1.0 + 1e-5);
+			if (regressed)
+				regressions++;
+
+			printf("%-28s %12.2f %12.2f %8.1f%% %10s\n", recorded.result.name.c_str(), before.result.nanoseconds,
+				recorded.result.nanoseconds, change * 100.0, regressed ? "YES" : "no");
+		}
+	}
+
+	return regressions;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include "Benchmarks.h"
+
+using namespace std;
+
+// What a micro benchmark measured, each per operation. The cache counters are negative where they
+// can't be read: on anything but Linux, or where the kernel doesn't allow perf events.
+struct MicroBenchmarkResult
+{
+	string name;
+	long long operations;
+	double nanoseconds;
+	double allocations;
+	double bytesAllocated;
+	double cacheMisses;
+	double cacheReferences;
+};
+
+// Every allocation made through operator new, on any thread. The Benchmarks executable replaces
+// operator new to count them.
+struct AllocationCounts
+{
+	long long allocations;
+	long long bytes;
+};
+
+AllocationCounts GetAllocationCounts();
+
+// The last level cache misses and references of the calling thread, through perf_event_open
+class CacheCounters
+{
+private:
+	int _missesFile;
+	int _referencesFile;
+
+public:
+	CacheCounters();
+	~CacheCounters();
+
+	CacheCounters(const CacheCounters&) = delete;
+	CacheCounters& operator=(const CacheCounters&) = delete;
+
+	bool IsAvailable() const { return _missesFile >= 0; }
+
+	void Start();
+	// Leaves misses and references at -1 when the counters aren't available
+	void Stop(long long& misses, long long& references);
+};
+
+// The counters every micro benchmark reads, opened on first use
+CacheCounters& GetCacheCounters();
+
+// Runs op, which performs operationsPerCall operations each time it is called, for at least
+// MICRO_BENCHMARK_SECONDS. The clock is only read between batches of calls long enough that
+// reading it doesn't show in the time.
+static const double MICRO_BENCHMARK_SECONDS = 0.25;
+
+template <typename Op>
+MicroBenchmarkResult RunMicroBenchmark(const char * name, int operationsPerCall, Op op)
+{
+	// Warm up, and find how many calls take a millisecond
+	op();
+
+	long long batch = 1;
+	for (;;)
+	{
+		BenchmarkTimer timer;
+		for (long long call = 0; call < batch; call++)
+		{
+			op();
+		}
+
+		if (timer.GetSeconds() >= 0.001)
+			break;
+
+		batch *= 2;
+	}
+
+	CacheCounters& cacheCounters = GetCacheCounters();
+	AllocationCounts allocationsBefore = GetAllocationCounts();
+	cacheCounters.Start();
+
+	long long calls = 0;
+	BenchmarkTimer timer;
+
+	do
+	{
+		for (long long call = 0; call < batch; call++)
+		{
+			op();
+		}
+
+		calls += batch;
+	} while (timer.GetSeconds() < MICRO_BENCHMARK_SECONDS);
+
+	double seconds = timer.GetSeconds();
+	long long cacheMisses, cacheReferences;
+	cacheCounters.Stop(cacheMisses, cacheReferences);
+	AllocationCounts allocationsAfter = GetAllocationCounts();
+
+	MicroBenchmarkResult result;
+	result.name = name;
+	result.operations = calls * operationsPerCall;
+	result.nanoseconds = seconds * 1e9 / result.operations;
+	result.allocations = (double)(allocationsAfter.allocations - allocationsBefore.allocations) / result.operations;
+	result.bytesAllocated = (double)(allocationsAfter.bytes - allocationsBefore.bytes) / result.operations;
+	result.cacheMisses = cacheMisses < 0 ? -1.0 : (double)cacheMisses / result.operations;
+	result.cacheReferences = cacheReferences < 0 ? -1.0 : (double)cacheReferences / result.operations;
+	return result;
+}
+
+void PrintMicroBenchmarkHeader();
+void PrintMicroBenchmarkResult(const MicroBenchmarkResult& result);
+
+// Keeps a result for the JSON report, which Benchmarks writes when it is given --json
+void RecordMicroBenchmarkResult(const char * benchmark, const MicroBenchmarkResult& result);
+bool WriteMicroBenchmarkJson(const char * path);
+
+// Compares the results kept so far against a report written earlier by WriteMicroBenchmarkJson.
+// An operation regressed when it takes more than tolerance longer, as a fraction, or allocates
+// more often than before. Returns the number that regressed, or -1 when the report can't be read.
+int CompareMicroBenchmarkJson(const char * baselinePath, double tolerance);
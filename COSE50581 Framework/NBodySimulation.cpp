@@ -0,0 +1,210 @@
+#include "NBodySimulation.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+const float NBodySimulation::DEFAULT_OPENING_ANGLE = 0.5f;
+const float NBodySimulation::DEFAULT_SOFTENING = 0.01f;
+
+// Bodies per job in the kicks and drifts
+static const int STEP_GRAIN_SIZE = 4096;
+
+NBodySimulation::NBodySimulation()
+{
+	_openingAngle = DEFAULT_OPENING_ANGLE;
+	_softening = DEFAULT_SOFTENING;
+	_accelerationsValid = false;
+	_interactionCount = 0;
+}
+
+NBodySimulation::~NBodySimulation()
+{
+}
+
+void NBodySimulation::Clear()
+{
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_vx.clear();
+	_vy.clear();
+	_vz.clear();
+	_ax.clear();
+	_ay.clear();
+	_az.clear();
+	_mass.clear();
+	_attractors.clear();
+	_accelerationsValid = false;
+}
+
+int NBodySimulation::AddBody(const XMFLOAT3& position, const XMFLOAT3& velocity, float mass)
+{
+	_x.push_back(position.x);
+	_y.push_back(position.y);
+	_z.push_back(position.z);
+	_vx.push_back(velocity.x);
+	_vy.push_back(velocity.y);
+	_vz.push_back(velocity.z);
+	_ax.push_back(0.0f);
+	_ay.push_back(0.0f);
+	_az.push_back(0.0f);
+	_mass.push_back(mass);
+	_accelerationsValid = false;
+
+	return (int)_x.size() - 1;
+}
+
+int NBodySimulation::AddAttractor(const XMFLOAT3& position, float mass, float radius)
+{
+	Attractor attractor;
+	attractor.position = position;
+	attractor.mass = mass;
+	attractor.radius = radius;
+	attractor.softeningSquared = _softening * _softening + radius * radius;
+	_attractors.push_back(attractor);
+	_accelerationsValid = false;
+
+	return (int)_attractors.size() - 1;
+}
+
+void NBodySimulation::SetSoftening(float softening)
+{
+	_softening = softening;
+	_accelerationsValid = false;
+
+	for (Attractor& attractor : _attractors)
+	{
+		attractor.softeningSquared = _softening * _softening + attractor.radius * attractor.radius;
+	}
+}
+
+void NBodySimulation::SetAttractorPosition(int attractor, const XMFLOAT3& position)
+{
+	// The accelerations the next step starts from stay those from where the attractor was at the
+	// end of the last step, which is where leapfrog needs them
+	_attractors[attractor].position = position;
+}
+
+void NBodySimulation::ComputeAccelerations(JobSystem * jobSystem)
+{
+	int count = GetBodyCount();
+
+	{
+		PROFILE_ZONE("NBodySimulation::BuildTree");
+		_tree.Build(_x.data(), _y.data(), _z.data(), _mass.data(), count, jobSystem);
+	}
+
+	PROFILE_ZONE("NBodySimulation::ComputeForces");
+	_interactionCount = _tree.ComputeAccelerations(_openingAngle, _softening, _ax.data(), _ay.data(), _az.data(), jobSystem);
+
+	if (_attractors.empty())
+		return;
+
+	auto addAttractors = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			for (const Attractor& attractor : _attractors)
+			{
+				float dx = attractor.position.x - _x[i];
+				float dy = attractor.position.y - _y[i];
+				float dz = attractor.position.z - _z[i];
+				float inverseDistance = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz + attractor.softeningSquared);
+				float strength = attractor.mass * inverseDistance * inverseDistance * inverseDistance;
+				_ax[i] += strength * dx;
+				_ay[i] += strength * dy;
+				_az[i] += strength * dz;
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(count, STEP_GRAIN_SIZE, addAttractors);
+	else
+		addAttractors(0, count);
+}
+
+void NBodySimulation::Step(float dt, JobSystem * jobSystem)
+{
+	PROFILE_ZONE("NBodySimulation::Step");
+
+	int count = GetBodyCount();
+	if (count == 0)
+		return;
+
+	// The first step, or the first after the bodies changed, needs the accelerations it starts from
+	if (!_accelerationsValid)
+		ComputeAccelerations(jobSystem);
+
+	float halfStep = 0.5f * dt;
+
+	// Half a kick with the accelerations at the start of the step, then a whole drift
+	auto kickDrift = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			_vx[i] += halfStep * _ax[i];
+			_vy[i] += halfStep * _ay[i];
+			_vz[i] += halfStep * _az[i];
+			_x[i] += dt * _vx[i];
+			_y[i] += dt * _vy[i];
+			_z[i] += dt * _vz[i];
+		}
+	};
+
+	// And the other half kick with the accelerations at the end
+	auto kick = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			_vx[i] += halfStep * _ax[i];
+			_vy[i] += halfStep * _ay[i];
+			_vz[i] += halfStep * _az[i];
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(count, STEP_GRAIN_SIZE, kickDrift);
+	else
+		kickDrift(0, count);
+
+	ComputeAccelerations(jobSystem);
+	_accelerationsValid = true;
+
+	if (jobSystem)
+		jobSystem->ParallelFor(count, STEP_GRAIN_SIZE, kick);
+	else
+		kick(0, count);
+}
+
+double NBodySimulation::ComputeEnergy() const
+{
+	int count = GetBodyCount();
+	double softeningSquared = (double)_softening * _softening;
+	double kinetic = 0.0;
+	double potential = 0.0;
+
+	for (int i = 0; i < count; i++)
+	{
+		kinetic += 0.5 * _mass[i] * ((double)_vx[i] * _vx[i] + (double)_vy[i] * _vy[i] + (double)_vz[i] * _vz[i]);
+
+		for (int j = i + 1; j < count; j++)
+		{
+			double dx = (double)_x[j] - _x[i];
+			double dy = (double)_y[j] - _y[i];
+			double dz = (double)_z[j] - _z[i];
+			potential -= (double)_mass[i] * _mass[j] / sqrt(dx * dx + dy * dy + dz * dz + softeningSquared);
+		}
+
+		for (const Attractor& attractor : _attractors)
+		{
+			double dx = (double)attractor.position.x - _x[i];
+			double dy = (double)attractor.position.y - _y[i];
+			double dz = (double)attractor.position.z - _z[i];
+			potential -= (double)_mass[i] * attractor.mass / sqrt(dx * dx + dy * dy + dz * dz + attractor.softeningSquared);
+		}
+	}
+
+	return kinetic + potential;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "BarnesHutTree.h"
+
+using namespace DirectX;
+using namespace std;
+
+class JobSystem;
+
+// Point masses pulling on each other under gravity, stepped with the kick-drift-kick leapfrog.
+// Leapfrog is symplectic, so the energy it gets wrong swings back and forth instead of building
+// up, and orbits stay closed over long runs where Euler's spiral outwards.
+//
+// Each component of the bodies' positions, velocities and accelerations is an array of its own,
+// so the steps stream through memory. The bodies pull on each other through a BarnesHutTree,
+// built again every step. Attractors are bodies moved by someone else, like the scripted sun and
+// planets: they pull on the bodies without being pulled back.
+//
+// Masses are gravitational parameters, G times the mass, so G never appears.
+class NBodySimulation
+{
+private:
+	struct Attractor
+	{
+		XMFLOAT3 position;
+		float mass;
+		float radius;
+		// The simulation's softening and the radius together
+		float softeningSquared;
+	};
+
+	vector<float> _x, _y, _z;
+	vector<float> _vx, _vy, _vz;
+	vector<float> _ax, _ay, _az;
+	vector<float> _mass;
+
+	vector<Attractor> _attractors;
+
+	BarnesHutTree _tree;
+	float _openingAngle;
+	float _softening;
+
+	// Whether the accelerations are those at the current positions, which the next step starts from
+	bool _accelerationsValid;
+	long long _interactionCount;
+
+	void ComputeAccelerations(JobSystem * jobSystem);
+
+public:
+	static const float DEFAULT_OPENING_ANGLE;
+	static const float DEFAULT_SOFTENING;
+
+	NBodySimulation();
+	~NBodySimulation();
+
+	// Removes every body and attractor
+	void Clear();
+
+	int AddBody(const XMFLOAT3& position, const XMFLOAT3& velocity, float mass);
+	int GetBodyCount() const { return (int)_x.size(); }
+	XMFLOAT3 GetPosition(int body) const { return XMFLOAT3(_x[body], _y[body], _z[body]); }
+	XMFLOAT3 GetVelocity(int body) const { return XMFLOAT3(_vx[body], _vy[body], _vz[body]); }
+
+	// An attractor pulls as if its mass were spread through radius, so that bodies passing
+	// through the sphere it is drawn as aren't flung away
+	int AddAttractor(const XMFLOAT3& position, float mass, float radius = 0.0f);
+	void SetAttractorPosition(int attractor, const XMFLOAT3& position);
+
+	// How large a node can be against its distance and still pull as one body. Smaller is more
+	// accurate and slower, and 0 sums every pair.
+	void SetOpeningAngle(float openingAngle) { _openingAngle = openingAngle; _accelerationsValid = false; }
+	// Distances are never taken as closer than this, so close passes don't fling bodies away
+	void SetSoftening(float softening);
+
+	// Advances the bodies by dt, on the job system's threads when one is given. The attractors
+	// must already be where they are at the end of the step.
+	void Step(float dt, JobSystem * jobSystem = nullptr);
+
+	// Kinetic plus potential energy, with the same softening as the forces. Every pair is summed
+	// in double precision, so this is O(n^2) and meant for checking the integrator.
+	double ComputeEnergy() const;
+
+	// The bodies and nodes that pulled on a body in the last step, summed over every body
+	long long GetInteractionCount() const { return _interactionCount; }
+	const BarnesHutTree& GetTree() const { return _tree; }
+};
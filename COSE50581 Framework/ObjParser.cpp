@@ -0,0 +1,253 @@
+#include "ObjParser.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// Marks a face corner with no normal
+	const int NO_NORMAL = -1;
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char * SkipSpaces(const char * c, const char * end)
+	{
+		while (c < end && IsSpace(*c))
+			c++;
+		return c;
+	}
+
+	const char * NextLine(const char * c, const char * end)
+	{
+		while (c < end && *c != '\n')
+			c++;
+		return c < end ? c + 1 : end;
+	}
+
+	// Reads a float, returning where it ended or null when there isn't one
+	const char * ParseFloat(const char * c, const char * end, float& value)
+	{
+		c = SkipSpaces(c, end);
+		char * parsedEnd;
+		value = strtof(c, &parsedEnd);
+		return parsedEnd == c || parsedEnd > end ? nullptr : parsedEnd;
+	}
+
+	const char * ParseInt(const char * c, const char * end, long& value)
+	{
+		char * parsedEnd;
+		value = strtol(c, &parsedEnd, 10);
+		return parsedEnd == c || parsedEnd > end ? nullptr : parsedEnd;
+	}
+
+	// Turns a one based, or negative and relative, OBJ index into a zero based one
+	bool ResolveIndex(long index, size_t count, int& resolved)
+	{
+		long long zeroBased = index > 0 ? index - 1 : (long long)count + index;
+		if (index == 0 || zeroBased < 0 || zeroBased >= (long long)count)
+			return false;
+
+		resolved = (int)zeroBased;
+		return true;
+	}
+
+	bool StartsWithKeyword(const char * c, const char * end, const char * keyword)
+	{
+		for (; *keyword; keyword++, c++)
+		{
+			if (c >= end || *c != *keyword)
+				return false;
+		}
+
+		return c == end || IsSpace(*c) || *c == '\n';
+	}
+}
+
+bool ParseObj(const char * text, size_t length, MeshAsset& asset, string& error)
+{
+	asset.vertices.clear();
+	asset.indices.clear();
+	asset.submeshes.clear();
+
+	vector<XMFLOAT3> positions;
+	vector<XMFLOAT3> normals;
+
+	// The vertex made for each position and normal pair, and the position each vertex came from
+	unordered_map<unsigned long long, uint32_t> vertexLookup;
+	vector<int> vertexPositions;
+	bool anyMissingNormals = false;
+
+	bool startSubmesh = true;
+	vector<uint32_t> corners;
+
+	const char * end = text + length;
+	int lineNumber = 0;
+
+	for (const char * line = text; line < end; line = NextLine(line, end))
+	{
+		lineNumber++;
+		const char * c = SkipSpaces(line, end);
+
+		if (StartsWithKeyword(c, end, "v") || StartsWithKeyword(c, end, "vn"))
+		{
+			bool isNormal = c[1] == 'n';
+			c += isNormal ? 2 : 1;
+
+			XMFLOAT3 value;
+			if (!(c = ParseFloat(c, end, value.x)) || !(c = ParseFloat(c, end, value.y)) || !(c = ParseFloat(c, end, value.z)))
+			{
+				error = "line " + to_string(lineNumber) + ": expected three numbers";
+				return false;
+			}
+
+			(isNormal ? normals : positions).push_back(value);
+		}
+		else if (StartsWithKeyword(c, end, "f"))
+		{
+			c++;
+			corners.clear();
+
+			for (;;)
+			{
+				c = SkipSpaces(c, end);
+				if (c >= end || *c == '\n' || *c == '#')
+					break;
+
+				// v, v/vt, v//vn or v/vt/vn
+				long positionIndex = 0, normalIndex = 0;
+				int position, normal = NO_NORMAL;
+
+				if (!(c = ParseInt(c, end, positionIndex)) || !ResolveIndex(positionIndex, positions.size(), position))
+				{
+					error = "line " + to_string(lineNumber) + ": bad position index";
+					return false;
+				}
+
+				if (c < end && *c == '/')
+				{
+					c++;
+					while (c < end && *c != '/' && !IsSpace(*c) && *c != '\n')
+						c++;
+
+					if (c < end && *c == '/')
+					{
+						c++;
+						if (!(c = ParseInt(c, end, normalIndex)) || !ResolveIndex(normalIndex, normals.size(), normal))
+						{
+							error = "line " + to_string(lineNumber) + ": bad normal index";
+							return false;
+						}
+					}
+				}
+
+				unsigned long long key = ((unsigned long long)(unsigned)position << 32) | (unsigned)normal;
+				auto found = vertexLookup.find(key);
+				if (found == vertexLookup.end())
+				{
+					SimpleVertex vertex;
+					vertex.Pos = positions[position];
+					vertex.Normal = normal == NO_NORMAL ? XMFLOAT3(0.0f, 0.0f, 0.0f) : normals[normal];
+					anyMissingNormals = anyMissingNormals || normal == NO_NORMAL;
+
+					found = vertexLookup.emplace(key, (uint32_t)asset.vertices.size()).first;
+					asset.vertices.push_back(vertex);
+					vertexPositions.push_back(normal == NO_NORMAL ? position : -1);
+				}
+
+				corners.push_back(found->second);
+			}
+
+			if (corners.size() < 3)
+			{
+				error = "line " + to_string(lineNumber) + ": a face needs at least three corners";
+				return false;
+			}
+
+			if (startSubmesh)
+			{
+				MeshFileSubmesh submesh = {};
+				submesh.firstIndex = (uint32_t)asset.indices.size();
+				asset.submeshes.push_back(submesh);
+				startSubmesh = false;
+			}
+
+			for (size_t i = 2; i < corners.size(); i++)
+			{
+				asset.indices.push_back(corners[0]);
+				asset.indices.push_back(corners[i - 1]);
+				asset.indices.push_back(corners[i]);
+			}
+
+			asset.submeshes.back().indexCount = (uint32_t)asset.indices.size() - asset.submeshes.back().firstIndex;
+		}
+		else if (StartsWithKeyword(c, end, "g") || StartsWithKeyword(c, end, "o") || StartsWithKeyword(c, end, "usemtl"))
+		{
+			startSubmesh = true;
+		}
+
+		// Everything else, such as comments, texture coordinates and smoothing groups, is skipped
+	}
+
+	if (anyMissingNormals)
+	{
+		// Sum the normals of the faces around each position, weighted by area, which is what the
+		// length of the unnormalised cross product gives
+		vector<XMFLOAT3> positionNormals(positions.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+		for (size_t i = 0; i + 2 < asset.indices.size(); i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&asset.vertices[asset.indices[i]].Pos);
+			XMVECTOR b = XMLoadFloat3(&asset.vertices[asset.indices[i + 1]].Pos);
+			XMVECTOR c = XMLoadFloat3(&asset.vertices[asset.indices[i + 2]].Pos);
+			XMVECTOR faceNormal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int position = vertexPositions[asset.indices[i + corner]];
+				if (position >= 0)
+					XMStoreFloat3(&positionNormals[position], XMVectorAdd(XMLoadFloat3(&positionNormals[position]), faceNormal));
+			}
+		}
+
+		for (size_t i = 0; i < asset.vertices.size(); i++)
+		{
+			if (vertexPositions[i] >= 0)
+				XMStoreFloat3(&asset.vertices[i].Normal, XMVector3Normalize(XMLoadFloat3(&positionNormals[vertexPositions[i]])));
+		}
+	}
+
+	return true;
+}
+
+bool LoadObj(const char * path, MeshAsset& asset, string& error)
+{
+	FILE * file = fopen(path, "rb");
+	if (!file)
+	{
+		error = string("could not open ") + path;
+		return false;
+	}
+
+	// Read the file in one go, then parse it from memory
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	string text(size > 0 ? (size_t)size : 0, '\0');
+	bool ok = size >= 0 && fread(&text[0], 1, text.size(), file) == text.size();
+	fclose(file);
+
+	if (!ok)
+	{
+		error = string("could not read ") + path;
+		return false;
+	}
+
+	return ParseObj(text.data(), text.size(), asset, error);
+}
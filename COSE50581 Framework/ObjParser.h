@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "MeshFile.h"
+
+using namespace std;
+
+// Reads Wavefront OBJ text into a MeshAsset. Positions and normals are read from v and vn
+// lines, and each distinct position and normal pair used by a face becomes one vertex. Faces
+// with more than three corners are split into a fan of triangles, and negative indices count
+// back from the latest element, as OBJ allows. Texture coordinates are skipped, since
+// SimpleVertex has none. Vertices whose faces give no normal get the area weighted average of
+// the normals of the faces around their position.
+//
+// Every g, o or usemtl line that is followed by faces starts a new submesh. The text must be
+// followed by a zero byte, as a string's is.
+bool ParseObj(const char * text, size_t length, MeshAsset& asset, string& error);
+
+// Reads the whole file and parses it
+bool LoadObj(const char * path, MeshAsset& asset, string& error);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Holds a number of objects chosen at run time in slabs of SLAB_SIZE, allocated as they are
+// needed. Growing never moves the objects already there, so pointers and references to them
+// stay valid, and each slab is one contiguous array a loop can walk without chasing pointers.
+// Shrinking only forgets the objects past the new count; the slabs are kept for the next growth.
+template <typename T>
+class ObjectPool
+{
+public:
+	static const int SLAB_SHIFT = 12;
+	static const int SLAB_SIZE = 1 << SLAB_SHIFT;
+
+private:
+	vector<unique_ptr<T[]>> _slabs;
+	int _count;
+
+public:
+	ObjectPool() { _count = 0; }
+	~ObjectPool() {}
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	// Sets the number of objects. New ones are default constructed, or reset to a default
+	// constructed object when they reuse a slab.
+	void Resize(int count)
+	{
+		int slabCount = (count + SLAB_SIZE - 1) >> SLAB_SHIFT;
+		while ((int)_slabs.size() < slabCount)
+			_slabs.emplace_back(new T[SLAB_SIZE]);
+
+		for (int i = _count; i < count; i++)
+			(*this)[i] = T();
+
+		_count = count;
+	}
+
+	// Adds one default constructed object and returns its index
+	int Add()
+	{
+		Resize(_count + 1);
+		return _count - 1;
+	}
+
+	int GetCount() const { return _count; }
+
+	T& operator[](int i) { return _slabs[i >> SLAB_SHIFT][i & (SLAB_SIZE - 1)]; }
+	const T& operator[](int i) const { return _slabs[i >> SLAB_SHIFT][i & (SLAB_SIZE - 1)]; }
+
+	// The slabs holding objects, the last one only partly filled
+	int GetSlabCount() const { return (_count + SLAB_SIZE - 1) >> SLAB_SHIFT; }
+	T * GetSlab(int slab) { return _slabs[slab].get(); }
+	const T * GetSlab(int slab) const { return _slabs[slab].get(); }
+	int GetSlabObjectCount(int slab) const { return slab + 1 < GetSlabCount() ? SLAB_SIZE : _count - slab * SLAB_SIZE; }
+
+	// The memory the slabs take, whether or not every object in them is in use
+	size_t GetBytesReserved() const { return _slabs.size() * SLAB_SIZE * sizeof(T); }
+};
+
+template <typename T>
+const int ObjectPool<T>::SLAB_SHIFT;
+template <typename T>
+const int ObjectPool<T>::SLAB_SIZE;
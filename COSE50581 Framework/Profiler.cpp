@@ -0,0 +1,228 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+const int Profiler::RING_SIZE;
+
+namespace
+{
+	// Every timestamp is measured from here, so they fit a trace's microsecond doubles exactly
+	const chrono::steady_clock::time_point profilerEpoch = chrono::steady_clock::now();
+
+	// Guards the lists of rings, which only change when a thread records its first zone or exits
+	mutex ringsLock;
+
+	double Percentile(const vector<long long>& sortedDurations, double percentile)
+	{
+		size_t index = static_cast<size_t>(percentile * (sortedDurations.size() - 1) + 0.5);
+		return sortedDurations[index] / 1e3;
+	}
+
+	void WriteJsonString(ostream& stream, const char * text)
+	{
+		stream << '"';
+		for (const char * c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				stream << '\\';
+			stream << *c;
+		}
+		stream << '"';
+	}
+}
+
+long long Profiler::Now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+Profiler::RingLease::~RingLease()
+{
+	if (_ring == nullptr)
+		return;
+
+	lock_guard<mutex> lock(ringsLock);
+	GetFreeRings().push_back(_ring);
+}
+
+Profiler::ThreadRing& Profiler::RingLease::GetRing()
+{
+	// Only a thread's first zone takes the lock, to reuse the ring of a thread that has exited
+	// or add a new one to the list
+	if (_ring == nullptr)
+	{
+		lock_guard<mutex> lock(ringsLock);
+		vector<ThreadRing *>& freeRings = GetFreeRings();
+
+		if (!freeRings.empty())
+		{
+			_ring = freeRings.back();
+			freeRings.pop_back();
+		}
+		else
+		{
+			unique_ptr<ThreadRing> ring(new ThreadRing());
+			ring->written = 0;
+			ring->cleared = 0;
+
+			vector<unique_ptr<ThreadRing>>& rings = GetRings();
+			ring->thread = (int)rings.size();
+			_ring = ring.get();
+			rings.push_back(move(ring));
+		}
+	}
+
+	return *_ring;
+}
+
+Profiler::ThreadRing& Profiler::GetThreadRing()
+{
+	thread_local RingLease ringLease;
+	return ringLease.GetRing();
+}
+
+void Profiler::Record(const char * name, long long startNanoseconds, long long endNanoseconds)
+{
+	ThreadRing& ring = GetThreadRing();
+
+	long long index = ring.written.load(memory_order_relaxed);
+	Zone& zone = ring.zones[index & (RING_SIZE - 1)];
+	zone.name = name;
+	zone.startNanoseconds = startNanoseconds;
+	zone.endNanoseconds = endNanoseconds;
+	zone.thread = ring.thread;
+
+	// Publishes the zone to Collect
+	ring.written.store(index + 1, memory_order_release);
+}
+
+vector<Profiler::Zone> Profiler::Collect()
+{
+	vector<Zone> zones;
+
+	lock_guard<mutex> lock(ringsLock);
+	for (const unique_ptr<ThreadRing>& ring : GetRings())
+	{
+		long long end = ring->written.load(memory_order_acquire);
+		long long begin = max(ring->cleared.load(memory_order_relaxed), end - RING_SIZE);
+
+		size_t first = zones.size();
+		for (long long index = begin; index < end; index++)
+			zones.push_back(ring->zones[index & (RING_SIZE - 1)]);
+
+		// The thread may have carried on while the ring was copied. Any zone whose slot it has
+		// reused since, or may be writing now, is dropped.
+		long long firstIntact = ring->written.load(memory_order_acquire) - RING_SIZE + 1;
+		long long overwritten = min(end - begin, max(0LL, firstIntact - begin));
+		zones.erase(zones.begin() + first, zones.begin() + first + (size_t)overwritten);
+	}
+
+	return zones;
+}
+
+void Profiler::Clear()
+{
+	lock_guard<mutex> lock(ringsLock);
+	for (const unique_ptr<ThreadRing>& ring : GetRings())
+	{
+		ring->cleared.store(ring->written.load(memory_order_acquire), memory_order_relaxed);
+	}
+}
+
+void Profiler::WriteChromeTrace(ostream& stream, const vector<Zone>& zones)
+{
+	// Complete ("X") events, timed in microseconds
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	char timing[96];
+	for (size_t i = 0; i < zones.size(); i++)
+	{
+		const Zone& zone = zones[i];
+
+		stream << "{\"name\":";
+		WriteJsonString(stream, zone.name);
+		snprintf(timing, sizeof(timing), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d}",
+			zone.startNanoseconds / 1e3, (zone.endNanoseconds - zone.startNanoseconds) / 1e3, zone.thread);
+		stream << timing << (i + 1 < zones.size() ? ",\n" : "\n");
+	}
+
+	stream << "]}\n";
+}
+
+vector<Profiler::ZoneSummary> Profiler::Summarise(const vector<Zone>& zones)
+{
+	// The same name can be a different literal in each file, so the names are compared by text
+	map<string, pair<const char *, vector<long long>>> durationsByName;
+	for (const Zone& zone : zones)
+	{
+		pair<const char *, vector<long long>>& durations = durationsByName[zone.name];
+		durations.first = zone.name;
+		durations.second.push_back(zone.endNanoseconds - zone.startNanoseconds);
+	}
+
+	vector<ZoneSummary> summaries;
+	for (auto& entry : durationsByName)
+	{
+		vector<long long>& durations = entry.second.second;
+		sort(durations.begin(), durations.end());
+
+		long long total = 0;
+		for (long long duration : durations)
+			total += duration;
+
+		ZoneSummary summary;
+		summary.name = entry.second.first;
+		summary.count = (int)durations.size();
+		summary.totalMilliseconds = total / 1e6;
+		summary.p50Microseconds = Percentile(durations, 0.50);
+		summary.p95Microseconds = Percentile(durations, 0.95);
+		summary.p99Microseconds = Percentile(durations, 0.99);
+		summary.maxMicroseconds = durations.back() / 1e3;
+		summaries.push_back(summary);
+	}
+
+	sort(summaries.begin(), summaries.end(),
+		[](const ZoneSummary& a, const ZoneSummary& b) { return a.totalMilliseconds > b.totalMilliseconds; });
+
+	return summaries;
+}
+
+string Profiler::FormatSummary(const vector<ZoneSummary>& summaries)
+{
+	string text;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%-32s %8s %10s %10s %10s %10s %10s\n", "zone", "count", "total ms", "p50 us", "p95 us",
+		"p99 us", "max us");
+	text += line;
+
+	for (const ZoneSummary& summary : summaries)
+	{
+		snprintf(line, sizeof(line), "%-32s %8d %10.3f %10.3f %10.3f %10.3f %10.3f\n", summary.name, summary.count,
+			summary.totalMilliseconds, summary.p50Microseconds, summary.p95Microseconds, summary.p99Microseconds,
+			summary.maxMicroseconds);
+		text += line;
+	}
+
+	return text;
+}
+
+vector<unique_ptr<Profiler::ThreadRing>>& Profiler::GetRings()
+{
+	// Every ring made so far. There are only ever as many as threads recording at once, and a ring
+	// goes on holding an exited thread's zones until the thread that reuses it overwrites them.
+	static vector<unique_ptr<ThreadRing>> rings;
+	return rings;
+}
+
+vector<Profiler::ThreadRing *>& Profiler::GetFreeRings()
+{
+	static vector<ThreadRing *> freeRings;
+	return freeRings;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Builds with PROFILER_ENABLED set to 0 compile every PROFILE_ZONE away to nothing
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// A CPU profiler for finding where the frame time goes. A zone is a named stretch of code timed
+// from the start of a scope to its end with PROFILE_ZONE. Each thread writes the zones it
+// finishes into a ring buffer of its own, so recording takes no locks and threads never wait on
+// each other. When a ring is full its oldest zones are overwritten. The ring of a thread that
+// exits is handed to the next thread to record a zone, which carries on after its zones.
+//
+// Collect copies out what the rings hold from any thread. The zones can then be written as a
+// Chrome trace, to be opened in chrome://tracing or Perfetto, or summarised as percentiles of
+// each zone's time.
+class Profiler
+{
+public:
+	struct Zone
+	{
+		// Zone names must be string literals, or otherwise outlive the profiler
+		const char * name;
+		long long startNanoseconds;
+		long long endNanoseconds;
+		int thread;
+	};
+
+	struct ZoneSummary
+	{
+		const char * name;
+		int count;
+		double totalMilliseconds;
+		double p50Microseconds;
+		double p95Microseconds;
+		double p99Microseconds;
+		double maxMicroseconds;
+	};
+
+	// How many of its latest zones each thread keeps
+	static const int RING_SIZE = 1 << 16;
+
+	// Nanoseconds since the profiler started, from steady_clock
+	static long long Now();
+
+	// Adds a finished zone to the calling thread's ring
+	static void Record(const char * name, long long startNanoseconds, long long endNanoseconds);
+
+	// Copies out the zones every thread has recorded since the last Clear, oldest first on each
+	// thread. Zones that may be overwritten while they're copied are left out, which always
+	// includes the oldest zone of a full ring, so a full ring gives RING_SIZE - 1 zones.
+	static vector<Zone> Collect();
+
+	// Forgets the zones recorded so far
+	static void Clear();
+
+	// Writes the zones as Chrome trace event JSON
+	static void WriteChromeTrace(ostream& stream, const vector<Zone>& zones);
+
+	// One summary per zone name, the slowest in total first
+	static vector<ZoneSummary> Summarise(const vector<Zone>& zones);
+
+	// A table of the summaries, one line per zone
+	static string FormatSummary(const vector<ZoneSummary>& summaries);
+
+private:
+	struct ThreadRing
+	{
+		Zone zones[RING_SIZE];
+		// How many zones have ever been written, only ever changed by the ring's own thread
+		atomic<long long> written;
+		// Zones before this one were cleared
+		atomic<long long> cleared;
+		int thread;
+	};
+
+	// Takes a ring for the calling thread when it records its first zone, and gives it back to be
+	// reused when the thread exits
+	class RingLease
+	{
+	private:
+		ThreadRing * _ring;
+
+	public:
+		RingLease() : _ring(nullptr) {}
+		~RingLease();
+
+		ThreadRing& GetRing();
+	};
+
+	static ThreadRing& GetThreadRing();
+	static vector<unique_ptr<ThreadRing>>& GetRings();
+	// The rings of threads that have exited, waiting to be reused
+	static vector<ThreadRing *>& GetFreeRings();
+};
+
+// Times the scope it lives in and records it as a zone when the scope ends
+class ProfileZone
+{
+private:
+	const char * _name;
+	long long _start;
+
+public:
+	explicit ProfileZone(const char * name)
+	{
+		_name = name;
+		_start = Profiler::Now();
+	}
+
+	~ProfileZone()
+	{
+		Profiler::Record(_name, _start, Profiler::Now());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
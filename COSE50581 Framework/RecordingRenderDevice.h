@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include "RenderDevice.h"
+
+using namespace std;
+
+// A RenderDevice that draws nothing and records every call it receives instead
+class RecordingRenderDevice : public RenderDevice
+{
+public:
+	struct DrawCall
+	{
+		MeshData meshData;
+		int instanceCount;
+		int startInstance;
+	};
+
+private:
+	vector<XMFLOAT4X4> _instances;
+	vector<DrawCall> _drawCalls;
+	int _instanceUploads;
+	int _constantBufferUploads[CB_COUNT];
+	int _constantBufferBytes;
+	int _rasterizerStateChanges;
+	int _shaderChanges;
+	int _meshChanges;
+	int _draws;
+
+public:
+	RecordingRenderDevice() { Clear(); }
+
+	void SetRasterizerState(int rasterizerState) override { _rasterizerStateChanges++; }
+	void SetShader(int shader) override { _shaderChanges++; }
+	void SetMesh(const MeshData& meshData) override { _meshChanges++; }
+	void DrawIndexed(int indexCount) override { _draws++; }
+
+	void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override
+	{
+		_constantBufferUploads[slot]++;
+		_constantBufferBytes += size;
+	}
+
+	void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) override
+	{
+		_instances.assign(worlds, worlds + count);
+		_instanceUploads++;
+	}
+
+	void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) override
+	{
+		DrawCall drawCall = { meshData, instanceCount, startInstance };
+		_drawCalls.push_back(drawCall);
+	}
+
+	void Clear()
+	{
+		_instances.clear();
+		_drawCalls.clear();
+		_instanceUploads = 0;
+		_constantBufferBytes = 0;
+		_rasterizerStateChanges = 0;
+		_shaderChanges = 0;
+		_meshChanges = 0;
+		_draws = 0;
+
+		for (int i = 0; i < CB_COUNT; i++)
+			_constantBufferUploads[i] = 0;
+	}
+
+	const vector<XMFLOAT4X4>& GetInstances() const { return _instances; }
+	const vector<DrawCall>& GetDrawCalls() const { return _drawCalls; }
+	int GetInstanceUploads() const { return _instanceUploads; }
+	int GetConstantBufferUploads(ConstantBufferSlot slot) const { return _constantBufferUploads[slot]; }
+	int GetConstantBufferBytes() const { return _constantBufferBytes; }
+	int GetRasterizerStateChanges() const { return _rasterizerStateChanges; }
+	int GetShaderChanges() const { return _shaderChanges; }
+	int GetMeshChanges() const { return _meshChanges; }
+	int GetDraws() const { return _draws; }
+};
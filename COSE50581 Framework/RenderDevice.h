@@ -0,0 +1,46 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "GameObject.h"
+
+using namespace DirectX;
+
+// The constant buffer slots used by Lighting.fx, one for each rate the data changes at. The value
+// is also the register the buffer is bound to.
+enum ConstantBufferSlot
+{
+	CB_FRAME = 0,
+	CB_MATERIAL = 1,
+	CB_OBJECT = 2,
+	CB_COUNT
+};
+
+// The draw calls the renderer needs, kept separate from Direct3D so that the code building them
+// can run without a GPU. D3D11RenderDevice is the real implementation, and RecordingRenderDevice
+// just remembers the calls so they can be checked on any platform. CommandBuffer stores the
+// calls to replay on another device later, and LoggingRenderDevice writes them out as text.
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// Binds one of the rasterizer states or shaders the device was set up with. The ids are
+	// chosen by the application.
+	virtual void SetRasterizerState(int rasterizerState) = 0;
+	virtual void SetShader(int shader) = 0;
+
+	// Binds the mesh's vertex and index buffers
+	virtual void SetMesh(const MeshData& meshData) = 0;
+
+	// Draws the bound mesh with the bound state
+	virtual void DrawIndexed(int indexCount) = 0;
+
+	// Replaces the contents of one of the constant buffers
+	virtual void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) = 0;
+
+	// Uploads the world matrices that the following instanced draws read from
+	virtual void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) = 0;
+
+	// Draws instanceCount copies of the mesh, starting at startInstance in the instance buffer
+	virtual void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) = 0;
+};
@@ -0,0 +1,348 @@
+#include "RenderQueue.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "TransformKernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+const int RenderQueue::MAX_PASSES;
+const int RenderQueue::MAX_RASTERIZER_STATES;
+const int RenderQueue::MAX_SHADERS;
+const int RenderQueue::MAX_MATERIALS;
+const int RenderQueue::MAX_MESHES;
+
+// Draws per job when the object constants are packed on several threads
+static const int PACK_GRAIN_SIZE = 2048;
+
+static_assert(sizeof(ObjectConstants) == sizeof(XMFLOAT4X4), "The object constants are transposed as a plain matrix");
+
+size_t RenderQueue::MeshHash::operator()(const MeshData& meshData) const
+{
+	// Meshes are told apart by their buffers, and the other fields only differ between meshes
+	// that share them
+	size_t hash = std::hash<const void *>()(meshData.VertexBuffer);
+	hash = hash * 31 + std::hash<const void *>()(meshData.IndexBuffer);
+	hash = hash * 31 + meshData.VBOffset;
+	return hash * 31 + meshData.IndexCount;
+}
+
+bool RenderQueue::MeshEqual::operator()(const MeshData& a, const MeshData& b) const
+{
+	return a.VertexBuffer == b.VertexBuffer && a.IndexBuffer == b.IndexBuffer &&
+		a.VBStride == b.VBStride && a.VBOffset == b.VBOffset && a.IndexCount == b.IndexCount &&
+		a.IndexFormat == b.IndexFormat && a.VertexFormat == b.VertexFormat;
+}
+
+RenderQueue::RenderQueue()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+uint64_t RenderQueue::MakeSortKey(int pass, int rasterizerState, int shader, int material, int mesh, float depth)
+{
+	// Positive floats sort the same way as their bit patterns. The sign bit is always clear and
+	// the lowest mantissa bits are dropped, which still orders depths a 4096th apart.
+	assert(pass >= 0 && pass < MAX_PASSES);
+	assert(rasterizerState >= 0 && rasterizerState < MAX_RASTERIZER_STATES);
+	assert(shader >= 0 && shader < MAX_SHADERS);
+	assert(material >= 0 && material < MAX_MATERIALS);
+	assert(mesh >= 0 && mesh < MAX_MESHES);
+
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return ((uint64_t)pass << 60) |
+		((uint64_t)rasterizerState << 56) |
+		((uint64_t)shader << 52) |
+		((uint64_t)material << 44) |
+		((uint64_t)mesh << 20) |
+		(depthBits >> 11);
+}
+
+void RenderQueue::SetMaterials(const MaterialConstants * materials, int count)
+{
+	_materials.assign(materials, materials + count);
+}
+
+void RenderQueue::Begin()
+{
+	_packets.clear();
+	_draws.clear();
+
+	// Meshes are given ids in the order they are first submitted each frame, so the table only
+	// ever holds what the frame draws
+	_meshes.clear();
+	_meshIds.clear();
+}
+
+int RenderQueue::GetStateKinds() const
+{
+	// The rasterizer state, shader and mesh, and the material when there are materials to bind
+	return _materials.empty() ? 3 : 4;
+}
+
+int RenderQueue::FindMesh(const MeshData& meshData)
+{
+	auto found = _meshIds.find(meshData);
+	if (found != _meshIds.end())
+		return found->second;
+
+	if ((int)_meshes.size() == MAX_MESHES)
+		return -1;
+
+	int mesh = (int)_meshes.size();
+	_meshes.push_back(meshData);
+	_meshIds.emplace(meshData, mesh);
+
+	return mesh;
+}
+
+bool RenderQueue::Submit(int pass, int rasterizerState, int shader, int material, const MeshData& meshData, float depth, const XMFLOAT4X4& world)
+{
+	if (pass < 0 || pass >= MAX_PASSES || rasterizerState < 0 || rasterizerState >= MAX_RASTERIZER_STATES ||
+		shader < 0 || shader >= MAX_SHADERS || material < 0 || material >= MAX_MATERIALS)
+		return false;
+
+	// Once a material has constants to bind, the draw's index must name one of them
+	if (!_materials.empty() && material >= (int)_materials.size())
+		return false;
+
+	int mesh = FindMesh(meshData);
+	if (mesh < 0)
+		return false;
+
+	DrawData draw;
+	draw.rasterizerState = rasterizerState;
+	draw.shader = shader;
+	draw.material = material;
+	draw.mesh = mesh;
+	draw.world = world;
+
+	DrawPacket packet;
+	packet.sortKey = MakeSortKey(pass, rasterizerState, shader, material, draw.mesh, depth);
+	packet.drawIndex = (int)_draws.size();
+
+	_draws.push_back(draw);
+	_packets.push_back(packet);
+
+	return true;
+}
+
+void RenderQueue::Sort()
+{
+	int count = (int)_packets.size();
+
+	if (count < 2)
+		return;
+
+	_sortBuffer.resize(count);
+
+	// Least significant digit radix sort, one byte at a time. All eight histograms are built
+	// in a single pass over the keys.
+	int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t key = _packets[i].sortKey;
+
+		for (int digit = 0; digit < 8; digit++)
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	DrawPacket* source = _packets.data();
+	DrawPacket* destination = _sortBuffer.data();
+
+	for (int digit = 0; digit < 8; digit++)
+	{
+		int* histogram = histograms[digit];
+
+		// When every key has the same value in this byte, the pass wouldn't change anything
+		if (histogram[(source[0].sortKey >> (digit * 8)) & 0xFF] == count)
+			continue;
+
+		int offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			int bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			int bucket = (source[i].sortKey >> (digit * 8)) & 0xFF;
+			destination[histogram[bucket]++] = source[i];
+		}
+
+		DrawPacket* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	// After an odd number of passes the sorted packets are in the sort buffer
+	if (source != _packets.data())
+		_packets.swap(_sortBuffer);
+}
+
+void RenderQueue::PackObjectConstants(int begin, int end)
+{
+	// Gather the world matrices in sorted order, then transpose them where they are with the
+	// batch kernel
+	XMFLOAT4X4 * worlds = (XMFLOAT4X4 *)_objectConstants.data();
+
+	for (int i = begin; i < end; i++)
+		worlds[i] = _draws[_packets[i].drawIndex].world;
+
+	TransposeTransforms(worlds + begin, worlds + begin, end - begin);
+}
+
+void RenderQueue::Flush(RenderDevice& renderDevice, ConstantBufferCache& constantBufferCache, JobSystem * jobSystem)
+{
+	Sort();
+
+	int count = (int)_packets.size();
+	_objectConstants.resize(count);
+
+	if (jobSystem == nullptr)
+	{
+		PackObjectConstants(0, count);
+	}
+	else
+	{
+		jobSystem->ParallelFor(count, PACK_GRAIN_SIZE, [this](int begin, int end) { PackObjectConstants(begin, end); });
+	}
+
+	memset(&_stats, 0, sizeof(_stats));
+	RecordRange(renderDevice, constantBufferCache, 0, count, _stats);
+	_stats.bindsRequested = _stats.draws * GetStateKinds();
+}
+
+void RenderQueue::Record(JobSystem& jobSystem, vector<CommandBuffer>& commandBuffers, int drawsPerBuffer)
+{
+	Sort();
+
+	int count = (int)_packets.size();
+	_objectConstants.resize(count);
+	jobSystem.ParallelFor(count, PACK_GRAIN_SIZE, [this](int begin, int end) { PackObjectConstants(begin, end); });
+
+	int bufferCount = (count + drawsPerBuffer - 1) / drawsPerBuffer;
+	commandBuffers.resize(bufferCount);
+	_rangeStats.resize(bufferCount);
+
+	jobSystem.ParallelFor(bufferCount, 1, [this, &commandBuffers, drawsPerBuffer, count](int begin, int end)
+	{
+		for (int buffer = begin; buffer < end; buffer++)
+		{
+			CommandBuffer& commandBuffer = commandBuffers[buffer];
+			commandBuffer.Clear();
+
+			Stats& stats = _rangeStats[buffer];
+			memset(&stats, 0, sizeof(stats));
+
+			ConstantBufferCache constantBufferCache;
+			int first = buffer * drawsPerBuffer;
+			RecordRange(commandBuffer, constantBufferCache, first, min(count, first + drawsPerBuffer), stats);
+		}
+	});
+
+	memset(&_stats, 0, sizeof(_stats));
+	for (const Stats& stats : _rangeStats)
+	{
+		_stats.draws += stats.draws;
+		_stats.rasterizerStateChanges += stats.rasterizerStateChanges;
+		_stats.shaderChanges += stats.shaderChanges;
+		_stats.materialChanges += stats.materialChanges;
+		_stats.meshChanges += stats.meshChanges;
+		_stats.objectConstantUploads += stats.objectConstantUploads;
+		_stats.materialConstantUploads += stats.materialConstantUploads;
+	}
+	_stats.bindsRequested = _stats.draws * GetStateKinds();
+}
+
+void RenderQueue::RecordRange(RenderDevice& renderDevice, ConstantBufferCache& constantBufferCache, int begin, int end, Stats& stats)
+{
+	PROFILE_ZONE("RenderQueue::RecordRange");
+
+	// Nothing is known about the device state at the start, so the first draw binds everything.
+	// A later range starts with whatever the draw before it left bound.
+	int rasterizerState = -1;
+	int shader = -1;
+	int material = -1;
+	int mesh = -1;
+	bool bindMaterials = !_materials.empty();
+
+	if (begin > 0)
+	{
+		const DrawData& previous = _draws[_packets[begin - 1].drawIndex];
+		rasterizerState = previous.rasterizerState;
+		shader = previous.shader;
+		material = previous.material;
+		mesh = previous.mesh;
+		constantBufferCache.Assume(CB_OBJECT, &_objectConstants[begin - 1], sizeof(ObjectConstants));
+
+		if (bindMaterials)
+			constantBufferCache.Assume(CB_MATERIAL, &_materials[material], sizeof(MaterialConstants));
+	}
+
+	int uploadsBefore = constantBufferCache.GetStats().uploads;
+	int materialUploads = 0;
+
+	for (int i = begin; i < end; i++)
+	{
+		const DrawData& draw = _draws[_packets[i].drawIndex];
+
+		if (draw.rasterizerState != rasterizerState)
+		{
+			rasterizerState = draw.rasterizerState;
+			renderDevice.SetRasterizerState(rasterizerState);
+			stats.rasterizerStateChanges++;
+		}
+
+		if (draw.shader != shader)
+		{
+			shader = draw.shader;
+			renderDevice.SetShader(shader);
+			stats.shaderChanges++;
+		}
+
+		if (draw.material != material)
+		{
+			material = draw.material;
+			stats.materialChanges++;
+
+			// Materials that differ only in their index still skip the upload
+			if (bindMaterials)
+			{
+				int materialUploadsBefore = constantBufferCache.GetStats().uploads;
+				constantBufferCache.Update(renderDevice, CB_MATERIAL, &_materials[material], sizeof(MaterialConstants));
+				materialUploads += constantBufferCache.GetStats().uploads - materialUploadsBefore;
+			}
+		}
+
+		if (draw.mesh != mesh)
+		{
+			mesh = draw.mesh;
+			renderDevice.SetMesh(_meshes[mesh]);
+			stats.meshChanges++;
+		}
+
+		constantBufferCache.Update(renderDevice, CB_OBJECT, &_objectConstants[i], sizeof(ObjectConstants));
+
+		renderDevice.DrawIndexed(_meshes[mesh].IndexCount);
+		stats.draws++;
+	}
+
+	stats.objectConstantUploads += constantBufferCache.GetStats().uploads - uploadsBefore - materialUploads;
+	stats.materialConstantUploads += materialUploads;
+}
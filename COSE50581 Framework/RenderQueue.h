@@ -0,0 +1,134 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "CommandBuffer.h"
+#include "ConstantBuffers.h"
+#include "RenderDevice.h"
+
+using namespace DirectX;
+using namespace std;
+
+class JobSystem;
+
+// Collects the draws for a frame as compact packets, sorts them by a 64-bit key and then sends
+// them to a RenderDevice, only binding state that differs from the previous draw.
+//
+// The key is laid out so that the most expensive state to change sorts first:
+//   bits 60-63  pass
+//   bits 56-59  rasterizer state
+//   bits 52-55  shader
+//   bits 44-51  material
+//   bits 20-43  mesh
+//   bits  0-19  depth, so draws sharing all their state go front to back
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		int draws;
+		int rasterizerStateChanges;
+		int shaderChanges;
+		int materialChanges;
+		int meshChanges;
+		// The binds that would be made if every draw set all of its state, as drawing each object on
+		// its own did.
+		// The material is only counted once SetMaterials has given the queue materials to bind.
+		int bindsRequested;
+		// Object and material constant uploads that weren't skipped because the data was unchanged
+		int objectConstantUploads;
+		int materialConstantUploads;
+	};
+
+	static const int MAX_PASSES = 16;
+	static const int MAX_RASTERIZER_STATES = 16;
+	static const int MAX_SHADERS = 16;
+	static const int MAX_MATERIALS = 256;
+	static const int MAX_MESHES = 1 << 24;
+
+private:
+	struct DrawPacket
+	{
+		uint64_t sortKey;
+		int drawIndex;
+	};
+
+	struct DrawData
+	{
+		int rasterizerState;
+		int shader;
+		int material;
+		int mesh;
+		XMFLOAT4X4 world;
+	};
+
+	// Two MeshData are the same mesh when they bind the same buffers the same way
+	struct MeshHash
+	{
+		size_t operator()(const MeshData& meshData) const;
+	};
+
+	struct MeshEqual
+	{
+		bool operator()(const MeshData& a, const MeshData& b) const;
+	};
+
+	vector<DrawPacket> _packets;
+	vector<DrawPacket> _sortBuffer;
+	vector<DrawData> _draws;
+	// The meshes submitted this frame, in the order they were first submitted, and each one's id
+	vector<MeshData> _meshes;
+	unordered_map<MeshData, int, MeshHash, MeshEqual> _meshIds;
+	vector<MaterialConstants> _materials;
+	// The object constants for each packet, in sorted order, ready to upload
+	vector<ObjectConstants> _objectConstants;
+	Stats _stats;
+	vector<Stats> _rangeStats;
+
+	void PackObjectConstants(int begin, int end);
+	void RecordRange(RenderDevice& renderDevice, ConstantBufferCache& constantBufferCache, int begin, int end, Stats& stats);
+
+	// The mesh's id this frame, or -1 when the frame already has MAX_MESHES meshes
+	int FindMesh(const MeshData& meshData);
+	int GetStateKinds() const;
+
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// Every id must be at least 0 and below its MAX_ constant, or it would run into the fields above it
+	static uint64_t MakeSortKey(int pass, int rasterizerState, int shader, int material, int mesh, float depth);
+
+	// Sets the constants of the materials draws refer to by index, which are uploaded to the
+	// material slot as the draws need them. Until it is called the queue leaves the slot alone,
+	// and the material of each draw is only sorted by.
+	void SetMaterials(const MaterialConstants * materials, int count);
+
+	// Starts a new frame, forgetting the draws and meshes submitted during the last one
+	void Begin();
+
+	// depth is the object's distance along the view direction. The draw is refused, and false
+	// returned, when one of its ids is past its MAX_ constant or the frame already has MAX_MESHES
+	// other meshes.
+	bool Submit(int pass, int rasterizerState, int shader, int material, const MeshData& meshData, float depth, const XMFLOAT4X4& world);
+
+	// Radix sorts the packets by their keys
+	void Sort();
+
+	// Sorts the packets, then binds state, uploads each world matrix and draws. The object
+	// constants are packed on the job system's threads when one is given.
+	void Flush(RenderDevice& renderDevice, ConstantBufferCache& constantBufferCache, JobSystem * jobSystem = nullptr);
+
+	// Sorts the packets, then records them on the job system's threads, drawsPerBuffer draws to
+	// each command buffer. Each buffer starts from the state the previous one leaves bound, so
+	// replaying them in order makes exactly the calls Flush would with an invalidated cache.
+	// The object and material constant buffer slots are changed by the replay without going
+	// through a cache.
+	void Record(JobSystem& jobSystem, vector<CommandBuffer>& commandBuffers, int drawsPerBuffer);
+
+	int GetPacketCount() const { return (int)_packets.size(); }
+	uint64_t GetSortKey(int i) const { return _packets[i].sortKey; }
+	const Stats& GetStats() const { return _stats; }
+};
@@ -0,0 +1,60 @@
+// Compiles a scene's text into a scene file that the application can load with one read, or with
+// -text writes a scene file back out as text. Either form is accepted as the input.
+//
+// Usage: SceneConverter [-text] input.scene output.bscene
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "SceneFile.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	bool text = argc == 4 && strcmp(argv[1], "-text") == 0;
+	if (argc != (text ? 4 : 3))
+	{
+		fprintf(stderr, "Usage: %s [-text] input.scene output.bscene\n", argv[0]);
+		return 1;
+	}
+
+	const char * inputPath = argv[argc - 2];
+	const char * outputPath = argv[argc - 1];
+
+	auto start = chrono::steady_clock::now();
+
+	SceneFile input;
+	if (!input.Load(inputPath))
+	{
+		fprintf(stderr, "%s: %s\n", inputPath, input.GetError().c_str());
+		return 1;
+	}
+
+	SceneDescription scene;
+	input.GetDescription(scene);
+
+	string error;
+	if (!(text ? WriteSceneText(outputPath, scene, error) : WriteSceneFile(outputPath, scene, error)))
+	{
+		fprintf(stderr, "%s: %s\n", outputPath, error.c_str());
+		return 1;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Read the file back to check it
+	SceneFile output;
+	if (!output.Load(outputPath))
+	{
+		fprintf(stderr, "%s: %s\n", outputPath, output.GetError().c_str());
+		return 1;
+	}
+
+	printf("%s: %d meshes, %d materials, %d bodies, %u asteroids, %llu bytes compiled, %.3f s\n", outputPath,
+		output.GetMeshCount(), output.GetMaterialCount(), output.GetBodyCount(), output.GetBelt().count,
+		(unsigned long long)output.GetSize(), seconds);
+
+	return 0;
+}
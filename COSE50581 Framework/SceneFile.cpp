@@ -0,0 +1,1049 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+const uint32_t SceneFileHeader::VERSION;
+const uint32_t SceneFileHeader::DATA_ALIGNMENT;
+
+static const char SCENE_FILE_MAGIC[8] = { 'S', 'S', 'S', 'C', 'E', 'N', 'E', 0 };
+
+static_assert(sizeof(ScenePointer<const char>) == 8, "References are eight bytes on disk whatever the size of a pointer");
+static_assert(sizeof(SceneMesh) == 8, "Meshes are written as they are laid out in memory");
+static_assert(sizeof(SceneMaterial) == 64, "Materials are written as they are laid out in memory");
+static_assert(sizeof(SceneBody) == 80, "Bodies are written as they are laid out in memory");
+static_assert(sizeof(SceneBelt) == 40, "The belt is written as it is laid out in memory");
+static_assert(sizeof(SceneFileHeader) == 112, "The scene file header is written as it is laid out in memory");
+
+// Generated planets start this far outside the belt and the bodies already there, and are spaced
+// so that their moons' orbits never meet
+static const float GENERATED_ORBIT_MARGIN = 1.5f;
+static const float GENERATED_PLANET_SCALE = 0.3f;
+static const float GENERATED_PLANET_SPIN = -1.0f;
+static const float GENERATED_MOON_SCALE = 0.08f;
+static const float GENERATED_MOON_ORBIT_START = 0.5f;
+static const float GENERATED_MOON_ORBIT_SPACING = 0.2f;
+static const float GENERATED_MOON_RATE = -3.0f;
+// The golden angle, in radians
+static const float GOLDEN_ANGLE = 2.39996323f;
+
+SceneDescription::SceneDescription()
+{
+	// The belt the solar system had before scenes were written down, without asteroids until a
+	// scene asks for them
+	belt.mesh = -1;
+	belt.material = -1;
+	belt.count = 0;
+	belt.scale = 0.01f;
+	belt.innerRadius = 4.5f;
+	belt.outerRadius = 6.5f;
+	belt.thickness = 0.1f;
+	belt.mass = 0.0027f;
+}
+
+SceneDescription::Body SceneDescription::DefaultBody()
+{
+	Body body;
+	body.parent = -1;
+	body.mesh = -1;
+	body.material = -1;
+	body.scale = 1.0f;
+	body.spinPhase = 0.0f;
+	body.spinRate = 0.0f;
+	body.orbitRadius = 0.0f;
+	body.orbitPhase = 0.0f;
+	body.orbitRate = 0.0f;
+	body.offset[0] = body.offset[1] = body.offset[2] = 0.0f;
+	body.mass = 0.0f;
+	body.radius = 0.0f;
+	return body;
+}
+
+SceneDescription::Material SceneDescription::DefaultMaterial()
+{
+	Material material;
+	for (int i = 0; i < 4; i++)
+	{
+		material.diffuse[i] = 1.0f;
+		material.ambient[i] = 1.0f;
+		material.specular[i] = 1.0f;
+	}
+	material.specularPower = 10.0f;
+	material.wireframe = false;
+	return material;
+}
+
+int SceneDescription::FindMesh(const string& name) const
+{
+	for (int i = 0; i < (int)meshes.size(); i++)
+	{
+		if (meshes[i] == name)
+			return i;
+	}
+
+	return -1;
+}
+
+int SceneDescription::FindMaterial(const string& name) const
+{
+	for (int i = 0; i < (int)materials.size(); i++)
+	{
+		if (materials[i].name == name)
+			return i;
+	}
+
+	return -1;
+}
+
+namespace
+{
+	// The tokens of one line of the text form, split on spaces and tabs
+	class LineTokens
+	{
+	private:
+		const char * _next;
+		const char * _end;
+
+	public:
+		LineTokens(const char * begin, const char * end)
+		{
+			_next = begin;
+			_end = end;
+		}
+
+		bool Next(const char *& token, size_t& length)
+		{
+			while (_next < _end && (*_next == ' ' || *_next == '\t' || *_next == '\r'))
+				_next++;
+
+			if (_next == _end)
+				return false;
+
+			token = _next;
+			while (_next < _end && *_next != ' ' && *_next != '\t' && *_next != '\r')
+				_next++;
+
+			length = _next - token;
+			return true;
+		}
+
+		bool Next(string& token)
+		{
+			const char * start;
+			size_t length;
+			if (!Next(start, length))
+				return false;
+
+			token.assign(start, length);
+			return true;
+		}
+
+		bool NextFloat(float& value)
+		{
+			const char * start;
+			size_t length;
+			if (!Next(start, length) || length >= 64)
+				return false;
+
+			// The text isn't terminated after the token, so it is copied to somewhere that is
+			char buffer[64];
+			memcpy(buffer, start, length);
+			buffer[length] = 0;
+
+			char * end;
+			value = strtof(buffer, &end);
+			return end == buffer + length;
+		}
+
+		bool NextInt(int& value)
+		{
+			const char * start;
+			size_t length;
+			if (!Next(start, length) || length >= 64)
+				return false;
+
+			char buffer[64];
+			memcpy(buffer, start, length);
+			buffer[length] = 0;
+
+			char * end;
+			long parsed = strtol(buffer, &end, 10);
+			value = (int)parsed;
+			return end == buffer + length && parsed >= INT_MIN && parsed <= INT_MAX;
+		}
+
+		bool NextFloats(float * values, int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				if (!NextFloat(values[i]))
+					return false;
+			}
+
+			return true;
+		}
+
+		bool AtEnd()
+		{
+			const char * start;
+			size_t length;
+			return !Next(start, length);
+		}
+	};
+
+	bool Is(const char * token, size_t length, const char * keyword)
+	{
+		return strlen(keyword) == length && memcmp(token, keyword, length) == 0;
+	}
+
+	enum BlockType
+	{
+		BLOCK_NONE,
+		BLOCK_MESH,
+		BLOCK_MATERIAL,
+		BLOCK_BODY,
+		BLOCK_BELT
+	};
+
+	bool ParseMaterialField(const char * key, size_t keyLength, LineTokens& tokens, SceneDescription::Material& material)
+	{
+		if (Is(key, keyLength, "diffuse"))
+			return tokens.NextFloats(material.diffuse, 4);
+		if (Is(key, keyLength, "ambient"))
+			return tokens.NextFloats(material.ambient, 4);
+		if (Is(key, keyLength, "specular"))
+			return tokens.NextFloats(material.specular, 4);
+		if (Is(key, keyLength, "power"))
+			return tokens.NextFloat(material.specularPower);
+
+		if (Is(key, keyLength, "wireframe"))
+		{
+			int wireframe;
+			if (!tokens.NextInt(wireframe))
+				return false;
+
+			material.wireframe = wireframe != 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ParseBodyField(const char * key, size_t keyLength, LineTokens& tokens, SceneDescription::Body& body)
+	{
+		if (Is(key, keyLength, "scale"))
+			return tokens.NextFloat(body.scale);
+		if (Is(key, keyLength, "spin"))
+			return tokens.NextFloat(body.spinPhase) && tokens.NextFloat(body.spinRate);
+		if (Is(key, keyLength, "orbit"))
+			return tokens.NextFloat(body.orbitRadius) && tokens.NextFloat(body.orbitPhase) && tokens.NextFloat(body.orbitRate);
+		if (Is(key, keyLength, "offset"))
+			return tokens.NextFloats(body.offset, 3);
+		if (Is(key, keyLength, "mass"))
+			return tokens.NextFloat(body.mass);
+		if (Is(key, keyLength, "radius"))
+			return tokens.NextFloat(body.radius);
+
+		return false;
+	}
+
+	bool ParseBeltField(const char * key, size_t keyLength, LineTokens& tokens, SceneDescription::Belt& belt)
+	{
+		if (Is(key, keyLength, "count"))
+		{
+			return tokens.NextInt(belt.count) && belt.count >= 0;
+		}
+
+		if (Is(key, keyLength, "scale"))
+			return tokens.NextFloat(belt.scale);
+		if (Is(key, keyLength, "ring"))
+			return tokens.NextFloat(belt.innerRadius) && tokens.NextFloat(belt.outerRadius) && tokens.NextFloat(belt.thickness);
+		if (Is(key, keyLength, "mass"))
+			return tokens.NextFloat(belt.mass);
+
+		return false;
+	}
+
+	bool Fail(string& error, int line, const string& message)
+	{
+		error = "line " + to_string(line) + ": " + message;
+		return false;
+	}
+}
+
+bool ParseScene(const char * text, size_t length, SceneDescription& scene, string& error)
+{
+	scene = SceneDescription();
+
+	// Bodies are looked up by name for every parent, so there are too many to search one by one
+	unordered_map<string, int> bodyIndices;
+
+	BlockType block = BLOCK_NONE;
+	const char * end = text + length;
+	int lineNumber = 0;
+	string name;
+
+	for (const char * line = text; line < end; )
+	{
+		const char * lineEnd = (const char *)memchr(line, '\n', end - line);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		lineNumber++;
+
+		const char * comment = (const char *)memchr(line, '#', lineEnd - line);
+		LineTokens tokens(line, comment ? comment : lineEnd);
+		bool indented = *line == ' ' || *line == '\t';
+		const char * next = lineEnd + 1;
+
+		const char * key;
+		size_t keyLength;
+		if (!tokens.Next(key, keyLength))
+		{
+			line = next;
+			continue;
+		}
+
+		if (!indented)
+		{
+			// A line that isn't indented starts a block, and names what it describes
+			if (Is(key, keyLength, "belt"))
+			{
+				block = BLOCK_BELT;
+				if (!tokens.AtEnd())
+					return Fail(error, lineNumber, "the belt has no name");
+
+				line = next;
+				continue;
+			}
+
+			if (!tokens.Next(name) || !tokens.AtEnd())
+				return Fail(error, lineNumber, "expected a block type and a name");
+
+			if (Is(key, keyLength, "mesh"))
+			{
+				if (scene.FindMesh(name) >= 0)
+					return Fail(error, lineNumber, "there is already a mesh called " + name);
+
+				block = BLOCK_MESH;
+				scene.meshes.push_back(name);
+			}
+			else if (Is(key, keyLength, "material"))
+			{
+				if (scene.FindMaterial(name) >= 0)
+					return Fail(error, lineNumber, "there is already a material called " + name);
+
+				block = BLOCK_MATERIAL;
+				scene.materials.push_back(SceneDescription::DefaultMaterial());
+				scene.materials.back().name = name;
+			}
+			else if (Is(key, keyLength, "body"))
+			{
+				if (!bodyIndices.insert(make_pair(name, (int)scene.bodies.size())).second)
+					return Fail(error, lineNumber, "there is already a body called " + name);
+
+				block = BLOCK_BODY;
+				scene.bodies.push_back(SceneDescription::DefaultBody());
+				scene.bodies.back().name = name;
+			}
+			else
+			{
+				return Fail(error, lineNumber, "unknown block type " + string(key, keyLength));
+			}
+
+			line = next;
+			continue;
+		}
+
+		// The fields that refer to other blocks by name
+		bool isMesh = Is(key, keyLength, "mesh");
+		bool isMaterial = Is(key, keyLength, "material");
+		bool isParent = Is(key, keyLength, "parent");
+		bool parsed = false;
+
+		if ((isMesh || isMaterial) && (block == BLOCK_BODY || block == BLOCK_BELT))
+		{
+			if (!tokens.Next(name))
+				return Fail(error, lineNumber, "expected a name");
+
+			int index = isMesh ? scene.FindMesh(name) : scene.FindMaterial(name);
+			if (index < 0)
+				return Fail(error, lineNumber, string("no ") + (isMesh ? "mesh" : "material") + " called " + name);
+
+			int& field = block == BLOCK_BELT ? (isMesh ? scene.belt.mesh : scene.belt.material) :
+				(isMesh ? scene.bodies.back().mesh : scene.bodies.back().material);
+			field = index;
+			parsed = true;
+		}
+		else if (isParent && block == BLOCK_BODY)
+		{
+			if (!tokens.Next(name))
+				return Fail(error, lineNumber, "expected a name");
+
+			auto parent = bodyIndices.find(name);
+			if (parent == bodyIndices.end())
+				return Fail(error, lineNumber, "no body called " + name + " before this one");
+
+			scene.bodies.back().parent = parent->second;
+			parsed = true;
+		}
+		else if (block == BLOCK_MATERIAL)
+		{
+			parsed = ParseMaterialField(key, keyLength, tokens, scene.materials.back());
+		}
+		else if (block == BLOCK_BODY)
+		{
+			parsed = ParseBodyField(key, keyLength, tokens, scene.bodies.back());
+		}
+		else if (block == BLOCK_BELT)
+		{
+			parsed = ParseBeltField(key, keyLength, tokens, scene.belt);
+		}
+
+		if (!parsed || !tokens.AtEnd())
+			return Fail(error, lineNumber, "can't read the field " + string(key, keyLength));
+
+		line = next;
+	}
+
+	if (scene.belt.count > 0 && scene.belt.mesh < 0)
+		return Fail(error, lineNumber, "the belt has asteroids but no mesh");
+
+	return true;
+}
+
+namespace
+{
+	bool ReadWholeFile(FILE * file, vector<char>& contents)
+	{
+		if (fseek(file, 0, SEEK_END) != 0)
+			return false;
+
+		long size = ftell(file);
+		if (size < 0 || fseek(file, 0, SEEK_SET) != 0)
+			return false;
+
+		contents.resize((size_t)size);
+		return size == 0 || fread(contents.data(), 1, (size_t)size, file) == (size_t)size;
+	}
+}
+
+bool LoadSceneText(const char * path, SceneDescription& scene, string& error)
+{
+	FILE * file = fopen(path, "rb");
+	if (!file)
+	{
+		error = string("could not open ") + path;
+		return false;
+	}
+
+	vector<char> text;
+	bool read = ReadWholeFile(file, text);
+	fclose(file);
+
+	if (!read)
+	{
+		error = string("could not read ") + path;
+		return false;
+	}
+
+	return ParseScene(text.data(), text.size(), scene, error);
+}
+
+bool WriteSceneText(const char * path, const SceneDescription& scene, string& error)
+{
+	FILE * file = fopen(path, "w");
+	if (!file)
+	{
+		error = string("could not create ") + path;
+		return false;
+	}
+
+	// Nine significant digits read back as the same float
+	for (const string& mesh : scene.meshes)
+	{
+		fprintf(file, "mesh %s\n", mesh.c_str());
+	}
+
+	for (const SceneDescription::Material& material : scene.materials)
+	{
+		fprintf(file, "\nmaterial %s\n", material.name.c_str());
+		fprintf(file, "\tdiffuse %.9g %.9g %.9g %.9g\n", material.diffuse[0], material.diffuse[1], material.diffuse[2], material.diffuse[3]);
+		fprintf(file, "\tambient %.9g %.9g %.9g %.9g\n", material.ambient[0], material.ambient[1], material.ambient[2], material.ambient[3]);
+		fprintf(file, "\tspecular %.9g %.9g %.9g %.9g\n", material.specular[0], material.specular[1], material.specular[2],
+			material.specular[3]);
+		fprintf(file, "\tpower %.9g\n", material.specularPower);
+		if (material.wireframe)
+			fprintf(file, "\twireframe 1\n");
+	}
+
+	// Only the fields that differ from a default body are written
+	const SceneDescription::Body defaultBody = SceneDescription::DefaultBody();
+
+	for (const SceneDescription::Body& body : scene.bodies)
+	{
+		fprintf(file, "\nbody %s\n", body.name.c_str());
+		if (body.parent >= 0)
+			fprintf(file, "\tparent %s\n", scene.bodies[body.parent].name.c_str());
+		if (body.mesh >= 0)
+			fprintf(file, "\tmesh %s\n", scene.meshes[body.mesh].c_str());
+		if (body.material >= 0)
+			fprintf(file, "\tmaterial %s\n", scene.materials[body.material].name.c_str());
+		if (body.scale != defaultBody.scale)
+			fprintf(file, "\tscale %.9g\n", body.scale);
+		if (body.spinPhase != 0.0f || body.spinRate != 0.0f)
+			fprintf(file, "\tspin %.9g %.9g\n", body.spinPhase, body.spinRate);
+		if (body.orbitRadius != 0.0f || body.orbitPhase != 0.0f || body.orbitRate != 0.0f)
+			fprintf(file, "\torbit %.9g %.9g %.9g\n", body.orbitRadius, body.orbitPhase, body.orbitRate);
+		if (body.offset[0] != 0.0f || body.offset[1] != 0.0f || body.offset[2] != 0.0f)
+			fprintf(file, "\toffset %.9g %.9g %.9g\n", body.offset[0], body.offset[1], body.offset[2]);
+		if (body.mass != 0.0f)
+			fprintf(file, "\tmass %.9g\n", body.mass);
+		if (body.radius != 0.0f)
+			fprintf(file, "\tradius %.9g\n", body.radius);
+	}
+
+	const SceneDescription::Belt& belt = scene.belt;
+	fprintf(file, "\nbelt\n");
+	if (belt.mesh >= 0)
+		fprintf(file, "\tmesh %s\n", scene.meshes[belt.mesh].c_str());
+	if (belt.material >= 0)
+		fprintf(file, "\tmaterial %s\n", scene.materials[belt.material].name.c_str());
+	fprintf(file, "\tcount %d\n", belt.count);
+	fprintf(file, "\tscale %.9g\n", belt.scale);
+	fprintf(file, "\tring %.9g %.9g %.9g\n", belt.innerRadius, belt.outerRadius, belt.thickness);
+	fprintf(file, "\tmass %.9g\n", belt.mass);
+
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		error = string("could not write ") + path;
+
+	return ok;
+}
+
+namespace
+{
+	uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + SceneFileHeader::DATA_ALIGNMENT - 1) & ~(uint64_t)(SceneFileHeader::DATA_ALIGNMENT - 1);
+	}
+
+	// Lays the scene out as a scene file, in a block of 64-bit words so that it is aligned for
+	// everything in it. Every reference is left as an offset.
+	bool CompileScene(const SceneDescription& scene, unique_ptr<uint64_t[]>& data, size_t& size, string& error)
+	{
+		int meshCount = (int)scene.meshes.size();
+		int materialCount = (int)scene.materials.size();
+		int bodyCount = (int)scene.bodies.size();
+
+		auto validReference = [](int index, int count) { return index >= -1 && index < count; };
+
+		for (int i = 0; i < bodyCount; i++)
+		{
+			const SceneDescription::Body& body = scene.bodies[i];
+			if (body.parent < -1 || body.parent >= i || !validReference(body.mesh, meshCount) ||
+				!validReference(body.material, materialCount))
+			{
+				error = "the body " + body.name + " refers to something that isn't in the scene, or to a parent after it";
+				return false;
+			}
+		}
+
+		const SceneDescription::Belt& belt = scene.belt;
+		if (!validReference(belt.mesh, meshCount) || !validReference(belt.material, materialCount) || belt.count < 0 ||
+			(belt.count > 0 && belt.mesh < 0))
+		{
+			error = "the belt refers to something that isn't in the scene, or has asteroids but no mesh";
+			return false;
+		}
+
+		// Every name, each followed by a zero
+		uint64_t namesSize = 0;
+		for (const string& mesh : scene.meshes)
+			namesSize += mesh.size() + 1;
+		for (const SceneDescription::Material& material : scene.materials)
+			namesSize += material.name.size() + 1;
+		for (const SceneDescription::Body& body : scene.bodies)
+			namesSize += body.name.size() + 1;
+
+		SceneFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+		header.version = SceneFileHeader::VERSION;
+		header.headerSize = sizeof(SceneFileHeader);
+		header.meshCount = meshCount;
+		header.materialCount = materialCount;
+		header.bodyCount = bodyCount;
+		header.meshOffset = AlignUp(sizeof(SceneFileHeader));
+		header.materialOffset = AlignUp(header.meshOffset + (uint64_t)meshCount * sizeof(SceneMesh));
+		header.bodyOffset = AlignUp(header.materialOffset + (uint64_t)materialCount * sizeof(SceneMaterial));
+		header.nameOffset = AlignUp(header.bodyOffset + (uint64_t)bodyCount * sizeof(SceneBody));
+		header.fileSize = header.nameOffset + namesSize;
+
+		auto meshOffset = [&](int index) { return index < 0 ? 0 : header.meshOffset + (uint64_t)index * sizeof(SceneMesh); };
+		auto materialOffset = [&](int index) { return index < 0 ? 0 : header.materialOffset + (uint64_t)index * sizeof(SceneMaterial); };
+		auto bodyOffset = [&](int index) { return index < 0 ? 0 : header.bodyOffset + (uint64_t)index * sizeof(SceneBody); };
+
+		header.belt.mesh.offset = meshOffset(belt.mesh);
+		header.belt.material.offset = materialOffset(belt.material);
+		header.belt.count = belt.count;
+		header.belt.scale = belt.scale;
+		header.belt.innerRadius = belt.innerRadius;
+		header.belt.outerRadius = belt.outerRadius;
+		header.belt.thickness = belt.thickness;
+		header.belt.mass = belt.mass;
+
+		size = (size_t)header.fileSize;
+		data.reset(new uint64_t[(size + 7) / 8]());
+		uint8_t * bytes = reinterpret_cast<uint8_t *>(data.get());
+
+		memcpy(bytes, &header, sizeof(header));
+
+		uint64_t nextName = header.nameOffset;
+		auto addName = [&](const string& name)
+		{
+			uint64_t offset = nextName;
+			memcpy(bytes + offset, name.c_str(), name.size() + 1);
+			nextName += name.size() + 1;
+			return offset;
+		};
+
+		SceneMesh * meshes = reinterpret_cast<SceneMesh *>(bytes + header.meshOffset);
+		for (int i = 0; i < meshCount; i++)
+		{
+			meshes[i].name.offset = addName(scene.meshes[i]);
+		}
+
+		SceneMaterial * materials = reinterpret_cast<SceneMaterial *>(bytes + header.materialOffset);
+		for (int i = 0; i < materialCount; i++)
+		{
+			const SceneDescription::Material& material = scene.materials[i];
+			materials[i].name.offset = addName(material.name);
+			memcpy(materials[i].diffuse, material.diffuse, sizeof(material.diffuse));
+			memcpy(materials[i].ambient, material.ambient, sizeof(material.ambient));
+			memcpy(materials[i].specular, material.specular, sizeof(material.specular));
+			materials[i].specularPower = material.specularPower;
+			materials[i].wireframe = material.wireframe ? 1 : 0;
+		}
+
+		SceneBody * bodies = reinterpret_cast<SceneBody *>(bytes + header.bodyOffset);
+		for (int i = 0; i < bodyCount; i++)
+		{
+			const SceneDescription::Body& body = scene.bodies[i];
+			SceneBody& compiled = bodies[i];
+			compiled.name.offset = addName(body.name);
+			compiled.parent.offset = bodyOffset(body.parent);
+			compiled.mesh.offset = meshOffset(body.mesh);
+			compiled.material.offset = materialOffset(body.material);
+			compiled.scale = body.scale;
+			compiled.spinPhase = body.spinPhase;
+			compiled.spinRate = body.spinRate;
+			compiled.orbitRadius = body.orbitRadius;
+			compiled.orbitPhase = body.orbitPhase;
+			compiled.orbitRate = body.orbitRate;
+			memcpy(compiled.offset, body.offset, sizeof(body.offset));
+			compiled.mass = body.mass;
+			compiled.radius = body.radius;
+			compiled.pad = 0;
+		}
+
+		return true;
+	}
+}
+
+bool WriteSceneFile(const char * path, const SceneDescription& scene, string& error)
+{
+	unique_ptr<uint64_t[]> data;
+	size_t size;
+	if (!CompileScene(scene, data, size, error))
+		return false;
+
+	FILE * file = fopen(path, "wb");
+	if (!file)
+	{
+		error = string("could not create ") + path;
+		return false;
+	}
+
+	bool ok = fwrite(data.get(), 1, size, file) == size;
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		error = string("could not write ") + path;
+
+	return ok;
+}
+
+void AddGeneratedBodies(SceneDescription& scene, int planetCount, int moonsPerPlanet)
+{
+	// The planets go round the first body with mass, as it would be without its own orbit, and at
+	// the speed of a circular orbit under its mass
+	const SceneDescription::Body * center = nullptr;
+	float start = scene.belt.count > 0 ? scene.belt.outerRadius : 0.0f;
+
+	for (const SceneDescription::Body& body : scene.bodies)
+	{
+		if (center == nullptr && body.mass > 0.0f)
+			center = &body;
+
+		if (body.parent < 0)
+			start = (max)(start, fabsf(body.orbitRadius));
+	}
+
+	SceneDescription::Body centerBody = center ? *center : SceneDescription::DefaultBody();
+	float centerMass = centerBody.mass > 0.0f ? centerBody.mass : 1.0f;
+	start += GENERATED_ORBIT_MARGIN;
+
+	float moonSystemRadius = GENERATED_MOON_ORBIT_START + moonsPerPlanet * GENERATED_MOON_ORBIT_SPACING;
+	float orbitSpacing = 2.0f * moonSystemRadius;
+	string prefix = "generated" + to_string(scene.bodies.size()) + "_";
+
+	scene.bodies.reserve(scene.bodies.size() + (size_t)planetCount * (2 + moonsPerPlanet));
+
+	for (int planet = 0; planet < planetCount; planet++)
+	{
+		string planetName = prefix + "planet" + to_string(planet);
+
+		// The orbit carries the planet and its moons, without turning them
+		SceneDescription::Body orbit = SceneDescription::DefaultBody();
+		orbit.name = planetName + "Orbit";
+		orbit.orbitRadius = start + planet * orbitSpacing;
+		orbit.orbitPhase = -planet * GOLDEN_ANGLE;
+		orbit.orbitRate = -sqrtf(centerMass / (orbit.orbitRadius * orbit.orbitRadius * orbit.orbitRadius));
+		orbit.spinPhase = orbit.orbitPhase;
+		orbit.spinRate = orbit.orbitRate;
+		memcpy(orbit.offset, centerBody.offset, sizeof(orbit.offset));
+
+		int orbitIndex = (int)scene.bodies.size();
+		scene.bodies.push_back(orbit);
+
+		SceneDescription::Body body = SceneDescription::DefaultBody();
+		body.name = planetName;
+		body.parent = orbitIndex;
+		body.mesh = centerBody.mesh;
+		body.material = centerBody.material;
+		body.scale = GENERATED_PLANET_SCALE;
+		body.spinRate = GENERATED_PLANET_SPIN;
+		scene.bodies.push_back(body);
+
+		for (int moon = 0; moon < moonsPerPlanet; moon++)
+		{
+			SceneDescription::Body moonBody = body;
+			moonBody.name = planetName + "Moon" + to_string(moon);
+			moonBody.scale = GENERATED_MOON_SCALE;
+			moonBody.orbitRadius = GENERATED_MOON_ORBIT_START + moon * GENERATED_MOON_ORBIT_SPACING;
+			moonBody.orbitPhase = -moon * GOLDEN_ANGLE;
+			moonBody.orbitRate = GENERATED_MOON_RATE / (moon + 1);
+			moonBody.spinPhase = moonBody.orbitPhase;
+			moonBody.spinRate = moonBody.orbitRate;
+			scene.bodies.push_back(moonBody);
+		}
+	}
+}
+
+SceneFile::SceneFile()
+{
+	_size = 0;
+}
+
+SceneFile::~SceneFile()
+{
+}
+
+bool SceneFile::Load(const char * path)
+{
+	FILE * file = fopen(path, "rb");
+	if (!file)
+	{
+		_data.reset();
+		_error = string("could not open ") + path;
+		return false;
+	}
+
+	return Read(file, path);
+}
+
+#ifdef _WIN32
+bool SceneFile::Load(const wchar_t * path)
+{
+	FILE * file = _wfopen(path, L"rb");
+	if (!file)
+	{
+		_data.reset();
+		_error = "could not open the scene";
+		return false;
+	}
+
+	return Read(file, "the scene");
+}
+#endif
+
+bool SceneFile::Read(FILE * file, const string& name)
+{
+	// The whole file goes into the block the scene is used from, in one read
+	bool read = false;
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		long size = ftell(file);
+		if (size >= 0 && fseek(file, 0, SEEK_SET) == 0)
+		{
+			_size = (size_t)size;
+			_data.reset(new uint64_t[(_size + 7) / 8 + 1]);
+			read = fread(_data.get(), 1, _size, file) == _size;
+		}
+	}
+
+	fclose(file);
+
+	if (!read)
+	{
+		_data.reset();
+		_error = "could not read " + name;
+		return false;
+	}
+
+	if (_size >= sizeof(SCENE_FILE_MAGIC) && memcmp(_data.get(), SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) == 0)
+		return FixUp();
+
+	// Anything else is taken to be the text form
+	SceneDescription scene;
+	if (!ParseScene(reinterpret_cast<const char *>(_data.get()), _size, scene, _error))
+	{
+		_data.reset();
+		_error = name + ", " + _error;
+		return false;
+	}
+
+	return Load(scene);
+}
+
+bool SceneFile::Load(const void * data, size_t size)
+{
+	_size = size;
+	_data.reset(new uint64_t[(size + 7) / 8 + 1]);
+	memcpy(_data.get(), data, size);
+	return FixUp();
+}
+
+bool SceneFile::Load(const SceneDescription& scene)
+{
+	if (!CompileScene(scene, _data, _size, _error))
+	{
+		_data.reset();
+		return false;
+	}
+
+	return FixUp();
+}
+
+bool SceneFile::FixUp()
+{
+	uint8_t * bytes = reinterpret_cast<uint8_t *>(_data.get());
+	const SceneFileHeader& header = GetHeader();
+
+	auto fail = [this](const char * message)
+	{
+		_data.reset();
+		_error = message;
+		return false;
+	};
+
+	if (_size < sizeof(SceneFileHeader) || memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0)
+		return fail("not a scene file");
+	if (header.version != SceneFileHeader::VERSION || header.headerSize != sizeof(SceneFileHeader))
+		return fail("the scene file is from a different version");
+	if (header.fileSize != _size)
+		return fail("the scene file is the wrong size");
+
+	// The sections come in order, each aligned and inside the file, and the names end with a zero
+	// so that every name inside them is terminated. Each section is checked to fit before the
+	// next is compared with its end, so that no sum of an offset and a size can wrap around.
+	auto fits = [this](uint64_t offset, uint64_t size) { return offset <= _size && size <= _size - offset; };
+
+	uint64_t meshBytes = (uint64_t)header.meshCount * sizeof(SceneMesh);
+	uint64_t materialBytes = (uint64_t)header.materialCount * sizeof(SceneMaterial);
+	uint64_t bodyBytes = (uint64_t)header.bodyCount * sizeof(SceneBody);
+
+	if (header.meshOffset < sizeof(SceneFileHeader) || !fits(header.meshOffset, meshBytes) ||
+		header.materialOffset < header.meshOffset + meshBytes || !fits(header.materialOffset, materialBytes) ||
+		header.bodyOffset < header.materialOffset + materialBytes || !fits(header.bodyOffset, bodyBytes) ||
+		header.nameOffset < header.bodyOffset + bodyBytes || !fits(header.nameOffset, 0) ||
+		header.meshOffset % 8 != 0 || header.materialOffset % 8 != 0 || header.bodyOffset % 8 != 0 ||
+		header.bodyCount > (uint32_t)INT_MAX || header.belt.count > (uint32_t)INT_MAX)
+	{
+		return fail("the scene file's sections overlap or run past its end");
+	}
+
+	uint64_t meshEnd = header.meshOffset + meshBytes;
+	uint64_t materialEnd = header.materialOffset + materialBytes;
+
+	if (header.nameOffset < _size && bytes[_size - 1] != 0)
+		return fail("the scene file's names aren't terminated");
+
+	auto fixName = [&](ScenePointer<const char>& name)
+	{
+		if (name.offset < header.nameOffset || name.offset >= _size)
+			return false;
+
+		name.pointer = reinterpret_cast<const char *>(bytes + name.offset);
+		return true;
+	};
+
+	// A reference is null, or the start of an element of its section before the limit
+	auto fixReference = [bytes](uint64_t offset, uint64_t sectionOffset, uint64_t size, uint64_t limit) -> const void *
+	{
+		if (offset == 0)
+			return nullptr;
+
+		if (offset < sectionOffset || offset >= limit || (offset - sectionOffset) % size != 0)
+			return bytes;
+
+		return bytes + offset;
+	};
+
+	auto fixMesh = [&](ScenePointer<const SceneMesh>& mesh)
+	{
+		const void * pointer = fixReference(mesh.offset, header.meshOffset, sizeof(SceneMesh), meshEnd);
+		mesh.pointer = static_cast<const SceneMesh *>(pointer);
+		return pointer != bytes;
+	};
+
+	auto fixMaterial = [&](ScenePointer<const SceneMaterial>& material)
+	{
+		const void * pointer = fixReference(material.offset, header.materialOffset, sizeof(SceneMaterial), materialEnd);
+		material.pointer = static_cast<const SceneMaterial *>(pointer);
+		return pointer != bytes;
+	};
+
+	SceneMesh * meshes = reinterpret_cast<SceneMesh *>(bytes + header.meshOffset);
+	for (uint32_t i = 0; i < header.meshCount; i++)
+	{
+		if (!fixName(meshes[i].name))
+			return fail("a mesh's name is outside the names");
+	}
+
+	SceneMaterial * materials = reinterpret_cast<SceneMaterial *>(bytes + header.materialOffset);
+	for (uint32_t i = 0; i < header.materialCount; i++)
+	{
+		if (!fixName(materials[i].name))
+			return fail("a material's name is outside the names");
+	}
+
+	SceneBody * bodies = reinterpret_cast<SceneBody *>(bytes + header.bodyOffset);
+	for (uint32_t i = 0; i < header.bodyCount; i++)
+	{
+		SceneBody& body = bodies[i];
+
+		// A parent always comes before its child, so there can be no loops
+		uint64_t bodyOffset = header.bodyOffset + (uint64_t)i * sizeof(SceneBody);
+		const void * parent = fixReference(body.parent.offset, header.bodyOffset, sizeof(SceneBody), bodyOffset);
+		body.parent.pointer = static_cast<const SceneBody *>(parent);
+
+		if (!fixName(body.name) || parent == bytes || !fixMesh(body.mesh) || !fixMaterial(body.material))
+			return fail("a body refers outside the scene, or to a parent after it");
+	}
+
+	SceneFileHeader& writableHeader = *reinterpret_cast<SceneFileHeader *>(bytes);
+	if (!fixMesh(writableHeader.belt.mesh) || !fixMaterial(writableHeader.belt.material) ||
+		(header.belt.count > 0 && header.belt.mesh.pointer == nullptr))
+	{
+		return fail("the belt refers outside the scene, or has asteroids but no mesh");
+	}
+
+	return true;
+}
+
+const SceneMesh * SceneFile::GetMeshes() const
+{
+	return reinterpret_cast<const SceneMesh *>(reinterpret_cast<const uint8_t *>(_data.get()) + GetHeader().meshOffset);
+}
+
+const SceneMaterial * SceneFile::GetMaterials() const
+{
+	return reinterpret_cast<const SceneMaterial *>(reinterpret_cast<const uint8_t *>(_data.get()) + GetHeader().materialOffset);
+}
+
+const SceneBody * SceneFile::GetBodies() const
+{
+	return reinterpret_cast<const SceneBody *>(reinterpret_cast<const uint8_t *>(_data.get()) + GetHeader().bodyOffset);
+}
+
+int SceneFile::FindMesh(const char * name) const
+{
+	for (int i = 0; i < GetMeshCount(); i++)
+	{
+		if (strcmp(GetMeshes()[i].name.pointer, name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+int SceneFile::FindBody(const char * name) const
+{
+	for (int i = 0; i < GetBodyCount(); i++)
+	{
+		if (strcmp(GetBodies()[i].name.pointer, name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+void SceneFile::GetDescription(SceneDescription& scene) const
+{
+	scene = SceneDescription();
+
+	for (int i = 0; i < GetMeshCount(); i++)
+	{
+		scene.meshes.push_back(GetMeshes()[i].name.pointer);
+	}
+
+	for (int i = 0; i < GetMaterialCount(); i++)
+	{
+		const SceneMaterial& compiled = GetMaterials()[i];
+		SceneDescription::Material material;
+		material.name = compiled.name.pointer;
+		memcpy(material.diffuse, compiled.diffuse, sizeof(material.diffuse));
+		memcpy(material.ambient, compiled.ambient, sizeof(material.ambient));
+		memcpy(material.specular, compiled.specular, sizeof(material.specular));
+		material.specularPower = compiled.specularPower;
+		material.wireframe = compiled.wireframe != 0;
+		scene.materials.push_back(material);
+	}
+
+	scene.bodies.resize(GetBodyCount());
+	for (int i = 0; i < GetBodyCount(); i++)
+	{
+		const SceneBody& compiled = GetBodies()[i];
+		SceneDescription::Body& body = scene.bodies[i];
+		body.name = compiled.name.pointer;
+		body.parent = GetBodyIndex(compiled.parent.pointer);
+		body.mesh = GetMeshIndex(compiled.mesh.pointer);
+		body.material = GetMaterialIndex(compiled.material.pointer);
+		body.scale = compiled.scale;
+		body.spinPhase = compiled.spinPhase;
+		body.spinRate = compiled.spinRate;
+		body.orbitRadius = compiled.orbitRadius;
+		body.orbitPhase = compiled.orbitPhase;
+		body.orbitRate = compiled.orbitRate;
+		memcpy(body.offset, compiled.offset, sizeof(body.offset));
+		body.mass = compiled.mass;
+		body.radius = compiled.radius;
+	}
+
+	const SceneBelt& belt = GetBelt();
+	scene.belt.mesh = GetMeshIndex(belt.mesh.pointer);
+	scene.belt.material = GetMaterialIndex(belt.material.pointer);
+	scene.belt.count = (int)belt.count;
+	scene.belt.scale = belt.scale;
+	scene.belt.innerRadius = belt.innerRadius;
+	scene.belt.outerRadius = belt.outerRadius;
+	scene.belt.thickness = belt.thickness;
+	scene.belt.mass = belt.mass;
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A scene describes the bodies of a solar system: their hierarchy, how they orbit and spin,
+// what they pull with under gravity, the materials they are drawn with, the names of the meshes
+// they are drawn with, and the asteroid belt. It is written as text, and compiled into a scene
+// file that loads with one read.
+//
+// The text form is a list of blocks. Each starts with a line naming the mesh, material, body or
+// belt, and the indented lines after it set its fields. Names are referred to by later blocks,
+// so a parent comes before its children. Anything after a # is a comment.
+//
+//   mesh body
+//   material planet
+//       diffuse 0.25 0.5 1 1
+//       wireframe 1
+//   body sun
+//       mesh body
+//       scale 0.75
+//       spin 0 1
+//       offset 0 10 0
+//
+// A body's local matrix is its scale, then its spin about y, then a move out along x by its
+// orbit radius turned about y by its orbit angle, then its offset. Angles are in radians, and
+// each is its phase plus its rate times the time in seconds, turning the way XMMatrixRotationY
+// does. Bodies without a mesh are drawn as nothing, and only carry their children.
+//
+// In the compiled form the header is followed by the meshes, materials, bodies and the names,
+// each starting on a 16 byte boundary. The structures are written as they are laid out in memory,
+// with every reference as a byte offset from the start of the file, zero for none. Loading reads
+// the whole file into one block, checks every offset and turns it into a pointer in place.
+// Everything is little endian.
+
+// A reference from one part of a scene file to another, an offset on disk and a pointer once loaded
+template <typename T>
+union ScenePointer
+{
+	uint64_t offset;
+	T * pointer;
+};
+
+struct SceneMesh
+{
+	ScenePointer<const char> name;
+};
+
+struct SceneMaterial
+{
+	ScenePointer<const char> name;
+	float diffuse[4];
+	float ambient[4];
+	float specular[4];
+	float specularPower;
+	// Drawn in wireframe whatever the rasterizer state of the rest of the scene
+	uint32_t wireframe;
+};
+
+struct SceneBody
+{
+	ScenePointer<const char> name;
+	// Null for a body at the root of the hierarchy. Always comes before the body in the file.
+	ScenePointer<const SceneBody> parent;
+	ScenePointer<const SceneMesh> mesh;
+	ScenePointer<const SceneMaterial> material;
+
+	float scale;
+	float spinPhase;
+	float spinRate;
+	float orbitRadius;
+	float orbitPhase;
+	float orbitRate;
+	float offset[3];
+
+	// Bodies with mass pull on the asteroids under gravity, as spheres of this radius
+	float mass;
+	float radius;
+	uint32_t pad;
+};
+
+struct SceneBelt
+{
+	ScenePointer<const SceneMesh> mesh;
+	ScenePointer<const SceneMaterial> material;
+	uint32_t count;
+	float scale;
+	// The ring the belt is placed in under gravity, and the mass of all its asteroids together
+	float innerRadius;
+	float outerRadius;
+	float thickness;
+	float mass;
+};
+
+struct SceneFileHeader
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t DATA_ALIGNMENT = 16;
+
+	// "SSSCENE" followed by a zero byte
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+
+	uint32_t meshCount;
+	uint32_t materialCount;
+	uint32_t bodyCount;
+	uint32_t pad;
+
+	uint64_t meshOffset;
+	uint64_t materialOffset;
+	uint64_t bodyOffset;
+	uint64_t nameOffset;
+	uint64_t fileSize;
+
+	SceneBelt belt;
+};
+
+// A scene as it is built or parsed, before being compiled. References are indices, -1 for none.
+struct SceneDescription
+{
+	struct Material
+	{
+		string name;
+		float diffuse[4];
+		float ambient[4];
+		float specular[4];
+		float specularPower;
+		bool wireframe;
+	};
+
+	struct Body
+	{
+		string name;
+		int parent;
+		int mesh;
+		int material;
+		float scale;
+		float spinPhase;
+		float spinRate;
+		float orbitRadius;
+		float orbitPhase;
+		float orbitRate;
+		float offset[3];
+		float mass;
+		float radius;
+	};
+
+	struct Belt
+	{
+		int mesh;
+		int material;
+		int count;
+		float scale;
+		float innerRadius;
+		float outerRadius;
+		float thickness;
+		float mass;
+	};
+
+	vector<string> meshes;
+	vector<Material> materials;
+	vector<Body> bodies;
+	Belt belt;
+
+	SceneDescription();
+
+	// A body at the root with nothing to draw, no mass, and no scale, spin or orbit
+	static Body DefaultBody();
+	// White, with the specular power Lighting.fx was written for
+	static Material DefaultMaterial();
+
+	int FindMesh(const string& name) const;
+	int FindMaterial(const string& name) const;
+};
+
+// Parses the text form. On failure the error names the line.
+bool ParseScene(const char * text, size_t length, SceneDescription& scene, string& error);
+bool LoadSceneText(const char * path, SceneDescription& scene, string& error);
+bool WriteSceneText(const char * path, const SceneDescription& scene, string& error);
+
+// Compiles the scene and writes it as a scene file
+bool WriteSceneFile(const char * path, const SceneDescription& scene, string& error);
+
+// Adds planetCount planets to the scene, each with moonsPerPlanet moons, orbiting outside
+// everything already there around the first body with mass, and drawn with its mesh and
+// material. Consecutive planets and moons start a golden angle apart, so any number are spread
+// evenly round their orbits.
+void AddGeneratedBodies(SceneDescription& scene, int planetCount, int moonsPerPlanet);
+
+// A scene loaded into one block of memory. The pointers it gives out point into the block, and
+// stay valid until the scene is loaded again or destroyed.
+class SceneFile
+{
+private:
+	unique_ptr<uint64_t[]> _data;
+	size_t _size;
+	string _error;
+
+	// Reads the whole of the open file into the block and closes it
+	bool Read(FILE * file, const string& name);
+	// Turns every offset in the block into a pointer, checking it points where it should
+	bool FixUp();
+
+public:
+	SceneFile();
+	~SceneFile();
+
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+
+	// Loads a scene file, or parses and compiles the text form when the file doesn't start like
+	// one. On failure GetError says why.
+	bool Load(const char * path);
+#ifdef _WIN32
+	bool Load(const wchar_t * path);
+#endif
+	// Loads a compiled scene from memory, which is copied
+	bool Load(const void * data, size_t size);
+	// Compiles the scene in memory, as WriteSceneFile would write it
+	bool Load(const SceneDescription& scene);
+
+	bool IsLoaded() const { return _data != nullptr; }
+	const string& GetError() const { return _error; }
+	size_t GetSize() const { return _size; }
+
+	const SceneFileHeader& GetHeader() const { return *reinterpret_cast<const SceneFileHeader *>(_data.get()); }
+	int GetMeshCount() const { return (int)GetHeader().meshCount; }
+	int GetMaterialCount() const { return (int)GetHeader().materialCount; }
+	int GetBodyCount() const { return (int)GetHeader().bodyCount; }
+
+	const SceneMesh * GetMeshes() const;
+	const SceneMaterial * GetMaterials() const;
+	const SceneBody * GetBodies() const;
+	const SceneBelt& GetBelt() const { return GetHeader().belt; }
+
+	int GetMeshIndex(const SceneMesh * mesh) const { return mesh ? (int)(mesh - GetMeshes()) : -1; }
+	int GetMaterialIndex(const SceneMaterial * material) const { return material ? (int)(material - GetMaterials()) : -1; }
+	int GetBodyIndex(const SceneBody * body) const { return body ? (int)(body - GetBodies()) : -1; }
+
+	// -1 when there is none of that name
+	int FindMesh(const char * name) const;
+	int FindBody(const char * name) const;
+
+	// Copies the scene back out, to edit or write as text
+	void GetDescription(SceneDescription& scene) const;
+};
@@ -0,0 +1,214 @@
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "TransformKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+const int SceneGraph::NO_PARENT;
+
+// Nodes per job when a level is updated on several threads
+static const int UPDATE_GRAIN_SIZE = 1024;
+
+// The matrices are passed to the transform kernels as XMFLOAT4X4 arrays
+static_assert(sizeof(XMFLOAT4X4A) == sizeof(XMFLOAT4X4), "XMFLOAT4X4A must be laid out as XMFLOAT4X4");
+
+SceneGraph::SceneGraph()
+{
+	_firstDirty = 0;
+	_orderChanged = false;
+	_updatedCount = 0;
+}
+
+SceneGraph::~SceneGraph()
+{
+}
+
+int SceneGraph::AddNode(int parent)
+{
+	int handle = (int)_slots.size();
+	int slot = (int)_parents.size();
+
+	_parents.push_back(parent == NO_PARENT ? NO_PARENT : _slots[parent]);
+	_handles.push_back(handle);
+	_slots.push_back(slot);
+
+	XMFLOAT4X4A identity;
+	XMStoreFloat4x4A(&identity, XMMatrixIdentity());
+	_locals.push_back(identity);
+	_worlds.push_back(identity);
+
+	// New nodes are dirty so they pick up their parent's world matrix on the next update
+	_dirty.push_back(1);
+	_firstDirty = min(_firstDirty, slot);
+
+	// A child may belong in front of nodes that are already stored, and a root in front of
+	// deeper nodes, so re-sort before the next update
+	_orderChanged = true;
+
+	return handle;
+}
+
+void SceneGraph::SetLocal(int node, FXMMATRIX local)
+{
+	int slot = _slots[node];
+
+	XMStoreFloat4x4A(&_locals[slot], local);
+	_dirty[slot] = 1;
+	_firstDirty = min(_firstDirty, slot);
+}
+
+void SceneGraph::SortBreadthFirst()
+{
+	int count = (int)_parents.size();
+
+	// Parents are always added before their children, so one pass over the
+	// slots in their current order is enough to work out every depth
+	vector<int> depths(count);
+	for (int slot = 0; slot < count; slot++)
+	{
+		int parent = _parents[slot];
+		depths[slot] = parent == NO_PARENT ? 0 : depths[parent] + 1;
+	}
+
+	// Ordering by depth, keeping insertion order within a level, gives a breadth-first order
+	vector<int> order(count);
+	for (int slot = 0; slot < count; slot++)
+		order[slot] = slot;
+	stable_sort(order.begin(), order.end(), [&depths](int a, int b) { return depths[a] < depths[b]; });
+
+	_levelStarts.clear();
+	for (int newSlot = 0; newSlot < count; newSlot++)
+	{
+		if (newSlot == 0 || depths[order[newSlot]] != depths[order[newSlot - 1]])
+			_levelStarts.push_back(newSlot);
+	}
+	_levelStarts.push_back(count);
+
+	// Then each level after the first is ordered by where its parents went in the level above,
+	// which groups siblings together and keeps them in insertion order
+	vector<int> newSlots(count);
+	for (int level = 0; level + 1 < (int)_levelStarts.size(); level++)
+	{
+		int first = _levelStarts[level];
+		int end = _levelStarts[level + 1];
+
+		if (level > 0)
+		{
+			stable_sort(order.begin() + first, order.begin() + end,
+				[this, &newSlots](int a, int b) { return newSlots[_parents[a]] < newSlots[_parents[b]]; });
+		}
+
+		for (int newSlot = first; newSlot < end; newSlot++)
+			newSlots[order[newSlot]] = newSlot;
+	}
+
+	vector<int> parents(count);
+	vector<XMFLOAT4X4A> locals(count);
+	vector<XMFLOAT4X4A> worlds(count);
+	vector<unsigned char> dirty(count);
+	vector<int> handles(count);
+
+	for (int newSlot = 0; newSlot < count; newSlot++)
+	{
+		int oldSlot = order[newSlot];
+		int parent = _parents[oldSlot];
+
+		parents[newSlot] = parent == NO_PARENT ? NO_PARENT : newSlots[parent];
+		locals[newSlot] = _locals[oldSlot];
+		worlds[newSlot] = _worlds[oldSlot];
+		dirty[newSlot] = _dirty[oldSlot];
+		handles[newSlot] = _handles[oldSlot];
+		_slots[handles[newSlot]] = newSlot;
+	}
+
+	_parents.swap(parents);
+	_locals.swap(locals);
+	_worlds.swap(worlds);
+	_dirty.swap(dirty);
+	_handles.swap(handles);
+
+	// Dirty nodes may have moved anywhere, so the next update has to start from the top
+	_firstDirty = 0;
+	_orderChanged = false;
+}
+
+int SceneGraph::UpdateSlots(int first, int end)
+{
+	int updated = 0;
+	int slot = first;
+	while (slot < end)
+	{
+		int parent = _parents[slot];
+
+		// A parent is always stored before its children, so its flag already says
+		// whether its world matrix changed during this update
+		bool parentDirty = parent != NO_PARENT && _dirty[parent];
+		if (!_dirty[slot] && !parentDirty)
+		{
+			slot++;
+			continue;
+		}
+
+		// Siblings are stored next to each other, so the run of them that changed is multiplied
+		// by their parent's matrix in one batch. A run may be cut short where a chunk of a
+		// threaded update ends.
+		int runEnd = slot + 1;
+		while (runEnd < end && _parents[runEnd] == parent && (parentDirty || _dirty[runEnd]))
+		{
+			runEnd++;
+		}
+
+		if (parent == NO_PARENT)
+			copy(_locals.begin() + slot, _locals.begin() + runEnd, _worlds.begin() + slot);
+		else
+			MultiplyTransforms(&_locals[slot], _worlds[parent], &_worlds[slot], runEnd - slot);
+
+		memset(&_dirty[slot], 1, runEnd - slot);
+		updated += runEnd - slot;
+		slot = runEnd;
+	}
+
+	return updated;
+}
+
+void SceneGraph::UpdateWorlds(JobSystem * jobSystem)
+{
+	if (_orderChanged)
+		SortBreadthFirst();
+
+	int count = (int)_parents.size();
+	_updatedCount = 0;
+
+	if (_firstDirty >= count)
+		return;
+
+	if (jobSystem == nullptr)
+	{
+		_updatedCount = UpdateSlots(_firstDirty, count);
+	}
+	else
+	{
+		atomic<int> updated(0);
+
+		for (int level = 0; level + 1 < (int)_levelStarts.size(); level++)
+		{
+			int first = max(_levelStarts[level], _firstDirty);
+			int end = _levelStarts[level + 1];
+
+			if (first >= end)
+				continue;
+
+			jobSystem->ParallelFor(end - first, UPDATE_GRAIN_SIZE, [this, first, &updated](int chunkBegin, int chunkEnd)
+			{
+				updated.fetch_add(UpdateSlots(first + chunkBegin, first + chunkEnd), memory_order_relaxed);
+			});
+		}
+
+		_updatedCount = updated.load(memory_order_relaxed);
+	}
+
+	memset(&_dirty[_firstDirty], 0, count - _firstDirty);
+	_firstDirty = count;
+}
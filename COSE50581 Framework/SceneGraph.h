@@ -0,0 +1,68 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+using namespace std;
+
+class JobSystem;
+
+// A parent/child transform hierarchy. Every node has a local matrix, relative to its parent,
+// and a cached world matrix. World matrices are only recomputed for nodes whose local matrix
+// changed since the last update and for everything below them, so static nodes cost nothing.
+//
+// Nodes are stored flattened in breadth-first order, so a parent is always updated before its
+// children and the update is one forward walk through contiguous arrays. Within a level, the
+// children of each parent are stored next to each other, in the order they were added, so that
+// siblings are multiplied by their parent's matrix in one batch. Nodes are referred to by the
+// handle returned from AddNode, which stays valid when the storage is reordered.
+//
+// Each level of the tree is contiguous too, and no node depends on another in its own level,
+// so a level can be split between threads once the level above it is done.
+class SceneGraph
+{
+private:
+	// Indexed by storage slot, in breadth-first order
+	vector<int> _parents;
+	vector<XMFLOAT4X4A> _locals;
+	vector<XMFLOAT4X4A> _worlds;
+	vector<unsigned char> _dirty;
+	vector<int> _handles;
+
+	// The first slot of each level, followed by the node count
+	vector<int> _levelStarts;
+
+	// Indexed by handle
+	vector<int> _slots;
+
+	// The first slot that may need updating, or the node count when nothing is dirty
+	int _firstDirty;
+	bool _orderChanged;
+	int _updatedCount;
+
+	void SortBreadthFirst();
+	// Gives back how many world matrices it recomputed
+	int UpdateSlots(int first, int end);
+
+public:
+	static const int NO_PARENT = -1;
+
+	SceneGraph();
+	~SceneGraph();
+
+	// Adds a node with an identity local matrix under parent, which must already exist
+	int AddNode(int parent = NO_PARENT);
+
+	void SetLocal(int node, FXMMATRIX local);
+	XMFLOAT4X4 GetWorld(int node) const { return _worlds[_slots[node]]; }
+
+	int GetNodeCount() const { return (int)_slots.size(); }
+
+	// Recomputes the world matrices of the dirty nodes and their descendants, sharing each level
+	// out over the job system's threads when one is given
+	void UpdateWorlds(JobSystem * jobSystem = nullptr);
+
+	// How many world matrices the last UpdateWorlds recomputed
+	int GetUpdatedCount() const { return _updatedCount; }
+};
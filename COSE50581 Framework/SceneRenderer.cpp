@@ -0,0 +1,182 @@
+#include "SceneRenderer.h"
+#include "Profiler.h"
+
+const int SceneRenderer::DRAWS_PER_COMMAND_BUFFER;
+
+static MaterialConstants MakeMaterialConstants(const SolarSystem::Material& material)
+{
+	MaterialConstants materialConstants;
+	materialConstants.diffuseMaterial = material.diffuse;
+	materialConstants.gAmbientMtrl = material.ambient;
+	materialConstants.gSpecularMtrl = material.specular;
+	materialConstants.gSpecularPower = material.specularPower;
+	materialConstants.pad = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	return materialConstants;
+}
+
+SceneRenderer::SceneRenderer()
+{
+	XMStoreFloat4x4(&_view, XMMatrixIdentity());
+	_viewportHeight = 720;
+	_lodProjectionScale = 0.0f;
+	_lodStats = {};
+}
+
+SceneRenderer::~SceneRenderer()
+{
+}
+
+void SceneRenderer::SubmitObject(GameObject& gameObject, int rasterizerState, int material, int cullIndex)
+{
+	if (!_frustumCuller.IsVisible(cullIndex))
+	{
+		return;
+	}
+
+	UpdateLod(gameObject);
+
+	XMFLOAT4X4 world = gameObject.GetWorld();
+
+	// Draws that share all their state are sorted front to back, by distance along the view direction
+	XMVECTOR position = XMVectorSet(world._41, world._42, world._43, 1.0f);
+	float depth = XMVectorGetZ(XMVector3TransformCoord(position, XMLoadFloat4x4(&_view)));
+
+	_renderQueue.Submit(PASS_OPAQUE, rasterizerState, SHADER_LIT, material, gameObject.GetMeshData(), depth, world);
+}
+
+void SceneRenderer::UpdateLod(GameObject& gameObject)
+{
+	const LodChain * lodChain = gameObject.GetLodChain();
+	if (lodChain)
+	{
+		gameObject.UpdateLod(LodChain::GetScreenRadius(gameObject.GetBoundingSphere(), _view, _lodProjectionScale));
+		_lodStats.levelObjects[gameObject.GetLodLevel()]++;
+	}
+
+	int triangles = (int)gameObject.GetMeshData().IndexCount / 3;
+	_lodStats.objects++;
+	_lodStats.triangles += triangles;
+	_lodStats.fullDetailTriangles += lodChain ? lodChain->GetTriangleCount(0) : triangles;
+}
+
+void SceneRenderer::Render(RenderDevice& renderDevice, JobSystem& jobSystem, SolarSystem& solarSystem, const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection, const XMFLOAT3& eyePosition, bool wireframe, bool drawSolarSystem)
+{
+	PROFILE_ZONE("SceneRenderer::Render");
+
+	_view = view;
+
+	int rasterizerState = wireframe ? RS_WIREFRAME : RS_SOLID;
+
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	XMMATRIX projectionMatrix = XMLoadFloat4x4(&projection);
+
+	_lodProjectionScale = projection._22 * _viewportHeight * 0.5f;
+	_lodStats = {};
+
+	// The frame constants are the same for everything drawn this frame. The render queue
+	// uploads the material constants as the draws need them, and the object constants for each.
+	FrameConstants frameConstants;
+	frameConstants.mView = XMMatrixTranspose(viewMatrix);
+	frameConstants.mProjection = XMMatrixTranspose(projectionMatrix);
+	frameConstants.diffuseLight = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	frameConstants.lightVecW = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	frameConstants.gAmbientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	frameConstants.gSpecularLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	frameConstants.gEyePosW = eyePosition;
+	frameConstants.pad0 = 0.0f;
+	frameConstants.pad1 = 0.0f;
+
+	// The plane isn't part of the scene, and is drawn with the material the bodies used to share
+	int materialCount = solarSystem.GetMaterialCount();
+	int planeMaterial = materialCount;
+	_materials.resize(materialCount + 1);
+	for (int i = 0; i < materialCount; i++)
+	{
+		_materials[i] = MakeMaterialConstants(solarSystem.GetMaterial(i));
+	}
+
+	MaterialConstants& planeMaterialConstants = _materials[planeMaterial];
+	planeMaterialConstants.diffuseMaterial = XMFLOAT4(0.25f, 0.5f, 1.0f, 1.0f);
+	planeMaterialConstants.gAmbientMtrl = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	planeMaterialConstants.gSpecularMtrl = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	planeMaterialConstants.gSpecularPower = 10.0f;
+	planeMaterialConstants.pad = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	_renderQueue.SetMaterials(_materials.data(), (int)_materials.size());
+
+	_constantBufferCache.ResetStats();
+	_constantBufferCache.Update(renderDevice, CB_FRAME, &frameConstants, sizeof(frameConstants));
+
+	// Cull the bounding spheres of everything in the scene against the view frustum. The
+	// asteroids are found through their hierarchy, the bodies are tested together.
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, viewMatrix * projectionMatrix);
+	Frustum frustum = Frustum::FromViewProjection(viewProjection);
+
+	_frustumCuller.Clear();
+	_visibleAsteroids.clear();
+
+	if (drawSolarSystem)
+	{
+		solarSystem.GetAsteroidBvh().QueryFrustum(frustum, _visibleAsteroids);
+
+		for (int i = 0; i < solarSystem.GetBodyCount(); i++)
+		{
+			_frustumCuller.Add(solarSystem.GetBody(i).GetBoundingSphere());
+		}
+	}
+	else
+	{
+		_frustumCuller.Add(solarSystem.GetPlane().GetBoundingSphere());
+	}
+
+	_frustumCuller.Cull(frustum, jobSystem);
+
+	// Submit everything to the render queue, which sorts the draws by state and only binds what changes
+	_renderQueue.Begin();
+
+	if (drawSolarSystem)
+	{
+		for (int i = 0; i < solarSystem.GetBodyCount(); i++)
+		{
+			int bodyRasterizerState = solarSystem.GetBodyMaterial(i).wireframe ? RS_WIREFRAME : rasterizerState;
+			SubmitObject(solarSystem.GetBody(i), bodyRasterizerState, solarSystem.GetBodyMaterialIndex(i), i);
+		}
+	}
+	else
+	{
+		SubmitObject(solarSystem.GetPlane(), rasterizerState, planeMaterial, 0);
+	}
+
+	_renderQueue.Record(jobSystem, _commandBuffers, DRAWS_PER_COMMAND_BUFFER);
+
+	for (const CommandBuffer& commandBuffer : _commandBuffers)
+	{
+		commandBuffer.Replay(renderDevice);
+	}
+
+	// The replay sets the material slot behind the cache's back
+	if (_renderQueue.GetStats().materialConstantUploads > 0)
+		_constantBufferCache.Invalidate(CB_MATERIAL);
+
+	if (drawSolarSystem)
+	{
+		// The asteroids share one mesh, or a few levels of one, so they are drawn together as
+		// instances, one batch per level. Their world matrices go in the instance buffer, and the
+		// view and projection come from the frame constants.
+		_instanceBatcher.Begin();
+		for (int asteroid : _visibleAsteroids)
+		{
+			UpdateLod(solarSystem.GetAsteroid(asteroid));
+			_instanceBatcher.Add(solarSystem.GetAsteroid(asteroid));
+		}
+
+		int beltMaterial = solarSystem.GetBeltMaterialIndex();
+		_constantBufferCache.Update(renderDevice, CB_MATERIAL, &_materials[beltMaterial], sizeof(MaterialConstants));
+
+		renderDevice.SetRasterizerState(solarSystem.GetMaterial(beltMaterial).wireframe ? RS_WIREFRAME : rasterizerState);
+		renderDevice.SetShader(SHADER_INSTANCED);
+		_instanceBatcher.Submit(renderDevice);
+	}
+}
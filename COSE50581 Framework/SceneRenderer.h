@@ -0,0 +1,100 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "CommandBuffer.h"
+#include "ConstantBuffers.h"
+#include "Frustum.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "LodChain.h"
+#include "RenderDevice.h"
+#include "RenderQueue.h"
+#include "SolarSystem.h"
+
+using namespace DirectX;
+using namespace std;
+
+// The ids the render queue and render devices use for the passes and states in the scene
+enum RenderPass
+{
+	PASS_OPAQUE
+};
+
+enum RasterizerStateId
+{
+	RS_SOLID,
+	RS_WIREFRAME
+};
+
+enum ShaderId
+{
+	SHADER_LIT,
+	SHADER_INSTANCED
+};
+
+// Draws the solar system through any RenderDevice. It sets the frame and material constants,
+// culls against the view frustum, records the sorted draws into command buffers on the job
+// system's threads, replays them and then draws the asteroids instanced. Objects with a chain
+// of levels of detail are drawn with the level that suits their size on screen. Application renders
+// with it through Direct3D, and the headless driver through the software rasteriser.
+class SceneRenderer
+{
+public:
+	struct LodStats
+	{
+		// Objects drawn this frame
+		int objects;
+		int levelObjects[LodChain::MAX_LEVELS];
+		long long triangles;
+		// The triangles drawing every object at its most detailed level would take
+		long long fullDetailTriangles;
+	};
+
+private:
+	InstanceBatcher _instanceBatcher;
+	RenderQueue _renderQueue;
+	// The sorted draws are recorded into these on the job system's threads, then replayed in order
+	vector<CommandBuffer> _commandBuffers;
+
+	// Everything that might be drawn is tested against the view frustum together each frame
+	FrustumCuller _frustumCuller;
+	vector<int> _visibleAsteroids;
+
+	// Skips constant buffer uploads whose contents haven't changed, and counts the bytes sent
+	ConstantBufferCache _constantBufferCache;
+
+	// The solar system's materials, and the plane's after them, as the render queue uploads them
+	vector<MaterialConstants> _materials;
+
+	XMFLOAT4X4 _view;
+
+	int _viewportHeight;
+	// Turns a sphere's size and depth into its radius in pixels for the level of detail
+	float _lodProjectionScale;
+	LodStats _lodStats;
+
+	void SubmitObject(GameObject& gameObject, int rasterizerState, int material, int cullIndex);
+	// Picks the object's level of detail for this frame and counts its triangles
+	void UpdateLod(GameObject& gameObject);
+
+public:
+	// Draws recorded by each job when the render queue is recorded into command buffers
+	static const int DRAWS_PER_COMMAND_BUFFER = 256;
+
+	SceneRenderer();
+	~SceneRenderer();
+
+	// The height in pixels of the viewport drawn to, which the levels of detail are chosen for.
+	// 720 until it is set.
+	void SetViewportHeight(int viewportHeight) { _viewportHeight = viewportHeight; }
+
+	// Draws the plane, or the solar system when drawSolarSystem is set. Everything follows
+	// wireframe, and what the scene gives a wireframe material is always drawn in wireframe.
+	void Render(RenderDevice& renderDevice, JobSystem& jobSystem, SolarSystem& solarSystem, const XMFLOAT4X4& view,
+		const XMFLOAT4X4& projection, const XMFLOAT3& eyePosition, bool wireframe, bool drawSolarSystem);
+
+	const ConstantBufferStats& GetConstantBufferStats() const { return _constantBufferCache.GetStats(); }
+	const RenderQueue::Stats& GetQueueStats() const { return _renderQueue.GetStats(); }
+	const LodStats& GetLodStats() const { return _lodStats; }
+};
@@ -0,0 +1,74 @@
+#include "SimulationClock.h"
+
+#include <cmath>
+
+SimulationClock::SimulationClock(double stepSeconds, int maxStepsPerTick)
+{
+	_stepSeconds = stepSeconds;
+	_maxStepsPerTick = maxStepsPerTick;
+	Reset();
+}
+
+SimulationClock::~SimulationClock()
+{
+}
+
+void SimulationClock::Reset()
+{
+	_started = false;
+	_accumulator = 0.0;
+	_simulationTime = 0.0;
+	_stepCount = 0;
+	_droppedSeconds = 0.0;
+	_lastTickSeconds = 0.0;
+}
+
+int SimulationClock::Tick()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+	if (!_started)
+	{
+		_lastTick = now;
+		_started = true;
+		return 0;
+	}
+
+	double elapsedSeconds = chrono::duration<double>(now - _lastTick).count();
+	_lastTick = now;
+
+	return Tick(elapsedSeconds);
+}
+
+int SimulationClock::Tick(double elapsedSeconds)
+{
+	_lastTickSeconds = elapsedSeconds;
+	_accumulator += elapsedSeconds;
+
+	int steps = (int)(_accumulator / _stepSeconds);
+
+	if (steps > _maxStepsPerTick)
+	{
+		double excess = _accumulator - _maxStepsPerTick * _stepSeconds;
+
+		// Only whole steps are dropped, so the interpolation doesn't jump
+		double dropped = floor(excess / _stepSeconds) * _stepSeconds;
+		_accumulator -= dropped;
+		_droppedSeconds += dropped;
+		steps = _maxStepsPerTick;
+	}
+
+	return steps;
+}
+
+double SimulationClock::Step()
+{
+	_accumulator -= _stepSeconds;
+	if (_accumulator < 0.0)
+		_accumulator = 0.0;
+
+	_stepCount++;
+	_simulationTime += _stepSeconds;
+
+	return _simulationTime;
+}
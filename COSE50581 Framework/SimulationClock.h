@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+
+using namespace std;
+
+// Runs the simulation in fixed steps, decoupled from the frame rate. Each frame, Tick adds the
+// real time that has passed to an accumulator and says how many whole steps are due. The
+// caller runs that many, calling Step before each one, and then draws the scene interpolated
+// GetAlpha of the way from the previous step to the latest.
+//
+// Real time comes from steady_clock, which is monotonic and has sub-microsecond resolution.
+// When a frame takes so long that more than the maximum number of steps are due, the rest of
+// the time is dropped rather than carried over, so a slow frame can't make the next one
+// slower still.
+class SimulationClock
+{
+private:
+	chrono::steady_clock::time_point _lastTick;
+	bool _started;
+
+	double _stepSeconds;
+	int _maxStepsPerTick;
+
+	double _accumulator;
+	double _simulationTime;
+	long long _stepCount;
+	double _droppedSeconds;
+	double _lastTickSeconds;
+
+public:
+	explicit SimulationClock(double stepSeconds = 1.0 / 60.0, int maxStepsPerTick = 8);
+	~SimulationClock();
+
+	// Measures the real time since the last tick and returns the number of steps due. The first
+	// tick only starts the clock.
+	int Tick();
+
+	// Adds elapsedSeconds instead of measuring it, for fixed-rate and headless drivers
+	int Tick(double elapsedSeconds);
+
+	// Takes one step's time from the accumulator and returns the simulation time to update to
+	double Step();
+
+	// Forgets the accumulated time and restarts the simulation from zero
+	void Reset();
+
+	// How far between the previous step and the latest one the current frame is, from 0 to 1
+	float GetAlpha() const { return (float)(_accumulator / _stepSeconds); }
+
+	void SetStepSeconds(double stepSeconds) { _stepSeconds = stepSeconds; }
+	double GetStepSeconds() const { return _stepSeconds; }
+	double GetSimulationTime() const { return _simulationTime; }
+	long long GetStepCount() const { return _stepCount; }
+
+	// The real time the last tick added, for things that move with the frame rather than the steps
+	double GetLastTickSeconds() const { return _lastTickSeconds; }
+
+	// Real time that was dropped because too many steps were due at once
+	double GetDroppedSeconds() const { return _droppedSeconds; }
+};
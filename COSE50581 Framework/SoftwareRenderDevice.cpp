@@ -0,0 +1,768 @@
+#include "SoftwareRenderDevice.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_RASTERISER_SSE 1
+#include <emmintrin.h>
+#endif
+
+const int SoftwareRenderDevice::TILE_SIZE;
+const int SoftwareRenderDevice::GUARD_BAND;
+
+// Screen positions are snapped to 1/256 of a pixel. Inside the guard band that leaves the
+// differences between them exact, which the edge functions rely on.
+static const float SUB_PIXELS = 256.0f;
+
+// near, far, then the guard band's left, right, bottom and top
+static const int CLIP_PLANE_COUNT = 6;
+
+static float Snap(float value)
+{
+	return floorf(value * SUB_PIXELS + 0.5f) / SUB_PIXELS;
+}
+
+static float ClipDistance(const XMFLOAT4& position, int plane)
+{
+	const float guardBand = (float)SoftwareRenderDevice::GUARD_BAND;
+
+	switch (plane)
+	{
+	case 0: return position.z;
+	case 1: return position.w - position.z;
+	case 2: return guardBand * position.w + position.x;
+	case 3: return guardBand * position.w - position.x;
+	case 4: return guardBand * position.w + position.y;
+	default: return guardBand * position.w - position.y;
+	}
+}
+
+static int OutCode(const XMFLOAT4& position)
+{
+	int outCode = 0;
+
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		if (ClipDistance(position, plane) < 0.0f)
+			outCode |= 1 << plane;
+	}
+
+	return outCode;
+}
+
+template <typename Vertex>
+static Vertex LerpVertex(const Vertex& a, const Vertex& b, float t)
+{
+	Vertex vertex;
+	vertex.position.x = a.position.x + (b.position.x - a.position.x) * t;
+	vertex.position.y = a.position.y + (b.position.y - a.position.y) * t;
+	vertex.position.z = a.position.z + (b.position.z - a.position.z) * t;
+	vertex.position.w = a.position.w + (b.position.w - a.position.w) * t;
+
+	for (int i = 0; i < 6; i++)
+		vertex.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+
+	return vertex;
+}
+
+// Where the edge from inside to outside crosses the plane. It is always measured from the inside
+// vertex, so two triangles that share the edge clip it at exactly the same point.
+template <typename Vertex>
+static Vertex ClipEdge(const Vertex& inside, const Vertex& outside, int plane)
+{
+	float insideDistance = ClipDistance(inside.position, plane);
+	float outsideDistance = ClipDistance(outside.position, plane);
+
+	return LerpVertex(inside, outside, insideDistance / (insideDistance - outsideDistance));
+}
+
+static uint32_t PackColor(float r, float g, float b, float a)
+{
+	uint32_t red = (uint32_t)(fminf(fmaxf(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint32_t green = (uint32_t)(fminf(fmaxf(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint32_t blue = (uint32_t)(fminf(fmaxf(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint32_t alpha = (uint32_t)(fminf(fmaxf(a, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+	return red | (green << 8) | (blue << 16) | (alpha << 24);
+}
+
+SoftwareRenderDevice::SoftwareRenderDevice(int width, int height)
+{
+	_width = width;
+	_height = height;
+	_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	_colorBuffer.assign((size_t)width * height, 0);
+	_depthBuffer.assign((size_t)width * height, 1.0f);
+	_bins.resize(_tilesX * _tilesY);
+	_tilePixels.assign(_tilesX * _tilesY, 0);
+
+	_mesh = nullptr;
+	_wireframe = false;
+	_shadingChanged = true;
+
+	XMStoreFloat4x4(&_view, XMMatrixIdentity());
+	XMStoreFloat4x4(&_projection, XMMatrixIdentity());
+	XMStoreFloat4x4(&_world, XMMatrixIdentity());
+	memset(&_lighting, 0, sizeof(_lighting));
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+SoftwareRenderDevice::~SoftwareRenderDevice()
+{
+}
+
+MeshData SoftwareRenderDevice::CreateMesh(const MeshGeometry& geometry, MeshVertexFormat vertexFormat)
+{
+	unique_ptr<Mesh> mesh(new Mesh());
+	mesh->indices.assign(geometry.indices.begin(), geometry.indices.end());
+
+	CompressedVertices vertices;
+	CompressVertices(geometry.vertices, vertexFormat, vertices);
+	DecompressVertices(vertices, mesh->vertices);
+
+	MeshData meshData = AddMesh(move(mesh), INDEX_FORMAT_16);
+	meshData.VBStride = (unsigned int)vertices.stride;
+	meshData.VertexFormat = vertexFormat;
+	meshData.Quantisation = vertices.quantisation;
+
+	return meshData;
+}
+
+MeshData SoftwareRenderDevice::CreateMesh(const MeshAsset& asset)
+{
+	unique_ptr<Mesh> mesh(new Mesh());
+	mesh->vertices = asset.vertices;
+	mesh->indices = asset.indices;
+
+	// The same choice of width a mesh file makes
+	return AddMesh(move(mesh), asset.vertices.size() > 65536 ? INDEX_FORMAT_32 : INDEX_FORMAT_16);
+}
+
+MeshData SoftwareRenderDevice::AddMesh(unique_ptr<Mesh> mesh, MeshIndexFormat indexFormat)
+{
+	MeshData meshData = {};
+	meshData.VertexBuffer = reinterpret_cast<ID3D11Buffer *>(mesh.get());
+	meshData.IndexBuffer = reinterpret_cast<ID3D11Buffer *>(&mesh->indices);
+	meshData.VBStride = sizeof(SimpleVertex);
+	meshData.VBOffset = 0;
+	meshData.IndexCount = (unsigned int)mesh->indices.size();
+	meshData.IndexFormat = indexFormat;
+
+	// Borrow the vertices for a moment to work out the bounds the same way MeshGeometry does
+	MeshGeometry bounds;
+	bounds.vertices.swap(mesh->vertices);
+	bounds.GetBounds(meshData.BoundsCenter, meshData.BoundsRadius);
+	bounds.vertices.swap(mesh->vertices);
+
+	_meshes.push_back(move(mesh));
+
+	return meshData;
+}
+
+const SoftwareRenderDevice::Mesh * SoftwareRenderDevice::FindMesh(const MeshData& meshData) const
+{
+	for (const unique_ptr<Mesh>& mesh : _meshes)
+	{
+		if (reinterpret_cast<ID3D11Buffer *>(mesh.get()) == meshData.VertexBuffer)
+			return mesh.get();
+	}
+
+	return nullptr;
+}
+
+void SoftwareRenderDevice::RegisterRasterizerState(int rasterizerState, bool wireframe)
+{
+	if (rasterizerState >= (int)_wireframeStates.size())
+		_wireframeStates.resize(rasterizerState + 1, false);
+
+	_wireframeStates[rasterizerState] = wireframe;
+}
+
+void SoftwareRenderDevice::Clear(const float color[4])
+{
+	fill(_colorBuffer.begin(), _colorBuffer.end(), PackColor(color[0], color[1], color[2], color[3]));
+	fill(_depthBuffer.begin(), _depthBuffer.end(), 1.0f);
+
+	_triangles.clear();
+	_lines.clear();
+	_primitives.clear();
+	_shadings.clear();
+	_shadingChanged = true;
+}
+
+void SoftwareRenderDevice::SetRasterizerState(int rasterizerState)
+{
+	_wireframe = rasterizerState >= 0 && rasterizerState < (int)_wireframeStates.size() && _wireframeStates[rasterizerState];
+}
+
+void SoftwareRenderDevice::SetMesh(const MeshData& meshData)
+{
+	_mesh = FindMesh(meshData);
+}
+
+void SoftwareRenderDevice::DrawIndexed(int indexCount)
+{
+	if (_mesh)
+		DrawMesh(*_mesh, indexCount, _world);
+}
+
+void SoftwareRenderDevice::UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size)
+{
+	// The matrices are stored transposed for the shaders, so they are transposed back
+	switch (slot)
+	{
+	case CB_FRAME:
+	{
+		FrameConstants frameConstants;
+		memcpy(&frameConstants, data, min((size_t)size, sizeof(frameConstants)));
+
+		XMStoreFloat4x4(&_view, XMMatrixTranspose(frameConstants.mView));
+		XMStoreFloat4x4(&_projection, XMMatrixTranspose(frameConstants.mProjection));
+		_lighting.diffuseLight = frameConstants.diffuseLight;
+		_lighting.ambientLight = frameConstants.gAmbientLight;
+		_lighting.specularLight = frameConstants.gSpecularLight;
+		_lighting.eyePosition = frameConstants.gEyePosW;
+		_lighting.lightVector = frameConstants.lightVecW;
+		_shadingChanged = true;
+		break;
+	}
+
+	case CB_MATERIAL:
+	{
+		MaterialConstants materialConstants;
+		memcpy(&materialConstants, data, min((size_t)size, sizeof(materialConstants)));
+
+		_lighting.diffuseMaterial = materialConstants.diffuseMaterial;
+		_lighting.ambientMaterial = materialConstants.gAmbientMtrl;
+		_lighting.specularMaterial = materialConstants.gSpecularMtrl;
+		_lighting.specularPower = materialConstants.gSpecularPower;
+		_shadingChanged = true;
+		break;
+	}
+
+	case CB_OBJECT:
+	{
+		ObjectConstants objectConstants;
+		memcpy(&objectConstants, data, min((size_t)size, sizeof(objectConstants)));
+
+		XMStoreFloat4x4(&_world, XMMatrixTranspose(objectConstants.mWorld));
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+void SoftwareRenderDevice::UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count)
+{
+	_instances.assign(worlds, worlds + count);
+}
+
+void SoftwareRenderDevice::DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance)
+{
+	const Mesh * mesh = FindMesh(meshData);
+	if (!mesh)
+		return;
+
+	int endInstance = min(startInstance + instanceCount, (int)_instances.size());
+	for (int i = startInstance; i < endInstance; i++)
+		DrawMesh(*mesh, meshData.IndexCount, _instances[i]);
+}
+
+int SoftwareRenderDevice::GetShading()
+{
+	if (_shadingChanged)
+	{
+		const Lighting& l = _lighting;
+
+		Shading shading;
+		shading.eyePosition = l.eyePosition;
+		shading.lightVector = l.lightVector;
+		shading.diffuse = XMFLOAT3(l.diffuseMaterial.x * l.diffuseLight.x, l.diffuseMaterial.y * l.diffuseLight.y, l.diffuseMaterial.z * l.diffuseLight.z);
+		shading.ambient = XMFLOAT3(l.ambientMaterial.x * l.ambientLight.x, l.ambientMaterial.y * l.ambientLight.y, l.ambientMaterial.z * l.ambientLight.z);
+		shading.specular = XMFLOAT3(l.specularMaterial.x * l.specularLight.x, l.specularMaterial.y * l.specularLight.y, l.specularMaterial.z * l.specularLight.z);
+		shading.specularPower = l.specularPower;
+		shading.alpha = l.diffuseMaterial.w;
+
+		_shadings.push_back(shading);
+		_shadingChanged = false;
+	}
+
+	return (int)_shadings.size() - 1;
+}
+
+void SoftwareRenderDevice::DrawMesh(const Mesh& mesh, int indexCount, const XMFLOAT4X4& world)
+{
+	int shading = GetShading();
+
+	// The vertex shader: world position and normal, and the clip space position
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMMATRIX viewProjection = XMLoadFloat4x4(&_view) * XMLoadFloat4x4(&_projection);
+
+	_clipVertices.resize(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const SimpleVertex& vertex = mesh.vertices[i];
+		ClipVertex& clipVertex = _clipVertices[i];
+
+		XMVECTOR positionW = XMVector3Transform(XMLoadFloat3(&vertex.Pos), worldMatrix);
+		XMVECTOR normalW = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.Normal), worldMatrix));
+
+		XMStoreFloat4(&clipVertex.position, XMVector4Transform(positionW, viewProjection));
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3 *>(&clipVertex.attributes[0]), positionW);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3 *>(&clipVertex.attributes[3]), normalW);
+	}
+
+	indexCount = min(indexCount, (int)mesh.indices.size());
+
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		const ClipVertex& a = _clipVertices[mesh.indices[i]];
+		const ClipVertex& b = _clipVertices[mesh.indices[i + 1]];
+		const ClipVertex& c = _clipVertices[mesh.indices[i + 2]];
+
+		if (_wireframe)
+		{
+			AddLine(a, b, shading);
+			AddLine(b, c, shading);
+			AddLine(c, a, shading);
+		}
+		else
+		{
+			AddClippedTriangle(a, b, c, shading);
+		}
+	}
+}
+
+SoftwareRenderDevice::ScreenVertex SoftwareRenderDevice::ToScreen(const ClipVertex& vertex) const
+{
+	ScreenVertex screenVertex;
+	screenVertex.invW = 1.0f / vertex.position.w;
+	screenVertex.x = Snap((vertex.position.x * screenVertex.invW * 0.5f + 0.5f) * _width);
+	screenVertex.y = Snap((0.5f - vertex.position.y * screenVertex.invW * 0.5f) * _height);
+	screenVertex.z = vertex.position.z * screenVertex.invW;
+
+	for (int i = 0; i < 6; i++)
+		screenVertex.attributes[i] = vertex.attributes[i] * screenVertex.invW;
+
+	return screenVertex;
+}
+
+void SoftwareRenderDevice::AddClippedTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int shading)
+{
+	int outCodeA = OutCode(a.position);
+	int outCodeB = OutCode(b.position);
+	int outCodeC = OutCode(c.position);
+
+	// Entirely outside one of the planes
+	if ((outCodeA & outCodeB & outCodeC) != 0)
+		return;
+
+	if ((outCodeA | outCodeB | outCodeC) == 0)
+	{
+		AddTriangle(a, b, c, shading);
+		return;
+	}
+
+	// Clip the triangle to each plane it crosses in turn, which leaves a convex polygon
+	ClipVertex polygons[2][3 + CLIP_PLANE_COUNT];
+	polygons[0][0] = a;
+	polygons[0][1] = b;
+	polygons[0][2] = c;
+	int count = 3;
+	int current = 0;
+
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		if (((outCodeA | outCodeB | outCodeC) & (1 << plane)) == 0)
+			continue;
+
+		const ClipVertex * input = polygons[current];
+		ClipVertex * output = polygons[current ^ 1];
+		int outputCount = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			const ClipVertex& vertex = input[i];
+			const ClipVertex& next = input[(i + 1) % count];
+			bool vertexInside = ClipDistance(vertex.position, plane) >= 0.0f;
+			bool nextInside = ClipDistance(next.position, plane) >= 0.0f;
+
+			if (vertexInside)
+				output[outputCount++] = vertex;
+
+			if (vertexInside && !nextInside)
+				output[outputCount++] = ClipEdge(vertex, next, plane);
+			else if (!vertexInside && nextInside)
+				output[outputCount++] = ClipEdge(next, vertex, plane);
+		}
+
+		count = outputCount;
+		current ^= 1;
+
+		if (count < 3)
+			return;
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+		AddTriangle(polygons[current][0], polygons[current][i], polygons[current][i + 1], shading);
+}
+
+void SoftwareRenderDevice::AddTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int shading)
+{
+	Triangle triangle;
+	triangle.vertices[0] = ToScreen(a);
+	triangle.vertices[1] = ToScreen(b);
+	triangle.vertices[2] = ToScreen(c);
+	triangle.shading = shading;
+
+	const ScreenVertex * v = triangle.vertices;
+
+	// With y pointing down the screen, clockwise triangles have a positive area. The others face
+	// away and are culled, along with those too thin to cover anything.
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if (!(area > 0.0f))
+		return;
+
+	triangle.minX = max(0, (int)floorf(fminf(fminf(v[0].x, v[1].x), v[2].x)));
+	triangle.minY = max(0, (int)floorf(fminf(fminf(v[0].y, v[1].y), v[2].y)));
+	triangle.maxX = min(_width - 1, (int)ceilf(fmaxf(fmaxf(v[0].x, v[1].x), v[2].x)));
+	triangle.maxY = min(_height - 1, (int)ceilf(fmaxf(fmaxf(v[0].y, v[1].y), v[2].y)));
+
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	_primitives.push_back((int)_triangles.size());
+	_triangles.push_back(triangle);
+}
+
+void SoftwareRenderDevice::AddLine(const ClipVertex& a, const ClipVertex& b, int shading)
+{
+	// Trim the line to the part inside every plane
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		float distanceA = ClipDistance(a.position, plane);
+		float distanceB = ClipDistance(b.position, plane);
+
+		if (distanceA < 0.0f && distanceB < 0.0f)
+			return;
+
+		if (distanceA < 0.0f)
+			t0 = fmaxf(t0, distanceA / (distanceA - distanceB));
+		else if (distanceB < 0.0f)
+			t1 = fminf(t1, distanceA / (distanceA - distanceB));
+	}
+
+	if (t0 > t1)
+		return;
+
+	Line line;
+	line.vertices[0] = ToScreen(t0 > 0.0f ? LerpVertex(a, b, t0) : a);
+	line.vertices[1] = ToScreen(t1 < 1.0f ? LerpVertex(a, b, t1) : b);
+	line.shading = shading;
+
+	const ScreenVertex * v = line.vertices;
+	line.minX = max(0, (int)floorf(fminf(v[0].x, v[1].x)));
+	line.minY = max(0, (int)floorf(fminf(v[0].y, v[1].y)));
+	line.maxX = min(_width - 1, (int)ceilf(fmaxf(v[0].x, v[1].x)));
+	line.maxY = min(_height - 1, (int)ceilf(fmaxf(v[0].y, v[1].y)));
+
+	if (line.minX > line.maxX || line.minY > line.maxY)
+		return;
+
+	_primitives.push_back(~(int)_lines.size());
+	_lines.push_back(line);
+}
+
+void SoftwareRenderDevice::Rasterise(JobSystem& jobSystem)
+{
+	for (vector<int>& bin : _bins)
+		bin.clear();
+
+	_stats.triangles = (int)_triangles.size();
+	_stats.lines = (int)_lines.size();
+	_stats.binEntries = 0;
+
+	// Add every primitive to the bins of the tiles its bounds overlap
+	for (int primitive : _primitives)
+	{
+		int minX, minY, maxX, maxY;
+
+		if (primitive >= 0)
+		{
+			const Triangle& triangle = _triangles[primitive];
+			minX = triangle.minX; minY = triangle.minY; maxX = triangle.maxX; maxY = triangle.maxY;
+		}
+		else
+		{
+			const Line& line = _lines[~primitive];
+			minX = line.minX; minY = line.minY; maxX = line.maxX; maxY = line.maxY;
+		}
+
+		for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+		{
+			for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++)
+			{
+				_bins[tileY * _tilesX + tileX].push_back(primitive);
+				_stats.binEntries++;
+			}
+		}
+	}
+
+	// No two tiles share a pixel, so every tile is a job of its own
+	jobSystem.ParallelFor(_tilesX * _tilesY, 1, [this](int begin, int end)
+	{
+		for (int tile = begin; tile < end; tile++)
+			RasteriseTile(tile);
+	});
+
+	_stats.pixelsShaded = 0;
+	for (long long pixels : _tilePixels)
+		_stats.pixelsShaded += pixels;
+}
+
+void SoftwareRenderDevice::RasteriseTile(int tile)
+{
+	int x0 = (tile % _tilesX) * TILE_SIZE;
+	int y0 = (tile / _tilesX) * TILE_SIZE;
+	int x1 = min(x0 + TILE_SIZE, _width) - 1;
+	int y1 = min(y0 + TILE_SIZE, _height) - 1;
+
+	long long pixels = 0;
+
+	for (int primitive : _bins[tile])
+	{
+		if (primitive >= 0)
+			pixels += DrawTriangle(_triangles[primitive], x0, y0, x1, y1);
+		else
+			pixels += DrawLine(_lines[~primitive], x0, y0, x1, y1);
+	}
+
+	_tilePixels[tile] = pixels;
+}
+
+long long SoftwareRenderDevice::DrawTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1)
+{
+	const ScreenVertex * v = triangle.vertices;
+	const Shading& shading = _shadings[triangle.shading];
+
+	int minX = max(triangle.minX, x0);
+	int minY = max(triangle.minY, y0);
+	int maxX = min(triangle.maxX, x1);
+	int maxY = min(triangle.maxY, y1);
+
+	if (minX > maxX || minY > maxY)
+		return 0;
+
+	// Edge i is the one opposite vertex i, so its function is vertex i's barycentric weight
+	// scaled by twice the area. Each edge is measured from its upper vertex whichever triangle
+	// it belongs to, so two triangles sharing it get exactly opposite values. Pixel centres
+	// exactly on an edge belong to the triangle it is a top or left edge of.
+	float originX[3], originY[3], stepX[3], stepY[3];
+	bool topLeft[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		const ScreenVertex& a = v[(i + 1) % 3];
+		const ScreenVertex& b = v[(i + 2) % 3];
+		float dx = b.x - a.x;
+		float dy = b.y - a.y;
+
+		topLeft[i] = (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+
+		const ScreenVertex& origin = (a.y > b.y || (a.y == b.y && a.x > b.x)) ? b : a;
+
+		originX[i] = origin.x;
+		originY[i] = origin.y;
+		stepX[i] = dx;
+		stepY[i] = dy;
+	}
+
+	long long pixels = 0;
+
+#ifdef SOFTWARE_RASTERISER_SSE
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 topLeftMasks[3], originXs[3], stepYs[3];
+	for (int i = 0; i < 3; i++)
+	{
+		topLeftMasks[i] = _mm_castsi128_ps(_mm_set1_epi32(topLeft[i] ? -1 : 0));
+		originXs[i] = _mm_set1_ps(originX[i]);
+		stepYs[i] = _mm_set1_ps(stepY[i]);
+	}
+#endif
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float pixelY = y + 0.5f;
+		float rowTerms[3];
+		for (int i = 0; i < 3; i++)
+			rowTerms[i] = stepX[i] * (pixelY - originY[i]);
+
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			// The edge functions for four pixels side by side
+			float edges[3][4];
+			int coverage = 0;
+
+#ifdef SOFTWARE_RASTERISER_SSE
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 edge = _mm_sub_ps(_mm_set1_ps(rowTerms[i]), _mm_mul_ps(stepYs[i], _mm_sub_ps(pixelX, originXs[i])));
+				__m128 edgeInside = _mm_or_ps(_mm_cmpgt_ps(edge, zero), _mm_and_ps(_mm_cmpeq_ps(edge, zero), topLeftMasks[i]));
+				inside = _mm_and_ps(inside, edgeInside);
+				_mm_storeu_ps(edges[i], edge);
+			}
+
+			coverage = _mm_movemask_ps(inside);
+#else
+			for (int lane = 0; lane < 4; lane++)
+			{
+				float pixelX = x + lane + 0.5f;
+				bool inside = true;
+
+				for (int i = 0; i < 3; i++)
+				{
+					float edge = rowTerms[i] - stepY[i] * (pixelX - originX[i]);
+					inside = inside && (edge > 0.0f || (edge == 0.0f && topLeft[i]));
+					edges[i][lane] = edge;
+				}
+
+				if (inside)
+					coverage |= 1 << lane;
+			}
+#endif
+
+			// The lanes past the right of the tile
+			if (maxX - x < 3)
+				coverage &= (1 << (maxX - x + 1)) - 1;
+
+			for (int lane = 0; coverage != 0; lane++, coverage >>= 1)
+			{
+				if ((coverage & 1) == 0)
+					continue;
+
+				float invSum = 1.0f / (edges[0][lane] + edges[1][lane] + edges[2][lane]);
+				float weights[3] = { edges[0][lane] * invSum, edges[1][lane] * invSum, edges[2][lane] * invSum };
+
+				float z = weights[0] * v[0].z + weights[1] * v[1].z + weights[2] * v[2].z;
+				size_t index = (size_t)y * _width + x + lane;
+
+				if (!(z >= 0.0f && z <= 1.0f && z < _depthBuffer[index]))
+					continue;
+
+				// Perspective correct attributes
+				float invW = weights[0] * v[0].invW + weights[1] * v[1].invW + weights[2] * v[2].invW;
+				float w = 1.0f / invW;
+				float attributes[6];
+				for (int i = 0; i < 6; i++)
+					attributes[i] = (weights[0] * v[0].attributes[i] + weights[1] * v[1].attributes[i] + weights[2] * v[2].attributes[i]) * w;
+
+				_depthBuffer[index] = z;
+				_colorBuffer[index] = Shade(shading, attributes);
+				pixels++;
+			}
+		}
+	}
+
+	return pixels;
+}
+
+long long SoftwareRenderDevice::DrawLine(const Line& line, int x0, int y0, int x1, int y1)
+{
+	const ScreenVertex& a = line.vertices[0];
+	const ScreenVertex& b = line.vertices[1];
+	const Shading& shading = _shadings[line.shading];
+
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+
+	if (dx == 0.0f && dy == 0.0f)
+		return 0;
+
+	// Step one pixel at a time along the longer axis, lighting the pixel the line passes through
+	// at each pixel centre
+	bool xMajor = fabsf(dx) >= fabsf(dy);
+	float start = xMajor ? fminf(a.x, b.x) : fminf(a.y, b.y);
+	float end = xMajor ? fmaxf(a.x, b.x) : fmaxf(a.y, b.y);
+	int first = max((int)ceilf(start - 0.5f), xMajor ? x0 : y0);
+	int last = min((int)floorf(end - 0.5f), xMajor ? x1 : y1);
+
+	long long pixels = 0;
+
+	for (int major = first; major <= last; major++)
+	{
+		float t = xMajor ? (major + 0.5f - a.x) / dx : (major + 0.5f - a.y) / dy;
+		int minor = (int)floorf(xMajor ? a.y + t * dy : a.x + t * dx);
+		int x = xMajor ? major : minor;
+		int y = xMajor ? minor : major;
+
+		if (x < x0 || x > x1 || y < y0 || y > y1)
+			continue;
+
+		float z = a.z + (b.z - a.z) * t;
+		size_t index = (size_t)y * _width + x;
+
+		if (!(z >= 0.0f && z <= 1.0f && z < _depthBuffer[index]))
+			continue;
+
+		float invW = a.invW + (b.invW - a.invW) * t;
+		float w = 1.0f / invW;
+		float attributes[6];
+		for (int i = 0; i < 6; i++)
+			attributes[i] = (a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t) * w;
+
+		_depthBuffer[index] = z;
+		_colorBuffer[index] = Shade(shading, attributes);
+		pixels++;
+	}
+
+	return pixels;
+}
+
+uint32_t SoftwareRenderDevice::Shade(const Shading& shading, const float attributes[6]) const
+{
+	// PS in Lighting.fx: per-pixel Phong lighting with the light vector used as it is given
+	float normalLength = sqrtf(attributes[3] * attributes[3] + attributes[4] * attributes[4] + attributes[5] * attributes[5]);
+	float normalScale = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+	float nx = attributes[3] * normalScale;
+	float ny = attributes[4] * normalScale;
+	float nz = attributes[5] * normalScale;
+
+	float ex = shading.eyePosition.x - attributes[0];
+	float ey = shading.eyePosition.y - attributes[1];
+	float ez = shading.eyePosition.z - attributes[2];
+	float eyeLength = sqrtf(ex * ex + ey * ey + ez * ez);
+	float eyeScale = eyeLength > 0.0f ? 1.0f / eyeLength : 0.0f;
+
+	const XMFLOAT3& l = shading.lightVector;
+	float lightDotNormal = l.x * nx + l.y * ny + l.z * nz;
+
+	// reflect(-lightVector, normal)
+	float rx = 2.0f * lightDotNormal * nx - l.x;
+	float ry = 2.0f * lightDotNormal * ny - l.y;
+	float rz = 2.0f * lightDotNormal * nz - l.z;
+
+	float reflectDotEye = (rx * ex + ry * ey + rz * ez) * eyeScale;
+	float specularAmount = reflectDotEye > 0.0f ? powf(reflectDotEye, shading.specularPower) : 0.0f;
+	float diffuseAmount = fmaxf(lightDotNormal, 0.0f);
+
+	return PackColor(
+		specularAmount * shading.specular.x + diffuseAmount * shading.diffuse.x + shading.ambient.x,
+		specularAmount * shading.specular.y + diffuseAmount * shading.diffuse.y + shading.ambient.y,
+		specularAmount * shading.specular.z + diffuseAmount * shading.diffuse.z + shading.ambient.z,
+		shading.alpha);
+}
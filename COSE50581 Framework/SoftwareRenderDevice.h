@@ -0,0 +1,192 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ConstantBuffers.h"
+#include "MeshFile.h"
+#include "MeshGeometry.h"
+#include "RenderDevice.h"
+
+using namespace DirectX;
+using namespace std;
+
+class JobSystem;
+
+// A RenderDevice that draws on the CPU. The vertices are transformed as each draw is made, the
+// way VS and VSInstanced in Lighting.fx transform them. Rasterise then sorts the triangles into
+// tiles of the screen and fills each tile as a job of its own, with a depth buffer and the
+// per-pixel Phong lighting of PS, so a frame can be drawn and checked without a GPU.
+//
+// It follows the rasterizer states Application creates: solid draws cull back faces, with
+// clockwise triangles facing forward like D3D11's default state, and wireframe draws the edges
+// of every triangle without culling. Each tile draws its primitives in the order they were
+// submitted, so the image is the same whatever the number of threads.
+class SoftwareRenderDevice : public RenderDevice
+{
+public:
+	struct Stats
+	{
+		// Primitives left after clipping and back face culling
+		int triangles;
+		int lines;
+		// Primitive and tile pairs the binning produced
+		int binEntries;
+		// Pixels that passed the depth test and were shaded
+		long long pixelsShaded;
+	};
+
+	static const int TILE_SIZE = 64;
+
+	// Triangles are clipped this many times the viewport's width and height out from its
+	// centre, so the screen positions stay small enough to snap to sub-pixels exactly
+	static const int GUARD_BAND = 4;
+
+private:
+	struct Mesh
+	{
+		vector<SimpleVertex> vertices;
+		vector<uint32_t> indices;
+	};
+
+	// The lighting constants as they were last set
+	struct Lighting
+	{
+		XMFLOAT4 diffuseLight;
+		XMFLOAT4 ambientLight;
+		XMFLOAT4 specularLight;
+		XMFLOAT3 eyePosition;
+		XMFLOAT3 lightVector;
+		XMFLOAT4 diffuseMaterial;
+		XMFLOAT4 ambientMaterial;
+		XMFLOAT4 specularMaterial;
+		float specularPower;
+	};
+
+	// The lighting every pixel of a draw is shaded with, with the light and material colours
+	// already multiplied together
+	struct Shading
+	{
+		XMFLOAT3 eyePosition;
+		XMFLOAT3 lightVector;
+		XMFLOAT3 diffuse;
+		XMFLOAT3 ambient;
+		XMFLOAT3 specular;
+		float specularPower;
+		float alpha;
+	};
+
+	// A vertex as the vertex shader outputs it
+	struct ClipVertex
+	{
+		XMFLOAT4 position;
+		float attributes[6];
+	};
+
+	// A vertex in screen space, with its attributes divided by w for perspective correct
+	// interpolation
+	struct ScreenVertex
+	{
+		float x, y, z, invW;
+		float attributes[6];
+	};
+
+	struct Triangle
+	{
+		ScreenVertex vertices[3];
+		int minX, minY, maxX, maxY;
+		int shading;
+	};
+
+	struct Line
+	{
+		ScreenVertex vertices[2];
+		int minX, minY, maxX, maxY;
+		int shading;
+	};
+
+	int _width;
+	int _height;
+	int _tilesX;
+	int _tilesY;
+
+	vector<uint32_t> _colorBuffer;
+	vector<float> _depthBuffer;
+
+	vector<unique_ptr<Mesh>> _meshes;
+	const Mesh * _mesh;
+	vector<bool> _wireframeStates;
+	bool _wireframe;
+
+	XMFLOAT4X4 _view;
+	XMFLOAT4X4 _projection;
+	XMFLOAT4X4 _world;
+	Lighting _lighting;
+	vector<XMFLOAT4X4> _instances;
+
+	vector<Shading> _shadings;
+	bool _shadingChanged;
+	vector<ClipVertex> _clipVertices;
+	vector<Triangle> _triangles;
+	vector<Line> _lines;
+	// Every triangle and line in the order they were drawn, stored like the bins' entries
+	vector<int> _primitives;
+
+	// The primitives touching each tile, in the order they were drawn. Triangles are stored as
+	// their index, lines as the complement of theirs.
+	vector<vector<int>> _bins;
+	vector<long long> _tilePixels;
+	Stats _stats;
+
+	const Mesh * FindMesh(const MeshData& meshData) const;
+	// Keeps the mesh and returns the MeshData that refers to it
+	MeshData AddMesh(unique_ptr<Mesh> mesh, MeshIndexFormat indexFormat);
+	int GetShading();
+
+	void DrawMesh(const Mesh& mesh, int indexCount, const XMFLOAT4X4& world);
+	void AddTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int shading);
+	void AddClippedTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int shading);
+	void AddLine(const ClipVertex& a, const ClipVertex& b, int shading);
+	ScreenVertex ToScreen(const ClipVertex& vertex) const;
+
+	void RasteriseTile(int tile);
+	long long DrawTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+	long long DrawLine(const Line& line, int x0, int y0, int x1, int y1);
+	uint32_t Shade(const Shading& shading, const float attributes[6]) const;
+
+public:
+	SoftwareRenderDevice(int width, int height);
+	~SoftwareRenderDevice();
+
+	// Copies the geometry, and returns the MeshData to draw it with. Its buffer pointers are
+	// handles to the device's copy and are never used as Direct3D buffers. A compressed vertex
+	// format is applied and then decoded again, so the mesh is drawn as the GPU would draw it.
+	MeshData CreateMesh(const MeshGeometry& geometry, MeshVertexFormat vertexFormat = VERTEX_FORMAT_SIMPLE);
+	MeshData CreateMesh(const MeshAsset& asset);
+
+	// Sets up one of the application's rasterizer state ids
+	void RegisterRasterizerState(int rasterizerState, bool wireframe);
+
+	// Clears the colour and depth buffers and forgets the primitives drawn since the last clear
+	void Clear(const float color[4]);
+
+	// Bins everything drawn since the last clear into tiles and fills them on the job system's threads
+	void Rasterise(JobSystem& jobSystem);
+
+	void SetRasterizerState(int rasterizerState) override;
+	// VS or VSInstanced is chosen by the draw call, so there is no state to change
+	void SetShader(int shader) override {}
+	void SetMesh(const MeshData& meshData) override;
+	void DrawIndexed(int indexCount) override;
+	void UpdateConstantBuffer(ConstantBufferSlot slot, const void * data, int size) override;
+	void UpdateInstanceBuffer(const XMFLOAT4X4 * worlds, int count) override;
+	void DrawIndexedInstanced(const MeshData& meshData, int instanceCount, int startInstance) override;
+
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+
+	// RGBA with 8 bits per channel, red in the lowest byte, row by row from the top left
+	const vector<uint32_t>& GetColorBuffer() const { return _colorBuffer; }
+	const Stats& GetStats() const { return _stats; }
+};
@@ -0,0 +1,490 @@
+#include "SolarSystem.h"
+#include "Profiler.h"
+#include "TransformKernels.h"
+#include "TransformStack.h"
+#include <cmath>
+#include <cstdlib>
+
+const int SolarSystem::BODY_LOD_SUBDIVISIONS;
+
+// Longer updates are split into steps no longer than this, up to a limit so that a long pause
+// can't stall the next frame
+static const float MAX_GRAVITY_STEP = 1.0f / 60.0f;
+static const int MAX_GRAVITY_STEPS = 8;
+
+// Asteroids per job when their world matrices follow the simulation
+static const int ASTEROID_GRAIN_SIZE = 4096;
+// Asteroids per batch through the transform kernels, few enough for their scratch to fit on the stack
+static const int ASTEROID_BATCH_SIZE = 256;
+
+// Bodies per batch through the transform kernels, and per job when their worlds are read back
+static const int BODY_BATCH_SIZE = 256;
+static const int BODY_GRAIN_SIZE = 4096;
+
+// Picks where in the belt an asteroid goes, from rand() so that srand repeats the belt
+static void RandomBeltPosition(float& x, float& z)
+{
+	x = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
+	z = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
+
+	//need to normalize it
+	float length = sqrt(x * x + z + z);
+	x /= length;
+	z /= length;
+
+	//we have a direction, now we need a radius to get the final position
+	float radius = static_cast <float> (rand()) / static_cast <float> (RAND_MAX/6.0f);
+	x *= radius;
+	z *= radius;
+}
+
+static float RandomFloat(float low, float high)
+{
+	return low + (high - low) * static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
+}
+
+static XMFLOAT4X4 AsteroidWorld(const XMFLOAT3& position, float scale)
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixMultiply(XMMatrixScaling(scale, scale, scale),
+		XMMatrixTranslation(position.x, position.y, position.z)));
+	return world;
+}
+
+static XMFLOAT3 GetTranslation(const XMFLOAT4X4& world)
+{
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+static SolarSystem::Material MakeMaterial(const float * diffuse, const float * ambient, const float * specular, float specularPower,
+	bool wireframe)
+{
+	SolarSystem::Material material;
+	material.diffuse = XMFLOAT4(diffuse[0], diffuse[1], diffuse[2], diffuse[3]);
+	material.ambient = XMFLOAT4(ambient[0], ambient[1], ambient[2], ambient[3]);
+	material.specular = XMFLOAT4(specular[0], specular[1], specular[2], specular[3]);
+	material.specularPower = specularPower;
+	material.wireframe = wireframe;
+	return material;
+}
+
+SolarSystem::SolarSystem()
+{
+	_hasUpdated = false;
+	_asteroidCount = -1;
+	_beltMesh = -1;
+	_beltMaterial = 0;
+	_beltScale = 0.0f;
+	_beltInnerRadius = 0.0f;
+	_beltOuterRadius = 0.0f;
+	_beltThickness = 0.0f;
+	_beltMass = 0.0f;
+	_planeNode = -1;
+	_asteroidGravity = false;
+	_beltTime = 0.0f;
+}
+
+SolarSystem::~SolarSystem()
+{
+}
+
+void SolarSystem::Initialise(const SceneFile& scene, const vector<MeshData>& meshes, MeshData planeMeshData)
+{
+	_meshes = meshes;
+	_planeMesh = planeMeshData;
+
+	const SceneBody * sceneBodies = scene.GetBodies();
+	int bodyCount = scene.GetBodyCount();
+
+	// Anything that names no material is drawn with the last, which the scene file doesn't hold
+	int materialCount = scene.GetMaterialCount();
+	_materials.resize(materialCount + 1);
+	for (int i = 0; i < materialCount; i++)
+	{
+		const SceneMaterial& material = scene.GetMaterials()[i];
+		_materials[i] = MakeMaterial(material.diffuse, material.ambient, material.specular, material.specularPower, material.wireframe != 0);
+	}
+
+	SceneDescription::Material defaultMaterial = SceneDescription::DefaultMaterial();
+	_materials[materialCount] = MakeMaterial(defaultMaterial.diffuse, defaultMaterial.ambient, defaultMaterial.specular,
+		defaultMaterial.specularPower, defaultMaterial.wireframe);
+
+	int drawnCount = 0;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		if (sceneBodies[i].mesh.pointer)
+			drawnCount++;
+	}
+
+	_bodyMotions.resize(bodyCount);
+	_bodies.Resize(drawnCount);
+	_bodyNodes.clear();
+	_bodyMeshes.clear();
+	_bodyMaterials.clear();
+	_bodyNodes.reserve(drawnCount);
+	_bodyMeshes.reserve(drawnCount);
+	_bodyMaterials.reserve(drawnCount);
+
+	for (int i = 0; i < bodyCount; i++)
+	{
+		const SceneBody& body = sceneBodies[i];
+		BodyMotion& motion = _bodyMotions[i];
+
+		// A parent always comes before its children, so its node is already there
+		int parent = scene.GetBodyIndex(body.parent.pointer);
+		motion.node = parent < 0 ? _sceneGraph.AddNode() : _sceneGraph.AddNode(_bodyMotions[parent].node);
+		motion.scale = body.scale;
+		motion.spinPhase = body.spinPhase;
+		motion.spinRate = body.spinRate;
+		motion.orbitRadius = body.orbitRadius;
+		motion.orbitPhase = body.orbitPhase;
+		motion.orbitRate = body.orbitRate;
+		motion.offset = XMFLOAT3(body.offset[0], body.offset[1], body.offset[2]);
+
+		if (body.mesh.pointer)
+		{
+			int mesh = scene.GetMeshIndex(body.mesh.pointer);
+			_bodies[(int)_bodyNodes.size()].Initialise(&_meshes[mesh]);
+			_bodyNodes.push_back(motion.node);
+			_bodyMeshes.push_back(mesh);
+			_bodyMaterials.push_back(body.material.pointer ? scene.GetMaterialIndex(body.material.pointer) : materialCount);
+		}
+	}
+
+	_previousWorlds.resize(drawnCount);
+	_currentWorlds.resize(drawnCount);
+	_hasUpdated = false;
+
+	const SceneBelt& belt = scene.GetBelt();
+	_beltMesh = scene.GetMeshIndex(belt.mesh.pointer);
+	_beltMaterial = belt.material.pointer ? scene.GetMaterialIndex(belt.material.pointer) : materialCount;
+	_beltScale = belt.scale;
+	_beltInnerRadius = belt.innerRadius;
+	_beltOuterRadius = belt.outerRadius;
+	_beltThickness = belt.thickness;
+	_beltMass = belt.mass;
+
+	// A belt without a mesh has nothing to draw its asteroids with
+	int asteroidCount = _asteroidCount >= 0 ? _asteroidCount : (int)belt.count;
+	if (_beltMesh < 0)
+		asteroidCount = 0;
+
+	_asteroidBelt.Resize(asteroidCount);
+	for (int i = 0; i < asteroidCount; i++)
+	{
+		_asteroidBelt[i].Initialise(&_meshes[_beltMesh]);
+	}
+
+	_plane.Initialise(&_planeMesh);
+	_planeNode = _sceneGraph.AddNode();
+
+	// Without gravity the asteroids never move, so their world matrices are worked out once here
+	_asteroidNodes.resize(_asteroidGravity ? 0 : asteroidCount);
+	for (int i = 0; i < (int)_asteroidNodes.size(); i++)
+	{
+		float x, z;
+		RandomBeltPosition(x, z);
+
+		TransformStack local;
+		local.Scale(_beltScale, _beltScale, _beltScale);
+		local.Translate(x, 0.0f, z);
+
+		_asteroidNodes[i] = _sceneGraph.AddNode();
+		_sceneGraph.SetLocal(_asteroidNodes[i], local.GetMatrix());
+	}
+
+	// The belt under gravity is placed around where the bodies start
+	AnimateBodies(0.0f);
+	_sceneGraph.UpdateWorlds();
+
+	if (_asteroidGravity)
+	{
+		InitialiseBeltGravity(scene);
+	}
+	else
+	{
+		for (int i = 0; i < asteroidCount; i++)
+		{
+			_asteroidBelt[i].SetWorld(_sceneGraph.GetWorld(_asteroidNodes[i]));
+		}
+	}
+
+	BuildAsteroidBvh();
+
+	_plane.SetWorld(_sceneGraph.GetWorld(_planeNode));
+
+	for (int i = 0; i < drawnCount; i++)
+	{
+		_bodies[i].SetWorld(_sceneGraph.GetWorld(_bodyNodes[i]));
+	}
+}
+
+void SolarSystem::Initialise(const SceneFile& scene, MeshData meshData, MeshData planeMeshData)
+{
+	Initialise(scene, vector<MeshData>(scene.GetMeshCount(), meshData), planeMeshData);
+}
+
+void SolarSystem::SetMeshLodChain(int mesh, const LodChain * lodChain)
+{
+	for (int i = 0; i < _bodies.GetCount(); i++)
+	{
+		if (_bodyMeshes[i] == mesh)
+			_bodies[i].SetLodChain(lodChain);
+	}
+
+	if (mesh != _beltMesh)
+		return;
+
+	for (int i = 0; i < _asteroidBelt.GetCount(); i++)
+	{
+		_asteroidBelt[i].SetLodChain(lodChain);
+	}
+
+	// The asteroids' bounds come from the mesh, so the hierarchy over them is built again
+	BuildAsteroidBvh();
+}
+
+void SolarSystem::InitialiseBeltGravity(const SceneFile& scene)
+{
+	_beltSimulation.Clear();
+	_beltTime = 0.0f;
+	_attractorNodes.clear();
+	_attractorPositions.clear();
+
+	const SceneBody * sceneBodies = scene.GetBodies();
+	float centralMass = 0.0f;
+
+	for (int i = 0; i < scene.GetBodyCount(); i++)
+	{
+		const SceneBody& body = sceneBodies[i];
+		if (!(body.mass > 0.0f))
+			continue;
+
+		if (_attractorNodes.empty())
+			centralMass = body.mass;
+
+		XMFLOAT3 position = GetTranslation(_sceneGraph.GetWorld(_bodyMotions[i].node));
+		_attractorNodes.push_back(_bodyMotions[i].node);
+		_attractorPositions.push_back(position);
+		_beltSimulation.AddAttractor(position, body.mass, body.radius);
+	}
+
+	_attractorTargets.resize(_attractorNodes.size());
+
+	// The belt goes round the first body with mass, or where the origin is when there is none
+	XMFLOAT3 centre = _attractorPositions.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : _attractorPositions[0];
+	int asteroidCount = _asteroidBelt.GetCount();
+
+	for (int i = 0; i < asteroidCount; i++)
+	{
+		// From rand() too, so that srand repeats this belt as it does the other
+		float angle = RandomFloat(0.0f, XM_2PI);
+		float radius = RandomFloat(_beltInnerRadius, _beltOuterRadius);
+		float height = RandomFloat(-0.5f * _beltThickness, 0.5f * _beltThickness);
+
+		// Going round the same way as the planets, at the speed of a circular orbit of the centre
+		float speed = sqrtf(centralMass / radius);
+
+		XMFLOAT3 position(centre.x + radius * cosf(angle), centre.y + height, centre.z + radius * sinf(angle));
+		XMFLOAT3 velocity(-speed * sinf(angle), 0.0f, speed * cosf(angle));
+
+		_beltSimulation.AddBody(position, velocity, _beltMass / asteroidCount);
+		_asteroidBelt[i].SetWorld(AsteroidWorld(position, _beltScale));
+	}
+}
+
+void SolarSystem::UpdateBeltGravity(float t, JobSystem * jobSystem)
+{
+	PROFILE_ZONE("SolarSystem::UpdateBeltGravity");
+
+	int attractorCount = (int)_attractorNodes.size();
+	for (int i = 0; i < attractorCount; i++)
+	{
+		_attractorTargets[i] = GetTranslation(_sceneGraph.GetWorld(_attractorNodes[i]));
+	}
+
+	// Time going backwards, as when the clock is reset, leaves the belt where it is. Between the
+	// steps of a long update the attractors move in a straight line.
+	float elapsed = t - _beltTime;
+	if (elapsed > 0.0f)
+	{
+		// Less a little, so that rounding in t doesn't split an update of exactly one step in two
+		int steps = (int)ceilf(elapsed / MAX_GRAVITY_STEP - 0.01f);
+		steps = (max)(1, (min)(steps, MAX_GRAVITY_STEPS));
+
+		for (int step = 1; step <= steps; step++)
+		{
+			float alpha = (float)step / steps;
+			for (int i = 0; i < attractorCount; i++)
+			{
+				XMFLOAT3 position;
+				XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&_attractorPositions[i]), XMLoadFloat3(&_attractorTargets[i]), alpha));
+				_beltSimulation.SetAttractorPosition(i, position);
+			}
+
+			_beltSimulation.Step(elapsed / steps, jobSystem);
+		}
+	}
+
+	_beltTime = t;
+	for (int i = 0; i < attractorCount; i++)
+	{
+		_attractorPositions[i] = _attractorTargets[i];
+		_beltSimulation.SetAttractorPosition(i, _attractorTargets[i]);
+	}
+
+	// Each slab of the belt is an array of its own, so the asteroids are moved slab by slab, and
+	// their worlds and bounds are found a batch at a time by the transform kernels
+	auto moveAsteroids = [this](int beginSlab, int endSlab)
+	{
+		TransformTRS transforms[ASTEROID_BATCH_SIZE];
+		XMFLOAT4X4 worlds[ASTEROID_BATCH_SIZE];
+
+		for (int slab = beginSlab; slab < endSlab; slab++)
+		{
+			GameObject * asteroids = _asteroidBelt.GetSlab(slab);
+			int first = slab * ObjectPool<GameObject>::SLAB_SIZE;
+			int count = _asteroidBelt.GetSlabObjectCount(slab);
+
+			// Every asteroid is the same mesh
+			const MeshData& meshData = asteroids[0].GetMeshData();
+			SphereBounds localSphere = { meshData.BoundsCenter, meshData.BoundsRadius };
+
+			for (int batch = 0; batch < count; batch += ASTEROID_BATCH_SIZE)
+			{
+				int batchCount = (min)(ASTEROID_BATCH_SIZE, count - batch);
+
+				for (int i = 0; i < batchCount; i++)
+				{
+					XMFLOAT3 position = _beltSimulation.GetPosition(first + batch + i);
+					transforms[i].scale = XMFLOAT4(_beltScale, _beltScale, _beltScale, 0.0f);
+					transforms[i].rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+					transforms[i].translation = XMFLOAT4(position.x, position.y, position.z, 0.0f);
+				}
+
+				ComposeTransforms(transforms, worlds, batchCount);
+				TransformSpheres(localSphere, worlds, &_asteroidSpheres[first + batch], batchCount);
+
+				for (int i = 0; i < batchCount; i++)
+				{
+					asteroids[batch + i].SetWorld(worlds[i]);
+				}
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(_asteroidBelt.GetSlabCount(), (max)(1, ASTEROID_GRAIN_SIZE / ObjectPool<GameObject>::SLAB_SIZE), moveAsteroids);
+	else
+		moveAsteroids(0, _asteroidBelt.GetSlabCount());
+
+	_asteroidBvh.Refit(_asteroidSpheres.data());
+	if (_asteroidBvh.NeedsRebuild())
+		_asteroidBvh.Build(_asteroidSpheres.data(), (int)_asteroidSpheres.size());
+}
+
+void SolarSystem::BuildAsteroidBvh()
+{
+	// The belt isn't one array, so the hierarchy is built from its bounds instead
+	_asteroidSpheres.resize(_asteroidBelt.GetCount());
+	for (int i = 0; i < _asteroidBelt.GetCount(); i++)
+	{
+		_asteroidSpheres[i] = _asteroidBelt[i].GetBoundingSphere();
+	}
+
+	_asteroidBvh.Build(_asteroidSpheres.data(), (int)_asteroidSpheres.size());
+}
+
+void SolarSystem::AnimateBodies(float t)
+{
+	TransformTRS transforms[BODY_BATCH_SIZE];
+	XMFLOAT4X4 locals[BODY_BATCH_SIZE];
+
+	int count = (int)_bodyMotions.size();
+
+	for (int batch = 0; batch < count; batch += BODY_BATCH_SIZE)
+	{
+		int batchCount = (min)(BODY_BATCH_SIZE, count - batch);
+
+		// The scale, then the spin about y, then the move out along x turned by the orbit angle,
+		// then the offset. Both angles turn the way XMMatrixRotationY does, x towards -z.
+		for (int i = 0; i < batchCount; i++)
+		{
+			const BodyMotion& motion = _bodyMotions[batch + i];
+			float spin = motion.spinPhase + motion.spinRate * t;
+			float orbit = motion.orbitPhase + motion.orbitRate * t;
+
+			transforms[i].scale = XMFLOAT4(motion.scale, motion.scale, motion.scale, 0.0f);
+			transforms[i].rotation = XMFLOAT4(0.0f, sinf(0.5f * spin), 0.0f, cosf(0.5f * spin));
+			transforms[i].translation = XMFLOAT4(motion.offset.x + motion.orbitRadius * cosf(orbit), motion.offset.y,
+				motion.offset.z - motion.orbitRadius * sinf(orbit), 0.0f);
+		}
+
+		ComposeTransforms(transforms, locals, batchCount);
+
+		for (int i = 0; i < batchCount; i++)
+		{
+			_sceneGraph.SetLocal(_bodyMotions[batch + i].node, XMLoadFloat4x4(&locals[i]));
+		}
+	}
+}
+
+void SolarSystem::Update(float t, JobSystem * jobSystem)
+{
+	PROFILE_ZONE("SolarSystem::Update");
+
+	AnimateBodies(t);
+
+	// Only the nodes AnimateBodies set and their children are recomputed, the asteroids and the plane are skipped
+	_sceneGraph.UpdateWorlds(jobSystem);
+
+	auto moveBodies = [this](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			XMFLOAT4X4 world = _sceneGraph.GetWorld(_bodyNodes[i]);
+
+			// There is nothing to blend from before the first update
+			_previousWorlds[i] = _hasUpdated ? _currentWorlds[i] : world;
+			_currentWorlds[i] = world;
+			_bodies[i].SetWorld(world);
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(_bodies.GetCount(), BODY_GRAIN_SIZE, moveBodies);
+	else
+		moveBodies(0, _bodies.GetCount());
+
+	if (_asteroidGravity)
+		UpdateBeltGravity(t, jobSystem);
+
+	_hasUpdated = true;
+}
+
+void SolarSystem::Interpolate(float alpha)
+{
+	for (int i = 0; i < _bodies.GetCount(); i++)
+	{
+		XMVECTOR previousScale, previousRotation, previousTranslation;
+		XMVECTOR currentScale, currentRotation, currentTranslation;
+
+		// Every body is scaled uniformly, so the matrices always decompose
+		if (!XMMatrixDecompose(&previousScale, &previousRotation, &previousTranslation, XMLoadFloat4x4(&_previousWorlds[i])) ||
+			!XMMatrixDecompose(&currentScale, &currentRotation, &currentTranslation, XMLoadFloat4x4(&_currentWorlds[i])))
+		{
+			_bodies[i].SetWorld(_currentWorlds[i]);
+			continue;
+		}
+
+		XMMATRIX world = XMMatrixAffineTransformation(
+			XMVectorLerp(previousScale, currentScale, alpha),
+			XMVectorZero(),
+			XMQuaternionSlerp(previousRotation, currentRotation, alpha),
+			XMVectorLerp(previousTranslation, currentTranslation, alpha));
+
+		XMFLOAT4X4 interpolated;
+		XMStoreFloat4x4(&interpolated, world);
+		_bodies[i].SetWorld(interpolated);
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "GameObject.h"
+#include "SceneGraph.h"
+#include "BoundingVolumeHierarchy.h"
+#include "JobSystem.h"
+#include "NBodySimulation.h"
+#include "ObjectPool.h"
+#include "SceneFile.h"
+#include <vector>
+
+using namespace DirectX;
+
+// The SolarSystem owns every GameObject in the scene and animates them. The bodies, their
+// orbits and materials and the belt all come from a scene file. It only depends on DirectXMath,
+// so the same update path runs inside Application and in the headless driver.
+class SolarSystem
+{
+public:
+	// What a body is drawn with, as the scene gives it
+	struct Material
+	{
+		XMFLOAT4 diffuse;
+		XMFLOAT4 ambient;
+		XMFLOAT4 specular;
+		float specularPower;
+		bool wireframe;
+	};
+
+private:
+	// How one body of the scene moves, as the parameters of its local matrix
+	struct BodyMotion
+	{
+		int node;
+		float scale;
+		float spinPhase;
+		float spinRate;
+		float orbitRadius;
+		float orbitPhase;
+		float orbitRate;
+		XMFLOAT3 offset;
+	};
+
+	// Every body in the scene, in the scene's order, so parents come before their children
+	vector<BodyMotion> _bodyMotions;
+
+	// The bodies with a mesh, with their nodes, meshes and materials, and their world matrices
+	// after the last two updates so that Interpolate can draw them between steps
+	ObjectPool<GameObject> _bodies;
+	vector<int> _bodyNodes;
+	vector<int> _bodyMeshes;
+	vector<int> _bodyMaterials;
+	vector<XMFLOAT4X4> _previousWorlds;
+	vector<XMFLOAT4X4> _currentWorlds;
+	bool _hasUpdated;
+
+	// The scene's materials, followed by the one drawn with by anything that names none
+	vector<Material> _materials;
+
+	// The mesh each of the scene's meshes names, and the plane's, which every object drawn with
+	// one of them points into
+	vector<MeshData> _meshes;
+	MeshData _planeMesh;
+
+	ObjectPool<GameObject> _asteroidBelt;
+	// -1 until SetAsteroidCount chooses a count other than the scene's
+	int _asteroidCount;
+	int _beltMesh;
+	int _beltMaterial;
+	float _beltScale;
+	float _beltInnerRadius;
+	float _beltOuterRadius;
+	float _beltThickness;
+	float _beltMass;
+	GameObject _plane;
+
+	// The transform hierarchy, which the scene's own hierarchy maps straight onto. A body
+	// without a mesh, such as a planet's orbit, is a node that its children share instead of
+	// each rebuilding the whole chain every frame.
+	SceneGraph _sceneGraph;
+	vector<int> _asteroidNodes;
+	int _planeNode;
+
+	// Built once over the asteroids, and refitted every update when they move under gravity
+	BoundingVolumeHierarchy _asteroidBvh;
+	vector<SphereBounds> _asteroidSpheres;
+
+	// Under gravity the asteroids orbit the bodies with mass, which pull on them as the
+	// simulation's attractors without being pulled back, so their scripted orbits stay as they are
+	bool _asteroidGravity;
+	NBodySimulation _beltSimulation;
+	// The time the belt has been simulated up to, and the attractors' nodes and where they were then
+	float _beltTime;
+	vector<int> _attractorNodes;
+	vector<XMFLOAT3> _attractorPositions;
+	vector<XMFLOAT3> _attractorTargets;
+
+	void AnimateBodies(float t);
+	void InitialiseBeltGravity(const SceneFile& scene);
+	void UpdateBeltGravity(float t, JobSystem * jobSystem);
+	void BuildAsteroidBvh();
+
+public:
+	// The bodies' most detailed level of detail is an icosphere split this many times, and each
+	// level after it is split once less
+	static const int BODY_LOD_SUBDIVISIONS = 4;
+
+	SolarSystem();
+	~SolarSystem();
+
+	// The objects point into the solar system's own table of meshes
+	SolarSystem(const SolarSystem&) = delete;
+	SolarSystem& operator=(const SolarSystem&) = delete;
+
+	// Sets how many asteroids Initialise puts in the belt instead of the scene's count
+	void SetAsteroidCount(int count) { _asteroidCount = count; }
+	int GetAsteroidCount() const { return _asteroidBelt.GetCount(); }
+
+	// Makes the belt Initialise puts in place a ring around the first body with mass whose
+	// asteroids orbit under gravity, instead of asteroids that never move
+	void SetAsteroidGravity(bool gravity) { _asteroidGravity = gravity; }
+	bool HasAsteroidGravity() const { return _asteroidGravity; }
+
+	// Builds the bodies and the belt of a loaded scene. meshes has the mesh each of the scene's
+	// meshes names, in the scene's order.
+	void Initialise(const SceneFile& scene, const vector<MeshData>& meshes, MeshData planeMeshData);
+	// Draws every mesh the scene names with meshData
+	void Initialise(const SceneFile& scene, MeshData meshData, MeshData planeMeshData);
+	// Draws everything drawn with one of the scene's meshes with the chain's levels instead. The
+	// chain must outlive the solar system.
+	void SetMeshLodChain(int mesh, const LodChain * lodChain);
+	// t is the total simulation time in seconds. The transforms are updated on the job system's
+	// threads when one is given.
+	void Update(float t, JobSystem * jobSystem = nullptr);
+
+	// Sets the world matrices of the moving bodies alpha of the way from the update before last
+	// to the last one, blending scale, rotation and translation separately. Update leaves them
+	// at the last update's, which is the same as an alpha of 1. Asteroids under gravity stay
+	// where the last update left them, which is where the hierarchy over them has them.
+	void Interpolate(float alpha);
+
+	// The bodies with a mesh, in the scene's order
+	int GetBodyCount() const { return _bodies.GetCount(); }
+	GameObject& GetBody(int i) { return _bodies[i]; }
+	const Material& GetBodyMaterial(int i) const { return _materials[_bodyMaterials[i]]; }
+	int GetBodyMaterialIndex(int i) const { return _bodyMaterials[i]; }
+
+	int GetMaterialCount() const { return (int)_materials.size(); }
+	const Material& GetMaterial(int i) const { return _materials[i]; }
+
+	GameObject& GetAsteroid(int i) { return _asteroidBelt[i]; }
+	const ObjectPool<GameObject>& GetAsteroidBelt() const { return _asteroidBelt; }
+	int GetBeltMaterialIndex() const { return _beltMaterial; }
+	GameObject& GetPlane() { return _plane; }
+
+	const BoundingVolumeHierarchy& GetAsteroidBvh() const { return _asteroidBvh; }
+	const NBodySimulation& GetBeltSimulation() const { return _beltSimulation; }
+};
@@ -0,0 +1,502 @@
+// Stress test for the engine. Generates solar systems with more and more planets, moons and
+// asteroids, runs each size for a number of frames without a window, drawing them with the
+// software rasteriser, and stops after the first size whose frames don't fit in the budget. A
+// frame fits when 95% of frames take no longer than the budget, so the answer is the size that
+// can be run at that rate, not just on average.
+//
+// Each size's stage timings, the profiled zones inside them and the memory the process has
+// resident are printed, and written as CSV and JSON when files are named. The counts start
+// where they are given and are multiplied by the growth factor each step: the planets and the
+// asteroids with --grow all, or only the ones named. Every planet keeps the same number of moons.
+// They are added to SolarSystem.scene, or the scene named, around its first body with mass.
+//
+// Usage: StressTest [--budget ms] [--frames n] [--planets n] [--moons n] [--asteroids n]
+//                   [--growth factor] [--grow all|planets|asteroids] [--max-bodies n]
+//                   [--gravity] [--no-raster] [--scene file] [--csv report.csv] [--json report.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "LodChain.h"
+#include "Profiler.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderDevice.h"
+#include "SolarSystem.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct StressOptions
+{
+	double budgetMilliseconds;
+	int frames;
+	int planets;
+	int moonsPerPlanet;
+	int asteroids;
+	double growth;
+	bool growPlanets;
+	bool growAsteroids;
+	long long maxBodies;
+	bool gravity;
+	bool rasterise;
+	const char * scenePath;
+	const char * csvPath;
+	const char * jsonPath;
+};
+
+// The mean and 95th percentile of one stage of the frame, in milliseconds
+struct StageTimes
+{
+	double mean;
+	double p95;
+};
+
+struct StressResult
+{
+	int planets;
+	int moons;
+	int asteroids;
+	double initialiseMilliseconds;
+	StageTimes update;
+	StageTimes render;
+	StageTimes rasterise;
+	StageTimes frame;
+	long long residentBytes;
+	long long trianglesSubmitted;
+#if PROFILER_ENABLED
+	vector<Profiler::ZoneSummary> zones;
+#endif
+};
+
+static const char * STAGE_NAMES[] = { "update", "render", "rasterise", "frame" };
+static const int STAGE_COUNT = 4;
+
+static double Milliseconds(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+	return chrono::duration<double, milli>(end - start).count();
+}
+
+static StageTimes Summarise(vector<double> times)
+{
+	StageTimes stage;
+	stage.mean = 0.0;
+	for (double time : times)
+		stage.mean += time;
+	stage.mean /= times.size();
+
+	sort(times.begin(), times.end());
+	stage.p95 = times[static_cast<size_t>(0.95 * (times.size() - 1) + 0.5)];
+	return stage;
+}
+
+static const StageTimes& GetStage(const StressResult& result, int stage)
+{
+	const StageTimes * stages[STAGE_COUNT] = { &result.update, &result.render, &result.rasterise, &result.frame };
+	return *stages[stage];
+}
+
+// The memory the process has resident, or -1 where it can't be found
+static long long GetResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (long long)counters.WorkingSetSize;
+	return -1;
+#elif defined(__linux__)
+	FILE * file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return -1;
+
+	long long totalPages = 0, residentPages = 0;
+	int read = fscanf(file, "%lld %lld", &totalPages, &residentPages);
+	fclose(file);
+
+	return read == 2 ? residentPages * sysconf(_SC_PAGESIZE) : -1;
+#else
+	return -1;
+#endif
+}
+
+// Builds a solar system of the given size and times its frames, each an update at 60 Hz, the
+// scene renderer's culling and recording, and the rasteriser drawing what it recorded
+static StressResult RunSize(const StressOptions& options, const SceneDescription& baseScene, int planets, int asteroids,
+	JobSystem& jobSystem, SoftwareRenderDevice& renderDevice, SceneRenderer& sceneRenderer, MeshData cubeMeshData,
+	MeshData planeMeshData, const LodChain& bodyLodChain)
+{
+	StressResult result = {};
+	result.planets = planets;
+	result.moons = planets * options.moonsPerPlanet;
+	result.asteroids = asteroids;
+
+	auto initialiseStart = chrono::steady_clock::now();
+
+	// The scene is compiled in memory, as loading the compiled file would give it, which can't
+	// fail for a scene that parsed. Its body mesh is drawn as Application draws it, and any other
+	// mesh as the cube.
+	SceneDescription description = baseScene;
+	AddGeneratedBodies(description, planets, options.moonsPerPlanet);
+
+	SceneFile scene;
+	scene.Load(description);
+
+	vector<MeshData> sceneMeshes(scene.GetMeshCount(), cubeMeshData);
+	int bodyMesh = scene.FindMesh("body");
+
+	// Far too big for the stack with a large belt's bookkeeping
+	unique_ptr<SolarSystem> solarSystem(new SolarSystem());
+	srand(0);
+	solarSystem->SetAsteroidCount(asteroids);
+	solarSystem->SetAsteroidGravity(options.gravity);
+	solarSystem->Initialise(scene, sceneMeshes, planeMeshData);
+	solarSystem->SetMeshLodChain(bodyMesh, &bodyLodChain);
+
+	result.initialiseMilliseconds = Milliseconds(initialiseStart, chrono::steady_clock::now());
+
+	// The camera where Application starts it
+	XMVECTOR eye = XMVectorSet(0.0f, 10.0f, -10.0f, 0.0f);
+	XMVECTOR at = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMFLOAT4X4 view, projection;
+	XMFLOAT3 eyePosition;
+	XMStoreFloat4x4(&view, XMMatrixLookAtLH(eye, at, up));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, renderDevice.GetWidth() / (float)renderDevice.GetHeight(), 0.01f, 100.0f));
+	XMStoreFloat3(&eyePosition, eye);
+
+	float clearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f };
+	const float dt = 1.0f / 60.0f;
+	float t = 0.0f;
+
+	vector<double> stageTimes[STAGE_COUNT];
+	for (vector<double>& times : stageTimes)
+		times.resize(options.frames);
+
+	// One frame first, so that the buffers every stage keeps between frames have grown
+	for (int frame = -1; frame < options.frames; frame++)
+	{
+		if (frame == 0)
+			Profiler::Clear();
+
+		t += dt;
+
+		auto start = chrono::steady_clock::now();
+		solarSystem->Update(t, &jobSystem);
+		auto updated = chrono::steady_clock::now();
+
+		renderDevice.Clear(clearColor);
+		sceneRenderer.Render(renderDevice, jobSystem, *solarSystem, view, projection, eyePosition, false, true);
+		auto rendered = chrono::steady_clock::now();
+
+		if (options.rasterise)
+			renderDevice.Rasterise(jobSystem);
+		auto end = chrono::steady_clock::now();
+
+		if (frame < 0)
+			continue;
+
+		stageTimes[0][frame] = Milliseconds(start, updated);
+		stageTimes[1][frame] = Milliseconds(updated, rendered);
+		stageTimes[2][frame] = Milliseconds(rendered, end);
+		stageTimes[3][frame] = Milliseconds(start, end);
+	}
+
+	result.update = Summarise(stageTimes[0]);
+	result.render = Summarise(stageTimes[1]);
+	result.rasterise = Summarise(stageTimes[2]);
+	result.frame = Summarise(stageTimes[3]);
+	result.trianglesSubmitted = sceneRenderer.GetLodStats().triangles;
+
+	// Measured while the solar system is still alive
+	result.residentBytes = GetResidentBytes();
+
+#if PROFILER_ENABLED
+	result.zones = Profiler::Summarise(Profiler::Collect());
+#endif
+
+	return result;
+}
+
+static bool WriteCsv(const char * path, const vector<StressResult>& results)
+{
+	FILE * file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "planets,moons,asteroids,bodies,initialise_ms");
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+		fprintf(file, ",%s_mean_ms,%s_p95_ms", STAGE_NAMES[stage], STAGE_NAMES[stage]);
+	fprintf(file, ",triangles,resident_bytes\n");
+
+	for (const StressResult& result : results)
+	{
+		fprintf(file, "%d,%d,%d,%d,%.3f", result.planets, result.moons, result.asteroids,
+			result.planets + result.moons + result.asteroids, result.initialiseMilliseconds);
+		for (int stage = 0; stage < STAGE_COUNT; stage++)
+			fprintf(file, ",%.4f,%.4f", GetStage(result, stage).mean, GetStage(result, stage).p95);
+		fprintf(file, ",%lld,%lld\n", result.trianglesSubmitted, result.residentBytes);
+	}
+
+	return fclose(file) == 0;
+}
+
+// One size to a line, as the micro benchmarks' reports are, so that two reports diff cleanly
+static bool WriteJson(const char * path, const StressOptions& options, const vector<StressResult>& results, int largestFitting)
+{
+	FILE * file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": 1,\n");
+	fprintf(file, "  \"budget_ms\": %.4f,\n", options.budgetMilliseconds);
+	fprintf(file, "  \"frames_per_size\": %d,\n", options.frames);
+	fprintf(file, "  \"moons_per_planet\": %d,\n", options.moonsPerPlanet);
+	fprintf(file, "  \"gravity\": %s,\n", options.gravity ? "true" : "false");
+	fprintf(file, "  \"rasterise\": %s,\n", options.rasterise ? "true" : "false");
+	fprintf(file, "  \"largest_fitting_size\": %d,\n", largestFitting);
+	fprintf(file, "  \"sizes\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const StressResult& result = results[i];
+
+		fprintf(file, "    { \"planets\": %d, \"moons\": %d, \"asteroids\": %d, \"initialise_ms\": %.3f", result.planets,
+			result.moons, result.asteroids, result.initialiseMilliseconds);
+		for (int stage = 0; stage < STAGE_COUNT; stage++)
+			fprintf(file, ", \"%s_mean_ms\": %.4f, \"%s_p95_ms\": %.4f", STAGE_NAMES[stage], GetStage(result, stage).mean,
+				STAGE_NAMES[stage], GetStage(result, stage).p95);
+		fprintf(file, ", \"triangles\": %lld, \"resident_bytes\": %lld, \"fits\": %s", result.trianglesSubmitted,
+			result.residentBytes, result.frame.p95 <= options.budgetMilliseconds ? "true" : "false");
+
+#if PROFILER_ENABLED
+		// Zone names are the functions they time, which never need escaping
+		fprintf(file, ", \"zones\": [");
+		for (size_t zone = 0; zone < result.zones.size(); zone++)
+		{
+			const Profiler::ZoneSummary& summary = result.zones[zone];
+			fprintf(file, "%s{ \"name\": \"%s\", \"count\": %d, \"ms_per_frame\": %.4f, \"p95_us\": %.3f }", zone ? ", " : "",
+				summary.name, summary.count, summary.totalMilliseconds / options.frames, summary.p95Microseconds);
+		}
+		fprintf(file, "]");
+#endif
+
+		fprintf(file, " }%s\n", i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+
+	return fclose(file) == 0;
+}
+
+static bool ParseOptions(int argc, char* argv[], StressOptions& options)
+{
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strcmp(argv[arg], "--gravity") == 0)
+		{
+			options.gravity = true;
+			continue;
+		}
+
+		if (strcmp(argv[arg], "--no-raster") == 0)
+		{
+			options.rasterise = false;
+			continue;
+		}
+
+		if (arg + 1 >= argc)
+			return false;
+
+		const char * name = argv[arg];
+		const char * value = argv[++arg];
+
+		if (strcmp(name, "--budget") == 0)
+			options.budgetMilliseconds = atof(value);
+		else if (strcmp(name, "--frames") == 0)
+			options.frames = atoi(value);
+		else if (strcmp(name, "--planets") == 0)
+			options.planets = atoi(value);
+		else if (strcmp(name, "--moons") == 0)
+			options.moonsPerPlanet = atoi(value);
+		else if (strcmp(name, "--asteroids") == 0)
+			options.asteroids = atoi(value);
+		else if (strcmp(name, "--growth") == 0)
+			options.growth = atof(value);
+		else if (strcmp(name, "--max-bodies") == 0)
+			options.maxBodies = atoll(value);
+		else if (strcmp(name, "--scene") == 0)
+			options.scenePath = value;
+		else if (strcmp(name, "--csv") == 0)
+			options.csvPath = value;
+		else if (strcmp(name, "--json") == 0)
+			options.jsonPath = value;
+		else if (strcmp(name, "--grow") == 0)
+		{
+			options.growPlanets = strcmp(value, "all") == 0 || strcmp(value, "planets") == 0;
+			options.growAsteroids = strcmp(value, "all") == 0 || strcmp(value, "asteroids") == 0;
+			if (!options.growPlanets && !options.growAsteroids)
+				return false;
+		}
+		else
+			return false;
+	}
+
+	return options.budgetMilliseconds > 0.0 && options.frames > 0 && options.planets >= 0 && options.moonsPerPlanet >= 0 &&
+		options.asteroids >= 0 && options.growth > 1.0 && options.maxBodies > 0;
+}
+
+// The next count up, at least one more so that a count of zero or one still grows
+static int Grow(int count, double growth)
+{
+	return (int)(max)((double)count + 1.0, ceil(count * growth));
+}
+
+int main(int argc, char* argv[])
+{
+	StressOptions options;
+	options.budgetMilliseconds = 1000.0 / 60.0;
+	options.frames = 60;
+	options.planets = 2;
+	options.moonsPerPlanet = 2;
+	options.asteroids = 1000;
+	options.growth = 2.0;
+	options.growPlanets = true;
+	options.growAsteroids = true;
+	options.maxBodies = 1 << 24;
+	options.gravity = false;
+	options.rasterise = true;
+	options.scenePath = SOLAR_SYSTEM_SCENE_PATH;
+	options.csvPath = nullptr;
+	options.jsonPath = nullptr;
+
+	if (!ParseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "Usage: %s [--budget ms] [--frames n] [--planets n] [--moons n] [--asteroids n]\n"
+			"    [--growth factor] [--grow all|planets|asteroids] [--max-bodies n]\n"
+			"    [--gravity] [--no-raster] [--scene file] [--csv report.csv] [--json report.json]\n", argv[0]);
+		return 1;
+	}
+
+	SceneDescription baseScene;
+	string error;
+	if (!LoadSceneText(options.scenePath, baseScene, error))
+	{
+		fprintf(stderr, "%s: %s\n", options.scenePath, error.c_str());
+		return 1;
+	}
+
+	int sceneBodies = 0;
+	for (const SceneDescription::Body& body : baseScene.bodies)
+	{
+		if (body.mesh >= 0)
+			sceneBodies++;
+	}
+
+	JobSystem jobSystem;
+	SceneRenderer sceneRenderer;
+
+	static SoftwareRenderDevice renderDevice(1280, 720);
+	renderDevice.RegisterRasterizerState(RS_SOLID, false);
+	renderDevice.RegisterRasterizerState(RS_WIREFRAME, true);
+	MeshData cubeMeshData = renderDevice.CreateMesh(CreateCubeGeometry());
+	MeshData planeMeshData = renderDevice.CreateMesh(CreatePlaneGeometry());
+	sceneRenderer.SetViewportHeight(renderDevice.GetHeight());
+
+	// The bodies are drawn as Application draws them, as icospheres with levels of detail
+	LodChain bodyLodChain;
+	for (int subdivisions = SolarSystem::BODY_LOD_SUBDIVISIONS; subdivisions >= 0; subdivisions--)
+	{
+		MeshGeometry sphere = CreateIcosphereGeometry(subdivisions);
+		bodyLodChain.AddLevel(sphere, renderDevice.CreateMesh(sphere));
+	}
+
+	printf("budget: %.3f ms  frames per size: %d  moons per planet: %d  gravity: %s  rasterise: %s  threads: %d\n",
+		options.budgetMilliseconds, options.frames, options.moonsPerPlanet, options.gravity ? "yes" : "no",
+		options.rasterise ? "yes" : "no", jobSystem.GetThreadCount());
+	printf("%9s %9s %10s %10s %12s %12s %12s %12s %12s %10s\n", "planets", "moons", "asteroids", "init ms", "update ms",
+		"render ms", "raster ms", "frame ms", "frame p95", "RSS MB");
+
+	vector<StressResult> results;
+	int largestFitting = -1;
+	int planets = options.planets;
+	int asteroids = options.asteroids;
+
+	for (;;)
+	{
+		// The scene's own bodies are always there too
+		long long bodies = (long long)planets * (1 + options.moonsPerPlanet) + asteroids + sceneBodies;
+		if (bodies > options.maxBodies)
+		{
+			printf("stopped at the %lld body limit before the budget was exceeded\n", options.maxBodies);
+			break;
+		}
+
+		StressResult result = RunSize(options, baseScene, planets, asteroids, jobSystem, renderDevice, sceneRenderer,
+			cubeMeshData, planeMeshData, bodyLodChain);
+		results.push_back(result);
+
+		printf("%9d %9d %10d %10.2f %12.3f %12.3f %12.3f %12.3f %12.3f %10.1f\n", result.planets, result.moons, result.asteroids,
+			result.initialiseMilliseconds, result.update.mean, result.render.mean, result.rasterise.mean, result.frame.mean,
+			result.frame.p95, result.residentBytes < 0 ? -1.0 : result.residentBytes / (1024.0 * 1024.0));
+
+		if (result.frame.p95 > options.budgetMilliseconds)
+			break;
+
+		largestFitting = (int)results.size() - 1;
+
+		if (options.growPlanets)
+			planets = Grow(planets, options.growth);
+		if (options.growAsteroids)
+			asteroids = Grow(asteroids, options.growth);
+	}
+
+	if (largestFitting >= 0)
+	{
+		const StressResult& fitting = results[largestFitting];
+		printf("largest size within %.3f ms: %d planets, %d moons, %d asteroids (%d bodies with the scene's own)\n",
+			options.budgetMilliseconds, fitting.planets, fitting.moons, fitting.asteroids,
+			fitting.planets + fitting.moons + fitting.asteroids + sceneBodies);
+	}
+	else
+	{
+		printf("even the first size exceeds %.3f ms\n", options.budgetMilliseconds);
+	}
+
+#if PROFILER_ENABLED
+	// Where the time went in the largest size run
+	if (!results.empty())
+	{
+		printf("zones at the last size:\n%s", Profiler::FormatSummary(results.back().zones).c_str());
+	}
+#endif
+
+	if (options.csvPath && !WriteCsv(options.csvPath, results))
+	{
+		fprintf(stderr, "Could not write %s\n", options.csvPath);
+		return 1;
+	}
+
+	if (options.jsonPath && !WriteJson(options.jsonPath, options, results, largestFitting))
+	{
+		fprintf(stderr, "Could not write %s\n", options.jsonPath);
+		return 1;
+	}
+
+	return 0;
+}
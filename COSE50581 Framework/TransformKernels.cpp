@@ -0,0 +1,214 @@
+#include "TransformKernelsSimd.h"
+
+#include <algorithm>
+#include "CpuFeatures.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_KERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static void ComposeTransformsScalar(const TransformTRS * transforms, XMFLOAT4X4 * worlds, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		XMMATRIX world = XMMatrixScalingFromVector(XMLoadFloat4(&transforms[i].scale)) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&transforms[i].rotation)) *
+			XMMatrixTranslationFromVector(XMLoadFloat4(&transforms[i].translation));
+		XMStoreFloat4x4(&worlds[i], world);
+	}
+}
+
+static void MultiplyTransformsScalar(const XMFLOAT4X4 * locals, const XMFLOAT4X4& parent, XMFLOAT4X4 * worlds, int count)
+{
+	XMMATRIX parentMatrix = XMLoadFloat4x4(&parent);
+
+	for (int i = 0; i < count; i++)
+	{
+		XMStoreFloat4x4(&worlds[i], XMMatrixMultiply(XMLoadFloat4x4(&locals[i]), parentMatrix));
+	}
+}
+
+static void TransposeTransformsScalar(const XMFLOAT4X4 * matrices, XMFLOAT4X4 * transposed, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		XMStoreFloat4x4(&transposed[i], XMMatrixTranspose(XMLoadFloat4x4(&matrices[i])));
+	}
+}
+
+static void TransformSpheresScalar(const SphereBounds& localSphere, const XMFLOAT4X4 * worlds, SphereBounds * worldSpheres, int count)
+{
+	XMVECTOR center = XMLoadFloat3(&localSphere.Center);
+
+	for (int i = 0; i < count; i++)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+
+		SphereBounds sphere;
+		XMStoreFloat3(&sphere.Center, XMVector3TransformCoord(center, world));
+
+		float scaleX = XMVectorGetX(XMVector3Length(world.r[0]));
+		float scaleY = XMVectorGetX(XMVector3Length(world.r[1]));
+		float scaleZ = XMVectorGetX(XMVector3Length(world.r[2]));
+		sphere.Radius = localSphere.Radius * (std::max)(scaleX, (std::max)(scaleY, scaleZ));
+
+		worldSpheres[i] = sphere;
+	}
+}
+
+const TransformKernelTable SCALAR_TRANSFORM_KERNELS =
+{
+	ComposeTransformsScalar,
+	MultiplyTransformsScalar,
+	TransposeTransformsScalar,
+	TransformSpheresScalar,
+};
+
+#if TRANSFORM_KERNELS_SSE2
+// SSE2 has no blend or fused multiply-add, so those are built from masks and separate operations
+struct Sse2
+{
+	typedef __m128 Vector;
+	static const int LANES = 1;
+
+	static Vector Set1(float value) { return _mm_set1_ps(value); }
+	static Vector Load(const float * p) { return _mm_loadu_ps(p); }
+	static void Store(float * p, Vector v) { _mm_storeu_ps(p, v); }
+	static Vector LoadLanes(const float * p, int) { return _mm_loadu_ps(p); }
+	static Vector LoadBroadcast(const float * p) { return _mm_loadu_ps(p); }
+
+	static void LoadMatrices(const float * p, Vector rows[4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			rows[row] = _mm_loadu_ps(p + row * 4);
+		}
+	}
+
+	static void StoreMatrices(float * p, const Vector rows[4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			_mm_storeu_ps(p + row * 4, rows[row]);
+		}
+	}
+
+	template <int X, int Y, int Z, int W>
+	static Vector Permute(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X)); }
+	// X and Y from a, Z and W from b
+	template <int X, int Y, int Z, int W>
+	static Vector Shuffle(Vector a, Vector b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+	// The elements of b where the mask has a bit set, with x as bit 0
+	template <int MASK>
+	static Vector Blend(Vector a, Vector b)
+	{
+		Vector mask = _mm_castsi128_ps(_mm_set_epi32((MASK & 8) ? -1 : 0, (MASK & 4) ? -1 : 0, (MASK & 2) ? -1 : 0, (MASK & 1) ? -1 : 0));
+		return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+	}
+
+	static Vector UnpackLo(Vector a, Vector b) { return _mm_unpacklo_ps(a, b); }
+	static Vector UnpackHi(Vector a, Vector b) { return _mm_unpackhi_ps(a, b); }
+	static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+	static Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+	static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+	static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+	static Vector Sqrt(Vector v) { return _mm_sqrt_ps(v); }
+};
+
+const TransformKernelTable SSE2_TRANSFORM_KERNELS =
+{
+	ComposeTransformsSimd<Sse2>,
+	MultiplyTransformsSimd<Sse2>,
+	TransposeTransformsSimd<Sse2>,
+	TransformSpheresSimd<Sse2>,
+};
+#endif
+
+bool IsTransformPathSupported(TransformPath path)
+{
+	switch (path)
+	{
+	case TRANSFORM_PATH_SCALAR:
+		return true;
+#if TRANSFORM_KERNELS_SSE2
+	case TRANSFORM_PATH_SSE2:
+		return GetCpuFeatures().sse2;
+#endif
+#if TRANSFORM_KERNELS_AVX2
+	case TRANSFORM_PATH_AVX2:
+		return GetCpuFeatures().avx2;
+#endif
+#if TRANSFORM_KERNELS_AVX512
+	case TRANSFORM_PATH_AVX512:
+		return GetCpuFeatures().avx512;
+#endif
+	default:
+		return false;
+	}
+}
+
+TransformPath GetBestTransformPath()
+{
+	int path = TRANSFORM_PATH_COUNT - 1;
+	while (!IsTransformPathSupported((TransformPath)path))
+	{
+		path--;
+	}
+
+	return (TransformPath)path;
+}
+
+const char * GetTransformPathName(TransformPath path)
+{
+	static const char * names[TRANSFORM_PATH_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+	return names[path];
+}
+
+static const TransformKernelTable& GetKernels(TransformPath path)
+{
+	while (!IsTransformPathSupported(path))
+	{
+		path = (TransformPath)(path - 1);
+	}
+
+	switch (path)
+	{
+#if TRANSFORM_KERNELS_SSE2
+	case TRANSFORM_PATH_SSE2:
+		return SSE2_TRANSFORM_KERNELS;
+#endif
+#if TRANSFORM_KERNELS_AVX2
+	case TRANSFORM_PATH_AVX2:
+		return AVX2_TRANSFORM_KERNELS;
+#endif
+#if TRANSFORM_KERNELS_AVX512
+	case TRANSFORM_PATH_AVX512:
+		return AVX512_TRANSFORM_KERNELS;
+#endif
+	default:
+		return SCALAR_TRANSFORM_KERNELS;
+	}
+}
+
+void ComposeTransforms(const TransformTRS * transforms, XMFLOAT4X4 * worlds, int count, TransformPath path)
+{
+	GetKernels(path).compose(transforms, worlds, count);
+}
+
+void MultiplyTransforms(const XMFLOAT4X4 * locals, const XMFLOAT4X4& parent, XMFLOAT4X4 * worlds, int count, TransformPath path)
+{
+	GetKernels(path).multiply(locals, parent, worlds, count);
+}
+
+void TransposeTransforms(const XMFLOAT4X4 * matrices, XMFLOAT4X4 * transposed, int count, TransformPath path)
+{
+	GetKernels(path).transpose(matrices, transposed, count);
+}
+
+void TransformSpheres(const SphereBounds& localSphere, const XMFLOAT4X4 * worlds, SphereBounds * worldSpheres, int count,
+	TransformPath path)
+{
+	GetKernels(path).spheres(localSphere, worlds, worldSpheres, count);
+}
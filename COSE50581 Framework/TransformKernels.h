@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Frustum.h"
+
+using namespace DirectX;
+
+// Kernels that work on arrays of transforms rather than one XMMATRIX at a time: composing scale,
+// rotation and translation into world matrices, multiplying by a parent, transposing for upload
+// and moving bounding spheres into world space.
+//
+// Each kernel has a path for SSE2, AVX2 and AVX-512, and the widest one the processor has is
+// picked with CPUID when the program starts, so one build runs well on every machine. SSE2
+// handles one transform per instruction, AVX2 two and AVX-512 four, each transform in its own
+// 128-bit lane. The scalar path is DirectXMath one transform at a time.
+enum TransformPath
+{
+	TRANSFORM_PATH_SCALAR,
+	TRANSFORM_PATH_SSE2,
+	TRANSFORM_PATH_AVX2,
+	TRANSFORM_PATH_AVX512,
+	TRANSFORM_PATH_COUNT
+};
+
+// Scale, then rotation, then translation. Each part fills 16 bytes so that the kernels load it
+// as one register; the w of the scale and the translation is ignored.
+struct TransformTRS
+{
+	XMFLOAT4 scale;
+	// A unit quaternion
+	XMFLOAT4 rotation;
+	XMFLOAT4 translation;
+};
+
+// Whether this build has the path and the processor can run it
+bool IsTransformPathSupported(TransformPath path);
+// The widest supported path, which the kernels use unless they are given another
+TransformPath GetBestTransformPath();
+const char * GetTransformPathName(TransformPath path);
+
+// Unsupported paths fall back to the widest supported path below them. Every kernel may write
+// over its input.
+
+void ComposeTransforms(const TransformTRS * transforms, XMFLOAT4X4 * worlds, int count,
+	TransformPath path = GetBestTransformPath());
+
+// worlds[i] = locals[i] * parent
+void MultiplyTransforms(const XMFLOAT4X4 * locals, const XMFLOAT4X4& parent, XMFLOAT4X4 * worlds, int count,
+	TransformPath path = GetBestTransformPath());
+
+// Into the column major layout the shaders' constant buffers read
+void TransposeTransforms(const XMFLOAT4X4 * matrices, XMFLOAT4X4 * transposed, int count,
+	TransformPath path = GetBestTransformPath());
+
+// Moves one mesh's bounding sphere by every world matrix, as GameObject::GetBoundingSphere does.
+// The matrices must be affine.
+void TransformSpheres(const SphereBounds& localSphere, const XMFLOAT4X4 * worlds, SphereBounds * worldSpheres, int count,
+	TransformPath path = GetBestTransformPath());
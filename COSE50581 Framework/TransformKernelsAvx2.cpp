@@ -0,0 +1,72 @@
+// The AVX2 transform kernels, two transforms to a register. The CMake build compiles this file
+// with AVX2 and FMA enabled, and TransformKernels.cpp only calls it when CPUID has found them.
+
+#include "TransformKernelsSimd.h"
+
+#if TRANSFORM_KERNELS_AVX2
+#include <immintrin.h>
+
+struct Avx2
+{
+	typedef __m256 Vector;
+	static const int LANES = 2;
+
+	static Vector Set1(float value) { return _mm256_set1_ps(value); }
+	static Vector Load(const float * p) { return _mm256_loadu_ps(p); }
+	static void Store(float * p, Vector v) { _mm256_storeu_ps(p, v); }
+
+	static Vector LoadLanes(const float * p, int stride)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + stride), 1);
+	}
+
+	static Vector LoadBroadcast(const float * p) { return _mm256_broadcast_ps((const __m128 *)p); }
+
+	// Two matrices are four whole registers, with the rows swapped between them so that each
+	// register holds one row of both
+	static void LoadMatrices(const float * p, Vector rows[4])
+	{
+		Vector first01 = _mm256_loadu_ps(p);
+		Vector first23 = _mm256_loadu_ps(p + 8);
+		Vector second01 = _mm256_loadu_ps(p + 16);
+		Vector second23 = _mm256_loadu_ps(p + 24);
+
+		rows[0] = _mm256_permute2f128_ps(first01, second01, 0x20);
+		rows[1] = _mm256_permute2f128_ps(first01, second01, 0x31);
+		rows[2] = _mm256_permute2f128_ps(first23, second23, 0x20);
+		rows[3] = _mm256_permute2f128_ps(first23, second23, 0x31);
+	}
+
+	static void StoreMatrices(float * p, const Vector rows[4])
+	{
+		_mm256_storeu_ps(p, _mm256_permute2f128_ps(rows[0], rows[1], 0x20));
+		_mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(rows[2], rows[3], 0x20));
+		_mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(rows[0], rows[1], 0x31));
+		_mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(rows[2], rows[3], 0x31));
+	}
+
+	template <int X, int Y, int Z, int W>
+	static Vector Permute(Vector v) { return _mm256_permute_ps(v, _MM_SHUFFLE(W, Z, Y, X)); }
+	template <int X, int Y, int Z, int W>
+	static Vector Shuffle(Vector a, Vector b) { return _mm256_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+	template <int MASK>
+	static Vector Blend(Vector a, Vector b) { return _mm256_blend_ps(a, b, MASK | (MASK << 4)); }
+
+	static Vector UnpackLo(Vector a, Vector b) { return _mm256_unpacklo_ps(a, b); }
+	static Vector UnpackHi(Vector a, Vector b) { return _mm256_unpackhi_ps(a, b); }
+	static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+	static Vector Sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+	static Vector Mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+	static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm256_fmadd_ps(a, b, c); }
+	static Vector Max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+	static Vector Sqrt(Vector v) { return _mm256_sqrt_ps(v); }
+};
+
+const TransformKernelTable AVX2_TRANSFORM_KERNELS =
+{
+	ComposeTransformsSimd<Avx2>,
+	MultiplyTransformsSimd<Avx2>,
+	TransposeTransformsSimd<Avx2>,
+	TransformSpheresSimd<Avx2>,
+};
+#endif
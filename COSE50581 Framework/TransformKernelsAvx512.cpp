@@ -0,0 +1,88 @@
+// The AVX-512 transform kernels, four transforms to a register. The CMake build compiles this
+// file with AVX-512 enabled, and TransformKernels.cpp only calls it when CPUID has found it.
+
+#include "TransformKernelsSimd.h"
+
+#if TRANSFORM_KERNELS_AVX512
+#include <immintrin.h>
+
+struct Avx512
+{
+	typedef __m512 Vector;
+	static const int LANES = 4;
+
+	static Vector Set1(float value) { return _mm512_set1_ps(value); }
+	static Vector Load(const float * p) { return _mm512_loadu_ps(p); }
+	static void Store(float * p, Vector v) { _mm512_storeu_ps(p, v); }
+
+	static Vector LoadLanes(const float * p, int stride)
+	{
+		Vector v = _mm512_castps128_ps512(_mm_loadu_ps(p));
+		v = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride), 1);
+		v = _mm512_insertf32x4(v, _mm_loadu_ps(p + 2 * stride), 2);
+		return _mm512_insertf32x4(v, _mm_loadu_ps(p + 3 * stride), 3);
+	}
+
+	static Vector LoadBroadcast(const float * p) { return _mm512_broadcast_f32x4(_mm_loadu_ps(p)); }
+
+	// Four matrices are four whole registers. Swapping the lanes between them as a 4x4 transpose
+	// turns a register per matrix into a register per row, and back.
+	static void TransposeLanes(Vector rows[4])
+	{
+		Vector low01 = _mm512_shuffle_f32x4(rows[0], rows[1], 0x44);
+		Vector high01 = _mm512_shuffle_f32x4(rows[0], rows[1], 0xEE);
+		Vector low23 = _mm512_shuffle_f32x4(rows[2], rows[3], 0x44);
+		Vector high23 = _mm512_shuffle_f32x4(rows[2], rows[3], 0xEE);
+
+		rows[0] = _mm512_shuffle_f32x4(low01, low23, 0x88);
+		rows[1] = _mm512_shuffle_f32x4(low01, low23, 0xDD);
+		rows[2] = _mm512_shuffle_f32x4(high01, high23, 0x88);
+		rows[3] = _mm512_shuffle_f32x4(high01, high23, 0xDD);
+	}
+
+	static void LoadMatrices(const float * p, Vector rows[4])
+	{
+		for (int matrix = 0; matrix < 4; matrix++)
+		{
+			rows[matrix] = _mm512_loadu_ps(p + matrix * 16);
+		}
+
+		TransposeLanes(rows);
+	}
+
+	static void StoreMatrices(float * p, const Vector rows[4])
+	{
+		Vector matrices[4] = { rows[0], rows[1], rows[2], rows[3] };
+		TransposeLanes(matrices);
+
+		for (int matrix = 0; matrix < 4; matrix++)
+		{
+			_mm512_storeu_ps(p + matrix * 16, matrices[matrix]);
+		}
+	}
+
+	template <int X, int Y, int Z, int W>
+	static Vector Permute(Vector v) { return _mm512_permute_ps(v, _MM_SHUFFLE(W, Z, Y, X)); }
+	template <int X, int Y, int Z, int W>
+	static Vector Shuffle(Vector a, Vector b) { return _mm512_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+	template <int MASK>
+	static Vector Blend(Vector a, Vector b) { return _mm512_mask_blend_ps((__mmask16)(MASK * 0x1111), a, b); }
+
+	static Vector UnpackLo(Vector a, Vector b) { return _mm512_unpacklo_ps(a, b); }
+	static Vector UnpackHi(Vector a, Vector b) { return _mm512_unpackhi_ps(a, b); }
+	static Vector Add(Vector a, Vector b) { return _mm512_add_ps(a, b); }
+	static Vector Sub(Vector a, Vector b) { return _mm512_sub_ps(a, b); }
+	static Vector Mul(Vector a, Vector b) { return _mm512_mul_ps(a, b); }
+	static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm512_fmadd_ps(a, b, c); }
+	static Vector Max(Vector a, Vector b) { return _mm512_max_ps(a, b); }
+	static Vector Sqrt(Vector v) { return _mm512_sqrt_ps(v); }
+};
+
+const TransformKernelTable AVX512_TRANSFORM_KERNELS =
+{
+	ComposeTransformsSimd<Avx512>,
+	MultiplyTransformsSimd<Avx512>,
+	TransposeTransformsSimd<Avx512>,
+	TransformSpheresSimd<Avx512>,
+};
+#endif
@@ -0,0 +1,191 @@
+#pragma once
+
+// The transform kernels, written once for any number of 128-bit lanes. Only TransformKernels.cpp
+// and the files that build the wider paths include this. Each of them defines a Simd type
+// wrapping its instruction set, with one transform in each lane of a Vector, and instantiates
+// the kernels with it. LoadMatrices and StoreMatrices move a register's worth of matrices as a
+// register per row, so that each lane holds that row of a different matrix.
+
+#include "TransformKernels.h"
+
+// MSVC compiles AVX2 intrinsics from Visual Studio 2013 and AVX-512 ones from 2017 without any
+// flags, so the files with those paths always build them. Other compilers need the instruction
+// sets enabled for those files, which the CMake build does, defining these when it has.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#if _MSC_VER >= 1800 && !defined(TRANSFORM_KERNELS_AVX2)
+#define TRANSFORM_KERNELS_AVX2 1
+#endif
+#if _MSC_VER >= 1911 && !defined(TRANSFORM_KERNELS_AVX512)
+#define TRANSFORM_KERNELS_AVX512 1
+#endif
+#endif
+
+struct TransformKernelTable
+{
+	void (*compose)(const TransformTRS * transforms, XMFLOAT4X4 * worlds, int count);
+	void (*multiply)(const XMFLOAT4X4 * locals, const XMFLOAT4X4& parent, XMFLOAT4X4 * worlds, int count);
+	void (*transpose)(const XMFLOAT4X4 * matrices, XMFLOAT4X4 * transposed, int count);
+	void (*spheres)(const SphereBounds& localSphere, const XMFLOAT4X4 * worlds, SphereBounds * worldSpheres, int count);
+};
+
+extern const TransformKernelTable SCALAR_TRANSFORM_KERNELS;
+extern const TransformKernelTable SSE2_TRANSFORM_KERNELS;
+extern const TransformKernelTable AVX2_TRANSFORM_KERNELS;
+extern const TransformKernelTable AVX512_TRANSFORM_KERNELS;
+
+// The kernels below are in an unnamed namespace so that every file gets its own copy, built with
+// its own instruction set. Were they shared, the linker could keep the AVX-512 copy for everyone.
+namespace
+{
+	// The transforms left over after the last whole register go through the scalar path
+	template <typename Simd>
+	void ComposeTransformsSimd(const TransformTRS * transforms, XMFLOAT4X4 * worlds, int count)
+	{
+		typedef typename Simd::Vector Vector;
+		const int STRIDE = sizeof(TransformTRS) / sizeof(float);
+
+		Vector zero = Simd::Set1(0.0f);
+		Vector one = Simd::Set1(1.0f);
+
+		int i = 0;
+		for (; i + Simd::LANES <= count; i += Simd::LANES)
+		{
+			Vector scale = Simd::LoadLanes(&transforms[i].scale.x, STRIDE);
+			Vector q = Simd::LoadLanes(&transforms[i].rotation.x, STRIDE);
+			Vector translation = Simd::LoadLanes(&transforms[i].translation.x, STRIDE);
+
+			// The rotation matrix of a quaternion, as XMMatrixRotationQuaternion builds it. The
+			// diagonal is 1 - 2(yy + zz), 1 - 2(xx + zz), 1 - 2(xx + yy), and the rest pairs the
+			// products 2xy, 2xz, 2yz with 2wz, 2wy, 2wx.
+			Vector q2 = Simd::Add(q, q);
+			Vector squares = Simd::Mul(q, q2);
+			Vector diagonal = Simd::Sub(Simd::Sub(one, Simd::template Permute<1, 0, 0, 3>(squares)),
+				Simd::template Permute<2, 2, 1, 3>(squares));
+
+			Vector products = Simd::Mul(Simd::template Permute<0, 0, 1, 3>(q), Simd::template Permute<2, 1, 2, 3>(q2));
+			Vector wProducts = Simd::Mul(Simd::template Permute<3, 3, 3, 3>(q2), Simd::template Permute<1, 2, 0, 3>(q));
+
+			// (2xz + 2wy, 2xy + 2wz, 2yz + 2wx) and the differences, with every w cleared so that
+			// the rows pick up a 0
+			Vector sums = Simd::template Blend<8>(Simd::Add(products, wProducts), zero);
+			Vector differences = Simd::template Blend<8>(Simd::Sub(products, wProducts), zero);
+			diagonal = Simd::template Blend<8>(diagonal, zero);
+
+			Vector row0 = Simd::template Shuffle<0, 2, 0, 3>(Simd::template Shuffle<0, 0, 1, 1>(diagonal, sums), differences);
+			Vector row1 = Simd::template Shuffle<0, 2, 2, 3>(Simd::template Shuffle<1, 1, 1, 1>(differences, diagonal), sums);
+			Vector row2 = Simd::template Shuffle<0, 2, 2, 3>(Simd::template Shuffle<0, 0, 2, 2>(sums, differences), diagonal);
+
+			Vector rows[4];
+			rows[0] = Simd::Mul(row0, Simd::template Permute<0, 0, 0, 0>(scale));
+			rows[1] = Simd::Mul(row1, Simd::template Permute<1, 1, 1, 1>(scale));
+			rows[2] = Simd::Mul(row2, Simd::template Permute<2, 2, 2, 2>(scale));
+			rows[3] = Simd::template Blend<8>(translation, one);
+			Simd::StoreMatrices(&worlds[i]._11, rows);
+		}
+
+		if (i < count)
+			SCALAR_TRANSFORM_KERNELS.compose(transforms + i, worlds + i, count - i);
+	}
+
+	// Each row of the result only needs the same row of the local matrix, so the matrices are
+	// read as one run of rows, whole registers at a time, whichever matrix they belong to
+	template <typename Simd>
+	void MultiplyTransformsSimd(const XMFLOAT4X4 * locals, const XMFLOAT4X4& parent, XMFLOAT4X4 * worlds, int count)
+	{
+		typedef typename Simd::Vector Vector;
+
+		Vector parent0 = Simd::LoadBroadcast(&parent._11);
+		Vector parent1 = Simd::LoadBroadcast(&parent._21);
+		Vector parent2 = Simd::LoadBroadcast(&parent._31);
+		Vector parent3 = Simd::LoadBroadcast(&parent._41);
+
+		const float * source = &locals[0]._11;
+		float * destination = &worlds[0]._11;
+		int rowCount = count * 4;
+
+		// Every path's lane count divides 4, so there are never rows left over
+		for (int row = 0; row < rowCount; row += Simd::LANES)
+		{
+			Vector local = Simd::Load(source + row * 4);
+
+			Vector world = Simd::Mul(Simd::template Permute<0, 0, 0, 0>(local), parent0);
+			world = Simd::MulAdd(Simd::template Permute<1, 1, 1, 1>(local), parent1, world);
+			world = Simd::MulAdd(Simd::template Permute<2, 2, 2, 2>(local), parent2, world);
+			world = Simd::MulAdd(Simd::template Permute<3, 3, 3, 3>(local), parent3, world);
+
+			Simd::Store(destination + row * 4, world);
+		}
+	}
+
+	template <typename Simd>
+	void TransposeTransformsSimd(const XMFLOAT4X4 * matrices, XMFLOAT4X4 * transposed, int count)
+	{
+		typedef typename Simd::Vector Vector;
+
+		int i = 0;
+		for (; i + Simd::LANES <= count; i += Simd::LANES)
+		{
+			Vector rows[4];
+			Simd::LoadMatrices(&matrices[i]._11, rows);
+
+			// _MM_TRANSPOSE4_PS, in every lane at once
+			Vector low01 = Simd::UnpackLo(rows[0], rows[1]);
+			Vector low23 = Simd::UnpackLo(rows[2], rows[3]);
+			Vector high01 = Simd::UnpackHi(rows[0], rows[1]);
+			Vector high23 = Simd::UnpackHi(rows[2], rows[3]);
+
+			rows[0] = Simd::template Shuffle<0, 1, 0, 1>(low01, low23);
+			rows[1] = Simd::template Shuffle<2, 3, 2, 3>(low01, low23);
+			rows[2] = Simd::template Shuffle<0, 1, 0, 1>(high01, high23);
+			rows[3] = Simd::template Shuffle<2, 3, 2, 3>(high01, high23);
+			Simd::StoreMatrices(&transposed[i]._11, rows);
+		}
+
+		if (i < count)
+			SCALAR_TRANSFORM_KERNELS.transpose(matrices + i, transposed + i, count - i);
+	}
+
+	// The squared length of a row's x, y and z, in every element of its lane
+	template <typename Simd>
+	typename Simd::Vector LengthSquared3(typename Simd::Vector row, typename Simd::Vector zero)
+	{
+		typedef typename Simd::Vector Vector;
+
+		Vector squares = Simd::template Blend<8>(Simd::Mul(row, row), zero);
+		Vector pairs = Simd::Add(squares, Simd::template Permute<1, 0, 3, 2>(squares));
+		return Simd::Add(pairs, Simd::template Permute<2, 3, 0, 1>(pairs));
+	}
+
+	template <typename Simd>
+	void TransformSpheresSimd(const SphereBounds& localSphere, const XMFLOAT4X4 * worlds, SphereBounds * worldSpheres, int count)
+	{
+		typedef typename Simd::Vector Vector;
+		static_assert(sizeof(SphereBounds) == 4 * sizeof(float), "A sphere must fill one lane");
+
+		Vector zero = Simd::Set1(0.0f);
+		Vector sphere = Simd::LoadBroadcast(&localSphere.Center.x);
+		Vector centerX = Simd::template Permute<0, 0, 0, 0>(sphere);
+		Vector centerY = Simd::template Permute<1, 1, 1, 1>(sphere);
+		Vector centerZ = Simd::template Permute<2, 2, 2, 2>(sphere);
+		Vector radius = Simd::template Permute<3, 3, 3, 3>(sphere);
+
+		int i = 0;
+		for (; i + Simd::LANES <= count; i += Simd::LANES)
+		{
+			Vector rows[4];
+			Simd::LoadMatrices(&worlds[i]._11, rows);
+
+			Vector center = Simd::MulAdd(centerX, rows[0], Simd::MulAdd(centerY, rows[1], Simd::MulAdd(centerZ, rows[2], rows[3])));
+
+			// The radius grows with the largest axis scale, so the sphere still covers the mesh
+			// when it is scaled unevenly
+			Vector scaleSquared = Simd::Max(LengthSquared3<Simd>(rows[0], zero),
+				Simd::Max(LengthSquared3<Simd>(rows[1], zero), LengthSquared3<Simd>(rows[2], zero)));
+
+			Simd::Store(&worldSpheres[i].Center.x, Simd::template Blend<8>(center, Simd::Mul(Simd::Sqrt(scaleSquared), radius)));
+		}
+
+		if (i < count)
+			SCALAR_TRANSFORM_KERNELS.spheres(localSphere, worlds + i, worldSpheres + i, count - i);
+	}
+}
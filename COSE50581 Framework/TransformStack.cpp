@@ -0,0 +1,16 @@
+#include "TransformStack.h"
+
+void TransformStack::Rotate(float x, float y, float z)
+{
+	XMMATRIX m = XMLoadFloat4x4A(&_matrix);
+
+	// Most objects only spin around one axis, so skip the axes that aren't rotated at all
+	if (x != 0.0f)
+		m = XMMatrixMultiply(m, XMMatrixRotationX(x));
+	if (y != 0.0f)
+		m = XMMatrixMultiply(m, XMMatrixRotationY(y));
+	if (z != 0.0f)
+		m = XMMatrixMultiply(m, XMMatrixRotationZ(z));
+
+	XMStoreFloat4x4A(&_matrix, m);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// Collects the scale, rotation and translation steps applied to an object during a frame.
+// Instead of storing every step and multiplying them together later, each step is folded into
+// a single 16-byte aligned matrix as soon as it is set, so there is no heap traffic and the
+// storage never grows. The result is the same as multiplying the steps together in the order
+// they were set, starting from the identity.
+//
+// All steps are affine, so the matrix always keeps (0, 0, 0, 1) as its last column. That lets
+// scaling and translation be applied with a few vector operations instead of a full multiply.
+class TransformStack
+{
+private:
+	XMFLOAT4X4A _matrix;
+
+public:
+	TransformStack() { Reset(); }
+
+	void Reset() { XMStoreFloat4x4A(&_matrix, XMMatrixIdentity()); }
+
+	// Same as multiplying by XMMatrixScaling(x, y, z)
+	void Scale(float x, float y, float z)
+	{
+		XMMATRIX m = XMLoadFloat4x4A(&_matrix);
+		XMVECTOR scale = XMVectorSet(x, y, z, 1.0f);
+		m.r[0] = XMVectorMultiply(m.r[0], scale);
+		m.r[1] = XMVectorMultiply(m.r[1], scale);
+		m.r[2] = XMVectorMultiply(m.r[2], scale);
+		m.r[3] = XMVectorMultiply(m.r[3], scale);
+		XMStoreFloat4x4A(&_matrix, m);
+	}
+
+	// Same as multiplying by XMMatrixRotationX(x) * XMMatrixRotationY(y) * XMMatrixRotationZ(z)
+	void Rotate(float x, float y, float z);
+
+	// Same as multiplying by XMMatrixTranslation(x, y, z)
+	void Translate(float x, float y, float z)
+	{
+		_matrix._41 += x;
+		_matrix._42 += y;
+		_matrix._43 += z;
+	}
+
+	XMMATRIX GetMatrix() const { return XMLoadFloat4x4A(&_matrix); }
+};
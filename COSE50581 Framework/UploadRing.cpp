@@ -0,0 +1,104 @@
+#include "UploadRing.h"
+
+const size_t UploadRing::INVALID_OFFSET = (size_t)-1;
+
+UploadRing::UploadRing()
+{
+	Reset(0);
+	ResetStats();
+}
+
+UploadRing::~UploadRing()
+{
+}
+
+void UploadRing::Reset(size_t capacity)
+{
+	_capacity = capacity;
+	_head = 0;
+	_used = 0;
+	_frameBytes = 0;
+	_frames.clear();
+}
+
+size_t UploadRing::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0 || size > _capacity)
+	{
+		_stats.failedAllocations++;
+		return INVALID_OFFSET;
+	}
+
+	// Nothing is in use, so start again from the beginning rather than wrapping later
+	if (_used == 0)
+		_head = 0;
+
+	size_t offset = (_head + alignment - 1) & ~(alignment - 1);
+	bool wrap = offset + size > _capacity;
+	if (wrap)
+		offset = 0;
+
+	// Everything from the head up to the end of the allocation, including the end of the ring
+	// that is skipped when wrapping
+	size_t taken = wrap ? _capacity - _head + size : offset + size - _head;
+
+	if (_used + taken > _capacity)
+	{
+		_stats.failedAllocations++;
+		return INVALID_OFFSET;
+	}
+
+	_head = offset + size;
+	_used += taken;
+	_frameBytes += taken;
+
+	_stats.allocations++;
+	_stats.bytesAllocated += size;
+	_stats.paddingBytes += taken - size;
+	_stats.wraps += wrap ? 1 : 0;
+
+	return offset;
+}
+
+void UploadRing::EndFrame(uint64_t fence)
+{
+	Frame frame;
+	frame.fence = fence;
+	frame.bytes = _frameBytes;
+	_frames.push_back(frame);
+
+	_frameBytes = 0;
+}
+
+void UploadRing::Retire(uint64_t completedFence)
+{
+	// Frames finish in order, so the space they free is always at the tail
+	while (!_frames.empty() && _frames.front().fence <= completedFence)
+	{
+		_used -= _frames.front().bytes;
+		_frames.pop_front();
+	}
+}
+
+bool UploadRing::GetOldestFence(uint64_t& fence) const
+{
+	for (const Frame& frame : _frames)
+	{
+		if (frame.bytes > 0)
+		{
+			fence = frame.fence;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UploadRing::ResetStats()
+{
+	_stats.allocations = 0;
+	_stats.bytesAllocated = 0;
+	_stats.paddingBytes = 0;
+	_stats.wraps = 0;
+	_stats.failedAllocations = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+using namespace std;
+
+struct UploadRingStats
+{
+	long long allocations;
+	long long bytesAllocated;
+	// Bytes skipped to align allocations or to wrap back to the start
+	long long paddingBytes;
+	long long wraps;
+	// Allocations refused because the space was still in use by frames the GPU hadn't finished
+	long long failedAllocations;
+};
+
+// Hands out space for per-frame upload data from one large buffer, in order, wrapping back to
+// the start when it reaches the end. Space stays in use until the frame it was allocated in has
+// been retired, so data the GPU may still be reading is never overwritten.
+//
+// Fences are just increasing numbers chosen by the caller. EndFrame closes the frame with a
+// fence, and Retire releases every closed frame whose fence the GPU has passed. The ring only
+// does the bookkeeping: D3D11RenderDevice maps the buffer itself and turns its event queries
+// into fences, so the logic can be checked without a GPU.
+class UploadRing
+{
+private:
+	struct Frame
+	{
+		uint64_t fence;
+		size_t bytes;
+	};
+
+	size_t _capacity;
+	// Where the next allocation starts looking, and the bytes between the oldest frame still in
+	// use and it, counting padding
+	size_t _head;
+	size_t _used;
+	// The bytes taken by the frame still being built
+	size_t _frameBytes;
+	deque<Frame> _frames;
+
+	UploadRingStats _stats;
+
+public:
+	// Allocate's result when the space can't be had
+	static const size_t INVALID_OFFSET;
+
+	UploadRing();
+	~UploadRing();
+
+	// Starts over with an empty ring of capacity bytes, forgetting the frames in flight
+	void Reset(size_t capacity);
+
+	// Returns the offset of size bytes aligned to alignment, which must be a power of two, or
+	// INVALID_OFFSET when they don't fit without reaching space still in use. An allocation never
+	// straddles the end of the ring.
+	size_t Allocate(size_t size, size_t alignment);
+
+	// Closes the current frame. Its space is released once fence has been retired.
+	void EndFrame(uint64_t fence);
+
+	// Releases the space of every closed frame whose fence is no later than completedFence
+	void Retire(uint64_t completedFence);
+
+	// The fence of the oldest closed frame still holding space, to wait on when Allocate fails.
+	// Returns false when no closed frame holds any.
+	bool GetOldestFence(uint64_t& fence) const;
+
+	size_t GetCapacity() const { return _capacity; }
+	size_t GetUsed() const { return _used; }
+	int GetFramesInFlight() const { return (int)_frames.size(); }
+
+	const UploadRingStats& GetStats() const { return _stats; }
+	void ResetStats();
+};
@@ -0,0 +1,253 @@
+#include "VertexCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float POSITION_STEPS = 65535.0f;
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// A SNORM integer as the GPU reads it: the most negative value reads as -1 too
+	float SnormToFloat(int value, int maxValue)
+	{
+		return (std::max)(value / (float)maxValue, -1.0f);
+	}
+
+	uint16_t QuantiseAxis(float value, float offset, float scale)
+	{
+		if (scale <= 0.0f)
+			return 0;
+
+		float steps = roundf((value - offset) / scale * POSITION_STEPS);
+		return (uint16_t)(std::min)((std::max)(steps, 0.0f), POSITION_STEPS);
+	}
+}
+
+size_t GetVertexStride(MeshVertexFormat format)
+{
+	switch (format)
+	{
+	case VERTEX_FORMAT_QUANTISED_12:
+		return sizeof(QuantisedVertex12);
+	case VERTEX_FORMAT_QUANTISED_8:
+		return sizeof(QuantisedVertex8);
+	default:
+		return sizeof(SimpleVertex);
+	}
+}
+
+PositionQuantisation GetPositionQuantisation(const vector<SimpleVertex>& vertices)
+{
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (const SimpleVertex& vertex : vertices)
+	{
+		boundsMin.x = fminf(boundsMin.x, vertex.Pos.x);
+		boundsMin.y = fminf(boundsMin.y, vertex.Pos.y);
+		boundsMin.z = fminf(boundsMin.z, vertex.Pos.z);
+		boundsMax.x = fmaxf(boundsMax.x, vertex.Pos.x);
+		boundsMax.y = fmaxf(boundsMax.y, vertex.Pos.y);
+		boundsMax.z = fmaxf(boundsMax.z, vertex.Pos.z);
+	}
+
+	PositionQuantisation quantisation;
+	if (vertices.empty())
+	{
+		quantisation.offset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		quantisation.scale = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return quantisation;
+	}
+
+	quantisation.offset = boundsMin;
+	quantisation.scale = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+	return quantisation;
+}
+
+float GetPositionErrorBound(const PositionQuantisation& quantisation)
+{
+	float x = quantisation.scale.x / POSITION_STEPS * 0.5f;
+	float y = quantisation.scale.y / POSITION_STEPS * 0.5f;
+	float z = quantisation.scale.z / POSITION_STEPS * 0.5f;
+
+	// Decoding in single precision can round once more on each axis
+	float magnitude = (std::max)(fabsf(quantisation.offset.x), fabsf(quantisation.offset.x + quantisation.scale.x));
+	magnitude = (std::max)(magnitude, (std::max)(fabsf(quantisation.offset.y), fabsf(quantisation.offset.y + quantisation.scale.y)));
+	magnitude = (std::max)(magnitude, (std::max)(fabsf(quantisation.offset.z), fabsf(quantisation.offset.z + quantisation.scale.z)));
+
+	return sqrtf(x * x + y * y + z * z) + magnitude * FLT_EPSILON * 4.0f;
+}
+
+void QuantisePosition(const XMFLOAT3& position, const PositionQuantisation& quantisation, uint16_t quantised[3])
+{
+	quantised[0] = QuantiseAxis(position.x, quantisation.offset.x, quantisation.scale.x);
+	quantised[1] = QuantiseAxis(position.y, quantisation.offset.y, quantisation.scale.y);
+	quantised[2] = QuantiseAxis(position.z, quantisation.offset.z, quantisation.scale.z);
+}
+
+XMFLOAT3 DequantisePosition(const uint16_t quantised[3], const PositionQuantisation& quantisation)
+{
+	// The input assembler turns UNORM into a fraction, then the shader scales and offsets it
+	return XMFLOAT3(
+		quantised[0] / POSITION_STEPS * quantisation.scale.x + quantisation.offset.x,
+		quantised[1] / POSITION_STEPS * quantisation.scale.y + quantisation.offset.y,
+		quantised[2] / POSITION_STEPS * quantisation.scale.z + quantisation.offset.z);
+}
+
+void EncodeOctahedral(const XMFLOAT3& normal, int bits, int encoded[2])
+{
+	int maxValue = (1 << (bits - 1)) - 1;
+
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half out over the
+	// corners of the upper half's square. A zero, infinite or NaN normal has no direction to
+	// keep, and is encoded as +z.
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	bool hasDirection = length > 0.0f && length <= FLT_MAX;
+	float x = hasDirection ? normal.x / length : 0.0f;
+	float y = hasDirection ? normal.y / length : 0.0f;
+
+	if (hasDirection && normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// Rounding each coordinate on its own isn't always nearest on the sphere, so try the four
+	// encodings around the point and keep whichever decodes closest
+	XMVECTOR target = hasDirection ? XMVector3Normalize(XMLoadFloat3(&normal)) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	float baseX = floorf(x * maxValue);
+	float baseY = floorf(y * maxValue);
+	float bestDot = -2.0f;
+
+	for (int corner = 0; corner < 4; corner++)
+	{
+		int candidate[2] =
+		{
+			(std::min)((std::max)((int)baseX + (corner & 1), -maxValue), maxValue),
+			(std::min)((std::max)((int)baseY + (corner >> 1), -maxValue), maxValue)
+		};
+
+		XMFLOAT3 decoded = DecodeOctahedral(candidate, bits);
+		float dot = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&decoded), target));
+
+		// The first candidate is always kept, in case no dot product compares
+		if (corner == 0 || dot > bestDot)
+		{
+			bestDot = dot;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+XMFLOAT3 DecodeOctahedral(const int encoded[2], int bits)
+{
+	int maxValue = (1 << (bits - 1)) - 1;
+
+	float x = SnormToFloat(encoded[0], maxValue);
+	float y = SnormToFloat(encoded[1], maxValue);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Points outside the diamond were folded up from the lower half
+	float t = (std::max)(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+	return normal;
+}
+
+void CompressVertices(const vector<SimpleVertex>& vertices, MeshVertexFormat format, CompressedVertices& compressed)
+{
+	compressed.format = format;
+	compressed.quantisation = GetPositionQuantisation(vertices);
+	compressed.stride = GetVertexStride(format);
+	compressed.count = vertices.size();
+	compressed.data.assign(compressed.stride * vertices.size(), 0);
+
+	uint8_t * out = compressed.data.data();
+
+	for (const SimpleVertex& vertex : vertices)
+	{
+		int normal[2];
+
+		switch (format)
+		{
+		case VERTEX_FORMAT_QUANTISED_12:
+		{
+			QuantisedVertex12 packed = {};
+			QuantisePosition(vertex.Pos, compressed.quantisation, packed.position);
+			EncodeOctahedral(vertex.Normal, 16, normal);
+			packed.normal[0] = (int16_t)normal[0];
+			packed.normal[1] = (int16_t)normal[1];
+			memcpy(out, &packed, sizeof(packed));
+			break;
+		}
+
+		case VERTEX_FORMAT_QUANTISED_8:
+		{
+			QuantisedVertex8 packed = {};
+			QuantisePosition(vertex.Pos, compressed.quantisation, packed.position);
+			EncodeOctahedral(vertex.Normal, 8, normal);
+			packed.normal[0] = (int8_t)normal[0];
+			packed.normal[1] = (int8_t)normal[1];
+			memcpy(out, &packed, sizeof(packed));
+			break;
+		}
+
+		default:
+			memcpy(out, &vertex, sizeof(vertex));
+			break;
+		}
+
+		out += compressed.stride;
+	}
+}
+
+void DecompressVertices(const CompressedVertices& compressed, vector<SimpleVertex>& vertices)
+{
+	vertices.resize(compressed.count);
+	const uint8_t * in = compressed.data.data();
+
+	for (SimpleVertex& vertex : vertices)
+	{
+		switch (compressed.format)
+		{
+		case VERTEX_FORMAT_QUANTISED_12:
+		{
+			QuantisedVertex12 packed;
+			memcpy(&packed, in, sizeof(packed));
+			int normal[2] = { packed.normal[0], packed.normal[1] };
+			vertex.Pos = DequantisePosition(packed.position, compressed.quantisation);
+			vertex.Normal = DecodeOctahedral(normal, 16);
+			break;
+		}
+
+		case VERTEX_FORMAT_QUANTISED_8:
+		{
+			QuantisedVertex8 packed;
+			memcpy(&packed, in, sizeof(packed));
+			int normal[2] = { packed.normal[0], packed.normal[1] };
+			vertex.Pos = DequantisePosition(packed.position, compressed.quantisation);
+			vertex.Normal = DecodeOctahedral(normal, 8);
+			break;
+		}
+
+		default:
+			memcpy(&vertex, in, sizeof(vertex));
+			break;
+		}
+
+		in += compressed.stride;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshGeometry.h"
+
+using namespace DirectX;
+using namespace std;
+
+// Smaller ways of storing SimpleVertex, for meshes where fetching the vertices costs more than
+// transforming them. Positions are stored as 16-bit fractions of the mesh's bounding box, and
+// normals are folded onto an octahedron and stored as its two coordinates (Cigolle et al., "A
+// Survey of Efficient Representations for Independent Unit Vectors", 2014). Lighting.fx decodes
+// both in VSQuantised and VSInstancedQuantised.
+enum MeshVertexFormat
+{
+	// SimpleVertex as it is, 24 bytes
+	VERTEX_FORMAT_SIMPLE,
+	// QuantisedVertex12: 16-bit positions and 16-bit octahedral normals
+	VERTEX_FORMAT_QUANTISED_12,
+	// QuantisedVertex8: 16-bit positions and 8-bit octahedral normals
+	VERTEX_FORMAT_QUANTISED_8,
+	VERTEX_FORMAT_COUNT
+};
+
+// Read as R16G16_UNORM and R16_UNORM positions and an R16G16_SNORM normal. The padding keeps the
+// normal 4-byte aligned.
+struct QuantisedVertex12
+{
+	uint16_t position[3];
+	uint16_t pad;
+	int16_t normal[2];
+};
+
+// Read as R16G16_UNORM and R16_UNORM positions and an R8G8_SNORM normal
+struct QuantisedVertex8
+{
+	uint16_t position[3];
+	int8_t normal[2];
+};
+
+static_assert(sizeof(QuantisedVertex12) == 12, "QuantisedVertex12 must match its input layout");
+static_assert(sizeof(QuantisedVertex8) == 8, "QuantisedVertex8 must match its input layout");
+
+// Maps a quantised position back into the mesh's space: offset + q / 65535 * scale. The offset is
+// the bounding box's minimum and the scale its size.
+struct PositionQuantisation
+{
+	XMFLOAT3 offset;
+	XMFLOAT3 scale;
+};
+
+// The largest angles, in degrees, between a unit normal and what its octahedral encoding decodes
+// to, measured over a million normals by the vertexformats benchmark and rounded up. The encoder
+// tries the four nearest encodings and keeps the closest, which is what holds the error this low.
+static const float OCTAHEDRAL_16_ERROR_DEGREES = 0.008f;
+static const float OCTAHEDRAL_8_ERROR_DEGREES = 0.7f;
+
+size_t GetVertexStride(MeshVertexFormat format);
+
+PositionQuantisation GetPositionQuantisation(const vector<SimpleVertex>& vertices);
+
+// The furthest a dequantised position can be from the original, which is half a step on every axis
+float GetPositionErrorBound(const PositionQuantisation& quantisation);
+
+void QuantisePosition(const XMFLOAT3& position, const PositionQuantisation& quantisation, uint16_t quantised[3]);
+XMFLOAT3 DequantisePosition(const uint16_t quantised[3], const PositionQuantisation& quantisation);
+
+// Encodes a unit normal as two signed normalised integers of bits bits each, as a SNORM format
+// stores them, and decodes them the way the input assembler and Lighting.fx do
+void EncodeOctahedral(const XMFLOAT3& normal, int bits, int encoded[2]);
+XMFLOAT3 DecodeOctahedral(const int encoded[2], int bits);
+
+// A mesh's vertices in one of the formats, ready to upload to a vertex buffer
+struct CompressedVertices
+{
+	MeshVertexFormat format;
+	PositionQuantisation quantisation;
+	size_t stride;
+	size_t count;
+	vector<uint8_t> data;
+};
+
+void CompressVertices(const vector<SimpleVertex>& vertices, MeshVertexFormat format, CompressedVertices& compressed);
+
+// Decodes the vertices exactly as the GPU would, so the software rasteriser draws what it would
+void DecompressVertices(const CompressedVertices& compressed, vector<SimpleVertex>& vertices);
@@ -0,0 +1,53 @@
+#include "ViewController.h"
+
+// About what holding a key gave when each press stalled the frame for 16 ms
+const float ViewController::MOVE_SPEED = 60.0f;
+
+ViewController::ViewController()
+{
+	_upDown = 6.5f;
+	_leftRight = 0.0f;
+	_forwardBack = 0.0f;
+	_wireframe = false;
+	_showSolarSystem = false;
+}
+
+ViewController::~ViewController()
+{
+}
+
+void ViewController::Update(const InputSystem& input, float elapsedSeconds)
+{
+	float distance = MOVE_SPEED * elapsedSeconds;
+
+	// Up and down
+	if (input.IsKeyDown(KEY_W))
+		_upDown += distance;
+
+	if (input.IsKeyDown(KEY_S))
+		_upDown -= distance;
+
+	// Left and right
+	if (input.IsKeyDown(KEY_A))
+		_leftRight -= distance;
+
+	if (input.IsKeyDown(KEY_D))
+		_leftRight += distance;
+
+	// Back and forward
+	if (input.IsKeyDown(KEY_DOWN))
+		_forwardBack += distance;
+
+	if (input.IsKeyDown(KEY_UP))
+		_forwardBack -= distance;
+
+	// The toggles only change on the frame the key goes down
+	if (input.WasKeyPressed(KEY_RETURN))
+		_wireframe = !_wireframe;
+
+	if (input.WasKeyPressed(KEY_K))
+		_showSolarSystem = true;
+
+	if (input.WasKeyPressed(KEY_L))
+		_showSolarSystem = false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <directxmath.h>
+#include "InputSystem.h"
+
+using namespace DirectX;
+
+// Turns the keyboard into the application's view settings: the point the camera looks at, and
+// the wireframe and scene toggles. W and S move the point up and down, A and D left and right,
+// and the up and down arrows forward and back, at a fixed speed in units per second so the
+// camera moves as fast whatever the frame rate. Return toggles wireframe, K shows the solar
+// system and L the cubes and plane.
+class ViewController
+{
+private:
+	float _upDown;
+	float _leftRight;
+	float _forwardBack;
+	bool _wireframe;
+	bool _showSolarSystem;
+
+public:
+	// How far a held key moves the camera target each second
+	static const float MOVE_SPEED;
+
+	ViewController();
+	~ViewController();
+
+	void Update(const InputSystem& input, float elapsedSeconds);
+
+	XMVECTOR GetAt() const { return XMVectorSet(_leftRight, _upDown, _forwardBack, 0.0f); }
+	bool IsWireframe() const { return _wireframe; }
+	bool IsSolarSystemShown() const { return _showSolarSystem; }
+};